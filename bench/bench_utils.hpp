@@ -0,0 +1,54 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BENCH_UTILS_HPP
+#define BENCH_UTILS_HPP
+
+#include <chrono>       // for steady_clock, duration_cast
+#include <cstdint>      // for int32_t, uint64_t
+#include <string_view>  // for string_view
+
+#include <fmt/core.h>
+
+namespace bench {
+
+/// @brief Keep the compiler from optimizing away the computed value.
+template <typename T>
+inline void do_not_optimize(const T& value) noexcept {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// @brief Run the function for the given number of iterations, and print the mean time of one.
+template <typename F>
+void run_bench(std::string_view name, std::int32_t iterations, F&& func) noexcept {
+    // Warm up the caches and allocator first
+    func();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::int32_t i = 0; i < iterations; ++i) {
+        func();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    const auto mean_ns = static_cast<std::uint64_t>(elapsed.count()) / static_cast<std::uint64_t>(iterations);
+    fmt::print("{:<40} {:>12} ns/iter ({} iterations)\n", name, mean_ns, iterations);
+}
+
+}  // namespace bench
+
+#endif  // BENCH_UTILS_HPP
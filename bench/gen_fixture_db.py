@@ -0,0 +1,52 @@
+#! /usr/bin/env python3
+"""Generate the minimal sync db for the get_kernels benchmark.
+
+It's the tarball of '<pkgname>-<pkgver>/desc' entries, same as repo-add creates,
+but without the packages themselves, which repo-add would require.
+Usage: gen_fixture_db.py <output.db> [filler packages count]
+"""
+
+import io
+import sys
+import tarfile
+
+KERNELS = ["linux-cachyos", "linux-cachyos-bore", "linux-cachyos-lts", "linux-cachyos-rc", "linux", "linux-lts", "linux-zen"]
+COMPANION_SUFFIXES = ["-headers", "-zfs", "-nvidia", "-nvidia-open"]
+
+
+def make_desc(name, version):
+    fields = {
+        "FILENAME": f"{name}-{version}-x86_64.pkg.tar.zst",
+        "NAME": name,
+        "VERSION": version,
+        "DESC": f"{name} package",
+        "CSIZE": "1024",
+        "ISIZE": "4096",
+        "ARCH": "x86_64",
+    }
+    return "".join(f"%{key}%\n{value}\n\n" for key, value in fields.items()).encode()
+
+
+def main():
+    output_path = sys.argv[1]
+    filler_count = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+
+    packages = []
+    for kernel in KERNELS:
+        packages.append(kernel)
+        companions = COMPANION_SUFFIXES if kernel.startswith("linux-cachyos") else COMPANION_SUFFIXES[:1]
+        packages += [kernel + suffix for suffix in companions]
+    # The rest of the repo, which the scan has to skip
+    packages += [f"filler-pkg-{i}" for i in range(filler_count)]
+    packages.append("linux-api-headers")
+
+    with tarfile.open(output_path, "w:gz") as db:
+        for name in packages:
+            desc = make_desc(name, "6.10.1-1")
+            entry = tarfile.TarInfo(f"{name}-6.10.1-1/desc")
+            entry.size = len(desc)
+            db.addfile(entry, io.BytesIO(desc))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,88 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Benchmark of Kernel::get_kernels over the generated sync db (see gen_fixture_db.py).
+// Usage: get_kernels_bench <fixture.db> <work dir>
+
+#include "bench_utils.hpp"
+#include "kernel.hpp"
+
+#include <cstdlib>  // for setenv, exit
+
+#include <filesystem>  // for create_directories, copy_file, remove
+#include <string>      // for string
+
+#include <alpm.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+static constexpr std::string_view FIXTURE_REPO_NAME = "cachyos";
+
+// Fresh handle each time, the same as the reload after the transaction
+auto bench_get_kernels(const std::string& dbpath) noexcept -> std::size_t {
+    alpm_errno_t err{};
+    auto* handle = alpm_initialize("/", dbpath.c_str(), &err);
+    if (handle == nullptr) {
+        fmt::print(stderr, "failed to initialize alpm: {}\n", alpm_strerror(err));
+        std::exit(1);
+    }
+    alpm_register_syncdb(handle, FIXTURE_REPO_NAME.data(), 0);
+
+    const auto& kernels = Kernel::get_kernels(handle);
+    const auto kernels_count = kernels.size();
+    alpm_release(handle);
+    return kernels_count;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> std::int32_t {
+    static constexpr std::int32_t ITERATIONS = 50;
+
+    if (argc != 3) {
+        fmt::print(stderr, "Usage: {} <fixture.db> <work dir>\n", argv[0]);
+        return 2;
+    }
+
+    // The kernel index is written into the home, keep it in the work dir
+    const fs::path work_dir{argv[2]};
+    const auto& dbpath     = work_dir / "db";
+    const auto& index_path = work_dir / ".cache" / "cachyos-km" / "kernel-index";
+    fs::create_directories(dbpath / "sync");
+    fs::create_directories(index_path.parent_path());
+    fs::copy_file(argv[1], dbpath / "sync" / fmt::format("{}.db", FIXTURE_REPO_NAME), fs::copy_options::overwrite_existing);
+    ::setenv("HOME", work_dir.c_str(), 1);
+
+    // dbpath must end with slash, the same as pacman has it
+    const auto& dbpath_str = dbpath.string() + '/';
+    if (bench_get_kernels(dbpath_str) == 0) {
+        fmt::print(stderr, "no kernels found in the fixture\n");
+        return 1;
+    }
+
+    bench::run_bench("get_kernels (scan)", ITERATIONS, [&] {
+        std::error_code remove_err{};
+        fs::remove(index_path, remove_err);
+        bench::do_not_optimize(bench_get_kernels(dbpath_str));
+    });
+    bench::run_bench("get_kernels (cached index)", ITERATIONS, [&] {
+        bench::do_not_optimize(bench_get_kernels(dbpath_str));
+    });
+}
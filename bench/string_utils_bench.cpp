@@ -0,0 +1,63 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Benchmark of the string helpers, which are used for parsing of the command outputs and configs.
+
+#include "bench_utils.hpp"
+#include "string_utils.hpp"
+
+#include <string>  // for string
+#include <vector>  // for vector
+
+#include <fmt/format.h>
+
+namespace {
+
+// Similar to the output of pacman/chwd, which is split by lines
+auto make_sample_text(std::int32_t lines_count) noexcept -> std::string {
+    std::string text{};
+    for (std::int32_t i = 0; i < lines_count; ++i) {
+        text += fmt::format("linux-cachyos-{} 6.{}.{}-1 /usr/lib/modules/{}\n", i, i % 20, i % 7, i);
+    }
+    return text;
+}
+
+}  // namespace
+
+auto main() -> std::int32_t {
+    static constexpr std::int32_t ITERATIONS = 2000;
+
+    const auto& sample_text = make_sample_text(500);
+
+    bench::run_bench("make_multiline (500 lines)", ITERATIONS, [&] {
+        bench::do_not_optimize(utils::make_multiline(sample_text));
+    });
+    bench::run_bench("make_multiline_view (500 lines)", ITERATIONS, [&] {
+        bench::do_not_optimize(utils::make_multiline_view(sample_text));
+    });
+    bench::run_bench("replace_all (500 matches)", ITERATIONS, [&] {
+        auto text = sample_text;
+        bench::do_not_optimize(utils::replace_all(text, "/usr/lib/modules/", "/lib/modules/"));
+        bench::do_not_optimize(text);
+    });
+
+    auto lines = utils::make_multiline_view(sample_text);
+    bench::run_bench("join_vec (500 lines)", ITERATIONS, [&] {
+        bench::do_not_optimize(utils::join_vec(lines, "\n"));
+    });
+}
@@ -51,6 +51,22 @@ mod ffi {
 
         pub cpu_opt_combo: String,
         pub custom_name_edit: String,
+
+        pub build_jobs_spin: u32,
+        pub build_load_limit_spin: u32,
+        pub build_memory_limit_spin: u32,
+        pub build_cpu_affinity_edit: String,
+        pub build_low_priority_check: bool,
+        pub compiler_cache_check: bool,
+
+        pub tunables_thp_combo: String,
+        pub tunables_preempt_combo: String,
+        pub tunables_nohz_full_edit: String,
+        pub tunables_isolcpus_edit: String,
+        pub tunables_swappiness_edit: String,
+        pub tunables_dirty_ratio_edit: String,
+        pub tunables_dirty_background_ratio_edit: String,
+        pub tunables_vfs_cache_pressure_edit: String,
     }
 
     extern "Rust" {
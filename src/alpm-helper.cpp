@@ -0,0 +1,134 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Privileged part of the kernel manager, which is started via pkexec.
+// Usage: alpm-helper [--prefetched] [--install <pkg>...] [--remove <pkg>...]
+// Progress is printed to stdout, in format of utils::format_progress_line.
+
+#include "alpm_transaction.hpp"
+
+#include <cstdio>   // for fflush
+#include <cstdlib>  // for getenv
+
+#include <algorithm>  // for all_of
+#include <charconv>   // for from_chars
+#include <optional>   // for optional
+#include <span>       // for span
+
+#include <pwd.h>     // for getpwuid
+#include <unistd.h>  // for geteuid
+
+#include <fmt/core.h>
+
+namespace {
+
+static constexpr std::int32_t EXIT_CODE_OK      = 0;
+static constexpr std::int32_t EXIT_CODE_FAILURE = 1;
+static constexpr std::int32_t EXIT_CODE_USAGE   = 2;
+
+// The helper is reachable by pkexec, so we accept only valid package names
+constexpr bool is_valid_pkg_name(std::string_view pkg_name) noexcept {
+    constexpr auto is_valid_char = [](char ch) {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')
+            || ch == '@' || ch == '.' || ch == '_' || ch == '+' || ch == '-';
+    };
+    return !pkg_name.empty() && pkg_name.front() != '-' && pkg_name.front() != '.'
+        && std::ranges::all_of(pkg_name, is_valid_char);
+}
+
+// Set by pkexec, or by sudo on the CLI path. Nothing is set, when root runs the helper directly.
+auto get_invoking_uid() noexcept -> std::optional<std::uint32_t> {
+    for (const auto* env_name : {"PKEXEC_UID", "SUDO_UID"}) {
+        const auto* env_value = std::getenv(env_name);
+        /* clang-format off */
+        if (env_value == nullptr) { continue; }
+        /* clang-format on */
+        const std::string_view uid_str{env_value};
+        std::uint32_t uid{};
+        if (auto [ptr, ec] = std::from_chars(uid_str.data(), uid_str.data() + uid_str.size(), uid); ec == std::errc{} && ptr == uid_str.data() + uid_str.size()) {
+            return uid;
+        }
+    }
+    return std::nullopt;
+}
+
+// Same dir as get_prefetch_cache_dir of the GUI, it's never taken from the arguments
+auto get_prefetch_dir(std::uint32_t uid) noexcept -> std::optional<std::string> {
+    const auto* pw = ::getpwuid(uid);
+    /* clang-format off */
+    if (pw == nullptr || pw->pw_dir == nullptr) { return std::nullopt; }
+    /* clang-format on */
+    return std::string{pw->pw_dir} + "/.cache/cachyos-km/pkg";
+}
+
+auto parse_targets(std::span<char*> args, utils::TransactionTargets& targets, bool& has_prefetched) noexcept -> bool {
+    std::vector<std::string>* current_list{};
+    for (const std::string_view arg : args) {
+        if (arg == "--prefetched") {
+            has_prefetched = true;
+        } else if (arg == "--install") {
+            current_list = &targets.install;
+        } else if (arg == "--remove") {
+            current_list = &targets.remove;
+        } else if (current_list != nullptr && is_valid_pkg_name(arg)) {
+            current_list->emplace_back(arg);
+        } else {
+            fmt::print(stderr, "[ALPM] invalid argument: '{}'\n", arg);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> std::int32_t {
+    utils::TransactionTargets targets{};
+    bool has_prefetched{};
+    if (!parse_targets(std::span{argv + 1, static_cast<std::size_t>(argc - 1)}, targets, has_prefetched)) {
+        fmt::print(stderr, "Usage: {} [--prefetched] [--install <pkg>...] [--remove <pkg>...]\n", argv[0]);
+        return EXIT_CODE_USAGE;
+    }
+    if (::geteuid() != 0) {
+        fmt::print(stderr, "[ALPM] the helper must be run as root\n");
+        return EXIT_CODE_FAILURE;
+    }
+
+    alpm_errno_t err{};
+    auto* handle = utils::init_alpm_for_transaction(&err);
+    if (handle == nullptr) {
+        fmt::print(stderr, "[ALPM] failed to initialize alpm handle: {}\n", alpm_strerror(err));
+        return EXIT_CODE_FAILURE;
+    }
+
+    if (has_prefetched && !targets.install.empty()) {
+        const auto& uid          = get_invoking_uid();
+        const auto& prefetch_dir = uid ? get_prefetch_dir(*uid) : std::nullopt;
+        if (prefetch_dir) {
+            utils::import_prefetched_packages(handle, targets.install, *prefetch_dir, *uid);
+        }
+    }
+
+    const bool is_success = utils::run_alpm_transaction(handle, targets, [](const utils::TransactionProgress& progress) {
+        fmt::print("{}\n", utils::format_progress_line(progress));
+        std::fflush(stdout);
+    });
+    alpm_release(handle);
+
+    return is_success ? EXIT_CODE_OK : EXIT_CODE_FAILURE;
+}
@@ -0,0 +1,548 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "alpm_transaction.hpp"
+#include "pacman_config.hpp"
+#include "string_utils.hpp"
+
+#include <cerrno>   // for errno
+#include <cstdio>   // for vsnprintf, rename
+#include <cstdlib>  // for free
+#include <cstring>  // for strerror
+
+#include <algorithm>  // for max, any_of
+#include <array>      // for array
+
+#include <fcntl.h>         // for open, O_RDONLY, O_NOFOLLOW
+#include <sys/sendfile.h>  // for sendfile
+#include <sys/stat.h>      // for fstat, lstat
+#include <unistd.h>        // for close, unlink
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+namespace {
+
+static constexpr auto PACMAN_ROOT_PATH       = "/";
+static constexpr auto PACMAN_DB_PATH         = "/var/lib/pacman/";
+static constexpr auto PACMAN_CACHE_PATH      = "/var/cache/pacman/pkg/";
+static constexpr auto PACMAN_GPG_PATH        = "/etc/pacman.d/gnupg/";
+static constexpr auto PACMAN_LOG_PATH        = "/var/log/pacman.log";
+static constexpr auto SYSTEM_HOOKS_PATH      = "/usr/share/libalpm/hooks/";
+static constexpr auto USER_HOOKS_PATH        = "/etc/pacman.d/hooks/";
+static constexpr auto PROGRESS_LINE_TAG      = std::string_view{"progress"};
+// NOTE: RECURSE is resolved by libalpm only for removal-only transactions, see add_unneeded_deps.
+// NOSAVE is checked on removal of the files, so it's honored by both.
+static constexpr auto TRANSACTION_SYNC_FLAGS = ALPM_TRANS_FLAG_NEEDED | ALPM_TRANS_FLAG_RECURSE | ALPM_TRANS_FLAG_NOSAVE;
+
+constexpr auto trim(std::string_view str) noexcept -> std::string_view {
+    constexpr std::string_view whitespace = " \t\r\n";
+
+    const auto first = str.find_first_not_of(whitespace);
+    /* clang-format off */
+    if (first == std::string_view::npos) { return {}; }
+    /* clang-format on */
+    const auto last = str.find_last_not_of(whitespace);
+    return str.substr(first, last - first + 1);
+}
+
+// Context of the running transaction, which is passed into callbacks
+struct TransactionContext {
+    const utils::transaction_progress_cb_t& on_progress;
+    std::int32_t last_percent{-1};
+    std::string last_message{};
+
+    void report(std::int32_t percent, std::string message) noexcept {
+        // libalpm reports progress per file, which would flood the UI otherwise
+        /* clang-format off */
+        if (percent == last_percent && message == last_message) { return; }
+        /* clang-format on */
+        last_percent = percent;
+        last_message = message;
+        if (on_progress) {
+            on_progress(utils::TransactionProgress{.percent = percent, .message = std::move(message)});
+        }
+    }
+};
+
+constexpr auto get_progress_name(alpm_progress_t progress) noexcept -> std::string_view {
+    switch (progress) {
+    case ALPM_PROGRESS_ADD_START:
+        return "installing";
+    case ALPM_PROGRESS_UPGRADE_START:
+        return "upgrading";
+    case ALPM_PROGRESS_DOWNGRADE_START:
+        return "downgrading";
+    case ALPM_PROGRESS_REINSTALL_START:
+        return "reinstalling";
+    case ALPM_PROGRESS_REMOVE_START:
+        return "removing";
+    case ALPM_PROGRESS_CONFLICTS_START:
+        return "checking for file conflicts";
+    case ALPM_PROGRESS_DISKSPACE_START:
+        return "checking available disk space";
+    case ALPM_PROGRESS_INTEGRITY_START:
+        return "checking package integrity";
+    case ALPM_PROGRESS_LOAD_START:
+        return "loading package files";
+    case ALPM_PROGRESS_KEYRING_START:
+        return "checking keys in keyring";
+    }
+    return "processing";
+}
+
+void on_alpm_progress(void* ctx, alpm_progress_t progress, const char* pkgname, int percent, size_t howmany, size_t current) noexcept {
+    auto* context = static_cast<TransactionContext*>(ctx);
+
+    // overall progress of the step over all packages
+    const auto total   = std::max<size_t>(howmany, 1);
+    const auto overall = static_cast<std::int32_t>(((std::max<size_t>(current, 1) - 1) * 100 + static_cast<size_t>(percent)) / total);
+
+    const auto& progress_name = get_progress_name(progress);
+    if (pkgname == nullptr || pkgname[0] == '\0') {
+        context->report(overall, std::string{progress_name});
+        return;
+    }
+    context->report(overall, fmt::format(FMT_COMPILE("{} {} ({}/{})"), progress_name, pkgname, current, howmany));
+}
+
+void on_alpm_event(void* ctx, alpm_event_t* event) noexcept {
+    auto* context = static_cast<TransactionContext*>(ctx);
+    switch (event->type) {
+    case ALPM_EVENT_CHECKDEPS_START:
+        context->report(-1, "checking dependencies");
+        break;
+    case ALPM_EVENT_PKG_RETRIEVE_START:
+        context->report(-1, "retrieving packages");
+        break;
+    case ALPM_EVENT_TRANSACTION_START:
+        context->report(-1, "processing package changes");
+        break;
+    case ALPM_EVENT_HOOK_RUN_START: {
+        const auto& hook_run = event->hook_run;
+        const auto* hook_name = (hook_run.desc != nullptr) ? hook_run.desc : hook_run.name;
+
+        const auto percent = static_cast<std::int32_t>(hook_run.position * 100 / std::max<size_t>(hook_run.total, 1));
+        context->report(percent, fmt::format(FMT_COMPILE("running hook ({}/{}): {}"), hook_run.position, hook_run.total, hook_name));
+        break;
+    }
+    case ALPM_EVENT_SCRIPTLET_INFO:
+        context->report(-1, std::string{trim(event->scriptlet_info.line)});
+        break;
+    default:
+        break;
+    }
+}
+
+// The same answers, which 'pacman --noconfirm' gives
+void on_alpm_question(void* /*ctx*/, alpm_question_t* question) noexcept {
+    switch (question->type) {
+    case ALPM_QUESTION_INSTALL_IGNOREPKG:  // install ignored package
+    case ALPM_QUESTION_REPLACE_PKG:        // replace package
+    case ALPM_QUESTION_CORRUPTED_PKG:      // delete corrupted package
+    case ALPM_QUESTION_IMPORT_KEY:         // import PGP key
+        question->any.answer = 1;
+        break;
+    case ALPM_QUESTION_SELECT_PROVIDER:
+        question->select_provider.use_index = 0;
+        break;
+    default:
+        question->any.answer = 0;
+        break;
+    }
+}
+
+void on_alpm_download(void* ctx, const char* filename, alpm_download_event_type_t event, void* data) noexcept {
+    /* clang-format off */
+    if (event != ALPM_DOWNLOAD_PROGRESS) { return; }
+    /* clang-format on */
+    auto* context        = static_cast<TransactionContext*>(ctx);
+    const auto* progress = static_cast<alpm_download_event_progress_t*>(data);
+    /* clang-format off */
+    if (progress->total <= 0) { return; }
+    /* clang-format on */
+
+    const auto percent = static_cast<std::int32_t>(progress->downloaded * 100 / progress->total);
+    context->report(percent, fmt::format(FMT_COMPILE("downloading {}"), filename));
+}
+
+void on_alpm_log(void* ctx, alpm_loglevel_t level, const char* fmt, va_list args) noexcept {
+    /* clang-format off */
+    if ((level & (ALPM_LOG_ERROR | ALPM_LOG_WARNING)) == 0) { return; }
+    /* clang-format on */
+    auto* context = static_cast<TransactionContext*>(ctx);
+
+    std::array<char, 1024> buf{};
+    std::vsnprintf(buf.data(), buf.size(), fmt, args);
+    context->report(-1, fmt::format(FMT_COMPILE("{}: {}"), (level & ALPM_LOG_ERROR) ? "error" : "warning", trim(buf.data())));
+}
+
+void register_sync_repos(alpm_handle_t* handle, const utils::PacmanConfig& config) noexcept {
+    for (const auto& repo : config.repos) {
+        auto* db = alpm_register_syncdb(handle, repo.name.c_str(), repo.siglevel);
+        /* clang-format off */
+        if (db == nullptr) { continue; }
+        /* clang-format on */
+        for (const auto& server : repo.servers) {
+            alpm_db_add_server(db, server.c_str());
+        }
+    }
+}
+
+auto find_sync_pkg(alpm_handle_t* handle, const std::string& pkg_name) noexcept -> alpm_pkg_t* {
+    for (auto* it = alpm_get_syncdbs(handle); it != nullptr; it = it->next) {
+        if (auto* pkg = alpm_db_get_pkg(static_cast<alpm_db_t*>(it->data), pkg_name.c_str()); pkg != nullptr) {
+            return pkg;
+        }
+    }
+    return nullptr;
+}
+
+// Whether any of the packages depends on the package.
+bool is_dep_of_any(alpm_pkg_t* pkg, alpm_list_t* pkgs) noexcept {
+    auto* pkg_list   = alpm_list_add(nullptr, pkg);
+    bool is_required = false;
+    for (auto* it = pkgs; it != nullptr && !is_required; it = it->next) {
+        for (auto* dep_it = alpm_pkg_get_depends(static_cast<alpm_pkg_t*>(it->data)); dep_it != nullptr && !is_required; dep_it = dep_it->next) {
+            char* dep_str = alpm_dep_compute_string(static_cast<alpm_depend_t*>(dep_it->data));
+            is_required   = (alpm_find_satisfier(pkg_list, dep_str) != nullptr);
+            std::free(dep_str);
+        }
+    }
+    alpm_list_free(pkg_list);
+    return is_required;
+}
+
+// With install targets libalpm takes the sync path, which never resolves RECURSE for the removals.
+// So deps of the removed packages are collected the same way as pacman -Rs does:
+// installed as a dependency and not required by anything, which stays or is being installed.
+bool add_unneeded_deps(alpm_handle_t* handle) noexcept {
+    auto* local_pkgs = alpm_db_get_pkgcache(alpm_get_localdb(handle));
+    auto* add_pkgs   = alpm_trans_get_add(handle);
+
+    std::vector<alpm_pkg_t*> removals{};
+    for (auto* it = alpm_trans_get_remove(handle); it != nullptr; it = it->next) {
+        removals.push_back(static_cast<alpm_pkg_t*>(it->data));
+    }
+    const auto& is_removed = [&](std::string_view pkg_name) {
+        return std::ranges::any_of(removals, [pkg_name](auto* pkg) { return pkg_name == alpm_pkg_get_name(pkg); });
+    };
+    const auto& is_required_by_others = [&](alpm_pkg_t* pkg) {
+        auto* required_by = alpm_pkg_compute_requiredby(pkg);
+        bool is_required  = false;
+        for (auto* it = required_by; it != nullptr && !is_required; it = it->next) {
+            is_required = !is_removed(static_cast<const char*>(it->data));
+        }
+        alpm_list_free_inner(required_by, std::free);
+        alpm_list_free(required_by);
+        return is_required;
+    };
+
+    // New deps are appended, so their own deps are visited as well
+    for (std::size_t i = 0; i < removals.size(); ++i) {
+        for (auto* dep_it = alpm_pkg_get_depends(removals[i]); dep_it != nullptr; dep_it = dep_it->next) {
+            char* dep_str = alpm_dep_compute_string(static_cast<alpm_depend_t*>(dep_it->data));
+            auto* dep_pkg = alpm_find_satisfier(local_pkgs, dep_str);
+            std::free(dep_str);
+
+            /* clang-format off */
+            if (dep_pkg == nullptr || alpm_pkg_get_reason(dep_pkg) != ALPM_PKG_REASON_DEPEND) { continue; }
+            if (is_removed(alpm_pkg_get_name(dep_pkg)) || is_required_by_others(dep_pkg) || is_dep_of_any(dep_pkg, add_pkgs)) { continue; }
+            /* clang-format on */
+            if (alpm_remove_pkg(handle, dep_pkg) != 0) {
+                return false;
+            }
+            removals.push_back(dep_pkg);
+        }
+    }
+    return true;
+}
+
+// The dir is writable by the user, so the file is opened without following symlinks,
+// and it's copied as a whole under the temporary name, the commit never sees a partial file.
+bool copy_user_file(const std::string& src_path, const std::string& dst_path, std::uint32_t owner_uid) noexcept {
+    const auto src_fd = ::open(src_path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    /* clang-format off */
+    if (src_fd == -1) { return false; }
+    /* clang-format on */
+
+    struct stat src_stat{};
+    if (::fstat(src_fd, &src_stat) != 0 || !S_ISREG(src_stat.st_mode) || src_stat.st_uid != owner_uid) {
+        ::close(src_fd);
+        return false;
+    }
+
+    const auto& part_path = dst_path + ".part";
+    const auto dst_fd     = ::open(part_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (dst_fd == -1) {
+        fmt::print(stderr, "[ALPM] failed to create '{}': {}\n", part_path, std::strerror(errno));
+        ::close(src_fd);
+        return false;
+    }
+
+    bool is_copied{true};
+    for (off_t offset{}; offset < src_stat.st_size;) {
+        if (::sendfile(dst_fd, src_fd, &offset, static_cast<std::size_t>(src_stat.st_size - offset)) <= 0) {
+            is_copied = false;
+            break;
+        }
+    }
+    is_copied = (::close(dst_fd) == 0) && is_copied;
+    ::close(src_fd);
+
+    if (!is_copied || std::rename(part_path.c_str(), dst_path.c_str()) != 0) {
+        fmt::print(stderr, "[ALPM] failed to copy '{}': {}\n", src_path, std::strerror(errno));
+        ::unlink(part_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+namespace utils {
+
+auto init_alpm_for_transaction(alpm_errno_t* err) noexcept -> alpm_handle_t* {
+    alpm_handle_t* handle = alpm_initialize(PACMAN_ROOT_PATH, PACMAN_DB_PATH, err);
+    /* clang-format off */
+    if (handle == nullptr) { return nullptr; }
+    /* clang-format on */
+
+    const auto& config = get_pacman_config();
+
+    for (const auto& cache_dir : config->cache_dirs) {
+        alpm_option_add_cachedir(handle, cache_dir.c_str());
+    }
+    if (config->cache_dirs.empty()) {
+        alpm_option_add_cachedir(handle, PACMAN_CACHE_PATH);
+    }
+    // system hooks go first, same as in pacman
+    alpm_option_add_hookdir(handle, SYSTEM_HOOKS_PATH);
+    for (const auto& hook_dir : config->hook_dirs) {
+        alpm_option_add_hookdir(handle, hook_dir.c_str());
+    }
+    if (config->hook_dirs.empty()) {
+        alpm_option_add_hookdir(handle, USER_HOOKS_PATH);
+    }
+    alpm_option_set_gpgdir(handle, config->gpg_dir.empty() ? PACMAN_GPG_PATH : config->gpg_dir.c_str());
+    alpm_option_set_logfile(handle, config->log_file.empty() ? PACMAN_LOG_PATH : config->log_file.c_str());
+    alpm_option_set_default_siglevel(handle, config->siglevel);
+    alpm_option_set_local_file_siglevel(handle, ALPM_SIG_USE_DEFAULT);
+    alpm_option_set_remote_file_siglevel(handle, ALPM_SIG_USE_DEFAULT);
+    alpm_option_set_parallel_downloads(handle, config->parallel_downloads);
+    register_sync_repos(handle, *config);
+
+    return handle;
+}
+
+auto prefetch_packages(std::span<const std::string> pkg_names, std::string_view cache_dir) noexcept -> std::int32_t {
+    alpm_errno_t err{};
+    alpm_handle_t* handle = alpm_initialize(PACMAN_ROOT_PATH, PACMAN_DB_PATH, &err);
+    if (handle == nullptr) {
+        fmt::print(stderr, "[ALPM] failed to initialize alpm handle: {}\n", alpm_strerror(err));
+        return -1;
+    }
+
+    // Ours goes first, so it's the one being written to. Packages in the cache of pacman aren't fetched again
+    const auto& config = get_pacman_config();
+    alpm_option_add_cachedir(handle, std::string{cache_dir}.c_str());
+    for (const auto& system_cache_dir : config->cache_dirs) {
+        alpm_option_add_cachedir(handle, system_cache_dir.c_str());
+    }
+    if (config->cache_dirs.empty()) {
+        alpm_option_add_cachedir(handle, PACMAN_CACHE_PATH);
+    }
+    // Signatures of sync packages are in the db, they are verified by the transaction, which uses the files
+    alpm_option_set_default_siglevel(handle, 0);
+    alpm_option_set_remote_file_siglevel(handle, 0);
+    alpm_option_set_parallel_downloads(handle, config->parallel_downloads);
+    register_sync_repos(handle, *config);
+
+    auto* localdb = alpm_get_localdb(handle);
+
+    std::vector<std::string> urls{};
+    for (const auto& pkg_name : pkg_names) {
+        auto* pkg = find_sync_pkg(handle, pkg_name);
+        /* clang-format off */
+        if (pkg == nullptr) { continue; }
+        /* clang-format on */
+
+        // The transaction skips it anyway (see ALPM_TRANS_FLAG_NEEDED)
+        auto* local_pkg = alpm_db_get_pkg(localdb, pkg_name.c_str());
+        if (local_pkg != nullptr && alpm_pkg_vercmp(alpm_pkg_get_version(local_pkg), alpm_pkg_get_version(pkg)) == 0) {
+            continue;
+        }
+
+        // Mirror fallback is left to the transaction, it downloads whatever has failed here
+        const auto* servers = alpm_db_get_servers(alpm_pkg_get_db(pkg));
+        /* clang-format off */
+        if (servers == nullptr) { continue; }
+        /* clang-format on */
+        urls.emplace_back(fmt::format(FMT_COMPILE("{}/{}"), static_cast<const char*>(servers->data), alpm_pkg_get_filename(pkg)));
+    }
+
+    std::int32_t fetched_count{};
+    if (!urls.empty()) {
+        alpm_list_t* url_list{};
+        for (auto& url : urls) {
+            url_list = alpm_list_add(url_list, url.data());
+        }
+
+        // All of them are fetched at once, in ParallelDownloads connections
+        alpm_list_t* fetched_list{};
+        if (alpm_fetch_pkgurl(handle, url_list, &fetched_list) != 0) {
+            fmt::print(stderr, "[ALPM] failed to prefetch packages: {}\n", alpm_strerror(alpm_errno(handle)));
+            fetched_count = -1;
+        } else {
+            fetched_count = static_cast<std::int32_t>(alpm_list_count(fetched_list));
+        }
+        alpm_list_free_inner(fetched_list, std::free);
+        alpm_list_free(fetched_list);
+        alpm_list_free(url_list);
+    }
+
+    alpm_release(handle);
+    return fetched_count;
+}
+
+auto import_prefetched_packages(alpm_handle_t* handle, std::span<const std::string> pkg_names, const std::string& prefetch_dir, std::uint32_t owner_uid) noexcept -> std::int32_t {
+    struct stat dir_stat{};
+    if (::lstat(prefetch_dir.c_str(), &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode) || dir_stat.st_uid != owner_uid) {
+        fmt::print(stderr, "[ALPM] ignoring prefetched packages in '{}', the dir isn't owned by the user\n", prefetch_dir);
+        return 0;
+    }
+
+    // New downloads go there as well, pacman keeps them, so does the transaction
+    const auto* cache_dirs = alpm_option_get_cachedirs(handle);
+    /* clang-format off */
+    if (cache_dirs == nullptr) { return 0; }
+    /* clang-format on */
+    const std::string system_cache_dir{static_cast<const char*>(cache_dirs->data)};
+
+    std::int32_t imported_count{};
+    for (const auto& pkg_name : pkg_names) {
+        auto* pkg = find_sync_pkg(handle, pkg_name);
+        /* clang-format off */
+        if (pkg == nullptr) { continue; }
+        /* clang-format on */
+
+        // cachedirs end with the slash
+        const std::string_view filename{alpm_pkg_get_filename(pkg)};
+        const auto& dst_path = fmt::format(FMT_COMPILE("{}{}"), system_cache_dir, filename);
+        struct stat dst_stat{};
+        if (::lstat(dst_path.c_str(), &dst_stat) == 0) {
+            continue;
+        }
+        const auto& src_path = fmt::format(FMT_COMPILE("{}/{}"), prefetch_dir, filename);
+        if (copy_user_file(src_path, dst_path, owner_uid)) {
+            copy_user_file(src_path + ".sig", dst_path + ".sig", owner_uid);
+            ++imported_count;
+        }
+    }
+    return imported_count;
+}
+
+bool run_alpm_transaction(alpm_handle_t* handle, const TransactionTargets& targets, const transaction_progress_cb_t& on_progress) noexcept {
+    TransactionContext context{.on_progress = on_progress};
+
+    const auto& report_error = [&](std::string_view what) {
+        context.report(-1, fmt::format(FMT_COMPILE("error: {}: {}"), what, alpm_strerror(alpm_errno(handle))));
+        return false;
+    };
+
+    alpm_option_set_logcb(handle, on_alpm_log, &context);
+    alpm_option_set_progresscb(handle, on_alpm_progress, &context);
+    alpm_option_set_eventcb(handle, on_alpm_event, &context);
+    alpm_option_set_questioncb(handle, on_alpm_question, &context);
+    alpm_option_set_dlcb(handle, on_alpm_download, &context);
+
+    if (alpm_trans_init(handle, TRANSACTION_SYNC_FLAGS) != 0) {
+        return report_error("failed to init transaction");
+    }
+    const auto& release_with = [&](bool is_success) {
+        alpm_trans_release(handle);
+        return is_success;
+    };
+
+    for (const auto& pkg_name : targets.install) {
+        auto* pkg = find_sync_pkg(handle, pkg_name);
+        if (pkg == nullptr) {
+            context.report(-1, fmt::format(FMT_COMPILE("error: target not found: {}"), pkg_name));
+            return release_with(false);
+        }
+        if (alpm_add_pkg(handle, pkg) != 0) {
+            return release_with(report_error(pkg_name));
+        }
+    }
+
+    auto* localdb = alpm_get_localdb(handle);
+    for (const auto& pkg_name : targets.remove) {
+        auto* pkg = alpm_db_get_pkg(localdb, pkg_name.c_str());
+        /* clang-format off */
+        if (pkg == nullptr) { continue; }
+        /* clang-format on */
+        if (alpm_remove_pkg(handle, pkg) != 0) {
+            return release_with(report_error(pkg_name));
+        }
+    }
+    if (!targets.install.empty() && !targets.remove.empty() && !add_unneeded_deps(handle)) {
+        return release_with(report_error("failed to add unneeded dependencies"));
+    }
+
+    // NOTE: the elements of data are owned by the caller, but the helper exits
+    // right after the transaction, so we release only the list itself.
+    alpm_list_t* data{};
+    if (alpm_trans_prepare(handle, &data) != 0) {
+        alpm_list_free(data);
+        return release_with(report_error("failed to prepare transaction"));
+    }
+
+    if (alpm_trans_get_add(handle) == nullptr && alpm_trans_get_remove(handle) == nullptr) {
+        context.report(-1, "there is nothing to do");
+        return release_with(true);
+    }
+
+    if (alpm_trans_commit(handle, &data) != 0) {
+        alpm_list_free(data);
+        return release_with(report_error("failed to commit transaction"));
+    }
+    return release_with(true);
+}
+
+auto format_progress_line(const TransactionProgress& progress) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}\t{}\t{}"), PROGRESS_LINE_TAG, progress.percent, progress.message);
+}
+
+auto parse_progress_line(std::string_view line) noexcept -> std::optional<TransactionProgress> {
+    const auto& parts = utils::make_multiline_view(line, '\t');
+    /* clang-format off */
+    if (parts.size() < 2 || parts[0] != PROGRESS_LINE_TAG) { return std::nullopt; }
+    /* clang-format on */
+
+    const auto percent_str = std::string{parts[1]};
+    TransactionProgress progress{.percent = static_cast<std::int32_t>(std::strtol(percent_str.c_str(), nullptr, 10))};
+
+    // message starts right after the second tab, it may contain tabs as well
+    const auto msg_pos = line.find('\t', PROGRESS_LINE_TAG.size() + 1);
+    if (msg_pos != std::string_view::npos) {
+        progress.message = line.substr(msg_pos + 1);
+    }
+    return progress;
+}
+
+}  // namespace utils
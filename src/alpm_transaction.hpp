@@ -0,0 +1,101 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef ALPM_TRANSACTION_HPP
+#define ALPM_TRANSACTION_HPP
+
+#include <cstdint>      // for int32_t
+#include <functional>   // for function
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#include <alpm.h>
+
+namespace utils {
+
+/// Location of the privileged helper, which runs the transaction.
+inline constexpr std::string_view ALPM_HELPER_PATH = "/usr/lib/cachyos-kernel-manager/alpm-helper";
+
+/// Packages to install and to remove within the single transaction.
+struct TransactionTargets {
+    std::vector<std::string> install{};
+    std::vector<std::string> remove{};
+};
+
+/// State of the running transaction (e.g 'installing linux-cachyos').
+struct TransactionProgress {
+    /// Progress of the current step in percents, or -1 if it's just a message.
+    std::int32_t percent{-1};
+    std::string message{};
+};
+using transaction_progress_cb_t = std::function<void(const TransactionProgress&)>;
+
+/// Outcome of the transaction, run by the helper.
+struct TransactionResult {
+    bool is_success{true};
+    /// What has failed, to be shown to the user.
+    std::string err_msg{};
+};
+
+/// @brief Create alpm handle, which is able to commit transactions.
+/// Unlike parse_alpm, it sets up servers, cache/hook/gpg directories and
+/// the log file from pacman.conf, the same way pacman does.
+/// @param err The error code, if handle couldn't be created.
+/// @return The handle, or nullptr on failure.
+auto init_alpm_for_transaction(alpm_errno_t* err) noexcept -> alpm_handle_t*;
+
+/// @brief Download packages from the sync repos into the cache dir, in ParallelDownloads connections.
+/// Doesn't need root, so it can run in the background, while the user is still choosing the kernels.
+/// Packages, which are cached by pacman already or installed with the same version, are skipped.
+/// @param pkg_names Names of the sync packages, unknown ones are skipped.
+/// @param cache_dir The dir to download to, it must exist. The helper imports from it (see import_prefetched_packages).
+/// @return Number of the packages, which are in the cache now, or -1 if any download has failed.
+auto prefetch_packages(std::span<const std::string> pkg_names, std::string_view cache_dir) noexcept -> std::int32_t;
+
+/// @brief Copy the prefetched files of the install targets into the first cache dir of pacman. Requires root.
+/// The transaction then verifies them like any other cached package, and pacman keeps them afterwards,
+/// so they are still there for reinstalls and downgrades.
+/// Only regular files of the target sync packages are copied, the dir must be owned by the uid and not be a symlink.
+/// @param handle The handle from init_alpm_for_transaction.
+/// @param pkg_names Names of the install targets.
+/// @param prefetch_dir The dir, which was passed to prefetch_packages by the user.
+/// @param owner_uid The user, who has started the helper.
+/// @return Number of the copied packages.
+auto import_prefetched_packages(alpm_handle_t* handle, std::span<const std::string> pkg_names, const std::string& prefetch_dir, std::uint32_t owner_uid) noexcept -> std::int32_t;
+
+/// @brief Install and remove packages in the single transaction.
+/// That way the hooks (e.g mkinitcpio, dkms) run only once. Requires root.
+/// @param handle The handle from init_alpm_for_transaction.
+/// @param targets The packages. Already installed packages are skipped.
+/// @param on_progress The callback, which receives progress of the transaction.
+/// @return True if the transaction was committed, or there was nothing to do.
+bool run_alpm_transaction(alpm_handle_t* handle, const TransactionTargets& targets, const transaction_progress_cb_t& on_progress) noexcept;
+
+/// @brief Serialize the progress into line of the helper output.
+auto format_progress_line(const TransactionProgress& progress) noexcept -> std::string;
+
+/// @brief Parse the line of the helper output.
+/// @return The progress, or nullopt if the line isn't a progress report.
+auto parse_progress_line(std::string_view line) noexcept -> std::optional<TransactionProgress>;
+
+}  // namespace utils
+
+#endif  // ALPM_TRANSACTION_HPP
@@ -17,30 +17,40 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "alpm_utils.hpp"
-#include "ini.hpp"
+#include "pacman_config.hpp"
+#include "trace.hpp"
+
+#include <filesystem>  // for directory_iterator
+
+#include <fmt/core.h>
 
 namespace utils {
 
 alpm_handle_t* parse_alpm(std::string_view root, std::string_view dbpath, alpm_errno_t* err) noexcept {
+    const trace::Span trace_span{"parse_alpm"};
+
     // Initialize alpm.
     alpm_handle_t* alpm_handle = alpm_initialize(root.data(), dbpath.data(), err);
+    /* clang-format off */
+    if (alpm_handle == nullptr) { return nullptr; }
+    /* clang-format on */
 
-    // Parse pacman config.
-    static constexpr auto pacman_conf_path = "/etc/pacman.conf";
-    static constexpr auto ignored_repo     = "testing";
-
-    const mINI::INIFile file(pacman_conf_path);
-    // next, create a structure that will hold data
-    mINI::INIStructure ini;
+    // Parse pacman config, it's parsed again only once it has changed.
+    static constexpr std::string_view ignored_repo = "testing";
 
-    // now we can read the file
-    file.read(ini);
-    for (const auto& it : ini) {
-        const auto& section = it.first;
-        if (section == ignored_repo || section == "options") {
+    const auto& config = get_pacman_config();
+    alpm_option_set_default_siglevel(alpm_handle, config->siglevel);
+    for (const auto& repo : config->repos) {
+        if (repo.name == ignored_repo) {
             continue;
         }
-        [[maybe_unused]] auto* db = alpm_register_syncdb(alpm_handle, section.c_str(), ALPM_SIG_USE_DEFAULT);
+        auto* db = alpm_register_syncdb(alpm_handle, repo.name.c_str(), repo.siglevel);
+        /* clang-format off */
+        if (db == nullptr) { continue; }
+        /* clang-format on */
+        for (const auto& server : repo.servers) {
+            alpm_db_add_server(db, server.c_str());
+        }
     }
 
     return alpm_handle;
@@ -55,4 +65,37 @@ std::int32_t release_alpm(alpm_handle_t* handle, alpm_errno_t* err) noexcept {
     return ret;
 }
 
+auto read_local_pkg_versions(std::string_view dbpath, const std::unordered_set<std::string_view>& pkg_names) noexcept -> std::unordered_map<std::string, std::string> {
+    namespace fs = std::filesystem;
+
+    std::unordered_map<std::string, std::string> local_pkgs{};
+    /* clang-format off */
+    if (pkg_names.empty()) { return local_pkgs; }
+    /* clang-format on */
+
+    // Every installed package has the entry named '<pkgname>-<pkgver>-<pkgrel>'
+    std::error_code err{};
+    for (fs::directory_iterator it{fs::path{dbpath} / "local", err}; !err && it != fs::directory_iterator{}; it.increment(err)) {
+        const auto& entry_name = it->path().filename().string();
+
+        const auto rel_pos = entry_name.rfind('-');
+        /* clang-format off */
+        if (rel_pos == std::string::npos || rel_pos == 0) { continue; }
+        /* clang-format on */
+        const auto ver_pos = entry_name.rfind('-', rel_pos - 1);
+        /* clang-format off */
+        if (ver_pos == std::string::npos) { continue; }
+        /* clang-format on */
+
+        const std::string_view pkg_name{entry_name.data(), ver_pos};
+        if (pkg_names.contains(pkg_name)) {
+            local_pkgs.emplace(pkg_name, entry_name.substr(ver_pos + 1));
+        }
+    }
+    if (err) {
+        fmt::print(stderr, "[ALPM] failed to read local db: {}\n", err.message());
+    }
+    return local_pkgs;
+}
+
 }  // namespace utils
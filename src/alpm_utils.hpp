@@ -19,8 +19,11 @@
 #ifndef ALPM_UTILS_HPP
 #define ALPM_UTILS_HPP
 
-#include <cstdint>      // for int32_t
-#include <string_view>  // for string_view
+#include <cstdint>        // for int32_t
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <unordered_set>  // for unordered_set
 
 #include <alpm.h>
 
@@ -29,6 +32,13 @@ namespace utils {
 alpm_handle_t* parse_alpm(std::string_view root, std::string_view dbpath, alpm_errno_t* err) noexcept;
 std::int32_t release_alpm(alpm_handle_t* handle, alpm_errno_t* err) noexcept;
 
+/// @brief Read versions of the installed packages directly from the local db directory.
+/// Unlike the local db of alpm handle, it's never cached, so it sees changes made by other processes.
+/// @param dbpath The db path (e.g /var/lib/pacman/).
+/// @param pkg_names The packages to look up, others are skipped.
+/// @return The map of package name to its version, for installed packages only.
+auto read_local_pkg_versions(std::string_view dbpath, const std::unordered_set<std::string_view>& pkg_names) noexcept -> std::unordered_map<std::string, std::string>;
+
 }  // namespace utils
 
 #endif  // ALPM_UTILS_HPP
@@ -17,72 +17,220 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "aur_kernel.hpp"
+#include "build_log.hpp"
+#include "pkgbuilds_repo.hpp"
+#include "process_utils.hpp"
 #include "utils.hpp"
 
-#include <cstdio>   // for perror
-#include <cstdlib>  // for system
-
-#include <algorithm>   // for search
-#include <filesystem>  // for path, exists
-#include <ranges>      // for ranges::*
+#include <algorithm>      // for search
+#include <chrono>         // for hours, milliseconds, steady_clock
+#include <filesystem>     // for path, exists, last_write_time
+#include <ranges>         // for ranges::*
+#include <unordered_map>  // for unordered_map
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
 
 namespace fs = std::filesystem;
 
 namespace {
 
-void prepare_build_environment(const std::string_view& package_name) noexcept {
-    static const fs::path app_path       = utils::fix_path("~/.cache/cachyos-km");
-    static const fs::path pkgbuilds_path = utils::fix_path("~/.cache/cachyos-km/aur_pkgbuilds");
-    static const fs::path package_path   = utils::fix_path(fmt::format("~/.cache/cachyos-km/aur_pkgbuilds/{}", package_name));
-    if (!fs::exists(app_path)) {
-        fs::create_directories(app_path);
+// The AUR package list changes slowly, and downloading it takes a while.
+constexpr auto AUR_LIST_TTL = std::chrono::hours{6};
+// Compiler lines are relayed at most that often, the whole output goes only into the log
+constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds{200};
+
+// Get names of the kernel headers from the AUR package list.
+// Output format of 'paru --aur -Sl': 'aur <pkgname> unknown-version'
+auto fetch_aur_kernel_headers() noexcept -> std::vector<std::string> {
+    if (!fs::exists("/sbin/paru")) {
+        fmt::print(stderr, "Paru is not installed! Disabling AUR kernels support\n");
+        return {};
     }
-    fs::current_path(app_path);
 
-    if (!fs::exists(pkgbuilds_path)) {
-        fs::create_directories(pkgbuilds_path);
+    std::vector<std::string> kernel_headers{};
+    utils::exec_argv({"paru", "--aur", "-Sl"}, [&kernel_headers](std::string_view line) {
+        const auto& columns = utils::make_multiline_view(line, ' ');
+        /* clang-format off */
+        if (columns.size() < 2) { return; }
+        /* clang-format on */
+
+        const auto& pkg_name = columns[1];
+        if (pkg_name.starts_with("linux") && pkg_name.find("-headers") != std::string_view::npos) {
+            kernel_headers.emplace_back(pkg_name);
+        }
+    });
+    return kernel_headers;
+}
+
+auto get_aur_kernel_headers() noexcept -> std::vector<std::string> {
+    static const auto cache_path = utils::fix_path("~/.cache/cachyos-km/aur-kernels");
+
+    std::error_code err_code{};
+    const auto& cache_mtime    = fs::last_write_time(cache_path, err_code);
+    const bool is_cache_exists = !err_code;
+    if (is_cache_exists && (fs::file_time_type::clock::now() - cache_mtime) < AUR_LIST_TTL) {
+        return utils::make_multiline(utils::read_whole_file(cache_path));
+    }
+
+    auto kernel_headers = fetch_aur_kernel_headers();
+    if (kernel_headers.empty()) {
+        // Outdated list is still better than nothing, e.g when we are offline
+        /* clang-format off */
+        if (!is_cache_exists) { return {}; }
+        /* clang-format on */
+        return utils::make_multiline(utils::read_whole_file(cache_path));
+    }
+
+    fs::create_directories(fs::path{cache_path}.parent_path(), err_code);
+    utils::write_to_file(cache_path, fmt::format("{}\n", fmt::join(kernel_headers, "\n")));
+    return kernel_headers;
+}
+
+// Query versions of all packages with single request to the AUR RPC.
+// NOTE: POST is used to not hit the URI length limit.
+auto fetch_aur_versions(std::span<const detail::AurKernelInfo> aur_kernels) noexcept -> std::unordered_map<std::string, std::string> {
+    /* clang-format off */
+    if (aur_kernels.empty()) { return {}; }
+    /* clang-format on */
+
+    std::vector<std::string> rpc_cmd{"curl", "-sf", "--max-time", "15"};
+    for (auto&& aur_kernel : aur_kernels) {
+        rpc_cmd.insert(rpc_cmd.end(), {"--data-urlencode", fmt::format("arg[]={}", aur_kernel.name)});
     }
-    fs::current_path(pkgbuilds_path);
+    rpc_cmd.emplace_back("https://aur.archlinux.org/rpc/v5/info");
 
-    // Check if folder exits, but .git doesn't.
-    if (fs::exists(package_path) && !fs::exists(package_path / ".git")) {
-        fs::remove_all(package_path);
+    const auto& response = utils::exec_argv(rpc_cmd).out;
+    const auto& rpc_doc  = QJsonDocument::fromJson(QByteArray::fromStdString(response));
+    if (!rpc_doc.isObject()) {
+        fmt::print(stderr, "[AURRPC] failed to fetch versions of AUR kernels\n");
+        return {};
     }
 
-    std::int32_t cmd_status{};
-    if (!fs::exists(package_path)) {
-        const auto& clone_cmd = fmt::format("git clone https://aur.archlinux.org/{}.git", package_name);
-        cmd_status            = std::system(clone_cmd.c_str());
+    std::unordered_map<std::string, std::string> versions{};
+    for (auto&& result : rpc_doc.object()[QStringLiteral("results")].toArray()) {
+        const auto& pkg_info = result.toObject();
+        versions.insert_or_assign(pkg_info[QStringLiteral("Name")].toString().toStdString(), pkg_info[QStringLiteral("Version")].toString().toStdString());
     }
+    return versions;
+}
 
-    fs::current_path(package_path);
-    cmd_status += std::system("git checkout --force master");
-    cmd_status += std::system("git clean -fd");
-    cmd_status += std::system("git pull");
-    if (cmd_status != 0) {
-        std::perror("prepare_build_environment");
+bool prepare_build_environment(std::string_view package_name) noexcept {
+    const pkgbuilds::RepoSpec aur_repo{
+        .path = utils::fix_path(fmt::format("~/.cache/cachyos-km/aur_pkgbuilds/{}", package_name)),
+        .url  = fmt::format("https://aur.archlinux.org/{}.git", package_name),
+    };
+    if (!pkgbuilds::sync_repo(aur_repo)) {
+        fmt::print(stderr, "[AURKERNEL] failed to prepare '{}'\n", aur_repo.path.string());
+        return false;
     }
+
+    std::error_code err_code{};
+    fs::current_path(aur_repo.path, err_code);
+    return !err_code;
 }
 
 }  // namespace
 
 namespace detail {
 
-void install_aur_kernels(std::span<std::string_view> kernel_list) noexcept {
+auto get_aur_kernels(const std::unordered_set<std::string>& skip_names) noexcept -> std::vector<AurKernelInfo> {
+    std::vector<AurKernelInfo> aur_kernels{};
+    std::unordered_set<std::string> seen_names{};
+    for (auto&& kernel_headers : get_aur_kernel_headers()) {
+        auto kernel_name = kernel_headers;
+        utils::replace_all(kernel_name, "-headers", "");
+        if (skip_names.contains(kernel_name) || !seen_names.insert(kernel_name).second) {
+            continue;
+        }
+        aur_kernels.emplace_back(AurKernelInfo{.name = std::move(kernel_name), .name_headers = std::move(kernel_headers)});
+    }
+
+    const auto& versions = fetch_aur_versions(aur_kernels);
+    for (auto&& aur_kernel : aur_kernels) {
+        auto version_it    = versions.find(aur_kernel.name);
+        aur_kernel.version = (version_it != versions.end()) ? version_it->second : "unknown-version";
+    }
+    return aur_kernels;
+}
+
+auto install_aur_kernels(std::span<const std::string> kernel_list, const utils::transaction_progress_cb_t& on_progress) noexcept -> utils::TransactionResult {
     using namespace std::literals;
 
+    // Other kernels are still built, the failed ones are reported all at once
+    std::vector<std::string> failed_builds{};
+
     for (auto&& kernel_name : kernel_list) {
         if (auto found = std::ranges::search(kernel_name, "headers"sv); !found.empty()) {
             continue;
         }
 
-        prepare_build_environment(kernel_name);
+        if (!prepare_build_environment(kernel_name)) {
+            failed_builds.emplace_back(fmt::format("failed to fetch the PKGBUILD of '{}'", kernel_name));
+            continue;
+        }
 
-        // Run our build command!
-        utils::runCmdTerminal("makepkg -sicf --cleanbuild --skipchecksums", false);
+        const auto& log_path = build_log::make_log_path(kernel_name);
+        CompressedLogWriter log_writer{};
+        log_writer.open(log_path);
+
+        // There is no terminal to answer the questions in, makepkg installs through polkit then
+        std::chrono::steady_clock::time_point last_report{};
+        const auto& exec_result = utils::exec_argv({"/bin/sh", "-c", "PACMAN_AUTH=pkexec exec makepkg -sicf --cleanbuild --skipchecksums --nocolor --noconfirm 2>&1"},
+            [&](std::string_view line) {
+                log_writer.write(line);
+                log_writer.write("\n"sv);
+                /* clang-format off */
+                if (!on_progress) { return; }
+                /* clang-format on */
+
+                // Stages of makepkg (e.g '==> Starting build()...') are always reported
+                const auto& now = std::chrono::steady_clock::now();
+                if (!line.starts_with("==>"sv) && now - last_report < PROGRESS_INTERVAL) {
+                    return;
+                }
+                last_report = now;
+
+                utils::TransactionProgress progress{.message = fmt::format("{}: {}", kernel_name, line)};
+                if (const auto& step_progress = build_log::parse_step_progress(line); step_progress) {
+                    progress.percent = static_cast<std::int32_t>(step_progress->current * 100 / step_progress->total);
+                }
+                on_progress(progress);
+            });
+        log_writer.close();
+
+        if (!exec_result.is_success()) {
+            fmt::print(stderr, "[AURKERNEL] build of '{}' has failed, see '{}'\n", kernel_name, log_path);
+            failed_builds.emplace_back(fmt::format("build of '{}' has failed, see '{}'", kernel_name, log_path));
+        }
     }
+    /* clang-format off */
+    if (failed_builds.empty()) { return {}; }
+    /* clang-format on */
+    return {.is_success = false, .err_msg = fmt::format("{}", fmt::join(failed_builds, "\n"))};
 }
 
 }  // namespace detail
@@ -19,11 +19,37 @@
 #ifndef AUR_KERNEL_HPP
 #define AUR_KERNEL_HPP
 
-#include <span>
-#include <string_view>
+#include "alpm_transaction.hpp"
+
+#include <span>           // for span
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_set>  // for unordered_set
+#include <vector>         // for vector
 
 namespace detail {
-void install_aur_kernels(std::span<std::string_view> kernel_list) noexcept;
+
+/// Kernel package found in the AUR.
+struct AurKernelInfo {
+    std::string name{};
+    std::string name_headers{};
+    std::string version{};
+};
+
+/// @brief Find kernels in the AUR.
+/// The list of AUR packages is cached on the disk, versions are fetched with single RPC request.
+/// NOTE: it requires network access, and must not be called from the GUI thread.
+/// @param skip_names Names of kernels, which are already provided by the repos.
+/// @return Kernels found in the AUR.
+auto get_aur_kernels(const std::unordered_set<std::string>& skip_names) noexcept -> std::vector<AurKernelInfo>;
+
+/// @brief Build and install kernels from the AUR, one after another.
+/// The output of each build goes into its log (see build_log::make_log_path).
+/// NOTE: it blocks until all builds are done, and must not be called from the GUI thread.
+/// @param on_progress The callback, which gets the stages of the build and the compile progress.
+/// @return The failure, if any of the kernels couldn't be built.
+auto install_aur_kernels(std::span<const std::string> kernel_list, const utils::transaction_progress_cb_t& on_progress = {}) noexcept -> utils::TransactionResult;
+
 }  // namespace detail
 
 #endif  // AUR_KERNEL_HPP
@@ -0,0 +1,424 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "boot_history.hpp"
+#include "process_utils.hpp"
+#include "string_utils.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+#include <pthread.h>        // for pthread_setaffinity_np
+#include <sched.h>          // for sched_getcpu, cpu_set_t, CPU_SET
+#include <sys/syscall.h>    // for SYS_getppid
+#include <sys/utsname.h>    // for uname
+#include <unistd.h>         // for syscall, pipe, read, write, close
+
+#include <algorithm>   // for min, ranges::count, ranges::find_if
+#include <array>       // for array
+#include <charconv>    // for from_chars
+#include <chrono>      // for steady_clock, system_clock
+#include <cstring>     // for memcpy
+#include <filesystem>  // for file_size, create_directories
+#include <thread>      // for thread
+#include <utility>     // for pair
+
+#include <fmt/chrono.h>
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr auto STARTUP_FINISHED_PREFIX = "Startup finished in "sv;
+
+// Oldest records are dropped, once there are more
+static constexpr std::size_t MAX_HISTORY_SIZE = 256;
+
+static constexpr std::uint32_t SYSCALL_ITERATIONS        = 1'000'000;
+static constexpr std::uint32_t CONTEXT_SWITCH_ITERATIONS = 50'000;
+static constexpr std::size_t MEMORY_BUFFER_SIZE          = 64 * 1024 * 1024;
+static constexpr std::uint32_t MEMORY_COPY_ITERATIONS    = 8;
+// The best of the runs is taken, it's the least disturbed by the rest of the system
+static constexpr std::uint32_t BENCH_RUNS = 3;
+
+static constexpr std::array<std::pair<std::string_view, double>, 6> TIMESPAN_UNITS{{
+    {"min"sv, 60.0},
+    {"ms"sv, 1e-3},
+    {"us"sv, 1e-6},
+    {"h"sv, 3600.0},
+    {"s"sv, 1.0},
+    {"d"sv, 86400.0},
+}};
+
+using bench_clock = std::chrono::steady_clock;
+
+inline auto get_elapsed_sec(bench_clock::time_point start) noexcept -> double {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+auto get_kernel_release() noexcept -> std::string {
+    struct utsname uts{};
+    /* clang-format off */
+    if (::uname(&uts) != 0) { return {}; }
+    /* clang-format on */
+    return uts.release;
+}
+
+auto read_first_line(const fs::path& file_path) noexcept -> std::string {
+    auto&& content = utils::read_whole_file(file_path.string());
+    return content.substr(0, content.find('\n'));
+}
+
+auto measure_syscall_latency_ns() noexcept -> double {
+    double best_sec{-1.0};
+    for (std::uint32_t run = 0; run < BENCH_RUNS; ++run) {
+        const auto start = bench_clock::now();
+        for (std::uint32_t i = 0; i < SYSCALL_ITERATIONS; ++i) {
+            // raw syscall, glibc may cache the result of the getppid() wrapper
+            ::syscall(SYS_getppid);
+        }
+        const auto elapsed_sec = get_elapsed_sec(start);
+        best_sec               = (best_sec < 0) ? elapsed_sec : std::min(best_sec, elapsed_sec);
+    }
+    return best_sec * 1e9 / SYSCALL_ITERATIONS;
+}
+
+void pin_to_cpu(std::thread& thread, std::int32_t cpu) noexcept {
+    cpu_set_t cpu_set{};
+    CPU_ZERO(&cpu_set);
+    CPU_SET(static_cast<std::size_t>(cpu), &cpu_set);
+    ::pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+}
+
+// Two threads on the same CPU pass a byte back and forth, so every hop is the switch
+auto measure_context_switch_us() noexcept -> double {
+    std::array<std::int32_t, 2> ping_fds{-1, -1};
+    std::array<std::int32_t, 2> pong_fds{-1, -1};
+    if (::pipe(ping_fds.data()) != 0 || ::pipe(pong_fds.data()) != 0) {
+        fmt::print(stderr, "[BOOT] failed to create pipes for the context switch benchmark\n");
+        for (auto fd : {ping_fds[0], ping_fds[1], pong_fds[0], pong_fds[1]}) {
+            if (fd != -1) {
+                ::close(fd);
+            }
+        }
+        return -1.0;
+    }
+
+    double elapsed_sec{-1.0};
+    std::thread echo_thread([&] {
+        char byte{};
+        for (std::uint32_t i = 0; i < CONTEXT_SWITCH_ITERATIONS; ++i) {
+            /* clang-format off */
+            if (::read(ping_fds[0], &byte, 1) != 1 || ::write(pong_fds[1], &byte, 1) != 1) { return; }
+            /* clang-format on */
+        }
+    });
+    std::thread ping_thread([&] {
+        char byte{};
+        const auto start = bench_clock::now();
+        for (std::uint32_t i = 0; i < CONTEXT_SWITCH_ITERATIONS; ++i) {
+            /* clang-format off */
+            if (::write(ping_fds[1], &byte, 1) != 1 || ::read(pong_fds[0], &byte, 1) != 1) { return; }
+            /* clang-format on */
+        }
+        elapsed_sec = get_elapsed_sec(start);
+    });
+    const auto cpu = std::max(::sched_getcpu(), 0);
+    pin_to_cpu(echo_thread, cpu);
+    pin_to_cpu(ping_thread, cpu);
+
+    ping_thread.join();
+    // unblock the echo thread, if the ping thread has failed
+    ::close(ping_fds[1]);
+    echo_thread.join();
+    for (auto fd : {ping_fds[0], pong_fds[0], pong_fds[1]}) {
+        ::close(fd);
+    }
+
+    /* clang-format off */
+    if (elapsed_sec < 0) { return -1.0; }
+    /* clang-format on */
+    return elapsed_sec * 1e6 / (CONTEXT_SWITCH_ITERATIONS * 2.0);
+}
+
+auto measure_memory_bandwidth_gib_s() noexcept -> double {
+    std::vector<char> src_buffer(MEMORY_BUFFER_SIZE, 1);
+    std::vector<char> dst_buffer(MEMORY_BUFFER_SIZE, 0);
+
+    double best_sec{-1.0};
+    for (std::uint32_t run = 0; run < BENCH_RUNS; ++run) {
+        const auto start = bench_clock::now();
+        for (std::uint32_t i = 0; i < MEMORY_COPY_ITERATIONS; ++i) {
+            std::memcpy(dst_buffer.data(), src_buffer.data(), MEMORY_BUFFER_SIZE);
+            // make the copies depend on each other, so none of them is dropped
+            src_buffer[i] = dst_buffer[MEMORY_BUFFER_SIZE - 1 - i];
+        }
+        const auto elapsed_sec = get_elapsed_sec(start);
+        best_sec               = (best_sec < 0) ? elapsed_sec : std::min(best_sec, elapsed_sec);
+    }
+    constexpr double copied_gib = static_cast<double>(MEMORY_BUFFER_SIZE) * MEMORY_COPY_ITERATIONS / (1024.0 * 1024.0 * 1024.0);
+    return (best_sec > 0) ? copied_gib / best_sec : -1.0;
+}
+
+auto convert_record_to_json(const BootRecord& record) noexcept -> QJsonObject {
+    QJsonObject timings_obj{};
+    timings_obj.insert("firmware_sec", record.timings.firmware_sec);
+    timings_obj.insert("loader_sec", record.timings.loader_sec);
+    timings_obj.insert("kernel_sec", record.timings.kernel_sec);
+    timings_obj.insert("initrd_sec", record.timings.initrd_sec);
+    timings_obj.insert("userspace_sec", record.timings.userspace_sec);
+    timings_obj.insert("total_sec", record.timings.total_sec);
+
+    QJsonObject bench_obj{};
+    bench_obj.insert("syscall_latency_ns", record.bench.syscall_latency_ns);
+    bench_obj.insert("context_switch_us", record.bench.context_switch_us);
+    bench_obj.insert("memory_bandwidth_gib_s", record.bench.memory_bandwidth_gib_s);
+
+    QJsonObject record_obj{};
+    record_obj.insert("pkg_name", QString::fromStdString(record.pkg_name));
+    record_obj.insert("kernel_release", QString::fromStdString(record.kernel_release));
+    record_obj.insert("timestamp", QString::fromStdString(record.timestamp));
+    record_obj.insert("boot", timings_obj);
+    record_obj.insert("initramfs_size", static_cast<qint64>(record.initramfs_size));
+    record_obj.insert("module_count", static_cast<qint64>(record.module_count));
+    record_obj.insert("bench", bench_obj);
+    return record_obj;
+}
+
+auto convert_json_to_record(const QJsonObject& record_obj) noexcept -> BootRecord {
+    const auto& timings_obj = record_obj.value("boot").toObject();
+    const auto& bench_obj   = record_obj.value("bench").toObject();
+    return BootRecord{
+        .pkg_name       = record_obj.value("pkg_name").toString().toStdString(),
+        .kernel_release = record_obj.value("kernel_release").toString().toStdString(),
+        .timestamp      = record_obj.value("timestamp").toString().toStdString(),
+        .timings        = BootTimings{
+                   .firmware_sec  = timings_obj.value("firmware_sec").toDouble(-1.0),
+                   .loader_sec    = timings_obj.value("loader_sec").toDouble(-1.0),
+                   .kernel_sec    = timings_obj.value("kernel_sec").toDouble(-1.0),
+                   .initrd_sec    = timings_obj.value("initrd_sec").toDouble(-1.0),
+                   .userspace_sec = timings_obj.value("userspace_sec").toDouble(-1.0),
+                   .total_sec     = timings_obj.value("total_sec").toDouble(-1.0),
+        },
+        .initramfs_size = static_cast<std::uint64_t>(record_obj.value("initramfs_size").toInteger()),
+        .module_count   = static_cast<std::uint32_t>(record_obj.value("module_count").toInteger()),
+        .bench          = MicroBenchResults{
+                     .syscall_latency_ns     = bench_obj.value("syscall_latency_ns").toDouble(-1.0),
+                     .context_switch_us      = bench_obj.value("context_switch_us").toDouble(-1.0),
+                     .memory_bandwidth_gib_s = bench_obj.value("memory_bandwidth_gib_s").toDouble(-1.0),
+        },
+    };
+}
+
+}  // namespace
+
+namespace boot_history {
+
+auto parse_timespan(std::string_view timespan) noexcept -> std::optional<double> {
+    double total_sec{};
+    bool has_parts{};
+    for (auto&& part : utils::make_multiline_view(timespan, ' ')) {
+        double value{};
+        auto [ptr, ec] = std::from_chars(part.data(), part.data() + part.size(), value);
+        /* clang-format off */
+        if (ec != std::errc{} || ptr == part.data()) { return std::nullopt; }
+        /* clang-format on */
+
+        const std::string_view unit{ptr, static_cast<std::size_t>(part.data() + part.size() - ptr)};
+        const auto* unit_it = std::ranges::find_if(TIMESPAN_UNITS, [unit](auto&& known_unit) { return known_unit.first == unit; });
+        /* clang-format off */
+        if (unit_it == TIMESPAN_UNITS.end()) { return std::nullopt; }
+        /* clang-format on */
+        total_sec += value * unit_it->second;
+        has_parts = true;
+    }
+    return has_parts ? std::make_optional(total_sec) : std::nullopt;
+}
+
+// e.g 'Startup finished in 7.4s (firmware) + 2.0s (loader) + 1.3s (kernel) + 2.4s (initrd) + 5.1s (userspace) = 18.2s'
+auto parse_systemd_analyze(std::string_view output) noexcept -> std::optional<BootTimings> {
+    const auto prefix_pos = output.find(STARTUP_FINISHED_PREFIX);
+    /* clang-format off */
+    if (prefix_pos == std::string_view::npos) { return std::nullopt; }
+    /* clang-format on */
+
+    auto line = output.substr(prefix_pos + STARTUP_FINISHED_PREFIX.size());
+    line      = line.substr(0, line.find('\n'));
+
+    const auto total_pos = line.rfind(" = "sv);
+    /* clang-format off */
+    if (total_pos == std::string_view::npos) { return std::nullopt; }
+    /* clang-format on */
+
+    BootTimings timings{};
+    const auto& total_sec = parse_timespan(line.substr(total_pos + 3));
+    /* clang-format off */
+    if (!total_sec) { return std::nullopt; }
+    /* clang-format on */
+    timings.total_sec = *total_sec;
+
+    const std::array<std::pair<std::string_view, double*>, 5> stages{{
+        {"firmware"sv, &timings.firmware_sec},
+        {"loader"sv, &timings.loader_sec},
+        {"kernel"sv, &timings.kernel_sec},
+        {"initrd"sv, &timings.initrd_sec},
+        {"userspace"sv, &timings.userspace_sec},
+    }};
+    for (auto stages_part = line.substr(0, total_pos); !stages_part.empty();) {
+        const auto plus_pos = stages_part.find(" + "sv);
+        const auto stage    = stages_part.substr(0, plus_pos);
+        stages_part         = (plus_pos == std::string_view::npos) ? std::string_view{} : stages_part.substr(plus_pos + 3);
+
+        const auto paren_pos = stage.find(" ("sv);
+        /* clang-format off */
+        if (paren_pos == std::string_view::npos || !stage.ends_with(')')) { continue; }
+        /* clang-format on */
+        const auto stage_name = stage.substr(paren_pos + 2, stage.size() - paren_pos - 3);
+        const auto& stage_sec = parse_timespan(stage.substr(0, paren_pos));
+
+        const auto* stage_it = std::ranges::find_if(stages, [stage_name](auto&& known_stage) { return known_stage.first == stage_name; });
+        if (stage_sec && stage_it != stages.end()) {
+            *stage_it->second = *stage_sec;
+        }
+    }
+    return timings;
+}
+
+auto run_micro_benchmarks() noexcept -> MicroBenchResults {
+    return MicroBenchResults{
+        .syscall_latency_ns     = measure_syscall_latency_ns(),
+        .context_switch_us      = measure_context_switch_us(),
+        .memory_bandwidth_gib_s = measure_memory_bandwidth_gib_s(),
+    };
+}
+
+auto load_history(std::string_view history_path) noexcept -> std::vector<BootRecord> {
+    const auto& history_content = utils::read_whole_file(history_path);
+    /* clang-format off */
+    if (history_content.empty()) { return {}; }
+    /* clang-format on */
+
+    const auto& history_doc = QJsonDocument::fromJson(QByteArray::fromRawData(history_content.data(), static_cast<qsizetype>(history_content.size())));
+    if (!history_doc.isArray()) {
+        fmt::print(stderr, "[BOOT] ignoring malformed history file: {}\n", history_path);
+        return {};
+    }
+
+    std::vector<BootRecord> records{};
+    for (auto&& record_value : history_doc.array()) {
+        auto record = convert_json_to_record(record_value.toObject());
+        if (!record.pkg_name.empty() && !record.kernel_release.empty()) {
+            records.emplace_back(std::move(record));
+        }
+    }
+    return records;
+}
+
+auto save_history(std::string_view history_path, std::span<const BootRecord> records) noexcept -> bool {
+    QJsonArray records_array{};
+    for (auto&& record : records) {
+        records_array.append(convert_record_to_json(record));
+    }
+
+    std::error_code err_code{};
+    fs::create_directories(fs::path{history_path}.parent_path(), err_code);
+
+    const auto& history_json = QJsonDocument{records_array}.toJson();
+    return utils::write_to_file(history_path, std::string_view{history_json.constData(), static_cast<std::size_t>(history_json.size())});
+}
+
+auto update_history() noexcept -> std::vector<BootRecord> {
+    const trace::Span trace_span{"update_boot_history"};
+
+    static const auto history_path = utils::fix_path("~/.cache/cachyos-km/boot-history.json");
+
+    auto records = load_history(history_path);
+
+    const auto& kernel_release = get_kernel_release();
+    const auto& is_recorded    = std::ranges::any_of(records, [&kernel_release](auto&& record) { return record.kernel_release == kernel_release; });
+    /* clang-format off */
+    if (kernel_release.empty() || is_recorded) { return records; }
+    /* clang-format on */
+
+    // Arch kernels tell which package they belong to
+    const fs::path modules_path{fmt::format(FMT_COMPILE("/usr/lib/modules/{}"), kernel_release)};
+    const auto& pkg_name = read_first_line(modules_path / "pkgbase");
+    if (pkg_name.empty()) {
+        fmt::print(stderr, "[BOOT] running kernel {} doesn't belong to any package\n", kernel_release);
+        return records;
+    }
+
+    // Boot is still in progress, the next launch records it
+    const auto& analyze_result = utils::exec_argv({"systemd-analyze", "time"});
+    const auto& timings        = parse_systemd_analyze(analyze_result.out);
+    /* clang-format off */
+    if (!analyze_result.is_success() || !timings) { return records; }
+    /* clang-format on */
+
+    std::error_code err_code{};
+    const auto initramfs_size = fs::file_size(fmt::format(FMT_COMPILE("/boot/initramfs-{}.img"), pkg_name), err_code);
+
+    const auto& modules_content = utils::read_whole_file("/proc/modules");
+    const auto now              = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+
+    records.emplace_back(BootRecord{
+        .pkg_name       = pkg_name,
+        .kernel_release = kernel_release,
+        .timestamp      = fmt::format(FMT_COMPILE("{:%FT%TZ}"), now),
+        .timings        = *timings,
+        .initramfs_size = err_code ? 0 : initramfs_size,
+        .module_count   = static_cast<std::uint32_t>(std::ranges::count(modules_content, '\n')),
+        .bench          = run_micro_benchmarks(),
+    });
+    if (records.size() > MAX_HISTORY_SIZE) {
+        records.erase(records.begin(), records.end() - MAX_HISTORY_SIZE);
+    }
+
+    if (!save_history(history_path, records)) {
+        fmt::print(stderr, "[BOOT] failed to save history into {}\n", history_path);
+    }
+    return records;
+}
+
+}  // namespace boot_history
@@ -0,0 +1,84 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BOOT_HISTORY_HPP
+#define BOOT_HISTORY_HPP
+
+#include <cstdint>      // for uint32_t, uint64_t
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+/// Stages reported by 'systemd-analyze time', negative if the stage isn't reported (e.g firmware inside of VM).
+struct BootTimings {
+    double firmware_sec{-1.0};
+    double loader_sec{-1.0};
+    double kernel_sec{-1.0};
+    double initrd_sec{-1.0};
+    double userspace_sec{-1.0};
+    double total_sec{-1.0};
+};
+
+/// Results of the quick micro-benchmarks, negative if the benchmark has failed.
+struct MicroBenchResults {
+    double syscall_latency_ns{-1.0};
+    double context_switch_us{-1.0};
+    double memory_bandwidth_gib_s{-1.0};
+};
+
+/// What we know about the first boot of the kernel release.
+struct BootRecord {
+    // package, which the kernel is installed from (e.g linux-cachyos)
+    std::string pkg_name{};
+    // e.g 6.9.1-2-cachyos
+    std::string kernel_release{};
+    std::string timestamp{};
+    BootTimings timings{};
+    // zero if the initramfs isn't found (e.g it's a part of UKI)
+    std::uint64_t initramfs_size{};
+    // loaded modules, once the boot has finished
+    std::uint32_t module_count{};
+    MicroBenchResults bench{};
+};
+
+namespace boot_history {
+
+/// @brief Parse the output of 'systemd-analyze time'.
+/// @return The timings, or std::nullopt if the boot hasn't finished yet.
+auto parse_systemd_analyze(std::string_view output) noexcept -> std::optional<BootTimings>;
+
+/// @brief Parse systemd timespan (e.g '1min 2.345s' or '812ms') into seconds.
+auto parse_timespan(std::string_view timespan) noexcept -> std::optional<double>;
+
+/// @brief Run syscall, context switch and memory bandwidth benchmarks. Blocks for about a second.
+auto run_micro_benchmarks() noexcept -> MicroBenchResults;
+
+/// @brief Load records from the history file, oldest first.
+auto load_history(std::string_view history_path) noexcept -> std::vector<BootRecord>;
+auto save_history(std::string_view history_path, std::span<const BootRecord> records) noexcept -> bool;
+
+/// @brief Record the running kernel into ~/.cache/cachyos-km/boot-history.json, if it's the first boot of it.
+/// Blocks while the benchmarks are running, so it must not be called from the GUI thread.
+/// @return The whole history, including the new record.
+auto update_history() noexcept -> std::vector<BootRecord>;
+
+}  // namespace boot_history
+
+#endif  // BOOT_HISTORY_HPP
@@ -0,0 +1,195 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "build_log.hpp"
+#include "utils.hpp"
+
+#include <algorithm>   // for max, min, ranges::sort, ranges::replace_if
+#include <charconv>    // for from_chars
+#include <chrono>      // for system_clock
+#include <filesystem>  // for directory_iterator, create_directories, remove
+#include <utility>     // for move, pair
+
+#include <zlib.h>
+
+#include <fmt/chrono.h>
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::string_view_literals;
+
+// Enough to look into the last builds, the oldest logs are removed
+static constexpr std::size_t MAX_KEPT_LOGS = 32;
+static constexpr auto LOG_SUFFIX           = ".log.gz"sv;
+
+constexpr bool is_digit(char ch) noexcept {
+    return ch >= '0' && ch <= '9';
+}
+
+auto parse_number(std::string_view str) noexcept -> std::optional<std::uint32_t> {
+    std::uint32_t number{};
+    const auto* str_end = str.data() + str.size();
+    const auto result   = std::from_chars(str.data(), str_end, number);
+    /* clang-format off */
+    if (result.ec != std::errc{} || result.ptr != str_end) { return std::nullopt; }
+    /* clang-format on */
+    return number;
+}
+
+void prune_old_logs(const fs::path& logs_path) noexcept {
+    std::vector<std::pair<fs::file_time_type, fs::path>> log_files{};
+
+    std::error_code err_code{};
+    for (auto&& dir_entry : fs::directory_iterator{logs_path, err_code}) {
+        if (dir_entry.path().filename().string().ends_with(LOG_SUFFIX)) {
+            log_files.emplace_back(dir_entry.last_write_time(err_code), dir_entry.path());
+        }
+    }
+    // Leave the room for the new log
+    /* clang-format off */
+    if (log_files.size() < MAX_KEPT_LOGS) { return; }
+    /* clang-format on */
+
+    std::ranges::sort(log_files, [](auto&& lhs, auto&& rhs) { return lhs.first > rhs.first; });
+    for (std::size_t i = MAX_KEPT_LOGS - 1; i < log_files.size(); ++i) {
+        fs::remove(log_files[i].second, err_code);
+    }
+}
+
+}  // namespace
+
+LogRingBuffer::LogRingBuffer(std::size_t capacity) noexcept
+  : m_lines(std::max<std::size_t>(capacity, 1)) { }
+
+void LogRingBuffer::push_back(std::string&& line) noexcept {
+    if (m_size == m_lines.size()) {
+        drop_front(1);
+    }
+    m_lines[(m_head + m_size) % m_lines.size()] = std::move(line);
+    ++m_size;
+}
+
+void LogRingBuffer::drop_front(std::size_t count) noexcept {
+    count = std::min(count, m_size);
+    for (std::size_t i = 0; i < count; ++i) {
+        // release the memory right away, the slot might not be reused for a while
+        std::string{}.swap(m_lines[(m_head + i) % m_lines.size()]);
+    }
+    m_head = (m_head + count) % m_lines.size();
+    m_size -= count;
+}
+
+CompressedLogWriter::~CompressedLogWriter() noexcept {
+    close();
+}
+
+bool CompressedLogWriter::open(const std::string& log_path) noexcept {
+    close();
+
+    // Level 6 is the default of gzip, it keeps up with the build output easily
+    m_file = ::gzopen(log_path.c_str(), "wb6");
+    if (m_file == nullptr) {
+        fmt::print(stderr, "[BUILDLOG] failed to open '{}'\n", log_path);
+        return false;
+    }
+    return true;
+}
+
+void CompressedLogWriter::write(std::string_view output) noexcept {
+    /* clang-format off */
+    if (m_file == nullptr || output.empty()) { return; }
+    /* clang-format on */
+
+    if (::gzwrite(m_file, output.data(), static_cast<unsigned>(output.size())) <= 0) {
+        int err_num{};
+        fmt::print(stderr, "[BUILDLOG] failed to write the log: {}\n", ::gzerror(m_file, &err_num));
+        close();
+    }
+}
+
+void CompressedLogWriter::close() noexcept {
+    /* clang-format off */
+    if (m_file == nullptr) { return; }
+    /* clang-format on */
+
+    if (::gzclose(m_file) != Z_OK) {
+        fmt::print(stderr, "[BUILDLOG] failed to finish the log\n");
+    }
+    m_file = nullptr;
+}
+
+namespace build_log {
+
+auto parse_step_progress(std::string_view line) noexcept -> std::optional<BuildProgress> {
+    /* clang-format off */
+    if (!line.starts_with('[')) { return std::nullopt; }
+    /* clang-format on */
+
+    const auto close_pos = line.find(']');
+    const auto slash_pos = line.find('/');
+    /* clang-format off */
+    if (close_pos == std::string_view::npos || slash_pos == std::string_view::npos || slash_pos > close_pos) { return std::nullopt; }
+    /* clang-format on */
+
+    // Counter is padded by some tools, e.g '[  12/3456]'
+    auto current_str = line.substr(1, slash_pos - 1);
+    current_str.remove_prefix(std::min(current_str.find_first_not_of(' '), current_str.size()));
+    const auto& current = parse_number(current_str);
+    const auto& total   = parse_number(line.substr(slash_pos + 1, close_pos - slash_pos - 1));
+    /* clang-format off */
+    if (!current || !total || *total == 0 || *current > *total) { return std::nullopt; }
+    /* clang-format on */
+    return BuildProgress{.current = *current, .total = *total};
+}
+
+bool is_compile_line(std::string_view line) noexcept {
+    // Kbuild quiet output is '  <CMD> <padding> <target>', modules are marked with '[M]'
+    /* clang-format off */
+    if (!line.starts_with("  CC "sv)) { return false; }
+    /* clang-format on */
+    line.remove_prefix("  CC "sv.size());
+    return line.find_first_not_of(' ') != std::string_view::npos;
+}
+
+auto make_log_path(std::string_view name) noexcept -> std::string {
+    static const fs::path logs_path = utils::fix_path("~/.cache/cachyos-km/build-logs");
+
+    std::error_code err_code{};
+    fs::create_directories(logs_path, err_code);
+    prune_old_logs(logs_path);
+
+    // The name comes from the PKGBUILD path, keep only the safe part of it
+    std::string file_name{fs::path{name}.filename().string()};
+    std::ranges::replace_if(file_name, [](char ch) { return !(is_digit(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '-' || ch == '_' || ch == '.'); }, '_');
+
+    const auto& now       = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    const auto& base_name = fmt::format(FMT_COMPILE("{}-{:%Y%m%d-%H%M%S}"), file_name, now);
+
+    // Parallel builds of the same kernel might start within the same second
+    auto log_path = logs_path / fmt::format(FMT_COMPILE("{}{}"), base_name, LOG_SUFFIX);
+    for (std::uint32_t i = 1; fs::exists(log_path, err_code); ++i) {
+        log_path = logs_path / fmt::format(FMT_COMPILE("{}-{}{}"), base_name, i, LOG_SUFFIX);
+    }
+    return log_path.string();
+}
+
+}  // namespace build_log
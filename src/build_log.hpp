@@ -0,0 +1,105 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BUILD_LOG_HPP
+#define BUILD_LOG_HPP
+
+#include <cstdint>      // for uint32_t
+#include <optional>     // for optional
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+// gzFile of zlib, so zlib.h isn't pulled into every user
+struct gzFile_s;
+
+/// Progress of the compile step, as reported by the build system.
+struct BuildProgress {
+    /// Number of the finished steps.
+    std::uint32_t current{};
+    /// Total number of the steps, zero if the build system doesn't report it (e.g Kbuild).
+    std::uint32_t total{};
+};
+
+/// Keeps the last lines of the output, the oldest are dropped once it's full.
+/// Lines are indexed from the oldest one, which is still kept.
+class LogRingBuffer final {
+ public:
+    explicit LogRingBuffer(std::size_t capacity) noexcept;
+
+    void push_back(std::string&& line) noexcept;
+    /// @brief Drop the oldest lines.
+    void drop_front(std::size_t count) noexcept;
+
+    /* clang-format off */
+    std::size_t size() const noexcept
+    { return m_size; }
+
+    std::size_t capacity() const noexcept
+    { return m_lines.size(); }
+
+    auto operator[](std::size_t index) const noexcept -> const std::string&
+    { return m_lines[(m_head + index) % m_lines.size()]; }
+    /* clang-format on */
+
+ private:
+    std::vector<std::string> m_lines{};
+    std::size_t m_head{};
+    std::size_t m_size{};
+};
+
+/// Streams the output into gzip file, so the whole log is kept at a fraction of its size.
+/// The file can be read with zless, or any other gzip aware tool.
+class CompressedLogWriter final {
+ public:
+    CompressedLogWriter() = default;
+    ~CompressedLogWriter() noexcept;
+
+    CompressedLogWriter(const CompressedLogWriter&)            = delete;
+    CompressedLogWriter& operator=(const CompressedLogWriter&) = delete;
+
+    bool open(const std::string& log_path) noexcept;
+    void write(std::string_view output) noexcept;
+    /// @brief Flush the compressed stream, and close the file.
+    void close() noexcept;
+
+    /* clang-format off */
+    bool is_open() const noexcept
+    { return m_file != nullptr; }
+    /* clang-format on */
+
+ private:
+    gzFile_s* m_file{nullptr};
+};
+
+namespace build_log {
+
+/// @brief Parse the '[n/m]' prefix of ninja style line (e.g '[12/3456] Building C object foo.o').
+/// @return The progress, or nullopt if the line has no such prefix.
+auto parse_step_progress(std::string_view line) noexcept -> std::optional<BuildProgress>;
+
+/// @brief Check if Kbuild line reports the compiled object (e.g '  CC      kernel/fork.o').
+bool is_compile_line(std::string_view line) noexcept;
+
+/// @brief Get path of the new log in ~/.cache/cachyos-km/build-logs, the oldest logs are removed.
+/// @param name The name of the build (e.g linux-cachyos), it's a part of the file name.
+auto make_log_path(std::string_view name) noexcept -> std::string;
+
+}  // namespace build_log
+
+#endif  // BUILD_LOG_HPP
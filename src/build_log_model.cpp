@@ -0,0 +1,200 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "build_log_model.hpp"
+
+#include <algorithm>         // for ranges::any_of
+#include <chrono>            // for milliseconds
+#include <initializer_list>  // for initializer_list
+#include <utility>           // for move
+
+#include <QColor>
+
+namespace {
+
+using namespace std::string_view_literals;
+
+// Kernel build is around 30k lines, keep all of it, while the memory is bounded
+static constexpr std::size_t MAX_SHOWN_LINES = 100'000;
+// Lines, which are longer, are cut in the view, the log on the disk has them in full
+static constexpr std::size_t MAX_LINE_LENGTH = 4096;
+// Output arrives in bursts of many lines, one model update per batch keeps the view cheap
+static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds{100};
+
+bool contains_any(std::string_view line, std::initializer_list<std::string_view> needles) noexcept {
+    return std::ranges::any_of(needles, [line](auto&& needle) { return line.find(needle) != std::string_view::npos; });
+}
+
+}  // namespace
+
+BuildLogModel::BuildLogModel(std::string log_path, QObject* parent)
+  : QAbstractListModel(parent), m_log_path(std::move(log_path)), m_lines(MAX_SHOWN_LINES) {
+    m_log_writer.open(m_log_path);
+
+    m_flush_timer.setSingleShot(true);
+    m_flush_timer.setInterval(FLUSH_INTERVAL);
+    connect(&m_flush_timer, &QTimer::timeout, this, &BuildLogModel::flush_pending_lines);
+}
+
+int BuildLogModel::rowCount(const QModelIndex& parent) const {
+    /* clang-format off */
+    if (parent.isValid()) { return 0; }
+    /* clang-format on */
+    return static_cast<int>(m_lines.size());
+}
+
+QVariant BuildLogModel::data(const QModelIndex& index, int role) const {
+    /* clang-format off */
+    if (!index.isValid() || static_cast<std::size_t>(index.row()) >= m_lines.size()) { return {}; }
+    /* clang-format on */
+
+    // Converted only for the visible rows, the rest stays in UTF-8
+    const std::string_view line = m_lines[static_cast<std::size_t>(index.row())];
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString::fromUtf8(line.data(), static_cast<qsizetype>(line.size()));
+    case Qt::ForegroundRole:
+        // makepkg reports as '==> ERROR:', compilers as 'file:line: error:'
+        if (contains_any(line, {"==> ERROR:"sv, "error:"sv})) {
+            return QVariant{QColor{Qt::red}};
+        }
+        if (contains_any(line, {"==> WARNING:"sv, "warning:"sv})) {
+            return QVariant{QColor{Qt::darkYellow}};
+        }
+        return {};
+    default:
+        return {};
+    }
+}
+
+void BuildLogModel::follow_process(QProcess* process, output_cb_t on_output) noexcept {
+    m_process = process;
+
+    auto read_channel = [this, process, on_output = std::move(on_output)](QProcess::ProcessChannel channel) {
+        const auto& output = (channel == QProcess::StandardOutput) ? process->readAllStandardOutput() : process->readAllStandardError();
+        const std::string_view output_view{output.constData(), static_cast<std::size_t>(output.size())};
+        if (on_output) {
+            on_output(output_view);
+        }
+        append_output(output_view, channel);
+    };
+    connect(process, &QProcess::readyReadStandardOutput, this, [read_channel] { read_channel(QProcess::StandardOutput); });
+    connect(process, &QProcess::readyReadStandardError, this, [read_channel] { read_channel(QProcess::StandardError); });
+}
+
+void BuildLogModel::append_output(std::string_view output, QProcess::ProcessChannel channel) noexcept {
+    /* clang-format off */
+    if (m_is_finished || output.empty()) { return; }
+    /* clang-format on */
+    m_log_writer.write(output);
+
+    // The last line might be not read completely yet
+    auto& partial_line = m_partial_lines[static_cast<std::size_t>(channel)];
+    while (!output.empty()) {
+        const auto newline_pos = output.find('\n');
+        if (newline_pos == std::string_view::npos) {
+            partial_line += output;
+            break;
+        }
+        partial_line += output.substr(0, newline_pos);
+        output.remove_prefix(newline_pos + 1);
+        append_line(partial_line);
+        partial_line.clear();
+    }
+
+    if (!m_pending_lines.empty() && !m_flush_timer.isActive()) {
+        m_flush_timer.start();
+    }
+}
+
+void BuildLogModel::append_line(std::string_view line) noexcept {
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+    }
+    // Progress bars (e.g of curl) redraw the line, only the last state is shown
+    if (const auto cr_pos = line.rfind('\r'); cr_pos != std::string_view::npos) {
+        line.remove_prefix(cr_pos + 1);
+    }
+
+    if (const auto& step_progress = build_log::parse_step_progress(line); step_progress) {
+        m_progress            = *step_progress;
+        m_is_progress_changed = true;
+    } else if (build_log::is_compile_line(line)) {
+        ++m_compiled_count;
+        m_is_progress_changed = true;
+    }
+    m_pending_lines.emplace_back(line.substr(0, MAX_LINE_LENGTH));
+}
+
+void BuildLogModel::flush_pending_lines() noexcept {
+    m_flush_timer.stop();
+    if (m_is_progress_changed) {
+        m_is_progress_changed = false;
+        emit progress_changed();
+    }
+    /* clang-format off */
+    if (m_pending_lines.empty()) { return; }
+    /* clang-format on */
+
+    // Older lines wouldn't be shown anyway
+    if (m_pending_lines.size() > m_lines.capacity()) {
+        m_pending_lines.erase(m_pending_lines.begin(), m_pending_lines.end() - static_cast<std::ptrdiff_t>(m_lines.capacity()));
+    }
+
+    // Make the room first, within a single removal, so the view doesn't relayout per line
+    const auto new_count = m_pending_lines.size();
+    const auto old_count = m_lines.size();
+    if (old_count + new_count > m_lines.capacity()) {
+        const auto drop_count = old_count + new_count - m_lines.capacity();
+        beginRemoveRows({}, 0, static_cast<int>(drop_count) - 1);
+        m_lines.drop_front(drop_count);
+        endRemoveRows();
+    }
+
+    const auto first_row = static_cast<int>(m_lines.size());
+    beginInsertRows({}, first_row, first_row + static_cast<int>(new_count) - 1);
+    for (auto&& line : m_pending_lines) {
+        m_lines.push_back(std::move(line));
+    }
+    endInsertRows();
+    m_pending_lines.clear();
+}
+
+void BuildLogModel::finish(bool is_success) noexcept {
+    /* clang-format off */
+    if (m_is_finished) { return; }
+    /* clang-format on */
+
+    // Output of the sibling command must not get into this log
+    if (m_process) {
+        disconnect(m_process, nullptr, this, nullptr);
+        m_process = nullptr;
+    }
+    for (auto&& partial_line : m_partial_lines) {
+        if (!partial_line.empty()) {
+            append_line(partial_line);
+            partial_line.clear();
+        }
+    }
+    flush_pending_lines();
+    m_log_writer.close();
+
+    m_is_finished = true;
+    m_is_success  = is_success;
+    emit finished(is_success);
+}
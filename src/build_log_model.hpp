@@ -0,0 +1,124 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BUILD_LOG_MODEL_HPP
+#define BUILD_LOG_MODEL_HPP
+
+#include "build_log.hpp"
+
+#include <array>        // for array
+#include <cstdint>      // for uint32_t
+#include <functional>   // for function
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QAbstractListModel>
+#include <QPointer>
+#include <QProcess>
+#include <QTimer>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/// Output of the build or install command, line per row.
+///
+/// The output is collected into batches, and only the last lines are kept
+/// in memory, so the view stays responsive with any amount of output.
+/// The whole output goes into the compressed log on the disk as it arrives.
+class BuildLogModel final : public QAbstractListModel {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(BuildLogModel)
+ public:
+    /// Receives the raw output of the process, in chunks as they are read.
+    using output_cb_t = std::function<void(std::string_view)>;
+
+    /// @param log_path Path of the compressed log (see build_log::make_log_path).
+    explicit BuildLogModel(std::string log_path, QObject* parent = nullptr);
+    ~BuildLogModel() override = default;
+
+    int rowCount(const QModelIndex& parent = {}) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    /// @brief Read stdout and stderr of the process, until finish is called.
+    /// @param on_output The callback, which gets the same output (e.g for the telemetry).
+    void follow_process(QProcess* process, output_cb_t on_output = {}) noexcept;
+
+    /// @brief Add the output, it's shown with the next batch.
+    void append_output(std::string_view output, QProcess::ProcessChannel channel) noexcept;
+
+    /// @brief Show the rest of the output, and close the log.
+    void finish(bool is_success) noexcept;
+
+    /* clang-format off */
+    auto get_log_path() const noexcept -> const std::string&
+    { return m_log_path; }
+
+    auto get_progress() const noexcept -> const BuildProgress&
+    { return m_progress; }
+
+    std::uint32_t get_compiled_count() const noexcept
+    { return m_compiled_count; }
+
+    bool is_finished() const noexcept
+    { return m_is_finished; }
+
+    bool is_success() const noexcept
+    { return m_is_success; }
+    /* clang-format on */
+
+ signals:
+    /// Emitted at most once per batch, when the progress or the compiled count has changed.
+    void progress_changed();
+    void finished(bool is_success);
+
+ private:
+    void append_line(std::string_view line) noexcept;
+    void flush_pending_lines() noexcept;
+
+    std::string m_log_path{};
+    CompressedLogWriter m_log_writer{};
+    LogRingBuffer m_lines;
+    std::vector<std::string> m_pending_lines{};
+    // the last incomplete line of stdout and stderr, they are split separately
+    std::array<std::string, 2> m_partial_lines{};
+    QTimer m_flush_timer{};
+    QPointer<QProcess> m_process{};
+
+    BuildProgress m_progress{};
+    std::uint32_t m_compiled_count{};
+    bool m_is_progress_changed{};
+    bool m_is_finished{};
+    bool m_is_success{};
+};
+
+#endif  // BUILD_LOG_MODEL_HPP
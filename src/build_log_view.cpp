@@ -0,0 +1,121 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "build_log_view.hpp"
+
+#include <utility>  // for move
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QDialogButtonBox>
+#include <QFontDatabase>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QVBoxLayout>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+BuildLogView::BuildLogView(std::shared_ptr<BuildLogModel> log_model, const QString& title, QWidget* parent)
+  : QWidget(parent, Qt::Window), m_log_model(std::move(log_model)) {
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(title);
+    resize(900, 600);
+
+    m_status_label = new QLabel(tr("Running..."), this);
+    m_progress_bar = new QProgressBar(this);
+    m_progress_bar->setRange(0, 0);
+
+    // Every row has the same height, so the view lays out only the visible rows
+    m_list_view = new QListView(this);
+    m_list_view->setModel(m_log_model.get());
+    m_list_view->setUniformItemSizes(true);
+    m_list_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    m_list_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_list_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_list_view->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+
+    auto* log_path_label = new QLabel(tr("Full log: %1").arg(QString::fromStdString(m_log_model->get_log_path())), this);
+    log_path_label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    auto* button_box = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    connect(button_box, &QDialogButtonBox::rejected, this, &QWidget::close);
+
+    auto* main_layout = new QVBoxLayout(this);
+    main_layout->addWidget(m_status_label);
+    main_layout->addWidget(m_progress_bar);
+    main_layout->addWidget(m_list_view, 1);
+    main_layout->addWidget(log_path_label);
+    main_layout->addWidget(button_box);
+
+    // Follow the output only, if the user is at the bottom already
+    auto* scroll_bar = m_list_view->verticalScrollBar();
+    connect(m_log_model.get(), &QAbstractItemModel::rowsAboutToBeInserted, this, [this, scroll_bar] {
+        m_is_following = scroll_bar->value() == scroll_bar->maximum();
+    });
+    connect(m_log_model.get(), &QAbstractItemModel::rowsInserted, this, [this] {
+        if (m_is_following) {
+            m_list_view->scrollToBottom();
+        }
+    });
+    connect(m_log_model.get(), &BuildLogModel::progress_changed, this, &BuildLogView::update_progress);
+    connect(m_log_model.get(), &BuildLogModel::finished, this, &BuildLogView::on_finished);
+
+    // The log might be opened after the build is done
+    if (m_log_model->is_finished()) {
+        on_finished(m_log_model->is_success());
+    } else {
+        update_progress();
+    }
+    m_list_view->scrollToBottom();
+}
+
+void BuildLogView::update_progress() noexcept {
+    const auto& progress = m_log_model->get_progress();
+    if (progress.total != 0) {
+        m_progress_bar->setRange(0, static_cast<int>(progress.total));
+        m_progress_bar->setValue(static_cast<int>(progress.current));
+        m_progress_bar->setFormat(QStringLiteral("%v/%m"));
+        return;
+    }
+
+    // Kbuild doesn't report the total, show the activity instead
+    m_progress_bar->setRange(0, 0);
+    if (const auto compiled_count = m_log_model->get_compiled_count(); compiled_count != 0) {
+        m_status_label->setText(tr("Running... compiled %1 files").arg(compiled_count));
+    }
+}
+
+void BuildLogView::on_finished(bool is_success) noexcept {
+    m_status_label->setText(is_success ? tr("Finished successfully") : tr("Failed, see the log for details"));
+    m_progress_bar->setRange(0, 1);
+    m_progress_bar->setValue(is_success ? 1 : 0);
+    m_progress_bar->setFormat(is_success ? QStringLiteral("%p%") : QString{});
+}
@@ -0,0 +1,70 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BUILD_LOG_VIEW_HPP
+#define BUILD_LOG_VIEW_HPP
+
+#include "build_log_model.hpp"
+
+#include <memory>  // for shared_ptr
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QLabel>
+#include <QListView>
+#include <QProgressBar>
+#include <QWidget>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/// Window with the output of the single build or install.
+///
+/// The view follows the new output, unless the user has scrolled up.
+/// It keeps the log alive, so it can be read after the build is done.
+class BuildLogView final : public QWidget {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(BuildLogView)
+ public:
+    BuildLogView(std::shared_ptr<BuildLogModel> log_model, const QString& title, QWidget* parent = nullptr);
+    ~BuildLogView() override = default;
+
+ private:
+    void update_progress() noexcept;
+    void on_finished(bool is_success) noexcept;
+
+    std::shared_ptr<BuildLogModel> m_log_model{};
+    QLabel* m_status_label{nullptr};
+    QProgressBar* m_progress_bar{nullptr};
+    QListView* m_list_view{nullptr};
+    bool m_is_following{true};
+};
+
+#endif  // BUILD_LOG_VIEW_HPP
@@ -0,0 +1,398 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "build_queue.hpp"
+#include "build_log.hpp"
+#include "utils.hpp"
+
+#include <cerrno>   // for errno
+#include <cstdlib>  // for mkdtemp
+#include <cstring>  // for strerror
+
+#include <algorithm>    // for max, min, find_if, all_of
+#include <array>        // for array
+#include <chrono>       // for seconds, days
+#include <filesystem>   // for path, copy, remove_all, last_write_time
+#include <fstream>      // for ifstream
+#include <limits>       // for numeric_limits
+#include <ranges>       // for ranges::*
+#include <string_view>  // for string_view
+#include <thread>       // for hardware_concurrency
+#include <utility>      // for move
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Rough requirements of the single kernel build, to keep the machine usable.
+static constexpr std::size_t CORES_PER_BUILD       = 4;
+static constexpr std::uint64_t MEMORY_PER_BUILD_KB = 4ULL * 1024 * 1024;
+
+// Enough to keep objects of a few kernel variants around.
+static constexpr std::string_view COMPILER_CACHE_MAX_SIZE = "20G";
+static constexpr std::string_view COMPILER_CACHE_LOG      = ".ccache-stats.log";
+
+// Output of the build in the terminal is captured there, while still going to the terminal.
+static constexpr std::string_view BUILD_LOG      = ".build.log";
+static constexpr std::string_view BUILD_PID_FILE = ".build-pid";
+static constexpr auto SAMPLE_INTERVAL            = std::chrono::seconds{1};
+
+// Work trees of the builds, which are long done, the packages are installed or copied out by then.
+// Way longer than any build takes, so the trees of running builds of other instances are never touched.
+static constexpr auto WORK_TREE_MAX_AGE = std::chrono::days{3};
+
+// These options stop the build in the console UI of the kernel config
+static constexpr std::array<std::string_view, 2> TERMINAL_OPTIONS{"_makenconfig=y", "_makemenuconfig=y"};
+
+bool needs_terminal(std::string_view options_set) noexcept {
+    for (auto&& var_assign : utils::make_split_view(options_set, '\n')) {
+        if (std::ranges::find(TERMINAL_OPTIONS, var_assign) != TERMINAL_OPTIONS.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Get MemAvailable from /proc/meminfo in kB.
+auto get_available_memory_kb() noexcept -> std::uint64_t {
+    std::ifstream meminfo{"/proc/meminfo"};
+
+    std::string field_name{};
+    std::uint64_t field_value{};
+    while (meminfo >> field_name >> field_value) {
+        if (field_name == "MemAvailable:") {
+            return field_value;
+        }
+        // skip the unit
+        meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return 0;
+}
+
+auto get_cores_count() noexcept -> std::size_t {
+    return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+// Shared between all builds, so the kernel tarball is downloaded only once.
+void prune_old_work_trees(const fs::path& builds_path) noexcept {
+    const auto& now = fs::file_time_type::clock::now();
+
+    std::error_code err_code{};
+    for (auto&& dir_entry : fs::directory_iterator{builds_path, err_code}) {
+        const auto& last_write_time = dir_entry.last_write_time(err_code);
+        if (!err_code && dir_entry.is_directory(err_code) && now - last_write_time > WORK_TREE_MAX_AGE) {
+            fs::remove_all(dir_entry.path(), err_code);
+        }
+    }
+}
+
+auto get_sources_path() noexcept -> const std::string& {
+    static const auto sources_path = utils::fix_path("~/.cache/cachyos-km/sources");
+    return sources_path;
+}
+
+// Shared between all builds, that way rebuild with one option toggled reuses most of the objects.
+auto get_compiler_cache_path() noexcept -> const std::string& {
+    static const auto compiler_cache_path = utils::fix_path("~/.cache/cachyos-km/ccache");
+    return compiler_cache_path;
+}
+
+// Each compilation is logged by ccache as '# <input file>' followed by its result,
+// so we get stats only of this build, even if other builds share the cache.
+auto parse_compiler_cache_log(const std::string& stats_log_path) noexcept -> CompilerCacheStats {
+    using namespace std::string_view_literals;
+
+    CompilerCacheStats cache_stats{};
+    const auto& stats_log = utils::read_whole_file(stats_log_path);
+    for (auto&& line : utils::make_split_view(stats_log, '\n')) {
+        if (line == "direct_cache_hit"sv || line == "preprocessed_cache_hit"sv) {
+            ++cache_stats.hits;
+        } else if (line == "cache_miss"sv) {
+            ++cache_stats.misses;
+        }
+    }
+    return cache_stats;
+}
+
+auto get_compiler_cache_exports(const std::string& work_path) noexcept -> std::string {
+    const auto& compiler_cache_path = get_compiler_cache_path();
+
+    std::error_code err_code{};
+    fs::create_directories(compiler_cache_path, err_code);
+
+    // Masquerade directory puts ccache in front of gcc/clang, kernel Makefile picks them up from PATH.
+    // Every build has its own work tree, paths are rewritten relative to it to get hits between builds.
+    // Sources are extracted fresh on each build (--cleanbuild), so mtime of headers is meaningless.
+    return fmt::format(FMT_COMPILE(" PATH=/usr/lib/ccache/bin:\"$PATH\" {} {} {} {} {} {}"),
+        utils::shell_quote(fmt::format(FMT_COMPILE("CCACHE_DIR={}"), compiler_cache_path)),
+        utils::shell_quote(fmt::format(FMT_COMPILE("CCACHE_BASEDIR={}"), work_path)),
+        utils::shell_quote(fmt::format(FMT_COMPILE("CCACHE_STATSLOG={}/{}"), work_path, COMPILER_CACHE_LOG)),
+        "CCACHE_NOHASHDIR=1", "CCACHE_SLOPPINESS=time_macros,include_file_mtime,include_file_ctime",
+        fmt::format(FMT_COMPILE("CCACHE_MAXSIZE={}"), COMPILER_CACHE_MAX_SIZE));
+}
+
+}  // namespace
+
+BuildQueue::BuildQueue(QObject* parent)
+  : QObject(parent), m_max_parallel_builds(get_max_parallel_builds()) {
+    m_sample_timer.setInterval(SAMPLE_INTERVAL);
+    connect(&m_sample_timer, &QTimer::timeout, this, &BuildQueue::sample_running_jobs);
+}
+
+BuildQueue::~BuildQueue() {
+    // Logs might outlive the queue in their views, they must not follow the processes anymore
+    for (auto&& running_job : m_running) {
+        if (running_job.log) {
+            running_job.log->finish(false);
+        }
+    }
+}
+
+auto BuildQueue::get_max_parallel_builds() noexcept -> std::size_t {
+    const auto by_cores  = get_cores_count() / CORES_PER_BUILD;
+    const auto by_memory = static_cast<std::size_t>(get_available_memory_kb() / MEMORY_PER_BUILD_KB);
+    return std::max<std::size_t>(std::min(by_cores, by_memory), 1);
+}
+
+bool BuildQueue::is_compiler_cache_available() noexcept {
+    std::error_code err_code{};
+    return fs::exists("/usr/lib/ccache/bin", err_code);
+}
+
+auto BuildQueue::make_work_tree(std::string_view pkgbuild_dir) noexcept -> std::string {
+    static const fs::path builds_path = utils::fix_path("~/.cache/cachyos-km/builds");
+
+    std::error_code err_code{};
+    fs::create_directories(builds_path, err_code);
+    prune_old_work_trees(builds_path);
+
+    // Unique name, other instances (e.g the CLI) create their trees in the same dir
+    const auto& src_path = fs::absolute(fs::path{pkgbuild_dir}, err_code);
+    auto work_path_str   = (builds_path / fmt::format(FMT_COMPILE("{}-XXXXXX"), src_path.filename().string())).string();
+    if (::mkdtemp(work_path_str.data()) == nullptr) {
+        fmt::print(stderr, "[BUILDQUEUE] failed to create '{}': {}\n", work_path_str, std::strerror(errno));
+        return {};
+    }
+    const fs::path work_path{work_path_str};
+
+    for (auto&& dir_entry : fs::directory_iterator{src_path, err_code}) {
+        // Skip build artifacts, if someone has built in the checkout directly
+        const auto& entry_name = dir_entry.path().filename().string();
+        if (entry_name == "src" || entry_name == "pkg" || entry_name.ends_with(".pkg.tar.zst")) {
+            continue;
+        }
+        fs::copy(dir_entry.path(), work_path / entry_name, fs::copy_options::recursive | fs::copy_options::copy_symlinks, err_code);
+        if (err_code) {
+            fmt::print(stderr, "[BUILDQUEUE] failed to copy '{}': {}\n", dir_entry.path().string(), err_code.message());
+            return {};
+        }
+    }
+    return work_path.string();
+}
+
+auto BuildQueue::get_build_exports(const BuildJob& job, std::size_t make_jobs) noexcept -> std::string {
+    const auto& sources_path = get_sources_path();
+
+    std::error_code err_code{};
+    fs::create_directories(sources_path, err_code);
+
+    // Options are exported only into the shell of this build, never into our own environment
+    std::string exports{"export"};
+    for (auto&& var_assign : utils::make_split_view(job.options_set, '\n')) {
+        exports += fmt::format(FMT_COMPILE(" {}"), utils::shell_quote(var_assign));
+    }
+    auto make_flags = fmt::format(FMT_COMPILE("MAKEFLAGS=-j{}"), make_jobs);
+    if (job.resources.load_limit != 0) {
+        make_flags += fmt::format(FMT_COMPILE(" -l{}"), job.resources.load_limit);
+    }
+    exports += fmt::format(FMT_COMPILE(" {} {}"), utils::shell_quote(fmt::format(FMT_COMPILE("SRCDEST={}"), sources_path)),
+        utils::shell_quote(make_flags));
+    if (job.use_compiler_cache) {
+        exports += get_compiler_cache_exports(job.work_path);
+    }
+    return exports;
+}
+
+auto BuildQueue::get_resource_limits_prefix(const BuildResources& resources) noexcept -> std::string {
+    std::string prefix{};
+    if (resources.memory_limit_gib != 0) {
+        std::error_code err_code{};
+        if (fs::exists("/usr/bin/systemd-run", err_code)) {
+            // Own cgroup, that way OOM killer picks the build instead of the desktop, and no swap thrashing
+            prefix += fmt::format(FMT_COMPILE("systemd-run --user --scope --quiet -p MemoryMax={}G -p MemorySwapMax=0 -- "), resources.memory_limit_gib);
+        } else {
+            fmt::print(stderr, "[BUILDQUEUE] systemd-run is not available, ignoring memory limit\n");
+        }
+    }
+    if (!resources.cpu_affinity.empty()) {
+        const bool is_valid_cpu_list = std::ranges::all_of(resources.cpu_affinity, [](char ch) { return (ch >= '0' && ch <= '9') || ch == ',' || ch == '-'; });
+        if (is_valid_cpu_list) {
+            prefix += fmt::format(FMT_COMPILE("taskset -c {} "), resources.cpu_affinity);
+        } else {
+            fmt::print(stderr, "[BUILDQUEUE] invalid CPU list '{}', ignoring CPU affinity\n", resources.cpu_affinity);
+        }
+    }
+    if (resources.low_priority) {
+        prefix += "nice -n 19 ionice -c 3 ";
+    }
+    return prefix;
+}
+
+void BuildQueue::enqueue(BuildJob job) noexcept {
+    m_queued.emplace_back(std::move(job));
+    start_pending_jobs();
+    emit state_changed();
+}
+
+void BuildQueue::start_pending_jobs() noexcept {
+    while (!m_queued.empty() && m_running.size() < m_max_parallel_builds) {
+        auto job = std::move(m_queued.front());
+        m_queued.pop_front();
+        start_job(std::move(job));
+    }
+}
+
+void BuildQueue::start_job(BuildJob job) noexcept {
+    const auto& sources_path = get_sources_path();
+
+    std::error_code err_code{};
+    fs::remove(fs::path{job.work_path} / ".done-status", err_code);
+    fs::remove(fs::path{job.work_path} / COMPILER_CACHE_LOG, err_code);
+    fs::remove(fs::path{job.work_path} / BUILD_LOG, err_code);
+    fs::remove(fs::path{job.work_path} / BUILD_PID_FILE, err_code);
+
+    const auto& resources = job.resources;
+    const auto make_jobs  = (resources.jobs != 0) ? std::size_t{resources.jobs} : std::max<std::size_t>(get_cores_count() / m_max_parallel_builds, 1);
+    auto exports          = get_build_exports(job, make_jobs);
+
+    const bool use_terminal = needs_terminal(job.options_set);
+    if (!use_terminal) {
+        // There is no terminal to ask the password in, makepkg installs dependencies through polkit then
+        exports += " PACMAN_AUTH=pkexec";
+    }
+
+    // Download stage is serialized with the lock, that way concurrent builds don't fetch the same sources.
+    const auto& fetch_lock    = utils::shell_quote(fmt::format(FMT_COMPILE("{}/.fetch.lock"), sources_path));
+    const auto& makepkg_flags = use_terminal ? std::string_view{} : std::string_view{" --nocolor --noconfirm"};
+    const auto& makepkg_cmd   = fmt::format(FMT_COMPILE("flock {} makepkg --verifysource --skipchecksums{}"
+                                                        " && makepkg -scf --cleanbuild --skipchecksums{}"),
+          fetch_lock, makepkg_flags, makepkg_flags);
+    const auto& pid_path      = fmt::format(FMT_COMPILE("{}/{}"), job.work_path, BUILD_PID_FILE);
+
+    auto process = std::make_unique<QProcess>();
+    process->setWorkingDirectory(QString::fromStdString(job.work_path));
+
+    std::unique_ptr<BuildTelemetry> telemetry{};
+    std::shared_ptr<BuildLogModel> log_model{};
+    if (use_terminal) {
+        // script keeps the terminal interactive (e.g menuconfig), while logging the output for the telemetry.
+        const auto& build_cmd = fmt::format(FMT_COMPILE("{}; echo $$ > {}; {}script -qefc {} {}"
+                                                        " && touch .done-status; read -p 'Press enter to exit'"),
+            exports, BUILD_PID_FILE, get_resource_limits_prefix(resources), utils::shell_quote(makepkg_cmd), BUILD_LOG);
+        process->setProgram(QStringLiteral("/usr/lib/cachyos-kernel-manager/terminal-helper"));
+        process->setArguments({QString::fromStdString(build_cmd)});
+        telemetry = std::make_unique<BuildTelemetry>(fmt::format(FMT_COMPILE("{}/{}"), job.work_path, BUILD_LOG), pid_path);
+    } else {
+        // The output is read directly, it goes into the log and the telemetry
+        const auto& build_cmd = fmt::format(FMT_COMPILE("{}; echo $$ > {}; {}bash -c {}"),
+            exports, BUILD_PID_FILE, get_resource_limits_prefix(resources), utils::shell_quote(makepkg_cmd));
+        process->setProgram(QStringLiteral("/bin/bash"));
+        process->setArguments({QStringLiteral("-c"), QString::fromStdString(build_cmd)});
+        process->setStandardInputFile(QProcess::nullDevice());
+        telemetry = std::make_unique<BuildTelemetry>(std::string{}, pid_path);
+        log_model = std::make_shared<BuildLogModel>(build_log::make_log_path(job.name));
+        log_model->follow_process(process.get(), [telemetry_ptr = telemetry.get()](std::string_view output) { telemetry_ptr->add_output(output); });
+    }
+
+    auto* process_ptr = process.get();
+    connect(process_ptr, &QProcess::finished, this, [this, process_ptr] { on_job_finished(process_ptr); });
+
+    fmt::print("[BUILDQUEUE] starting build of '{}' in '{}'\n", job.name, job.work_path);
+    process->start();
+    const auto& job_name = QString::fromStdString(job.name);
+    m_running.emplace_back(RunningJob{.job = std::move(job), .make_jobs = make_jobs, .process = std::move(process), .telemetry = std::move(telemetry), .log = log_model});
+    if (!m_sample_timer.isActive()) {
+        m_sample_timer.start();
+    }
+    emit job_started(job_name, std::move(log_model));
+}
+
+void BuildQueue::sample_running_jobs() noexcept {
+    for (auto&& running_job : m_running) {
+        running_job.telemetry->sample();
+    }
+}
+
+void BuildQueue::on_job_finished(QProcess* process) noexcept {
+    auto running_it = std::ranges::find_if(m_running, [process](auto&& running_job) { return running_job.process.get() == process; });
+    /* clang-format off */
+    if (running_it == m_running.end()) { return; }
+    /* clang-format on */
+
+    auto running_job = std::move(*running_it);
+    auto& job        = running_job.job;
+    m_running.erase(running_it);
+    if (m_running.empty()) {
+        m_sample_timer.stop();
+    }
+
+    // The terminal waits for the user, so the status is left by the build itself
+    const auto& done_status_path = fs::path{job.work_path} / ".done-status";
+    std::error_code err_code{};
+    const bool is_success = running_job.log ? (process->exitStatus() == QProcess::NormalExit && process->exitCode() == 0)
+                                            : fs::exists(done_status_path, err_code);
+    fs::remove(done_status_path, err_code);
+    if (running_job.log) {
+        running_job.log->finish(is_success);
+    }
+    // We are inside of the process signal, so it must not be destroyed right away
+    running_job.process.release()->deleteLater();
+
+    CompilerCacheStats cache_stats{};
+    if (job.use_compiler_cache) {
+        cache_stats = parse_compiler_cache_log(fmt::format(FMT_COMPILE("{}/{}"), job.work_path, COMPILER_CACHE_LOG));
+        fmt::print("[BUILDQUEUE] compiler cache of '{}': {} hits, {} misses\n", job.name, cache_stats.hits, cache_stats.misses);
+    }
+
+    const auto& record_path = telemetry::write_build_record(BuildRecord{
+        .name                  = job.name,
+        .options_set           = job.options_set,
+        .make_jobs             = running_job.make_jobs,
+        .parallel_builds       = m_max_parallel_builds,
+        .use_compiler_cache    = job.use_compiler_cache,
+        .compiler_cache_hits   = cache_stats.hits,
+        .compiler_cache_misses = cache_stats.misses,
+        .is_success            = is_success,
+        .phases                = running_job.telemetry->finish(),
+    });
+    if (!record_path.empty()) {
+        fmt::print("[BUILDQUEUE] build record of '{}' is saved to '{}'\n", job.name, record_path);
+    }
+
+    fmt::print("[BUILDQUEUE] build of '{}' {}\n", job.name, is_success ? "succeeded" : "failed");
+    emit job_finished(QString::fromStdString(job.work_path), is_success);
+    if (job.use_compiler_cache) {
+        emit compiler_cache_finished(QString::fromStdString(job.name), cache_stats);
+    }
+
+    start_pending_jobs();
+    emit state_changed();
+}
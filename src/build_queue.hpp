@@ -0,0 +1,165 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BUILD_QUEUE_HPP
+#define BUILD_QUEUE_HPP
+
+#include "build_log_model.hpp"
+#include "build_telemetry.hpp"
+
+#include <cstdint>      // for uint32_t
+#include <deque>        // for deque
+#include <memory>       // for unique_ptr, shared_ptr
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/// Resource limits of the single build, zero or empty means no limit.
+struct BuildResources {
+    /// Number of make jobs, zero means the cores are split between parallel builds.
+    std::uint32_t jobs{};
+    /// Load average, above which make doesn't start new jobs.
+    std::uint32_t load_limit{};
+    /// Memory ceiling of the whole build, enforced with the cgroup of transient systemd scope.
+    std::uint32_t memory_limit_gib{};
+    /// CPU list in taskset format (e.g '0-7,16-23').
+    std::string cpu_affinity{};
+    /// Run with idle IO class and the lowest CPU priority.
+    bool low_priority{};
+};
+
+/// Single kernel build.
+struct BuildJob {
+    /// Name to show to the user (e.g linux-cachyos-bore).
+    std::string name{};
+    /// Own copy of the PKGBUILD directory, the build happens inside of it.
+    std::string work_path{};
+    /// The variable assignments (e.g "_cachy_config=y\n"), exported only for this build.
+    std::string options_set{};
+    /// Compile through ccache, which is shared between all builds.
+    bool use_compiler_cache{};
+    BuildResources resources{};
+};
+
+/// Compiler cache results of the single build.
+struct CompilerCacheStats {
+    std::uint32_t hits{};
+    std::uint32_t misses{};
+};
+
+/// Runs kernel builds in parallel, as many as the machine can handle.
+///
+/// Every build runs in its own working tree, the options are exported only
+/// into the shell of that build. Output is streamed into the log of the build,
+/// only the interactive configuration (nconfig, menuconfig) needs a terminal.
+/// Sources are downloaded into the shared directory one build at a time, so the
+/// same kernel tarball is downloaded only once. Resource usage of each build is
+/// recorded per phase.
+class BuildQueue final : public QObject {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(BuildQueue)
+ public:
+    explicit BuildQueue(QObject* parent = nullptr);
+    ~BuildQueue() override;
+
+    /// @brief Create an isolated copy of the PKGBUILD directory for the new build.
+    /// The name is unique across instances, trees older than a few days are removed on the way.
+    /// @param pkgbuild_dir The directory in the PKGBUILDs checkout.
+    /// @return Path of the copy, or empty string on failure.
+    static auto make_work_tree(std::string_view pkgbuild_dir) noexcept -> std::string;
+
+    /// @brief Add the build into the queue, it starts as soon as there is a free slot.
+    void enqueue(BuildJob job) noexcept;
+
+    /* clang-format off */
+    std::size_t running_count() const noexcept
+    { return m_running.size(); }
+
+    std::size_t queued_count() const noexcept
+    { return m_queued.size(); }
+
+    bool is_idle() const noexcept
+    { return m_running.empty() && m_queued.empty(); }
+    /* clang-format on */
+
+    /// @brief Get number of builds, which can run at the same time on this machine.
+    static auto get_max_parallel_builds() noexcept -> std::size_t;
+
+    /// @brief Check if ccache is installed.
+    static bool is_compiler_cache_available() noexcept;
+
+    /// @brief Make the 'export ...' command of the build: the options, MAKEFLAGS, sources and compiler cache dirs.
+    /// Shared with the CLI, which builds without the queue.
+    /// @param make_jobs Number of make jobs, the resources of the job don't override it.
+    static auto get_build_exports(const BuildJob& job, std::size_t make_jobs) noexcept -> std::string;
+
+    /// @brief Make the prefix of the command, which applies the limits to every process of the build.
+    static auto get_resource_limits_prefix(const BuildResources& resources) noexcept -> std::string;
+
+ signals:
+    /// Emitted when the build has started, log is null if the build runs in the terminal.
+    void job_started(const QString& name, std::shared_ptr<BuildLogModel> log_model);
+    /// Emitted when the build has finished, successfully or not.
+    void job_finished(const QString& work_path, bool is_success);
+    /// Emitted after job_finished, if the build used compiler cache.
+    void compiler_cache_finished(const QString& name, CompilerCacheStats cache_stats);
+    /// Emitted when amount of running or queued builds changes.
+    void state_changed();
+
+ private:
+    struct RunningJob {
+        BuildJob job{};
+        std::size_t make_jobs{};
+        std::unique_ptr<QProcess> process{};
+        std::unique_ptr<BuildTelemetry> telemetry{};
+        std::shared_ptr<BuildLogModel> log{};
+    };
+
+    void start_pending_jobs() noexcept;
+    void start_job(BuildJob job) noexcept;
+    void on_job_finished(QProcess* process) noexcept;
+    void sample_running_jobs() noexcept;
+
+    std::deque<BuildJob> m_queued{};
+    std::vector<RunningJob> m_running{};
+    std::size_t m_max_parallel_builds{1};
+    QTimer m_sample_timer{};
+};
+
+#endif  // BUILD_QUEUE_HPP
@@ -0,0 +1,383 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "build_telemetry.hpp"
+#include "utils.hpp"
+
+#include <unistd.h>  // for sysconf, gethostname
+
+#include <algorithm>      // for max, all_of
+#include <array>          // for array
+#include <charconv>       // for from_chars
+#include <filesystem>     // for directory_iterator, create_directories, exists
+#include <fstream>        // for ifstream
+#include <optional>       // for optional
+#include <thread>         // for hardware_concurrency
+#include <unordered_map>  // for unordered_map, unordered_multimap
+#include <utility>        // for move
+
+#include <fmt/chrono.h>
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Messages of makepkg, which mark the beginning of the phase.
+struct PhaseMarker {
+    std::string_view message;
+    BuildPhase phase;
+};
+static constexpr std::array<PhaseMarker, 5> PHASE_MARKERS{{
+    {"Retrieving sources...", BuildPhase::download},
+    {"Extracting sources...", BuildPhase::prepare},
+    {"Starting build()...", BuildPhase::compile},
+    {"Entering fakeroot environment...", BuildPhase::package},
+    {"Starting package", BuildPhase::package},
+}};
+static constexpr std::string_view FINISHED_MARKER = "Finished making:";
+
+struct ProcStat {
+    pid_t ppid{};
+    std::uint64_t cpu_ticks{};
+    std::uint64_t rss_pages{};
+};
+
+template <typename T>
+auto parse_number(std::string_view str) noexcept -> T {
+    T value{};
+    std::from_chars(str.data(), str.data() + str.size(), value);
+    return value;
+}
+
+// Format of /proc/<pid>/stat: 'pid (comm) state ppid ...', comm may contain spaces.
+auto read_proc_stat(const fs::path& proc_path) noexcept -> std::optional<ProcStat> {
+    std::ifstream stat_file{proc_path / "stat"};
+    std::string stat_line{};
+    if (!std::getline(stat_file, stat_line)) {
+        return std::nullopt;
+    }
+    const auto comm_end = stat_line.rfind(')');
+    /* clang-format off */
+    if (comm_end == std::string::npos || comm_end + 2 >= stat_line.size()) { return std::nullopt; }
+    /* clang-format on */
+
+    // Fields after comm, starting from the state (3rd field)
+    const auto& fields = utils::make_multiline_view(std::string_view{stat_line}.substr(comm_end + 2), ' ');
+    if (fields.size() < 22) {
+        return std::nullopt;
+    }
+
+    // utime, stime, cutime and cstime are 14-17th fields, rss is 24th
+    return ProcStat{
+        .ppid      = parse_number<pid_t>(fields[1]),
+        .cpu_ticks = parse_number<std::uint64_t>(fields[11]) + parse_number<std::uint64_t>(fields[12])
+            + parse_number<std::uint64_t>(fields[13]) + parse_number<std::uint64_t>(fields[14]),
+        .rss_pages = parse_number<std::uint64_t>(fields[21]),
+    };
+}
+
+// Children are listed per thread, in '/proc/<pid>/task/<tid>/children' as 'pid pid ...'
+void read_child_pids(const fs::path& proc_path, std::vector<pid_t>& child_pids) noexcept {
+    std::error_code err_code{};
+    for (auto&& task_entry : fs::directory_iterator{proc_path / "task", err_code}) {
+        std::ifstream children_file{task_entry.path() / "children"};
+        for (pid_t child_pid{}; children_file >> child_pid;) {
+            child_pids.push_back(child_pid);
+        }
+    }
+}
+
+auto get_hostname() noexcept -> std::string {
+    std::array<char, 256> hostname{};
+    if (::gethostname(hostname.data(), hostname.size() - 1) != 0) {
+        return {};
+    }
+    return hostname.data();
+}
+
+// Options are the variable assignments, e.g '_use_llvm_lto=thin\n'
+auto convert_options_to_json(std::string_view options_set) noexcept -> QJsonObject {
+    QJsonObject options_obj{};
+    for (auto&& var_assign : utils::make_split_view(options_set, '\n')) {
+        const auto pos = var_assign.find('=');
+        /* clang-format off */
+        if (pos == std::string_view::npos) { continue; }
+        /* clang-format on */
+        options_obj.insert(QString::fromUtf8(var_assign.data(), static_cast<qsizetype>(pos)),
+            QString::fromUtf8(var_assign.data() + pos + 1, static_cast<qsizetype>(var_assign.size() - pos - 1)));
+    }
+    return options_obj;
+}
+
+}  // namespace
+
+BuildTelemetry::BuildTelemetry(std::string log_path, std::string pid_path) noexcept
+  : m_log_path(std::move(log_path)), m_pid_path(std::move(pid_path)), m_phase_start(std::chrono::steady_clock::now()) { }
+
+void BuildTelemetry::sample() noexcept {
+    read_new_output();
+
+    const auto& tree_usage = sample_process_tree();
+    // Once the process is gone, its CPU time can't be read anymore
+    m_last_cpu_ticks     = std::max(m_last_cpu_ticks, tree_usage.cpu_ticks);
+    m_phase_peak_rss_kib = std::max(m_phase_peak_rss_kib, tree_usage.rss_kib);
+}
+
+auto BuildTelemetry::finish() noexcept -> std::vector<BuildPhaseStats> {
+    if (m_phases.empty() || m_phases.back().phase != m_phase) {
+        sample();
+        switch_phase(m_phase);
+    }
+    return m_phases;
+}
+
+void BuildTelemetry::read_new_output() noexcept {
+    /* clang-format off */
+    if (m_log_path.empty()) { return; }
+    /* clang-format on */
+    std::ifstream log_file{m_log_path, std::ios::binary};
+    /* clang-format off */
+    if (!log_file.is_open()) { return; }
+    /* clang-format on */
+
+    log_file.seekg(static_cast<std::streamoff>(m_log_offset));
+    const std::string new_output{std::istreambuf_iterator<char>{log_file}, std::istreambuf_iterator<char>{}};
+    m_log_offset += new_output.size();
+    add_output(new_output);
+}
+
+void BuildTelemetry::add_output(std::string_view output) noexcept {
+    // The last line might be not written completely yet
+    std::string new_output{std::move(m_partial_line)};
+    new_output += output;
+    const auto last_newline = new_output.rfind('\n');
+    if (last_newline == std::string::npos) {
+        m_partial_line = std::move(new_output);
+        return;
+    }
+    m_partial_line = new_output.substr(last_newline + 1);
+    new_output.resize(last_newline);
+
+    for (auto&& line : utils::make_split_view(new_output, '\n')) {
+        // Nothing is recorded after the package is done, the terminal waits for the user then
+        if (m_phase == BuildPhase::package && line.find(FINISHED_MARKER) != std::string_view::npos) {
+            switch_phase(m_phase);
+            return;
+        }
+        for (auto&& [message, phase] : PHASE_MARKERS) {
+            // Phases only go forward, e.g download is repeated by the actual build after --verifysource
+            if (phase > m_phase && line.find(message) != std::string_view::npos) {
+                switch_phase(phase);
+                break;
+            }
+        }
+    }
+}
+
+void BuildTelemetry::switch_phase(BuildPhase phase) noexcept {
+    // Finished already
+    /* clang-format off */
+    if (!m_phases.empty() && m_phases.back().phase == m_phase) { return; }
+    /* clang-format on */
+
+    static const auto clock_ticks = static_cast<double>(std::max(::sysconf(_SC_CLK_TCK), 1L));
+
+    const auto& now = std::chrono::steady_clock::now();
+    m_phases.emplace_back(BuildPhaseStats{
+        .phase         = m_phase,
+        .wall_time_sec = std::chrono::duration<double>(now - m_phase_start).count(),
+        .cpu_time_sec  = static_cast<double>(m_last_cpu_ticks - m_phase_start_cpu_ticks) / clock_ticks,
+        .peak_rss_kib  = m_phase_peak_rss_kib,
+    });
+    /* clang-format off */
+    if (phase == m_phase) { return; }
+    /* clang-format on */
+
+    m_phase                 = phase;
+    m_phase_start           = now;
+    m_phase_start_cpu_ticks = m_last_cpu_ticks;
+    m_phase_peak_rss_kib    = 0;
+}
+
+auto BuildTelemetry::sample_process_tree() noexcept -> TreeUsage {
+    if (m_root_pid == -1) {
+        const auto& pid_content = utils::read_whole_file(m_pid_path);
+        /* clang-format off */
+        if (pid_content.empty()) { return {}; }
+        /* clang-format on */
+        m_root_pid = parse_number<pid_t>(pid_content);
+    }
+
+    static const auto page_size_kib = static_cast<std::uint64_t>(std::max(::sysconf(_SC_PAGESIZE), 4096L)) / 1024;
+    // Needs CONFIG_PROC_CHILDREN, which is enabled by the distro kernels
+    static const bool has_children_files = fs::exists("/proc/thread-self/children");
+
+    // Sum up the usage of the build shell and all of its descendants
+    TreeUsage tree_usage{};
+    const auto& add_usage = [&tree_usage](const ProcStat& proc_stat) {
+        tree_usage.cpu_ticks += proc_stat.cpu_ticks;
+        tree_usage.rss_kib += proc_stat.rss_pages * page_size_kib;
+    };
+
+    if (has_children_files) {
+        // Only the processes of the tree are read, instead of the whole /proc
+        std::vector<pid_t> pending_pids{m_root_pid};
+        while (!pending_pids.empty()) {
+            const auto pid = pending_pids.back();
+            pending_pids.pop_back();
+
+            const auto& proc_path = fs::path{"/proc"} / fmt::format(FMT_COMPILE("{}"), pid);
+            if (auto proc_stat = read_proc_stat(proc_path); proc_stat) {
+                add_usage(*proc_stat);
+                read_child_pids(proc_path, pending_pids);
+            }
+        }
+        return tree_usage;
+    }
+
+    // Fallback: the parent of each process is known only from its stat
+    std::unordered_map<pid_t, ProcStat> proc_stats{};
+    std::unordered_multimap<pid_t, pid_t> child_pids{};
+    std::error_code err_code{};
+    for (auto&& dir_entry : fs::directory_iterator{"/proc", err_code}) {
+        const auto& dir_name = dir_entry.path().filename().string();
+        /* clang-format off */
+        if (!std::ranges::all_of(dir_name, [](char ch) { return ch >= '0' && ch <= '9'; })) { continue; }
+        /* clang-format on */
+        if (auto proc_stat = read_proc_stat(dir_entry.path()); proc_stat) {
+            const auto pid = parse_number<pid_t>(dir_name);
+            child_pids.emplace(proc_stat->ppid, pid);
+            proc_stats.insert_or_assign(pid, *proc_stat);
+        }
+    }
+
+    std::vector<pid_t> pending_pids{m_root_pid};
+    while (!pending_pids.empty()) {
+        const auto pid = pending_pids.back();
+        pending_pids.pop_back();
+
+        auto proc_it = proc_stats.find(pid);
+        /* clang-format off */
+        if (proc_it == proc_stats.end()) { continue; }
+        /* clang-format on */
+        add_usage(proc_it->second);
+
+        const auto& [children_begin, children_end] = child_pids.equal_range(pid);
+        for (auto it = children_begin; it != children_end; ++it) {
+            pending_pids.push_back(it->second);
+        }
+    }
+    return tree_usage;
+}
+
+namespace telemetry {
+
+auto get_phase_name(BuildPhase phase) noexcept -> std::string_view {
+    switch (phase) {
+    case BuildPhase::download:
+        return "download";
+    case BuildPhase::prepare:
+        return "prepare";
+    case BuildPhase::compile:
+        return "compile";
+    case BuildPhase::package:
+        return "package";
+    }
+    return "unknown";
+}
+
+auto write_build_record(const BuildRecord& build_record) noexcept -> std::string {
+    static const fs::path records_path = utils::fix_path("~/.cache/cachyos-km/build-records");
+
+    const auto cores_count = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    QJsonArray phases_array{};
+    double total_wall_time_sec{};
+    for (auto&& phase_stats : build_record.phases) {
+        // Share of the whole machine, which the phase has used
+        const auto cpu_utilization = (phase_stats.wall_time_sec > 0)
+            ? phase_stats.cpu_time_sec / (phase_stats.wall_time_sec * static_cast<double>(cores_count))
+            : 0.0;
+
+        QJsonObject phase_obj{};
+        phase_obj.insert("name", QString::fromUtf8(get_phase_name(phase_stats.phase).data()));
+        phase_obj.insert("wall_time_sec", phase_stats.wall_time_sec);
+        phase_obj.insert("cpu_time_sec", phase_stats.cpu_time_sec);
+        phase_obj.insert("cpu_utilization", cpu_utilization);
+        phase_obj.insert("peak_rss_kib", static_cast<qint64>(phase_stats.peak_rss_kib));
+        phases_array.append(phase_obj);
+        total_wall_time_sec += phase_stats.wall_time_sec;
+    }
+
+    const auto& now = std::chrono::system_clock::now();
+
+    QJsonObject record_obj{};
+    record_obj.insert("name", QString::fromStdString(build_record.name));
+    record_obj.insert("timestamp", QString::fromStdString(fmt::format(FMT_COMPILE("{:%FT%TZ}"), std::chrono::floor<std::chrono::seconds>(now))));
+    record_obj.insert("hostname", QString::fromStdString(get_hostname()));
+    record_obj.insert("cores", static_cast<qint64>(cores_count));
+    record_obj.insert("make_jobs", static_cast<qint64>(build_record.make_jobs));
+    record_obj.insert("parallel_builds", static_cast<qint64>(build_record.parallel_builds));
+    record_obj.insert("options", convert_options_to_json(build_record.options_set));
+    record_obj.insert("success", build_record.is_success);
+    record_obj.insert("wall_time_sec", total_wall_time_sec);
+    record_obj.insert("phases", phases_array);
+    if (build_record.use_compiler_cache) {
+        QJsonObject cache_obj{};
+        cache_obj.insert("hits", static_cast<qint64>(build_record.compiler_cache_hits));
+        cache_obj.insert("misses", static_cast<qint64>(build_record.compiler_cache_misses));
+        record_obj.insert("compiler_cache", cache_obj);
+    }
+
+    std::error_code err_code{};
+    fs::create_directories(records_path, err_code);
+
+    const auto& record_path = records_path / fmt::format(FMT_COMPILE("{}-{:%Y%m%d-%H%M%S}.json"), build_record.name, std::chrono::floor<std::chrono::seconds>(now));
+    const auto& record_json = QJsonDocument{record_obj}.toJson();
+    if (!utils::write_to_file(record_path.string(), std::string_view{record_json.constData(), static_cast<std::size_t>(record_json.size())})) {
+        return {};
+    }
+    return record_path.string();
+}
+
+}  // namespace telemetry
@@ -0,0 +1,116 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef BUILD_TELEMETRY_HPP
+#define BUILD_TELEMETRY_HPP
+
+#include <sys/types.h>  // for pid_t
+
+#include <chrono>       // for steady_clock
+#include <cstdint>      // for uint64_t
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+/// Stage of the makepkg run, in order of execution.
+enum class BuildPhase : std::uint8_t {
+    download,
+    prepare,
+    compile,
+    package,
+};
+
+/// Resource usage of the single phase.
+struct BuildPhaseStats {
+    BuildPhase phase{};
+    double wall_time_sec{};
+    double cpu_time_sec{};
+    std::uint64_t peak_rss_kib{};
+};
+
+/// Everything about the finished build, which goes into the record.
+struct BuildRecord {
+    std::string name{};
+    std::string options_set{};
+    std::size_t make_jobs{};
+    std::size_t parallel_builds{};
+    bool use_compiler_cache{};
+    std::uint32_t compiler_cache_hits{};
+    std::uint32_t compiler_cache_misses{};
+    bool is_success{};
+    std::vector<BuildPhaseStats> phases{};
+};
+
+/// Follows the build log, and samples resource usage of the build process tree.
+///
+/// Phases are detected from the makepkg messages, e.g '==> Starting build()...'.
+/// CPU time includes already finished children (e.g compiler processes), as they
+/// are accounted to their parents, once reaped.
+class BuildTelemetry final {
+ public:
+    /// @param log_path The log, which the build writes its output into, or empty if the output is passed with add_output.
+    /// @param pid_path The file, which the build shell writes its pid into.
+    BuildTelemetry(std::string log_path, std::string pid_path) noexcept;
+
+    /// @brief Pass the output of the build, which is read by the caller.
+    void add_output(std::string_view output) noexcept;
+
+    /// @brief Read the new output of the build, and sample resource usage.
+    /// Meant to be called periodically, while the build runs.
+    void sample() noexcept;
+
+    /// @brief Take the last sample, and close the current phase.
+    /// @return Stats of all phases, which the build went through.
+    auto finish() noexcept -> std::vector<BuildPhaseStats>;
+
+ private:
+    struct TreeUsage {
+        std::uint64_t cpu_ticks{};
+        std::uint64_t rss_kib{};
+    };
+
+    void read_new_output() noexcept;
+    void switch_phase(BuildPhase phase) noexcept;
+    auto sample_process_tree() noexcept -> TreeUsage;
+
+    std::string m_log_path{};
+    std::string m_pid_path{};
+    std::string m_partial_line{};
+    std::uint64_t m_log_offset{};
+    pid_t m_root_pid{-1};
+
+    BuildPhase m_phase{BuildPhase::download};
+    std::chrono::steady_clock::time_point m_phase_start{};
+    std::uint64_t m_phase_start_cpu_ticks{};
+    std::uint64_t m_last_cpu_ticks{};
+    std::uint64_t m_phase_peak_rss_kib{};
+    std::vector<BuildPhaseStats> m_phases{};
+};
+
+namespace telemetry {
+
+/// @brief Get the name of the phase as used in the record (e.g 'compile').
+auto get_phase_name(BuildPhase phase) noexcept -> std::string_view;
+
+/// @brief Store the record of the build into ~/.cache/cachyos-km/build-records.
+/// @return Path of the record, or empty string on failure.
+auto write_build_record(const BuildRecord& build_record) noexcept -> std::string;
+
+}  // namespace telemetry
+
+#endif  // BUILD_TELEMETRY_HPP
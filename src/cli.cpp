@@ -0,0 +1,319 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "cli.hpp"
+#include "build_queue.hpp"
+#include "config-options.hpp"
+#include "kernel.hpp"
+#include "pkgbuild_evaluator.hpp"
+#include "utils.hpp"
+
+#include <unistd.h>  // for geteuid
+
+#include <cstdio>  // for fflush
+
+#include <algorithm>   // for find_if, any_of, max
+#include <filesystem>  // for is_directory
+#include <iterator>    // for next
+#include <optional>    // for optional
+#include <string>      // for string
+#include <thread>      // for hardware_concurrency
+#include <vector>      // for vector
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wnull-dereference"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+static constexpr std::int32_t EXIT_CODE_OK      = 0;
+static constexpr std::int32_t EXIT_CODE_FAILURE = 1;
+static constexpr std::int32_t EXIT_CODE_USAGE   = 2;
+
+static constexpr std::string_view DEFAULT_BUILD_KERNEL = "linux-cachyos";
+
+void print_usage() noexcept {
+    fmt::print(stderr,
+        "Usage: cachyos-kernel-manager --cli <command> [options]\n"
+        "\n"
+        "Commands:\n"
+        "  list                       List kernels from the sync databases\n"
+        "  install <kernel>...        Install kernels with their headers and modules\n"
+        "  remove <kernel>...         Remove kernels with their headers and modules\n"
+        "  build --config <file>      Build the kernel with options from the TOML config\n"
+        "        [--kernel <name>]    PKGBUILD to build (default: {})\n"
+        "        [--install]          Install the packages after successful build\n"
+        "\n"
+        "Results are printed to stdout as JSON, one object per line.\n",
+        DEFAULT_BUILD_KERNEL);
+}
+
+void print_json(const QJsonObject& json_obj) noexcept {
+    const auto& json_line = QJsonDocument{json_obj}.toJson(QJsonDocument::Compact);
+    fmt::print("{}\n", std::string_view{json_line.constData(), static_cast<std::size_t>(json_line.size())});
+    std::fflush(stdout);
+}
+
+void print_error(std::string_view action, std::string_view error_msg) noexcept {
+    print_json(QJsonObject{
+        {"action", QString::fromUtf8(action.data(), static_cast<qsizetype>(action.size()))},
+        {"success", false},
+        {"error", QString::fromUtf8(error_msg.data(), static_cast<qsizetype>(error_msg.size()))},
+    });
+}
+
+// Get value of the option (e.g '--config <file>'), or nullopt if option is not present.
+auto get_option_value(std::span<char*> args, std::string_view option_name) noexcept -> std::optional<std::string_view> {
+    auto option_it = std::ranges::find_if(args, [option_name](auto* arg) { return std::string_view{arg} == option_name; });
+    if (option_it == args.end() || std::next(option_it) == args.end()) {
+        return std::nullopt;
+    }
+    return std::string_view{*std::next(option_it)};
+}
+
+bool has_flag(std::span<char*> args, std::string_view flag_name) noexcept {
+    return std::ranges::any_of(args, [flag_name](auto* arg) { return std::string_view{arg} == flag_name; });
+}
+
+// Run the command through the shell, streaming its output into stderr.
+bool run_shell_streamed(const std::string& shell_cmd) noexcept {
+    auto&& result = utils::exec_argv({"/bin/bash", "-c", fmt::format(FMT_COMPILE("{} 2>&1"), shell_cmd)},
+        [](std::string_view line) { fmt::print(stderr, "{}\n", line); });
+    return result.is_success();
+}
+
+auto run_list(std::vector<Kernel>& kernels) noexcept -> std::int32_t {
+    for (auto&& kernel : kernels) {
+        const auto& kernel_name = kernel.get_name();
+        const auto& kernel_repo = kernel.get_repo();
+        const auto& category    = kernel.category();
+
+        // repo with the faster build for this CPU, e.g cachyos-v3
+        QString faster_repo{};
+        if (const auto* faster_kernel = Kernel::find_faster_variant(kernels, kernel, CpuFeatures::get()); faster_kernel != nullptr) {
+            faster_repo = QString::fromUtf8(faster_kernel->get_repo().data(), static_cast<qsizetype>(faster_kernel->get_repo().size()));
+        }
+        print_json(QJsonObject{
+            {"name", QString::fromUtf8(kernel_name.data(), static_cast<qsizetype>(kernel_name.size()))},
+            {"repo", QString::fromUtf8(kernel_repo.data(), static_cast<qsizetype>(kernel_repo.size()))},
+            {"category", QString::fromUtf8(category.data(), static_cast<qsizetype>(category.size()))},
+            {"version", QString::fromStdString(kernel.version())},
+            {"installed", kernel.is_installed()},
+            {"update_available", kernel.is_update_available()},
+            {"faster_repo", faster_repo},
+        });
+    }
+    return EXIT_CODE_OK;
+}
+
+auto run_transaction(std::vector<Kernel>& kernels, std::span<char*> kernel_names, bool is_install) noexcept -> std::int32_t {
+    const std::string_view action = is_install ? "install" : "remove";
+    if (kernel_names.empty()) {
+        print_usage();
+        return EXIT_CODE_USAGE;
+    }
+
+    Transaction trans{};
+    QJsonArray requested_kernels{};
+    for (auto* kernel_name_arg : kernel_names) {
+        const std::string_view kernel_name{kernel_name_arg};
+
+        auto kernel_it = std::ranges::find_if(kernels, [kernel_name](auto&& kernel) { return kernel.get_name() == kernel_name; });
+        if (kernel_it == kernels.end()) {
+            print_error(action, fmt::format(FMT_COMPILE("unknown kernel '{}'"), kernel_name));
+            return EXIT_CODE_FAILURE;
+        }
+
+        // Already in the requested state, nothing to do
+        const bool is_queued = is_install ? kernel_it->install(trans) : kernel_it->remove(trans);
+        if (is_queued) {
+            requested_kernels.append(QString::fromUtf8(kernel_name.data(), static_cast<qsizetype>(kernel_name.size())));
+        }
+    }
+
+    const bool is_success = Kernel::commit_transaction_batch(trans);
+    print_json(QJsonObject{
+        {"action", QString::fromUtf8(action.data(), static_cast<qsizetype>(action.size()))},
+        {"success", is_success},
+        {"kernels", requested_kernels},
+    });
+    return is_success ? EXIT_CODE_OK : EXIT_CODE_FAILURE;
+}
+
+auto run_build(std::span<char*> args) noexcept -> std::int32_t {
+    static constexpr std::string_view action = "build";
+
+    const auto& config_path = get_option_value(args, "--config");
+    if (!config_path) {
+        print_usage();
+        return EXIT_CODE_USAGE;
+    }
+    const auto& kernel_name = get_option_value(args, "--kernel").value_or(DEFAULT_BUILD_KERNEL);
+
+    // makepkg refuses to run as root
+    if (::geteuid() == 0) {
+        print_error(action, "building as root is not allowed");
+        return EXIT_CODE_FAILURE;
+    }
+
+    auto config_options = ConfigOptions::parse_from_file(*config_path);
+    if (!config_options) {
+        print_error(action, fmt::format(FMT_COMPILE("failed to load config '{}'"), *config_path));
+        return EXIT_CODE_FAILURE;
+    }
+    if (config_options->nconfig_check || config_options->menuconfig_check || config_options->xconfig_check || config_options->gconfig_check) {
+        print_error(action, "interactive kernel configuration is not supported in batch mode");
+        return EXIT_CODE_FAILURE;
+    }
+
+    if (!utils::prepare_build_environment()) {
+        print_error(action, "failed to clone repository");
+        return EXIT_CODE_FAILURE;
+    }
+    std::error_code err_code{};
+    if (!fs::is_directory(kernel_name, err_code)) {
+        print_error(action, fmt::format(FMT_COMPILE("unknown PKGBUILD '{}'"), kernel_name));
+        return EXIT_CODE_FAILURE;
+    }
+
+    // The checkout stays untouched, the same way as for the builds of the GUI
+    const auto& work_path = BuildQueue::make_work_tree(kernel_name);
+    if (work_path.empty()) {
+        print_error(action, "failed to prepare build directory");
+        return EXIT_CODE_FAILURE;
+    }
+    if (!config_options->custom_name_edit.empty() && !set_custom_name_in_pkgbuild(work_path, config_options->custom_name_edit)) {
+        print_error(action, "failed to set custom name in pkgbuild");
+        return EXIT_CODE_FAILURE;
+    }
+
+    const BuildJob build_job{
+        .name               = std::string{kernel_name},
+        .work_path          = work_path,
+        .options_set        = config_options->to_options_set(),
+        // Built without it, if ccache isn't installed (e.g the profile is from another machine)
+        .use_compiler_cache = config_options->compiler_cache_check && BuildQueue::is_compiler_cache_available(),
+        .resources          = {
+            .jobs             = config_options->build_jobs_spin,
+            .load_limit       = config_options->build_load_limit_spin,
+            .memory_limit_gib = config_options->build_memory_limit_spin,
+            .cpu_affinity     = config_options->build_cpu_affinity_edit,
+            .low_priority     = config_options->build_low_priority_check,
+        },
+    };
+    // The only build, so it gets all of the cores
+    const auto cores_count = std::max<std::uint32_t>(std::thread::hardware_concurrency(), 1);
+    const auto make_jobs   = (build_job.resources.jobs != 0) ? build_job.resources.jobs : cores_count;
+    const auto& build_cmd  = fmt::format(FMT_COMPILE("{}; cd {} && {}makepkg -scf --cleanbuild --skipchecksums --noconfirm"),
+        BuildQueue::get_build_exports(build_job, make_jobs), utils::shell_quote(work_path), BuildQueue::get_resource_limits_prefix(build_job.resources));
+    const bool is_built = run_shell_streamed(build_cmd);
+
+    QJsonArray package_files{};
+    bool is_installed{};
+    if (is_built) {
+        std::string pkg_globs{};
+        for (auto&& pkg_glob : get_package_names_glob_from_pkgbuild(work_path)) {
+            pkg_globs += fmt::format(FMT_COMPILE(" {}/{}"), utils::shell_quote(work_path), pkg_glob);
+            package_files.append(QString::fromStdString(fmt::format(FMT_COMPILE("{}/{}"), work_path, pkg_glob)));
+        }
+        if (has_flag(args, "--install")) {
+            is_installed = run_shell_streamed(fmt::format(FMT_COMPILE("sudo pacman -U --noconfirm{}"), pkg_globs));
+        }
+    }
+
+    const bool is_success = is_built && (is_installed || !has_flag(args, "--install"));
+    print_json(QJsonObject{
+        {"action", QString::fromUtf8(action.data(), static_cast<qsizetype>(action.size()))},
+        {"success", is_success},
+        {"kernel", QString::fromUtf8(kernel_name.data(), static_cast<qsizetype>(kernel_name.size()))},
+        {"packages", package_files},
+        {"installed", is_installed},
+    });
+    return is_success ? EXIT_CODE_OK : EXIT_CODE_FAILURE;
+}
+
+}  // namespace
+
+namespace cli {
+
+auto run(std::span<char*> args) noexcept -> std::int32_t {
+    using namespace std::string_view_literals;
+
+    if (args.empty()) {
+        print_usage();
+        return EXIT_CODE_USAGE;
+    }
+    const std::string_view command{args[0]};
+    const auto& command_args = args.subspan(1);
+
+    // Building needs PKGBUILDs only, skip loading the databases
+    if (command == "build"sv) {
+        return run_build(command_args);
+    }
+    if (command != "list"sv && command != "install"sv && command != "remove"sv) {
+        print_usage();
+        return EXIT_CODE_USAGE;
+    }
+
+    alpm_errno_t err{};
+    auto* handle = utils::parse_alpm("/", "/var/lib/pacman/", &err);
+    if (handle == nullptr) {
+        print_error(command, fmt::format(FMT_COMPILE("failed to initialize alpm: {}"), alpm_strerror(err)));
+        return EXIT_CODE_FAILURE;
+    }
+
+    std::int32_t exit_code{EXIT_CODE_OK};
+    {
+        // Kernels must be destroyed before the handle, as they reference its packages
+        auto kernels = Kernel::get_kernels(handle);
+        if (command == "list"sv) {
+            exit_code = run_list(kernels);
+        } else {
+            exit_code = run_transaction(kernels, command_args, command == "install"sv);
+        }
+    }
+
+    utils::release_alpm(handle, &err);
+    return exit_code;
+}
+
+}  // namespace cli
@@ -0,0 +1,40 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef CLI_HPP
+#define CLI_HPP
+
+#include <cstdint>      // for int32_t
+#include <span>         // for span
+#include <string_view>  // for string_view
+
+namespace cli {
+
+/// Argument, which switches the app into the headless mode.
+inline constexpr std::string_view CLI_ARG = "--cli";
+
+/// @brief Run the headless frontend, without QApplication and translations.
+/// Results are printed to stdout as JSON, one object per line,
+/// while the output of pacman/makepkg goes to stderr.
+/// @param args The arguments after '--cli'.
+/// @return The exit code of the app.
+auto run(std::span<char*> args) noexcept -> std::int32_t;
+
+}  // namespace cli
+
+#endif  // CLI_HPP
@@ -17,17 +17,22 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "conf-window.hpp"
-#include "compile_options.hpp"
+#include "build_log.hpp"
+#include "build_log_view.hpp"
 #include "config-options.hpp"
+#include "cpu_features.hpp"
+#include "pkgbuild_evaluator.hpp"
 #include "utils.hpp"
 
 #include <cstdio>
 #include <cstdlib>
 
 #include <algorithm>    // for for_each, transform
-#include <filesystem>   // for permissions
+#include <array>        // for array
+#include <filesystem>   // for exists, current_path
 #include <ranges>       // for ranges::*
 #include <string_view>  // for string_view
+#include <utility>      // for move
 
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -43,10 +48,15 @@
 #endif
 
 #include <QFileDialog>
+#include <QHeaderView>
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QRegularExpressionValidator>
+#include <QStatusBar>
 #include <QStringList>
+#include <QTableWidgetItem>
+#include <QtConcurrent/QtConcurrent>
 
 #if defined(__clang__)
 #pragma clang diagnostic pop
@@ -105,6 +115,8 @@ GENERATE_CONST_LOOKUP_OPTION_VALUES(tickless_mode, "full", "idle", "perodic")
 GENERATE_CONST_LOOKUP_OPTION_VALUES(preempt_mode, "full", "voluntary", "server")
 GENERATE_CONST_LOOKUP_OPTION_VALUES(lto_mode, "none", "full", "thin")
 GENERATE_CONST_LOOKUP_OPTION_VALUES(hugepage_mode, "always", "madvise")
+GENERATE_CONST_LOOKUP_OPTION_VALUES(tunables_thp_mode, "", "always", "madvise", "never")
+GENERATE_CONST_LOOKUP_OPTION_VALUES(tunables_preempt_mode, "", "none", "voluntary", "full", "lazy")
 GENERATE_CONST_LOOKUP_OPTION_VALUES(cpu_opt_mode, "manual", "generic", "native_amd", "native_intel", "zen", "zen2", "zen3", "sandybridge", "ivybridge", "haswell", "icelake", "tigerlake", "alderlake")
 
 // NOLINTEND(cppcoreguidelines-macro-usage)
@@ -160,95 +172,12 @@ inline auto set_combobox_val(QComboBox* combobox, ssize_t index) noexcept {
     return 0;
 }
 
-constexpr auto convert_to_varname(std::string_view option) noexcept {
-    // force constexpr call with lambda
-    return [option] { return detail::option_map.at(option); }();
-}
-
-inline auto convert_to_var_assign(std::string_view option, std::string_view value) noexcept {
-    return fmt::format(FMT_COMPILE("{}={}\n"), convert_to_varname(option), value);
-}
-
-/// return flag to enable if the option is enabled, otherwise do nothing
-constexpr auto convert_to_var_assign_empty_wrapped(std::string_view option_name, bool option_enabled) noexcept {
-    using namespace std::string_view_literals;
-    if (option_enabled) {
-        return convert_to_var_assign(option_name, "y"sv);
-    }
-    return std::string{};
-}
-
-auto get_source_array_from_pkgbuild(std::string_view kernel_name_path, std::string_view options_set) noexcept {
-    const auto& testscript_src  = fmt::format(FMT_COMPILE("#!/usr/bin/bash\n{}\nsource \"$1\"\n{}"), options_set, "echo \"${source[@]}\"");
-    const auto& testscript_path = fmt::format(FMT_COMPILE("{}/.testscript"), kernel_name_path);
-
-    if (utils::write_to_file(testscript_path, testscript_src)) {
-        fs::permissions(testscript_path,
-            fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec,
-            fs::perm_options::add);
-    }
-
-    const auto& src_entries = utils::exec(fmt::format(FMT_COMPILE("{} {}/PKGBUILD"), testscript_path, kernel_name_path));
-    return utils::make_multiline(src_entries, ' ');
-}
-
-auto prepare_func_names(std::vector<std::string> parse_lines, std::string_view pkgver_str) noexcept -> std::vector<std::string> {
-    using namespace std::string_view_literals;
-
-    static constexpr auto functor = [](auto&& rng) {
-        auto rng_str = std::string_view(&*rng.begin(), static_cast<size_t>(std::ranges::distance(rng)));
-        return rng_str.starts_with("package_"sv);
-    };
-
-    std::vector<std::string> pkg_globs{};
-    pkg_globs = parse_lines
-        | std::ranges::views::transform([&](auto&& rng) {
-              auto&& line = std::string_view(&*rng.begin(), static_cast<size_t>(std::ranges::distance(rng)));
-
-              static constexpr auto needle_prefix = "declare -f "sv;
-              if (line.starts_with(needle_prefix)) {
-                  line.remove_prefix(needle_prefix.size());
-              }
-              return line;
-          })
-        | std::ranges::views::filter(functor)
-        | std::ranges::views::transform([&](auto&& rng) {
-              auto&& line = std::string_view(&*rng.begin(), static_cast<size_t>(std::ranges::distance(rng)));
-
-              static constexpr auto needle_prefix = "package_"sv;
-              if (line.starts_with(needle_prefix)) {
-                  line.remove_prefix(needle_prefix.size());
-              }
-              return fmt::format(FMT_COMPILE("{}-{}-*.pkg.tar.zst"), line, pkgver_str);
-          })
-        | std::ranges::to<std::vector<std::string>>();
-    return pkg_globs;
-}
-
-auto get_package_names_glob_from_pkgbuild(std::string_view kernel_name_path) noexcept -> std::vector<std::string> {
-    using namespace std::string_view_literals;
-    static constexpr auto testscript_src = "#!/usr/bin/bash\nsource \"$1\"\ndeclare -F;echo \"pkgver: $pkgver-$pkgrel\""sv;
-    static constexpr auto pkgver_prefix  = "pkgver: "sv;
-
-    const auto& testscript_path = fmt::format(FMT_COMPILE("{}/.testscriptpkgnames"), kernel_name_path);
-    if (utils::write_to_file(testscript_path, testscript_src)) {
-        fs::permissions(testscript_path,
-            fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec,
-            fs::perm_options::add);
-    }
-
-    const auto& src_entries = utils::exec(fmt::format(FMT_COMPILE("{} {}/PKGBUILD"), testscript_path, kernel_name_path));
-    const auto& parse_lines = utils::make_multiline(src_entries, '\n');
-
-    auto it = std::ranges::find_if(parse_lines, [](auto&& line) { return line.starts_with(pkgver_prefix); });
-    if (it == std::ranges::end(parse_lines)) {
-        fmt::print(stderr, "broken pkgbuild; pkgver must be present\n");
-        return {};
-    }
-    auto pkgver_str = std::string_view{*it};
-    pkgver_str.remove_prefix(pkgver_prefix.size());
-
-    return prepare_func_names(parse_lines, pkgver_str);
+auto get_source_array_from_pkgbuild(std::string_view kernel_name_path, std::string_view options_set) noexcept -> std::vector<std::string> {
+    auto pkgbuild_info = PkgbuildEvaluator::instance().evaluate(kernel_name_path, options_set);
+    /* clang-format off */
+    if (!pkgbuild_info) { return {}; }
+    /* clang-format on */
+    return std::move(pkgbuild_info->source);
 }
 
 bool insert_new_source_array_into_pkgbuild(std::string_view kernel_name_path, QListWidget* list_widget, const std::vector<std::string>& orig_source_array) noexcept {
@@ -279,33 +208,39 @@ bool insert_new_source_array_into_pkgbuild(std::string_view kernel_name_path, QL
     return utils::write_to_file(pkgbuild_path, pkgbuildsrc);
 }
 
-bool set_custom_name_in_pkgbuild(std::string_view kernel_name_path, std::string_view custom_name) noexcept {
-    const auto& pkgbuild_path = fmt::format(FMT_COMPILE("{}/PKGBUILD"), kernel_name_path);
-    auto pkgbuildsrc          = utils::read_whole_file(pkgbuild_path);
-
-    const auto& custom_name_var = fmt::format(FMT_COMPILE("\n\npkgbase=\"{}\""), custom_name);
-    if (auto foundpos = pkgbuildsrc.find("_major="); foundpos != std::string::npos) {
-        if (auto last_newline_before = pkgbuildsrc.find_last_of('\n', foundpos); last_newline_before != std::string::npos) {
-            pkgbuildsrc.insert(last_newline_before, custom_name_var);
-        }
+inline void list_widget_apply_edit_flag(QListWidget* list_widget) noexcept {
+    // Apply flag to each item in list widget
+    for (int i = 0; i < list_widget->count(); ++i) {
+        auto* item = list_widget->item(i);
+        item->setFlags(item->flags() | Qt::ItemIsEditable);
     }
-    return utils::write_to_file(pkgbuild_path, pkgbuildsrc);
 }
 
-auto convert_vector_of_strings_to_stringlist(const std::vector<std::string>& vec) noexcept {
-    QStringList result{};
+// Make the list widget contain exactly the items, touching only rows which differ.
+// That way selection and scroll position survive the refresh.
+void list_widget_apply_items(QListWidget* list_widget, const std::vector<std::string>& items) noexcept {
+    const auto items_count = static_cast<std::int32_t>(items.size());
+    for (std::int32_t i = 0; i < items_count; ++i) {
+        const auto& item_text = QString::fromStdString(items[static_cast<std::size_t>(i)]);
+        if (i < list_widget->count() && list_widget->item(i)->text() == item_text) {
+            continue;
+        }
 
-    for (auto&& element : vec) {
-        result << QString::fromStdString(element);
+        // Move the item up, if it's further down the list
+        auto found_items = list_widget->findItems(item_text, Qt::MatchExactly);
+        auto found_it    = std::ranges::find_if(found_items, [list_widget, i](auto* item) { return list_widget->row(item) > i; });
+        if (found_it != found_items.end()) {
+            list_widget->insertItem(i, list_widget->takeItem(list_widget->row(*found_it)));
+            continue;
+        }
+
+        auto* new_item = new QListWidgetItem(item_text);
+        new_item->setFlags(new_item->flags() | Qt::ItemIsEditable);
+        list_widget->insertItem(i, new_item);
     }
-    return result;
-}
 
-inline void list_widget_apply_edit_flag(QListWidget* list_widget) noexcept {
-    // Apply flag to each item in list widget
-    for (int i = 0; i < list_widget->count(); ++i) {
-        auto* item = list_widget->item(i);
-        item->setFlags(item->flags() | Qt::ItemIsEditable);
+    while (list_widget->count() > items_count) {
+        delete list_widget->takeItem(list_widget->count() - 1);
     }
 }
 
@@ -313,15 +248,16 @@ inline void list_widget_apply_edit_flag(QListWidget* list_widget) noexcept {
 
 // NOTE: we use std::string const ref intentionally to prevent conversion from string_view into QString
 void ConfWindow::run_cmd_async(std::string cmd, const std::string& working_path) noexcept {
-    using namespace std::string_literals;
-    cmd += "; read -p 'Press enter to exit'"s;
-
-    // remember current build working directory
-    m_build_conf_path = working_path;
-
-    m_cmd.setProgram(QStringLiteral("/usr/lib/cachyos-kernel-manager/terminal-helper"));
-    m_cmd.setArguments({QString::fromStdString(cmd)});
+    // Output is shown in our own window, so nothing can wait for the input
+    m_cmd.setProgram(QStringLiteral("/bin/bash"));
+    m_cmd.setArguments({QStringLiteral("-c"), QString::fromStdString(cmd)});
     m_cmd.setWorkingDirectory(QString::fromStdString(working_path));
+    m_cmd.setStandardInputFile(QProcess::nullDevice());
+
+    m_cmd_log = std::make_shared<BuildLogModel>(build_log::make_log_path("install"));
+    m_cmd_log->follow_process(&m_cmd);
+    auto* log_view = new BuildLogView(m_cmd_log, tr("Installing packages"), this);
+    log_view->show();
 
     m_cmd.start();
 
@@ -329,116 +265,223 @@ void ConfWindow::run_cmd_async(std::string cmd, const std::string& working_path)
     connect(&m_cmd, &QProcess::finished, this, &ConfWindow::finished_proc, Qt::UniqueConnection);
 }
 
-void ConfWindow::finished_proc(int exit_code, QProcess::ExitStatus) noexcept {
-    using namespace std::string_view_literals;
-
+void ConfWindow::finished_proc(int exit_code, QProcess::ExitStatus exit_status) noexcept {
     m_running = false;
+    const bool is_success = exit_status == QProcess::NormalExit && exit_code == 0;
+    if (!is_success) {
+        fmt::print(stderr, "process failed with exit code: {}\n", exit_code);
+    }
+    if (m_cmd_log) {
+        m_cmd_log->finish(is_success);
+        m_cmd_log.reset();
+    }
+}
 
-    // handle exit case
-    const auto& check_tmp_path = fmt::format(FMT_COMPILE("{}/.done-status"), m_build_conf_path);
-    if (fs::exists(check_tmp_path)) {
-        fs::remove(check_tmp_path);
+void ConfWindow::on_build_started(const QString& name, std::shared_ptr<BuildLogModel> log_model) noexcept {
+    // The build is in the terminal
+    /* clang-format off */
+    if (!log_model) { return; }
+    /* clang-format on */
 
-        fmt::print("success\n");
+    auto* log_view = new BuildLogView(std::move(log_model), tr("Build log: %1").arg(name), this);
+    log_view->show();
+}
 
-        auto res = QMessageBox::question(this, "CachyOS Kernel Manager", tr("Do you want to install build packages?"));
-        if (res == QMessageBox::Yes) {
-            fmt::print("pressed yes\n");
+void ConfWindow::on_build_finished(const QString& work_path, bool is_success) noexcept {
+    if (is_success) {
+        m_built_paths.emplace_back(work_path.toStdString());
+    }
+
+    // Ask once, when all the queued builds are done
+    /* clang-format off */
+    if (!m_build_queue->is_idle() || m_built_paths.empty() || m_running) { return; }
+    /* clang-format on */
 
-            auto pkg_glob_list = get_package_names_glob_from_pkgbuild(m_build_conf_path);
-            auto pkg_globs     = pkg_glob_list | std::ranges::views::join_with(' ') | std::ranges::to<std::string>();
-            auto pacman_cmd    = fmt::format(FMT_COMPILE("sudo pacman -U {}"), pkg_globs);
+    auto res = QMessageBox::question(this, "CachyOS Kernel Manager", tr("Do you want to install build packages?"));
+    if (res == QMessageBox::Yes) {
+        fmt::print("pressed yes\n");
 
-            fmt::print("pacman_cmd := {}\n", pacman_cmd);
-            m_running = true;
-            run_cmd_async(pacman_cmd, m_build_conf_path);
+        std::string pkg_globs{};
+        for (auto&& built_path : m_built_paths) {
+            for (auto&& pkg_glob : get_package_names_glob_from_pkgbuild(built_path)) {
+                pkg_globs += fmt::format(FMT_COMPILE(" {}/{}"), utils::shell_quote(built_path), pkg_glob);
+            }
         }
-    } else {
-        fmt::print(stderr, "process failed with exit code: {}\n", exit_code);
+        // Already confirmed above, polkit asks for the password
+        auto pacman_cmd = fmt::format(FMT_COMPILE("pkexec pacman -U --noconfirm{}"), pkg_globs);
+
+        fmt::print("pacman_cmd := {}\n", pacman_cmd);
+        m_running = true;
+        run_cmd_async(pacman_cmd, m_built_paths.front());
     }
+    m_built_paths.clear();
+}
+
+void ConfWindow::update_build_status() noexcept {
+    // Keep the last message (e.g compiler cache report), when nothing is running
+    /* clang-format off */
+    if (m_build_queue->is_idle()) { return; }
+    /* clang-format on */
+    statusBar()->showMessage(tr("Builds running: %1, queued: %2").arg(m_build_queue->running_count()).arg(m_build_queue->queued_count()));
 }
 
-void ConfWindow::connect_all_checkboxes() noexcept {
+void ConfWindow::on_compiler_cache_finished(const QString& name, CompilerCacheStats cache_stats) noexcept {
+    const auto total_count = cache_stats.hits + cache_stats.misses;
+    /* clang-format off */
+    if (total_count == 0) { return; }
+    /* clang-format on */
+
+    const auto hit_ratio = (static_cast<double>(cache_stats.hits) * 100.0) / static_cast<double>(total_count);
+    statusBar()->showMessage(tr("%1: compiler cache hit ratio %2% (%3 of %4)").arg(name).arg(hit_ratio, 0, 'f', 1).arg(cache_stats.hits).arg(total_count));
+}
+
+void ConfWindow::connect_all_options() noexcept {
     auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
 
-    const std::array checkbox_list{
+    // Only the kernel and the options, which go into the options set, change the source array of PKGBUILD.
+    // NOTE: build resources and runtime tunables don't, so they are not connected.
+    const std::array option_checkboxes{
+        options_page_ui_obj->hardly_check,
+        options_page_ui_obj->perfgovern_check,
+        options_page_ui_obj->tcpbbr_check,
+        options_page_ui_obj->autooptim_check,
+        options_page_ui_obj->cachyconfig_check,
+        options_page_ui_obj->nconfig_check,
+        options_page_ui_obj->menuconfig_check,
+        options_page_ui_obj->xconfig_check,
+        options_page_ui_obj->gconfig_check,
+        options_page_ui_obj->localmodcfg_check,
+        options_page_ui_obj->numa_check,
+        options_page_ui_obj->damon_check,
+        options_page_ui_obj->builtin_zfs_check,
         options_page_ui_obj->builtin_nvidia_check,
         options_page_ui_obj->builtin_nvidia_open_check,
+        options_page_ui_obj->build_debug_check,
     };
-
-    for (auto* checkbox : checkbox_list) {
-        connect(checkbox, &QCheckBox::stateChanged, this, [this](std::int32_t) {
-            reset_patches_data_tab();
-        });
+    const std::array option_comboboxes{
+        options_page_ui_obj->main_combo_box,
+        options_page_ui_obj->hzticks_combo_box,
+        options_page_ui_obj->tickless_combo_box,
+        options_page_ui_obj->preempt_combo_box,
+        options_page_ui_obj->hugepage_combo_box,
+        options_page_ui_obj->lto_combo_box,
+        options_page_ui_obj->processor_opt_combo_box,
+    };
+    for (auto* checkbox : option_checkboxes) {
+        connect(checkbox, &QCheckBox::stateChanged, this, &ConfWindow::reset_patches_data_tab);
+    }
+    for (auto* combobox : option_comboboxes) {
+        connect(combobox, &QComboBox::currentIndexChanged, this, &ConfWindow::reset_patches_data_tab);
     }
+    connect(options_page_ui_obj->custom_name_edit, &QLineEdit::textChanged, this, &ConfWindow::reset_patches_data_tab);
 }
 
-std::string ConfWindow::get_all_set_values() const noexcept {
-    std::string result{};
+auto ConfWindow::get_config_options() const noexcept -> ConfigOptions {
     auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
 
-    // checkboxes values,
-    // which becomes enabled with any value passed,
-    // and if nothing passed means it's disabled.
-    result += convert_to_var_assign_empty_wrapped("hardly", checkstate_checked(options_page_ui_obj->hardly_check));
-    result += convert_to_var_assign_empty_wrapped("per_gov", checkstate_checked(options_page_ui_obj->perfgovern_check));
-    result += convert_to_var_assign_empty_wrapped("tcp_bbr3", checkstate_checked(options_page_ui_obj->tcpbbr_check));
-    result += convert_to_var_assign_empty_wrapped("auto_optim", checkstate_checked(options_page_ui_obj->autooptim_check));
-
-    result += convert_to_var_assign_empty_wrapped("cachy_config", checkstate_checked(options_page_ui_obj->cachyconfig_check));
-    result += convert_to_var_assign_empty_wrapped("nconfig", checkstate_checked(options_page_ui_obj->nconfig_check));
-    result += convert_to_var_assign_empty_wrapped("menuconfig", checkstate_checked(options_page_ui_obj->menuconfig_check));
-    result += convert_to_var_assign_empty_wrapped("xconfig", checkstate_checked(options_page_ui_obj->xconfig_check));
-    result += convert_to_var_assign_empty_wrapped("gconfig", checkstate_checked(options_page_ui_obj->gconfig_check));
-    result += convert_to_var_assign_empty_wrapped("localmodcfg", checkstate_checked(options_page_ui_obj->localmodcfg_check));
-    result += convert_to_var_assign_empty_wrapped("numa", checkstate_checked(options_page_ui_obj->numa_check));
-    result += convert_to_var_assign_empty_wrapped("damon", checkstate_checked(options_page_ui_obj->damon_check));
-    result += convert_to_var_assign_empty_wrapped("builtin_zfs", checkstate_checked(options_page_ui_obj->builtin_zfs_check));
-    result += convert_to_var_assign_empty_wrapped("builtin_nvidia", checkstate_checked(options_page_ui_obj->builtin_nvidia_check));
-    result += convert_to_var_assign_empty_wrapped("builtin_nvidia_open", checkstate_checked(options_page_ui_obj->builtin_nvidia_open_check));
-    result += convert_to_var_assign_empty_wrapped("build_debug", checkstate_checked(options_page_ui_obj->build_debug_check));
-
-    // combobox values
-    result += convert_to_var_assign("HZ_ticks", get_hz_tick(static_cast<size_t>(options_page_ui_obj->hzticks_combo_box->currentIndex())));
-    result += convert_to_var_assign("tickrate", get_tickless_mode(static_cast<size_t>(options_page_ui_obj->tickless_combo_box->currentIndex())));
-    result += convert_to_var_assign("preempt", get_preempt_mode(static_cast<size_t>(options_page_ui_obj->preempt_combo_box->currentIndex())));
-    result += convert_to_var_assign("hugepage", get_hugepage_mode(static_cast<size_t>(options_page_ui_obj->hugepage_combo_box->currentIndex())));
-    result += convert_to_var_assign("lto", get_lto_mode(static_cast<size_t>(options_page_ui_obj->lto_combo_box->currentIndex())));
-
-    const std::string_view cpu_opt_mode = get_cpu_opt_mode(static_cast<size_t>(options_page_ui_obj->processor_opt_combo_box->currentIndex()));
-    if (cpu_opt_mode != "manual") {
-        result += convert_to_var_assign("cpu_opt", cpu_opt_mode);
-    }
-
-    // NOTE: workaround PKGBUILD incorrectly working with custom pkgname
-    const std::string_view lto_mode = get_lto_mode(static_cast<size_t>(options_page_ui_obj->lto_combo_box->currentIndex()));
-    if (lto_mode != "none" && options_page_ui_obj->custom_name_edit->text() != "$pkgbase") {
-        result += "_use_lto_suffix=n\n";
-    }
-
-    return result;
-}
-
-void ConfWindow::clear_patches_data_tab() noexcept {
-    auto* patches_page_ui_obj = m_ui->conf_patches_page_widget->get_ui_obj();
-    patches_page_ui_obj->list_widget->clear();
+    ConfigOptions config_options{};
+
+    // checkboxes values (booleans)
+    config_options.hardly_check     = checkstate_checked(options_page_ui_obj->hardly_check);
+    config_options.per_gov_check    = checkstate_checked(options_page_ui_obj->perfgovern_check);
+    config_options.tcp_bbr3_check   = checkstate_checked(options_page_ui_obj->tcpbbr_check);
+    config_options.auto_optim_check = checkstate_checked(options_page_ui_obj->autooptim_check);
+
+    config_options.cachy_config_check        = checkstate_checked(options_page_ui_obj->cachyconfig_check);
+    config_options.nconfig_check             = checkstate_checked(options_page_ui_obj->nconfig_check);
+    config_options.menuconfig_check          = checkstate_checked(options_page_ui_obj->menuconfig_check);
+    config_options.xconfig_check             = checkstate_checked(options_page_ui_obj->xconfig_check);
+    config_options.gconfig_check             = checkstate_checked(options_page_ui_obj->gconfig_check);
+    config_options.localmodcfg_check         = checkstate_checked(options_page_ui_obj->localmodcfg_check);
+    config_options.numa_check                = checkstate_checked(options_page_ui_obj->numa_check);
+    config_options.damon_check               = checkstate_checked(options_page_ui_obj->damon_check);
+    config_options.builtin_zfs_check         = checkstate_checked(options_page_ui_obj->builtin_zfs_check);
+    config_options.builtin_nvidia_check      = checkstate_checked(options_page_ui_obj->builtin_nvidia_check);
+    config_options.builtin_nvidia_open_check = checkstate_checked(options_page_ui_obj->builtin_nvidia_open_check);
+    config_options.build_debug_check         = checkstate_checked(options_page_ui_obj->build_debug_check);
+
+    // combobox values (strings that we try to find on load)
+    config_options.hz_ticks_combo = get_hz_tick(static_cast<size_t>(options_page_ui_obj->hzticks_combo_box->currentIndex()));
+    config_options.tickrate_combo = get_tickless_mode(static_cast<size_t>(options_page_ui_obj->tickless_combo_box->currentIndex()));
+    config_options.preempt_combo  = get_preempt_mode(static_cast<size_t>(options_page_ui_obj->preempt_combo_box->currentIndex()));
+    config_options.hugepage_combo = get_hugepage_mode(static_cast<size_t>(options_page_ui_obj->hugepage_combo_box->currentIndex()));
+    config_options.lto_combo      = get_lto_mode(static_cast<size_t>(options_page_ui_obj->lto_combo_box->currentIndex()));
+    config_options.cpu_opt_combo  = get_cpu_opt_mode(static_cast<size_t>(options_page_ui_obj->processor_opt_combo_box->currentIndex()));
+
+    config_options.custom_name_edit = options_page_ui_obj->custom_name_edit->text().toStdString();
+
+    // build resources
+    const auto& build_resources             = get_build_resources();
+    config_options.build_jobs_spin          = build_resources.jobs;
+    config_options.build_load_limit_spin    = build_resources.load_limit;
+    config_options.build_memory_limit_spin  = build_resources.memory_limit_gib;
+    config_options.build_cpu_affinity_edit  = build_resources.cpu_affinity;
+    config_options.build_low_priority_check = build_resources.low_priority;
+    config_options.compiler_cache_check     = checkstate_checked(options_page_ui_obj->compiler_cache_check);
+
+    // runtime tunables
+    config_options.tunables_thp_combo                   = get_tunables_thp_mode(static_cast<size_t>(options_page_ui_obj->tunables_thp_combo_box->currentIndex()));
+    config_options.tunables_preempt_combo               = get_tunables_preempt_mode(static_cast<size_t>(options_page_ui_obj->tunables_preempt_combo_box->currentIndex()));
+    config_options.tunables_nohz_full_edit              = options_page_ui_obj->tunables_nohz_full_edit->text().toStdString();
+    config_options.tunables_isolcpus_edit               = options_page_ui_obj->tunables_isolcpus_edit->text().toStdString();
+    config_options.tunables_swappiness_edit             = options_page_ui_obj->tunables_swappiness_edit->text().toStdString();
+    config_options.tunables_dirty_ratio_edit            = options_page_ui_obj->tunables_dirty_ratio_edit->text().toStdString();
+    config_options.tunables_dirty_background_ratio_edit = options_page_ui_obj->tunables_dirty_background_ratio_edit->text().toStdString();
+    config_options.tunables_vfs_cache_pressure_edit     = options_page_ui_obj->tunables_vfs_cache_pressure_edit->text().toStdString();
+
+    return config_options;
+}
+
+std::string ConfWindow::get_all_set_values() const noexcept {
+    return get_config_options().to_options_set();
+}
+
+auto ConfWindow::get_build_resources() const noexcept -> BuildResources {
+    auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
+    return BuildResources{
+        .jobs             = static_cast<std::uint32_t>(options_page_ui_obj->build_jobs_spin->value()),
+        .load_limit       = static_cast<std::uint32_t>(options_page_ui_obj->build_load_limit_spin->value()),
+        .memory_limit_gib = static_cast<std::uint32_t>(options_page_ui_obj->build_memory_limit_spin->value()),
+        .cpu_affinity     = options_page_ui_obj->build_cpu_affinity_edit->text().toStdString(),
+        .low_priority     = checkstate_checked(options_page_ui_obj->build_low_priority_check),
+    };
 }
 
 void ConfWindow::reset_patches_data_tab() noexcept {
+    // Coalesce bursts of option changes into single refresh
+    m_patches_refresh_timer.start();
+}
+
+void ConfWindow::start_patches_refresh() noexcept {
+    // Only one evaluation in flight, the latest options are picked up once it's done
+    if (m_patches_watcher.isRunning()) {
+        m_patches_refresh_pending = true;
+        return;
+    }
+    m_patches_refresh_pending = false;
+
     auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
-    auto* patches_page_ui_obj = m_ui->conf_patches_page_widget->get_ui_obj();
 
     const std::int32_t main_combo_index  = options_page_ui_obj->main_combo_box->currentIndex();
     const std::string_view cpusched_path = get_kernel_name_path(get_kernel_name(static_cast<size_t>(main_combo_index)));
 
-    auto current_array_items = get_source_array_from_pkgbuild(cpusched_path, get_all_set_values());
-    std::erase_if(current_array_items, [](auto&& item_el) { return !item_el.ends_with(".patch"); });
+    // Options are collected here, worker must not touch widgets
+    m_patches_watcher.setFuture(QtConcurrent::run([cpusched_path, all_set_values = get_all_set_values()] {
+        auto current_array_items = get_source_array_from_pkgbuild(cpusched_path, all_set_values);
+        std::erase_if(current_array_items, [](auto&& item_el) { return !item_el.ends_with(".patch"); });
+        return current_array_items;
+    }));
+}
 
-    clear_patches_data_tab();
-    patches_page_ui_obj->list_widget->addItems(convert_vector_of_strings_to_stringlist(current_array_items));
+void ConfWindow::on_patches_refreshed() noexcept {
+    // Options were changed while evaluating, the result is stale already
+    if (m_patches_refresh_pending) {
+        start_patches_refresh();
+        return;
+    }
 
-    // Apply flag to each item in list widget
-    list_widget_apply_edit_flag(patches_page_ui_obj->list_widget);
+    auto* patches_page_ui_obj = m_ui->conf_patches_page_widget->get_ui_obj();
+    list_widget_apply_items(patches_page_ui_obj->list_widget, m_patches_watcher.result());
 }
 
 ConfWindow::ConfWindow(QWidget* parent)
@@ -500,6 +543,19 @@ ConfWindow::ConfWindow(QWidget* parent)
     options_page_ui_obj->processor_opt_combo_box->addItems(cpu_optims);
     /* clang-format on */
 
+    // Point at the best option for this machine, the default stays as is
+    const auto& cpu_features = CpuFeatures::get();
+    if (const auto recommended_index = lookup_cpu_opt_mode(get_recommended_cpu_opt(cpu_features)); recommended_index >= 0) {
+        auto* processor_opt_combo_box = options_page_ui_obj->processor_opt_combo_box;
+        const auto item_index         = static_cast<std::int32_t>(recommended_index);
+        processor_opt_combo_box->setItemText(item_index, tr("%1 (recommended)").arg(processor_opt_combo_box->itemText(item_index)));
+    }
+    if (cpu_features.x86_64_level != 0) {
+        options_page_ui_obj->processor_opt_combo_box->setToolTip(tr("Detected CPU: %1, supports x86-64-v%2")
+                                                                     .arg(QString::fromStdString(cpu_features.model_name))
+                                                                     .arg(cpu_features.x86_64_level));
+    }
+
     options_page_ui_obj->autooptim_check->setCheckState(Qt::Checked);
 
     QStringList lto_modes;
@@ -516,18 +572,65 @@ ConfWindow::ConfWindow(QWidget* parent)
     // Connect buttons signal
     connect(options_page_ui_obj->cancel_button, &QPushButton::clicked, this, &ConfWindow::on_cancel);
     connect(options_page_ui_obj->ok_button, &QPushButton::clicked, this, &ConfWindow::on_execute);
+    connect(&m_build_env_watcher, &QFutureWatcher<bool>::finished, this, &ConfWindow::on_build_environment_ready);
     connect(options_page_ui_obj->save_button, &QPushButton::clicked, this, &ConfWindow::on_save);
     connect(options_page_ui_obj->load_button, &QPushButton::clicked, this, &ConfWindow::on_load);
-    connect(options_page_ui_obj->main_combo_box, &QComboBox::currentIndexChanged, this, [this](std::int32_t) {
-        reset_patches_data_tab();
-    });
 
     // Setup patches page
     // TODO(vnepogodin): make it lazy loading, only if the user launched the configure window.
     // on window opening setup the page(clone git repo & reset values) run in the background -> show progress bar.
     // prepare_build_environment();
     // reset_patches_data_tab();
-    connect_all_checkboxes();
+    m_patches_refresh_timer.setSingleShot(true);
+    m_patches_refresh_timer.setInterval(std::chrono::milliseconds{150});
+    connect(&m_patches_refresh_timer, &QTimer::timeout, this, &ConfWindow::start_patches_refresh);
+    connect(&m_patches_watcher, &QFutureWatcher<std::vector<std::string>>::finished, this, &ConfWindow::on_patches_refreshed);
+    connect_all_options();
+
+    // Setup build queue
+    connect(m_build_queue, &BuildQueue::job_started, this, &ConfWindow::on_build_started);
+    connect(m_build_queue, &BuildQueue::job_finished, this, &ConfWindow::on_build_finished);
+    connect(m_build_queue, &BuildQueue::state_changed, this, &ConfWindow::update_build_status);
+    connect(m_build_queue, &BuildQueue::compiler_cache_finished, this, &ConfWindow::on_compiler_cache_finished);
+    // Same format as taskset accepts, e.g '0-7,16-23'
+    options_page_ui_obj->build_cpu_affinity_edit->setValidator(
+        new QRegularExpressionValidator(QRegularExpression(QStringLiteral("^[0-9]+(-[0-9]+)?(,[0-9]+(-[0-9]+)?)*$")), this));
+    if (!BuildQueue::is_compiler_cache_available()) {
+        options_page_ui_obj->compiler_cache_check->setEnabled(false);
+        options_page_ui_obj->compiler_cache_check->setToolTip(tr("Install ccache package to enable"));
+    }
+
+    // Setup runtime tunables, the first item keeps the running value
+    QStringList tunables_thp_modes;
+    tunables_thp_modes << tr("Unchanged")
+                       << "Always"
+                       << "Madvise"
+                       << "Never";
+    options_page_ui_obj->tunables_thp_combo_box->addItems(tunables_thp_modes);
+
+    QStringList tunables_preempt_modes;
+    tunables_preempt_modes << tr("Unchanged")
+                           << "None"
+                           << "Voluntary"
+                           << "Full"
+                           << "Lazy";
+    options_page_ui_obj->tunables_preempt_combo_box->addItems(tunables_preempt_modes);
+
+    // Same format as the kernel accepts, see kernel_tunables.hpp
+    options_page_ui_obj->tunables_nohz_full_edit->setValidator(
+        new QRegularExpressionValidator(QRegularExpression(QStringLiteral("^[0-9]+(-[0-9]+)?(,[0-9]+(-[0-9]+)?)*$")), this));
+    options_page_ui_obj->tunables_isolcpus_edit->setValidator(
+        new QRegularExpressionValidator(QRegularExpression(QStringLiteral("^((nohz|domain|managed_irq),)*[0-9]+(-[0-9]+)?(,[0-9]+(-[0-9]+)?)*$")), this));
+    for (auto* sysctl_edit : {options_page_ui_obj->tunables_swappiness_edit, options_page_ui_obj->tunables_dirty_ratio_edit,
+             options_page_ui_obj->tunables_dirty_background_ratio_edit, options_page_ui_obj->tunables_vfs_cache_pressure_edit}) {
+        sysctl_edit->setValidator(new QRegularExpressionValidator(QRegularExpression(QStringLiteral("^[0-9]{1,10}$")), this));
+    }
+    options_page_ui_obj->tunables_diff_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    connect(options_page_ui_obj->tunables_compare_button, &QPushButton::clicked, this, &ConfWindow::on_tunables_compare);
+    connect(options_page_ui_obj->tunables_apply_button, &QPushButton::clicked, this, &ConfWindow::on_tunables_apply);
+    connect(options_page_ui_obj->tunables_persist_button, &QPushButton::clicked, this, &ConfWindow::on_tunables_persist);
+    connect(&m_tunables_watcher, &QFutureWatcher<utils::ExecResult>::finished, this, &ConfWindow::on_tunables_helper_finished);
 
     // local patches
     connect(patches_page_ui_obj->local_patch_button, &QPushButton::clicked, this, [this, patches_page_ui_obj] {
@@ -603,79 +706,63 @@ void ConfWindow::on_cancel() noexcept {
 }
 
 void ConfWindow::on_execute() noexcept {
-    // Skip execution of the build, if already one is running
     /* clang-format off */
-    if (m_running) { return; }
+    if (m_build_env_watcher.isRunning()) { return; }
     /* clang-format on */
-    m_running = true;
 
+    // It might have to clone or fetch the repo, which must not block the UI
+    m_ui->conf_options_page_widget->get_ui_obj()->ok_button->setEnabled(false);
+    m_build_env_watcher.setFuture(QtConcurrent::run([] { return utils::prepare_build_environment(); }));
+}
+
+void ConfWindow::on_build_environment_ready() noexcept {
     auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
     auto* patches_page_ui_obj = m_ui->conf_patches_page_widget->get_ui_obj();
+    options_page_ui_obj->ok_button->setEnabled(true);
+    if (!m_build_env_watcher.result()) {
+        QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to clone repository!\nPlease check your internet connection and try again"));
+        return;
+    }
 
     const std::int32_t main_combo_index  = options_page_ui_obj->main_combo_box->currentIndex();
     const std::string_view cpusched_path = get_kernel_name_path(get_kernel_name(static_cast<size_t>(main_combo_index)));
-    utils::prepare_build_environment();
-
-    // Restore clean environment.
-    const auto& all_set_values = get_all_set_values();
-    utils::restore_clean_environment(m_previously_set_options, all_set_values);
 
     // Only files which end with .patch,
     // are considered as patches.
+    const auto& all_set_values = get_all_set_values();
     const auto& orig_src_array = get_source_array_from_pkgbuild(cpusched_path, all_set_values);
-    auto insert_status         = insert_new_source_array_into_pkgbuild(cpusched_path, patches_page_ui_obj->list_widget, orig_src_array);
+
+    // Each build gets its own copy of PKGBUILD, that way the checkout stays untouched for the next builds
+    const auto& work_path = m_build_queue->make_work_tree(cpusched_path);
+    if (work_path.empty()) {
+        fmt::print(stderr, "Failed to prepare build directory\n");
+        return;
+    }
+    auto insert_status = insert_new_source_array_into_pkgbuild(work_path, patches_page_ui_obj->list_widget, orig_src_array);
     if (!insert_status) {
-        m_running = false;
         fmt::print(stderr, "Failed to insert new source array into pkgbuild\n");
         return;
     }
     const auto& custom_name = options_page_ui_obj->custom_name_edit->text().toUtf8();
-    insert_status           = set_custom_name_in_pkgbuild(cpusched_path, std::string_view{custom_name.constData(), static_cast<size_t>(custom_name.size())});
+    insert_status           = set_custom_name_in_pkgbuild(work_path, std::string_view{custom_name.constData(), static_cast<size_t>(custom_name.size())});
     if (!insert_status) {
-        m_running = false;
         fmt::print(stderr, "Failed to set custom name in pkgbuild\n");
         return;
     }
-    const auto& saved_working_path = fs::current_path().string();
-    const auto& build_working_path = fmt::format(FMT_COMPILE("{}/{}"), saved_working_path, cpusched_path);
 
-    // Run our build command!
-    run_cmd_async("makepkg -scf --cleanbuild --skipchecksums && touch .done-status", build_working_path);
+    // Run our build, or queue it if the machine is already busy with other builds
+    const bool use_compiler_cache = checkstate_checked(options_page_ui_obj->compiler_cache_check);
+    m_build_queue->enqueue(BuildJob{
+        .name               = std::string{cpusched_path},
+        .work_path          = work_path,
+        .options_set        = all_set_values,
+        .use_compiler_cache = use_compiler_cache,
+        .resources          = get_build_resources(),
+    });
 }
 
 void ConfWindow::on_save() noexcept {
-    auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
-
-    ConfigOptions config_options{};
-
-    // checkboxes values (booleans)
-    config_options.hardly_check     = checkstate_checked(options_page_ui_obj->hardly_check);
-    config_options.per_gov_check    = checkstate_checked(options_page_ui_obj->perfgovern_check);
-    config_options.tcp_bbr3_check   = checkstate_checked(options_page_ui_obj->tcpbbr_check);
-    config_options.auto_optim_check = checkstate_checked(options_page_ui_obj->autooptim_check);
-
-    config_options.cachy_config_check        = checkstate_checked(options_page_ui_obj->cachyconfig_check);
-    config_options.nconfig_check             = checkstate_checked(options_page_ui_obj->nconfig_check);
-    config_options.menuconfig_check          = checkstate_checked(options_page_ui_obj->menuconfig_check);
-    config_options.xconfig_check             = checkstate_checked(options_page_ui_obj->xconfig_check);
-    config_options.gconfig_check             = checkstate_checked(options_page_ui_obj->gconfig_check);
-    config_options.localmodcfg_check         = checkstate_checked(options_page_ui_obj->localmodcfg_check);
-    config_options.numa_check                = checkstate_checked(options_page_ui_obj->numa_check);
-    config_options.damon_check               = checkstate_checked(options_page_ui_obj->damon_check);
-    config_options.builtin_zfs_check         = checkstate_checked(options_page_ui_obj->builtin_zfs_check);
-    config_options.builtin_nvidia_check      = checkstate_checked(options_page_ui_obj->builtin_nvidia_check);
-    config_options.builtin_nvidia_open_check = checkstate_checked(options_page_ui_obj->builtin_nvidia_open_check);
-    config_options.build_debug_check         = checkstate_checked(options_page_ui_obj->build_debug_check);
-
-    // combobox values (strings that we try to find on load)
-    config_options.hz_ticks_combo = get_hz_tick(static_cast<size_t>(options_page_ui_obj->hzticks_combo_box->currentIndex()));
-    config_options.tickrate_combo = get_tickless_mode(static_cast<size_t>(options_page_ui_obj->tickless_combo_box->currentIndex()));
-    config_options.preempt_combo  = get_preempt_mode(static_cast<size_t>(options_page_ui_obj->preempt_combo_box->currentIndex()));
-    config_options.hugepage_combo = get_hugepage_mode(static_cast<size_t>(options_page_ui_obj->hugepage_combo_box->currentIndex()));
-    config_options.lto_combo      = get_lto_mode(static_cast<size_t>(options_page_ui_obj->lto_combo_box->currentIndex()));
-    config_options.cpu_opt_combo  = get_cpu_opt_mode(static_cast<size_t>(options_page_ui_obj->processor_opt_combo_box->currentIndex()));
-
-    config_options.custom_name_edit = options_page_ui_obj->custom_name_edit->text().toStdString();
+    const auto& config_options = get_config_options();
 
     auto save_file_path = QFileDialog::getSaveFileName(
         this,
@@ -741,7 +828,111 @@ void ConfWindow::on_load() noexcept {
 
     options_page_ui_obj->custom_name_edit->setText(QString::fromStdString(config_options->custom_name_edit));
 
+    // build resources
+    options_page_ui_obj->build_jobs_spin->setValue(static_cast<std::int32_t>(config_options->build_jobs_spin));
+    options_page_ui_obj->build_load_limit_spin->setValue(static_cast<std::int32_t>(config_options->build_load_limit_spin));
+    options_page_ui_obj->build_memory_limit_spin->setValue(static_cast<std::int32_t>(config_options->build_memory_limit_spin));
+    options_page_ui_obj->build_cpu_affinity_edit->setText(QString::fromStdString(config_options->build_cpu_affinity_edit));
+    set_checkstate(options_page_ui_obj->build_low_priority_check, config_options->build_low_priority_check);
+    // The profile might come from the machine, which has ccache installed
+    set_checkstate(options_page_ui_obj->compiler_cache_check, config_options->compiler_cache_check && BuildQueue::is_compiler_cache_available());
+
+    // runtime tunables
+    combobox_stat += set_combobox_val(options_page_ui_obj->tunables_thp_combo_box, lookup_tunables_thp_mode(config_options->tunables_thp_combo));
+    combobox_stat += set_combobox_val(options_page_ui_obj->tunables_preempt_combo_box, lookup_tunables_preempt_mode(config_options->tunables_preempt_combo));
+    options_page_ui_obj->tunables_nohz_full_edit->setText(QString::fromStdString(config_options->tunables_nohz_full_edit));
+    options_page_ui_obj->tunables_isolcpus_edit->setText(QString::fromStdString(config_options->tunables_isolcpus_edit));
+    options_page_ui_obj->tunables_swappiness_edit->setText(QString::fromStdString(config_options->tunables_swappiness_edit));
+    options_page_ui_obj->tunables_dirty_ratio_edit->setText(QString::fromStdString(config_options->tunables_dirty_ratio_edit));
+    options_page_ui_obj->tunables_dirty_background_ratio_edit->setText(QString::fromStdString(config_options->tunables_dirty_background_ratio_edit));
+    options_page_ui_obj->tunables_vfs_cache_pressure_edit->setText(QString::fromStdString(config_options->tunables_vfs_cache_pressure_edit));
+    on_tunables_compare();
+
     if (combobox_stat != 0) {
         QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Config file(%1) is outdated").arg(QString::fromStdString(load_file_path)));
     }
 }
+
+void ConfWindow::on_tunables_compare() noexcept {
+    auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
+    auto* diff_table          = options_page_ui_obj->tunables_diff_table;
+
+    const auto& diffs = diff_tunables(get_config_options().to_tunables());
+    diff_table->setRowCount(static_cast<std::int32_t>(diffs.size()));
+
+    std::int32_t different_count{};
+    for (std::int32_t row = 0; auto&& diff : diffs) {
+        const auto& running_value = [&] {
+            if (!diff.running_value.empty()) {
+                return QString::fromStdString(diff.running_value);
+            }
+            return (diff.kind == TunableKind::BootParam) ? tr("not set") : tr("unknown");
+        }();
+        const auto& takes_effect = (diff.kind == TunableKind::BootParam) ? tr("after reboot") : tr("now");
+
+        const std::array row_texts{QString::fromStdString(diff.name), QString::fromStdString(diff.profile_value), running_value, takes_effect};
+        for (std::int32_t column = 0; auto&& text : row_texts) {
+            auto* item = new QTableWidgetItem(text);
+            // rows which would be changed stand out
+            auto font = item->font();
+            font.setBold(diff.is_different);
+            item->setFont(font);
+            diff_table->setItem(row, column++, item);
+        }
+        different_count += diff.is_different ? 1 : 0;
+        ++row;
+    }
+
+    if (diffs.empty()) {
+        statusBar()->showMessage(tr("No runtime tunables are set in the profile"));
+    } else {
+        statusBar()->showMessage(tr("Runtime tunables differ from the running kernel: %1 of %2").arg(different_count).arg(diffs.size()));
+    }
+}
+
+void ConfWindow::on_tunables_apply() noexcept {
+    run_tunables_helper("--apply");
+}
+
+void ConfWindow::on_tunables_persist() noexcept {
+    run_tunables_helper("--persist");
+}
+
+void ConfWindow::run_tunables_helper(std::string_view mode_arg) noexcept {
+    /* clang-format off */
+    if (m_tunables_watcher.isRunning()) { return; }
+    /* clang-format on */
+
+    const auto& tunables = get_config_options().to_tunables();
+    if (tunables.empty()) {
+        QMessageBox::information(this, "CachyOS Kernel Manager", tr("No runtime tunables are set in the profile"));
+        return;
+    }
+
+    std::vector<std::string> argv{"pkexec", std::string{TUNABLES_HELPER_PATH}, std::string{mode_arg}};
+    for (auto&& [name, value] : tunables) {
+        argv.emplace_back(fmt::format(FMT_COMPILE("{}={}"), name, value));
+    }
+
+    auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
+    options_page_ui_obj->tunables_apply_button->setEnabled(false);
+    options_page_ui_obj->tunables_persist_button->setEnabled(false);
+
+    // pkexec waits for the authentication, that must not block the GUI
+    m_tunables_watcher.setFuture(QtConcurrent::run([argv = std::move(argv)] { return utils::exec_argv(argv); }));
+}
+
+void ConfWindow::on_tunables_helper_finished() noexcept {
+    auto* options_page_ui_obj = m_ui->conf_options_page_widget->get_ui_obj();
+    options_page_ui_obj->tunables_apply_button->setEnabled(true);
+    options_page_ui_obj->tunables_persist_button->setEnabled(true);
+
+    const auto& result = m_tunables_watcher.result();
+    if (!result.is_success()) {
+        QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to set runtime tunables:\n%1").arg(QString::fromStdString(result.err).trimmed()));
+    }
+    on_tunables_compare();
+    if (result.is_success()) {
+        statusBar()->showMessage(QString::fromStdString(result.out).trimmed().replace(u'\n', QStringLiteral("; ")));
+    }
+}
@@ -39,13 +39,20 @@
 
 #include <ui_conf-window.h>
 
+#include "build_queue.hpp"
+#include "config-options.hpp"
+#include "process_utils.hpp"
+
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include <QFutureWatcher>
 #include <QMainWindow>
 #include <QProcess>
+#include <QTimer>
 
 #if defined(__clang__)
 #pragma clang diagnostic pop
@@ -60,6 +67,7 @@ class ConfWindow final : public QMainWindow {
     explicit ConfWindow(QWidget* parent = nullptr);
     ~ConfWindow() = default;
 
+    /// Schedules refresh of the patches list, must be called from the GUI thread.
     void reset_patches_data_tab() noexcept;
 
  protected:
@@ -68,20 +76,39 @@ class ConfWindow final : public QMainWindow {
  private:
     void on_cancel() noexcept;
     void on_execute() noexcept;
+    void on_build_environment_ready() noexcept;
     void on_save() noexcept;
     void on_load() noexcept;
     void finished_proc(int exit_code, QProcess::ExitStatus exit_status) noexcept;
+    void on_build_started(const QString& name, std::shared_ptr<BuildLogModel> log_model) noexcept;
+    void on_build_finished(const QString& work_path, bool is_success) noexcept;
+    void update_build_status() noexcept;
+    void on_compiler_cache_finished(const QString& name, CompilerCacheStats cache_stats) noexcept;
+    void start_patches_refresh() noexcept;
+    void on_patches_refreshed() noexcept;
+    void on_tunables_compare() noexcept;
+    void on_tunables_apply() noexcept;
+    void on_tunables_persist() noexcept;
+    void on_tunables_helper_finished() noexcept;
 
     bool m_running{};
     QProcess m_cmd{};
-    std::string m_build_conf_path{};
-    std::vector<std::string> m_previously_set_options{};
+    std::shared_ptr<BuildLogModel> m_cmd_log{};
+    BuildQueue* m_build_queue = new BuildQueue(this);
+    std::vector<std::string> m_built_paths{};
+    QTimer m_patches_refresh_timer{};
+    QFutureWatcher<std::vector<std::string>> m_patches_watcher{};
+    bool m_patches_refresh_pending{};
+    QFutureWatcher<utils::ExecResult> m_tunables_watcher{};
+    QFutureWatcher<bool> m_build_env_watcher{};
     std::unique_ptr<Ui::ConfWindow> m_ui = std::make_unique<Ui::ConfWindow>();
 
     void run_cmd_async(std::string cmd, const std::string& working_path) noexcept;
+    auto get_config_options() const noexcept -> ConfigOptions;
     auto get_all_set_values() const noexcept -> std::string;
-    void clear_patches_data_tab() noexcept;
-    void connect_all_checkboxes() noexcept;
+    auto get_build_resources() const noexcept -> BuildResources;
+    void connect_all_options() noexcept;
+    void run_tunables_helper(std::string_view mode_arg) noexcept;
 };
 
 #endif  // CONFWINDOW_HPP_
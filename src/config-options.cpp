@@ -17,8 +17,10 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "config-options.hpp"
+#include "compile_options.hpp"
 
-#include <utility>
+#include <array>    // for array
+#include <utility>  // for pair, move
 
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -38,8 +40,95 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <fmt/compile.h>
 #include <fmt/core.h>
 
+namespace {
+
+constexpr auto convert_to_varname(std::string_view option) noexcept {
+    // force constexpr call with lambda
+    return [option] { return detail::option_map.at(option); }();
+}
+
+inline auto convert_to_var_assign(std::string_view option, std::string_view value) noexcept {
+    return fmt::format(FMT_COMPILE("{}={}\n"), convert_to_varname(option), value);
+}
+
+/// return flag to enable if the option is enabled, otherwise do nothing
+constexpr auto convert_to_var_assign_empty_wrapped(std::string_view option_name, bool option_enabled) noexcept {
+    using namespace std::string_view_literals;
+    if (option_enabled) {
+        return convert_to_var_assign(option_name, "y"sv);
+    }
+    return std::string{};
+}
+
+}  // namespace
+
+auto ConfigOptions::to_options_set() const noexcept -> std::string {
+    std::string result{};
+
+    // checkboxes values,
+    // which becomes enabled with any value passed,
+    // and if nothing passed means it's disabled.
+    result += convert_to_var_assign_empty_wrapped("hardly", hardly_check);
+    result += convert_to_var_assign_empty_wrapped("per_gov", per_gov_check);
+    result += convert_to_var_assign_empty_wrapped("tcp_bbr3", tcp_bbr3_check);
+    result += convert_to_var_assign_empty_wrapped("auto_optim", auto_optim_check);
+
+    result += convert_to_var_assign_empty_wrapped("cachy_config", cachy_config_check);
+    result += convert_to_var_assign_empty_wrapped("nconfig", nconfig_check);
+    result += convert_to_var_assign_empty_wrapped("menuconfig", menuconfig_check);
+    result += convert_to_var_assign_empty_wrapped("xconfig", xconfig_check);
+    result += convert_to_var_assign_empty_wrapped("gconfig", gconfig_check);
+    result += convert_to_var_assign_empty_wrapped("localmodcfg", localmodcfg_check);
+    result += convert_to_var_assign_empty_wrapped("numa", numa_check);
+    result += convert_to_var_assign_empty_wrapped("damon", damon_check);
+    result += convert_to_var_assign_empty_wrapped("builtin_zfs", builtin_zfs_check);
+    result += convert_to_var_assign_empty_wrapped("builtin_nvidia", builtin_nvidia_check);
+    result += convert_to_var_assign_empty_wrapped("builtin_nvidia_open", builtin_nvidia_open_check);
+    result += convert_to_var_assign_empty_wrapped("build_debug", build_debug_check);
+
+    // combobox values
+    result += convert_to_var_assign("HZ_ticks", hz_ticks_combo);
+    result += convert_to_var_assign("tickrate", tickrate_combo);
+    result += convert_to_var_assign("preempt", preempt_combo);
+    result += convert_to_var_assign("hugepage", hugepage_combo);
+    result += convert_to_var_assign("lto", lto_combo);
+
+    if (cpu_opt_combo != "manual") {
+        result += convert_to_var_assign("cpu_opt", cpu_opt_combo);
+    }
+
+    // NOTE: workaround PKGBUILD incorrectly working with custom pkgname
+    if (lto_combo != "none" && custom_name_edit != "$pkgbase") {
+        result += "_use_lto_suffix=n\n";
+    }
+
+    return result;
+}
+
+auto ConfigOptions::to_tunables() const noexcept -> std::vector<TunableValue> {
+    const std::array<std::pair<std::string_view, const std::string*>, 8> tunables{{
+        {"transparent_hugepage", &tunables_thp_combo},
+        {"preempt", &tunables_preempt_combo},
+        {"nohz_full", &tunables_nohz_full_edit},
+        {"isolcpus", &tunables_isolcpus_edit},
+        {"vm.swappiness", &tunables_swappiness_edit},
+        {"vm.dirty_ratio", &tunables_dirty_ratio_edit},
+        {"vm.dirty_background_ratio", &tunables_dirty_background_ratio_edit},
+        {"vm.vfs_cache_pressure", &tunables_vfs_cache_pressure_edit},
+    }};
+
+    std::vector<TunableValue> result{};
+    for (auto&& [name, value] : tunables) {
+        if (!value->empty()) {
+            result.emplace_back(TunableValue{.name = std::string{name}, .value = *value});
+        }
+    }
+    return result;
+}
+
 auto ConfigOptions::parse_from_file(std::string_view filepath) noexcept -> std::optional<ConfigOptions> {
     ::cachyos_km::Config rust_config_options{};
     try {
@@ -77,6 +166,22 @@ auto ConfigOptions::parse_from_file(std::string_view filepath) noexcept -> std::
         .cpu_opt_combo  = std::string{rust_config_options.cpu_opt_combo},
 
         .custom_name_edit = std::string{rust_config_options.custom_name_edit},
+
+        .build_jobs_spin          = rust_config_options.build_jobs_spin,
+        .build_load_limit_spin    = rust_config_options.build_load_limit_spin,
+        .build_memory_limit_spin  = rust_config_options.build_memory_limit_spin,
+        .build_cpu_affinity_edit  = std::string{rust_config_options.build_cpu_affinity_edit},
+        .build_low_priority_check = rust_config_options.build_low_priority_check,
+        .compiler_cache_check     = rust_config_options.compiler_cache_check,
+
+        .tunables_thp_combo                   = std::string{rust_config_options.tunables_thp_combo},
+        .tunables_preempt_combo               = std::string{rust_config_options.tunables_preempt_combo},
+        .tunables_nohz_full_edit              = std::string{rust_config_options.tunables_nohz_full_edit},
+        .tunables_isolcpus_edit               = std::string{rust_config_options.tunables_isolcpus_edit},
+        .tunables_swappiness_edit             = std::string{rust_config_options.tunables_swappiness_edit},
+        .tunables_dirty_ratio_edit            = std::string{rust_config_options.tunables_dirty_ratio_edit},
+        .tunables_dirty_background_ratio_edit = std::string{rust_config_options.tunables_dirty_background_ratio_edit},
+        .tunables_vfs_cache_pressure_edit     = std::string{rust_config_options.tunables_vfs_cache_pressure_edit},
     };
     return std::make_optional<ConfigOptions>(std::move(config_options));
 }
@@ -109,6 +214,22 @@ auto ConfigOptions::write_config_file(const ConfigOptions& config_options, std::
         .cpu_opt_combo  = rust::String(config_options.cpu_opt_combo),
 
         .custom_name_edit = rust::String(config_options.custom_name_edit),
+
+        .build_jobs_spin          = config_options.build_jobs_spin,
+        .build_load_limit_spin    = config_options.build_load_limit_spin,
+        .build_memory_limit_spin  = config_options.build_memory_limit_spin,
+        .build_cpu_affinity_edit  = rust::String(config_options.build_cpu_affinity_edit),
+        .build_low_priority_check = config_options.build_low_priority_check,
+        .compiler_cache_check     = config_options.compiler_cache_check,
+
+        .tunables_thp_combo                   = rust::String(config_options.tunables_thp_combo),
+        .tunables_preempt_combo               = rust::String(config_options.tunables_preempt_combo),
+        .tunables_nohz_full_edit              = rust::String(config_options.tunables_nohz_full_edit),
+        .tunables_isolcpus_edit               = rust::String(config_options.tunables_isolcpus_edit),
+        .tunables_swappiness_edit             = rust::String(config_options.tunables_swappiness_edit),
+        .tunables_dirty_ratio_edit            = rust::String(config_options.tunables_dirty_ratio_edit),
+        .tunables_dirty_background_ratio_edit = rust::String(config_options.tunables_dirty_background_ratio_edit),
+        .tunables_vfs_cache_pressure_edit     = rust::String(config_options.tunables_vfs_cache_pressure_edit),
     };
 
     try {
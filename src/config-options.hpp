@@ -19,9 +19,13 @@
 #ifndef CONFIGOPTIONS_HPP_
 #define CONFIGOPTIONS_HPP_
 
+#include "kernel_tunables.hpp"
+
+#include <cstdint>      // for uint32_t
 #include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
+#include <vector>       // for vector
 
 struct ConfigOptions {
     bool hardly_check{};
@@ -51,6 +55,30 @@ struct ConfigOptions {
 
     std::string custom_name_edit{};
 
+    // build resources, zero or empty means no limit
+    std::uint32_t build_jobs_spin{};
+    std::uint32_t build_load_limit_spin{};
+    std::uint32_t build_memory_limit_spin{};
+    std::string build_cpu_affinity_edit{};
+    bool build_low_priority_check{};
+    bool compiler_cache_check{};
+
+    // runtime tunables, empty means the running value is kept
+    std::string tunables_thp_combo{};
+    std::string tunables_preempt_combo{};
+    std::string tunables_nohz_full_edit{};
+    std::string tunables_isolcpus_edit{};
+    std::string tunables_swappiness_edit{};
+    std::string tunables_dirty_ratio_edit{};
+    std::string tunables_dirty_background_ratio_edit{};
+    std::string tunables_vfs_cache_pressure_edit{};
+
+    /// @brief Convert the kernel options into the PKGBUILD variable assignments (e.g "_cachy_config=y\n").
+    auto to_options_set() const noexcept -> std::string;
+
+    /// @brief Get the runtime tunables, which are set in the profile.
+    auto to_tunables() const noexcept -> std::vector<TunableValue>;
+
     static auto parse_from_file(std::string_view filepath) noexcept -> std::optional<ConfigOptions>;
     static auto write_config_file(const ConfigOptions& config_options, std::string_view filepath) noexcept -> bool;
 };
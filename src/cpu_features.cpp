@@ -0,0 +1,188 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "cpu_features.hpp"
+#include "process_utils.hpp"
+#include "string_utils.hpp"
+#include "trace.hpp"
+
+#include <algorithm>  // for all_of, find, max
+#include <array>      // for array
+#include <fstream>    // for ifstream
+#include <iterator>   // for istreambuf_iterator
+#include <utility>    // for pair
+
+#include <fmt/core.h>
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr auto PROC_CPUINFO_PATH = "/proc/cpuinfo"sv;
+// Path of the dynamic loader is fixed by x86-64 psABI
+static constexpr auto LD_SO_PATH = "/lib64/ld-linux-x86-64.so.2"sv;
+
+static constexpr auto LD_SO_LEVEL_PREFIX = "x86-64-v"sv;
+
+static constexpr auto AMD_VENDOR_ID      = "AuthenticAMD"sv;
+static constexpr auto INTEL_VENDOR_ID    = "GenuineIntel"sv;
+static constexpr auto ZNVER4_REPO_SUFFIX = "-znver4"sv;
+
+// Required features of each level, as they are named in /proc/cpuinfo (see x86-64 psABI)
+static constexpr std::array X86_64_V2_FLAGS{"cx16"sv, "lahf_lm"sv, "popcnt"sv, "sse4_1"sv, "sse4_2"sv, "ssse3"sv};
+static constexpr std::array X86_64_V3_FLAGS{"avx"sv, "avx2"sv, "bmi1"sv, "bmi2"sv, "f16c"sv, "fma"sv, "abm"sv, "movbe"sv, "xsave"sv};
+static constexpr std::array X86_64_V4_FLAGS{"avx512f"sv, "avx512bw"sv, "avx512cd"sv, "avx512dq"sv, "avx512vl"sv};
+
+// Repo suffixes and levels they are built for, more specific first
+static constexpr std::array<std::pair<std::string_view, std::uint8_t>, 4> REPO_LEVEL_SUFFIXES{{
+    {ZNVER4_REPO_SUFFIX, 4},
+    {"-v4"sv, 4},
+    {"-v3"sv, 3},
+    {"-v2"sv, 2},
+}};
+
+constexpr auto trim(std::string_view str) noexcept -> std::string_view {
+    constexpr auto is_space = [](char ch) { return ch == ' ' || ch == '\t'; };
+    while (!str.empty() && is_space(str.front())) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && is_space(str.back())) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+auto read_file(std::string_view file_path) noexcept -> std::string {
+    std::ifstream file_stream{std::string{file_path}};
+    return {std::istreambuf_iterator<char>{file_stream}, std::istreambuf_iterator<char>{}};
+}
+
+auto probe_cpu_features() noexcept -> CpuFeatures {
+    const trace::Span trace_span{"probe_cpu_features"};
+
+    auto cpu_features = parse_cpuinfo(read_file(PROC_CPUINFO_PATH));
+    /* clang-format off */
+    if (cpu_features.x86_64_level == 0) { return cpu_features; }
+    /* clang-format on */
+
+    // The loader knows better, if it's there
+    const auto& result = utils::exec_argv({std::string{LD_SO_PATH}, "--help"});
+    if (const auto ld_so_level = parse_ld_so_levels(result.out); ld_so_level != 0) {
+        cpu_features.x86_64_level = ld_so_level;
+    } else {
+        fmt::print(stderr, "[CPU] failed to query supported levels from {}, using cpuinfo flags\n", LD_SO_PATH);
+    }
+    return cpu_features;
+}
+
+}  // namespace
+
+auto CpuFeatures::get() noexcept -> const CpuFeatures& {
+    static const auto cpu_features = probe_cpu_features();
+    return cpu_features;
+}
+
+auto parse_cpuinfo(std::string_view content) noexcept -> CpuFeatures {
+    CpuFeatures cpu_features{};
+    for (auto&& line : utils::make_multiline_view(content, '\n')) {
+        const auto colon_pos = line.find(':');
+        /* clang-format off */
+        if (colon_pos == std::string_view::npos) { continue; }
+        /* clang-format on */
+
+        const auto key   = trim(line.substr(0, colon_pos));
+        const auto value = trim(line.substr(colon_pos + 1));
+        if (key == "vendor_id"sv) {
+            cpu_features.vendor_id = value;
+        } else if (key == "model name"sv) {
+            cpu_features.model_name = value;
+        } else if (key == "flags"sv) {
+            cpu_features.x86_64_level = get_x86_64_level_from_flags(value);
+            // every processor has the same capabilities, the first one is enough
+            break;
+        }
+    }
+    return cpu_features;
+}
+
+auto get_x86_64_level_from_flags(std::string_view flags) noexcept -> std::uint8_t {
+    const auto& flag_list = utils::make_multiline_view(flags, ' ');
+    const auto has_flags  = [&flag_list](auto&& required_flags) {
+        return std::ranges::all_of(required_flags, [&flag_list](auto&& flag) { return std::ranges::find(flag_list, flag) != flag_list.end(); });
+    };
+
+    // 'lm' is the long mode, without it we are not on x86-64 at all
+    /* clang-format off */
+    if (std::ranges::find(flag_list, "lm"sv) == flag_list.end()) { return 0; }
+    if (!has_flags(X86_64_V2_FLAGS)) { return 1; }
+    if (!has_flags(X86_64_V3_FLAGS)) { return 2; }
+    if (!has_flags(X86_64_V4_FLAGS)) { return 3; }
+    /* clang-format on */
+    return 4;
+}
+
+auto parse_ld_so_levels(std::string_view output) noexcept -> std::uint8_t {
+    std::uint8_t level{};
+    bool has_hwcaps{};
+    for (auto&& line : utils::make_multiline_view(output, '\n')) {
+        const auto trimmed_line = trim(line);
+        /* clang-format off */
+        if (!trimmed_line.starts_with(LD_SO_LEVEL_PREFIX) || trimmed_line.size() <= LD_SO_LEVEL_PREFIX.size()) { continue; }
+        /* clang-format on */
+
+        has_hwcaps = true;
+        const char level_char = trimmed_line[LD_SO_LEVEL_PREFIX.size()];
+        if (level_char >= '2' && level_char <= '9' && trimmed_line.find("(supported"sv) != std::string_view::npos) {
+            level = std::max(level, static_cast<std::uint8_t>(level_char - '0'));
+        }
+    }
+    /* clang-format off */
+    if (!has_hwcaps) { return 0; }
+    /* clang-format on */
+
+    // none of the listed levels is supported, that's the baseline
+    return std::max<std::uint8_t>(level, 1);
+}
+
+auto get_repo_x86_64_level(std::string_view repo) noexcept -> std::uint8_t {
+    for (auto&& [suffix, level] : REPO_LEVEL_SUFFIXES) {
+        if (repo.ends_with(suffix)) {
+            return level;
+        }
+    }
+    return 1;
+}
+
+auto is_repo_supported(std::string_view repo, const CpuFeatures& cpu_features) noexcept -> bool {
+    // only Zen 4 and newer have AVX-512 among AMD CPUs
+    if (repo.ends_with(ZNVER4_REPO_SUFFIX) && cpu_features.vendor_id != AMD_VENDOR_ID) {
+        return false;
+    }
+    return get_repo_x86_64_level(repo) <= cpu_features.x86_64_level;
+}
+
+auto get_recommended_cpu_opt(const CpuFeatures& cpu_features) noexcept -> std::string_view {
+    // -march=native picks up everything the CPU has, including the tuning
+    if (cpu_features.vendor_id == AMD_VENDOR_ID) {
+        return "native_amd"sv;
+    }
+    if (cpu_features.vendor_id == INTEL_VENDOR_ID) {
+        return "native_intel"sv;
+    }
+    return "generic"sv;
+}
@@ -0,0 +1,58 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+#include <cstdint>      // for uint8_t
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+/// Capabilities of the host CPU, which decide how the kernel is best built and which repo it's installed from.
+struct CpuFeatures final {
+    std::string vendor_id{};
+    std::string model_name{};
+    // x86-64 microarchitecture level (1 - baseline, 2..4 - x86-64-v2..v4), 0 if it's not x86-64
+    std::uint8_t x86_64_level{};
+
+    /// @brief Get features of the current machine.
+    /// The probe runs once on the first call, and the result is cached for the lifetime of the app.
+    static auto get() noexcept -> const CpuFeatures&;
+};
+
+/// @brief Parse the first processor of /proc/cpuinfo. The level is derived from the flags.
+auto parse_cpuinfo(std::string_view content) noexcept -> CpuFeatures;
+
+/// @brief Get the highest level from the flags line of /proc/cpuinfo (e.g "fpu vme ... avx2 ...").
+auto get_x86_64_level_from_flags(std::string_view flags) noexcept -> std::uint8_t;
+
+/// @brief Get the highest level, which the dynamic loader reports as supported in 'ld.so --help'.
+/// Unlike the cpuinfo flags, it also takes into account whether the kernel has enabled the features (e.g AVX-512 state).
+/// @return The level, or 0 if the output doesn't have the glibc-hwcaps list.
+auto parse_ld_so_levels(std::string_view output) noexcept -> std::uint8_t;
+
+/// @brief Get the level, which the repo is built for (e.g 3 for cachyos-v3 or cachyos-core-v3, 4 for cachyos-znver4).
+auto get_repo_x86_64_level(std::string_view repo) noexcept -> std::uint8_t;
+
+/// @brief Check if packages from the repo can run on the CPU (e.g cachyos-znver4 needs AMD Zen 4 or newer).
+auto is_repo_supported(std::string_view repo, const CpuFeatures& cpu_features) noexcept -> bool;
+
+/// @brief Get the best _processor_opt for the build, which runs only on this machine (e.g native_amd).
+auto get_recommended_cpu_opt(const CpuFeatures& cpu_features) noexcept -> std::string_view;
+
+#endif  // CPU_FEATURES_HPP
@@ -0,0 +1,117 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "hardware_profile.hpp"
+#include "utils.hpp"
+
+#include <algorithm>  // for any_of
+#include <fstream>    // for ifstream
+#include <ranges>     // for ranges::*
+#include <string>     // for string, getline
+
+namespace {
+
+// Parse /proc/self/mountinfo and get the filesystem of the root.
+// Line format:
+//   36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+auto get_root_fstype() noexcept -> std::string {
+    using namespace std::string_view_literals;
+
+    std::ifstream mountinfo{"/proc/self/mountinfo"};
+    if (!mountinfo.is_open()) {
+        return {};
+    }
+
+    std::string root_fstype{};
+    std::string line{};
+    while (std::getline(mountinfo, line)) {
+        const auto& fields = utils::make_multiline_view(line, ' ');
+        if (fields.size() < 5 || fields[4] != "/"sv) {
+            continue;
+        }
+        auto separator = std::ranges::find(fields, "-"sv);
+        if (separator == fields.end() || std::next(separator) == fields.end()) {
+            continue;
+        }
+        // The last mount wins, it overmounts the previous ones.
+        root_fstype = *std::next(separator);
+    }
+    return root_fstype;
+}
+
+// Get names of installed chwd profiles (e.g nvidia-dkms.40xxcards).
+auto get_chwd_installed_profiles() noexcept -> std::vector<std::string> {
+    std::vector<std::string> profile_names{};
+    utils::exec_argv({"chwd", "--list-installed", "-d"}, [&profile_names](std::string_view line) {
+        /* clang-format off */
+        if (line.find("Name") == std::string_view::npos) { return; }
+        /* clang-format on */
+
+        // The profile name is the fourth column of the 'Name' line.
+        const auto& columns = utils::make_multiline_view(line, ' ');
+        if (columns.size() >= 4) {
+            profile_names.emplace_back(columns[3]);
+        }
+    });
+    return profile_names;
+}
+
+}  // namespace
+
+auto HardwareProfile::get() noexcept -> const HardwareProfile& {
+    static const HardwareProfile profile = [] {
+        HardwareProfile hw_profile{};
+        hw_profile.m_root_on_zfs = (get_root_fstype() == "zfs");
+
+        const auto& profile_names                = get_chwd_installed_profiles();
+        hw_profile.m_nvidia_prebuild_module      = std::ranges::any_of(profile_names, [](auto&& profile_name) { return profile_name.starts_with("nvidia-dkms"); });
+        hw_profile.m_nvidia_prebuild_open_module = std::ranges::any_of(profile_names, [](auto&& profile_name) { return profile_name.starts_with("nvidia-open-dkms"); });
+        return hw_profile;
+    }();
+    return profile;
+}
+
+void InstalledNvidiaModules::add(std::string_view pkg_name) noexcept {
+    static constexpr std::string_view modules_prefix = "linux-cachyos";
+
+    if (pkg_name == "nvidia-dkms") {
+        nvidia_dkms = true;
+    } else if (pkg_name == "nvidia-open-dkms") {
+        nvidia_open_dkms = true;
+    } else if (!pkg_name.starts_with(modules_prefix)) {
+        return;
+    } else if (pkg_name.ends_with("-nvidia")) {
+        nvidia_prebuilt = true;
+    } else if (pkg_name.ends_with("-nvidia-open")) {
+        nvidia_open_prebuilt = true;
+    }
+}
+
+auto find_local_nvidia_modules(alpm_handle_t* handle) noexcept -> std::vector<std::string> {
+    std::vector<std::string> module_names{};
+    for (alpm_list_t* i = alpm_db_get_pkgcache(alpm_get_localdb(handle)); i != nullptr; i = i->next) {
+        const std::string_view pkg_name = alpm_pkg_get_name(reinterpret_cast<alpm_pkg_t*>(i->data));
+
+        InstalledNvidiaModules pkg_modules{};
+        pkg_modules.add(pkg_name);
+        if (pkg_modules.nvidia_dkms || pkg_modules.nvidia_open_dkms || pkg_modules.nvidia_prebuilt || pkg_modules.nvidia_open_prebuilt) {
+            module_names.emplace_back(pkg_name);
+        }
+    }
+    return module_names;
+}
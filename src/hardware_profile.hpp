@@ -0,0 +1,73 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef HARDWARE_PROFILE_HPP
+#define HARDWARE_PROFILE_HPP
+
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#include <alpm.h>
+
+/// Hardware and system properties, which affect the set of packages we install with the kernel.
+class HardwareProfile {
+ public:
+    /// @brief Get the profile of the current machine.
+    /// The probe runs once on the first call, and the result is cached for the lifetime of the app.
+    /// @return The hardware profile.
+    static auto get() noexcept -> const HardwareProfile&;
+
+    /* clang-format off */
+    constexpr bool is_root_on_zfs() const noexcept
+    { return m_root_on_zfs; }
+
+    constexpr bool is_nvidia_card_prebuild_module() const noexcept
+    { return m_nvidia_prebuild_module; }
+
+    constexpr bool is_nvidia_card_prebuild_open_module() const noexcept
+    { return m_nvidia_prebuild_open_module; }
+    /* clang-format on */
+
+ private:
+    HardwareProfile() = default;
+
+    bool m_root_on_zfs{};
+    bool m_nvidia_prebuild_module{};
+    bool m_nvidia_prebuild_open_module{};
+};
+
+/// NVIDIA modules found in the local db.
+struct InstalledNvidiaModules {
+    bool nvidia_dkms{};
+    bool nvidia_open_dkms{};
+    bool nvidia_prebuilt{};
+    bool nvidia_open_prebuilt{};
+
+    /// @brief Mark the module as installed, packages which aren't NVIDIA modules are ignored.
+    void add(std::string_view pkg_name) noexcept;
+};
+
+/// @brief Find names of the installed NVIDIA modules (e.g nvidia-dkms, linux-cachyos-nvidia-open).
+/// It walks the whole local pkgcache, and the local db is changed by transactions,
+/// that's why it's not a part of HardwareProfile. The caller caches it per handle (see Kernel::install).
+/// @param handle The alpm handle.
+/// @return Names of the module packages.
+auto find_local_nvidia_modules(alpm_handle_t* handle) noexcept -> std::vector<std::string>;
+
+#endif  // HARDWARE_PROFILE_HPP
@@ -18,144 +18,308 @@
 
 #include "kernel.hpp"
 #include "aur_kernel.hpp"
+#include "hardware_profile.hpp"
+#include "kernel_index.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
+#include <unistd.h>  // for geteuid
+
 #include <cstdio>
 
-#include <algorithm>   // for any_of, find_if
-#include <filesystem>  // for exists
-#include <ranges>      // for ranges::*
-#include <utility>     // for move
+#include <algorithm>      // for any_of, find_if, sort, lower_bound
+#include <array>          // for array
+#include <filesystem>     // for create_directories, directory_iterator, remove
+#include <iterator>       // for next
+#include <optional>       // for optional
+#include <ranges>         // for ranges::*
+#include <unordered_map>  // for unordered_map
+#include <utility>        // for move, pair
 
 #include <fmt/compile.h>
 #include <fmt/core.h>
 
+namespace fs = std::filesystem;
+
 namespace {
 
-#ifdef ENABLE_AUR_KERNELS
-static std::vector<std::string_view> g_aur_kernel_install_list{};  // NOLINT
-#endif
+// Local db changes made by our transactions, on top of the localdb cache of the handle,
+// which libalpm never invalidates. Value is the installed version, or nullopt if removed.
+static std::unordered_map<std::string, std::optional<std::string>> g_local_pkg_overlay{};  // NOLINT
+
+// NVIDIA modules in the localdb of the handle, it's walked once per handle.
+// The state of each module is checked through the overlay.
+struct LocalNvidiaModules {
+    alpm_handle_t* handle{};
+    std::vector<std::string> pkg_names{};
+};
+static LocalNvidiaModules g_local_nvidia_modules{};  // NOLINT
+
+auto get_local_pkg_version(alpm_handle_t* handle, const std::string& pkg_name) noexcept -> std::optional<std::string> {
+    if (auto overlay_it = g_local_pkg_overlay.find(pkg_name); overlay_it != g_local_pkg_overlay.end()) {
+        return overlay_it->second;
+    }
+    auto* local_pkg = alpm_db_get_pkg(alpm_get_localdb(handle), pkg_name.c_str());
+    /* clang-format off */
+    if (local_pkg == nullptr) { return std::nullopt; }
+    /* clang-format on */
+    return alpm_pkg_get_version(local_pkg);
+}
 
-static std::vector<std::string_view> g_kernel_install_list{};                        // NOLINT
-static std::vector<std::string_view> g_kernel_removal_list{};                        // NOLINT
-static const bool is_root_on_zfs = utils::exec("findmnt -ln -o FSTYPE /") == "zfs";  // NOLINT
-
-// NOLINTNEXTLINE
-static const bool is_nvidia_card_prebuild_module = [] {
-    const auto& profile_names = utils::exec("chwd --list-installed -d 2>/dev/null | grep Name | awk '{print $4}'");
-    return std::ranges::any_of(utils::make_split_view(profile_names, '\n'), [](auto&& profile_name) { return profile_name.starts_with("nvidia-dkms"); });
-}();
-// NOLINTNEXTLINE
-static const bool is_nvidia_card_prebuild_open_module = [] {
-    const auto& profile_names = utils::exec("chwd --list-installed -d 2>/dev/null | grep Name | awk '{print $4}'");
-    return std::ranges::any_of(utils::make_split_view(profile_names, '\n'), [](auto&& profile_name) { return profile_name.starts_with("nvidia-open-dkms"); });
-}();
+struct CompanionModule {
+    std::string_view suffix;
+    std::string kernel_index::KernelEntry::*pkg_name;
+};
+
+// Packages, which are built for the particular kernel (e.g linux-cachyos-zfs).
+static constexpr std::array companion_modules{
+    CompanionModule{.suffix = "-zfs", .pkg_name = &kernel_index::KernelEntry::zfs_module},
+    CompanionModule{.suffix = "-nvidia", .pkg_name = &kernel_index::KernelEntry::nvidia_module},
+    CompanionModule{.suffix = "-nvidia-open", .pkg_name = &kernel_index::KernelEntry::nvidia_open_module},
+};
+
+// Names are owned by the handle, they stay valid until it's released.
+// NOTE: libalpm isn't thread-safe, so it must be called only from the thread, which owns the handle.
+auto get_installed_nvidia_modules(alpm_handle_t* handle) noexcept -> InstalledNvidiaModules {
+    if (g_local_nvidia_modules.handle != handle) {
+        g_local_nvidia_modules = LocalNvidiaModules{.handle = handle, .pkg_names = find_local_nvidia_modules(handle)};
+    }
 
-}  // namespace
+    InstalledNvidiaModules installed_modules{};
+    for (const auto& pkg_name : g_local_nvidia_modules.pkg_names) {
+        if (get_local_pkg_version(handle, pkg_name)) {
+            installed_modules.add(pkg_name);
+        }
+    }
+    // Installed by our transactions, after the walk
+    for (const auto& [pkg_name, pkg_version] : g_local_pkg_overlay) {
+        if (pkg_version) {
+            installed_modules.add(pkg_name);
+        }
+    }
+    return installed_modules;
+}
 
-std::string Kernel::version() noexcept {
-#ifdef ENABLE_AUR_KERNELS
+auto get_pkg_names(alpm_db_t* db) noexcept -> std::vector<std::string_view> {
+    std::vector<std::string_view> pkg_names{};
+    for (alpm_list_t* i = alpm_db_get_pkgcache(db); i != nullptr; i = i->next) {
+        pkg_names.emplace_back(alpm_pkg_get_name(reinterpret_cast<alpm_pkg_t*>(i->data)));
+    }
+    return pkg_names;
+}
+
+// Pair kernels with their headers and modules by name, it doesn't touch libalpm.
+auto find_kernels_in_names(std::vector<std::string_view> pkg_names) noexcept -> std::vector<kernel_index::KernelEntry> {
+    static constexpr std::string_view ignored_pkg    = "linux-api-headers";
+    static constexpr std::string_view kernel_prefix  = "linux";
+    static constexpr std::string_view headers_suffix = "-headers";
+    static constexpr std::string_view modules_prefix = "linux-cachyos";
+
+    // Flat table sorted by name, that way all packages sharing the same prefix are adjacent.
+    std::ranges::sort(pkg_names);
+
+    std::vector<kernel_index::KernelEntry> kernels{};
+    for (auto&& headers_name : pkg_names) {
+        if (!headers_name.starts_with(kernel_prefix) || !headers_name.ends_with(headers_suffix) || headers_name == ignored_pkg) {
+            continue;
+        }
+        auto kernel_name = headers_name;
+        kernel_name.remove_suffix(headers_suffix.size());
+
+        // Skip if the actual kernel package is not found
+        auto kernel_it = std::ranges::lower_bound(pkg_names, kernel_name);
+        /* clang-format off */
+        if (kernel_it == pkg_names.end() || *kernel_it != kernel_name) { continue; }
+        /* clang-format on */
+
+        kernel_index::KernelEntry kernel_entry{.name = std::string{kernel_name}, .headers = std::string{headers_name}};
+        if (kernel_name.starts_with(modules_prefix)) {
+            for (auto it = std::next(kernel_it); it != pkg_names.end() && it->starts_with(kernel_name); ++it) {
+                const auto& pkg_suffix = it->substr(kernel_name.size());
+                for (auto&& companion_module : companion_modules) {
+                    if (pkg_suffix == companion_module.suffix) {
+                        kernel_entry.*companion_module.pkg_name = std::string{*it};
+                    }
+                }
+            }
+        }
+        kernels.emplace_back(std::move(kernel_entry));
+    }
+    return kernels;
+}
+
+// Packages, which are downloaded in the background before the commit.
+// The helper resolves the same dir from the uid of the caller, the path isn't passed to it.
+auto get_prefetch_cache_dir() noexcept -> const std::string& {
+    static const auto cache_dir = utils::fix_path("~/.cache/cachyos-km/pkg");
+    return cache_dir;
+}
+
+// The helper has copied the used packages into the cache of pacman, what's left are stale downloads
+void clear_prefetch_cache_dir() noexcept {
+    std::error_code err{};
+    for (fs::directory_iterator it{get_prefetch_cache_dir(), err}; !err && it != fs::directory_iterator{}; it.increment(err)) {
+        std::error_code remove_err{};
+        fs::remove(it->path(), remove_err);
+    }
+}
+
+// Both lists go into the single alpm transaction, that way hooks run only once
+auto run_alpm_helper(const Transaction& trans, std::string_view escalate_cmd, const utils::transaction_progress_cb_t& on_progress) noexcept -> utils::TransactionResult {
+    std::vector<std::string> argv{};
+    if (!escalate_cmd.empty()) {
+        argv.emplace_back(escalate_cmd);
+    }
+    argv.emplace_back(utils::ALPM_HELPER_PATH);
+
+    const bool has_prefetched = fs::is_directory(get_prefetch_cache_dir());
+    if (has_prefetched && !trans.get_install_list().empty()) {
+        argv.emplace_back("--prefetched");
+    }
+    if (const auto& install_list = trans.get_install_list(); !install_list.empty()) {
+        argv.emplace_back("--install");
+        argv.insert(argv.end(), install_list.begin(), install_list.end());
+    }
+    if (const auto& removal_list = trans.get_removal_list(); !removal_list.empty()) {
+        argv.emplace_back("--remove");
+        argv.insert(argv.end(), removal_list.begin(), removal_list.end());
+    }
+
+    auto&& result = utils::exec_argv(argv, [&](std::string_view line) {
+        auto&& progress = utils::parse_progress_line(line);
+        if (!progress) {
+            fmt::print(stderr, "{}\n", line);
+        } else if (on_progress) {
+            on_progress(*progress);
+        }
+    });
+    if (!result.err.empty()) {
+        fmt::print(stderr, "{}", result.err);
+    }
+    if (has_prefetched && result.is_success()) {
+        clear_prefetch_cache_dir();
+    }
     /* clang-format off */
-    if (m_repo == "aur") { return m_version; }
+    if (result.is_success()) { return {}; }
     /* clang-format on */
-#endif
-    const char* sync_pkg_ver = alpm_pkg_get_version(m_pkg);
+
+    // pkexec exits with 126, when the authorization is dismissed
+    std::string err_msg{result.err};
+    err_msg.erase(err_msg.find_last_not_of(" \n") + 1);
+    if (err_msg.empty()) {
+        err_msg = fmt::format("alpm helper has exited with status {}", result.status);
+    }
+    return {.is_success = false, .err_msg = std::move(err_msg)};
+}
+
+}  // namespace
+
+void Kernel::resolve_local_state() const noexcept {
     /* clang-format off */
-    if (!is_installed()) { return sync_pkg_ver; }
+    if (m_local_state.is_resolved) { return; }
     /* clang-format on */
+    m_local_state.is_resolved = true;
+
+    // Name must be without any repo name (e.g. core/linux)
+    const auto& local_pkg_ver  = get_local_pkg_version(m_handle, m_name);
+    m_local_state.is_installed = local_pkg_ver.has_value();
 
-    auto* db                  = alpm_get_localdb(m_handle);
-    auto* local_pkg           = alpm_db_get_pkg(db, m_name.c_str());
-    const char* local_pkg_ver = alpm_pkg_get_version(local_pkg);
-    const int32_t ret         = alpm_pkg_vercmp(local_pkg_ver, sync_pkg_ver);
+#ifdef ENABLE_AUR_KERNELS
+    if (m_repo == "aur") {
+        m_local_state.version = m_version;
+        return;
+    }
+#endif
+    const char* sync_pkg_ver = m_version.c_str();
+    if (!local_pkg_ver) {
+        m_local_state.version = sync_pkg_ver;
+        return;
+    }
+
+    const int32_t ret = alpm_pkg_vercmp(local_pkg_ver->c_str(), sync_pkg_ver);
     if (ret == 1) {
-        return fmt::format(FMT_COMPILE("∨{}"), local_pkg_ver);
+        m_local_state.version = fmt::format(FMT_COMPILE("∨{}"), *local_pkg_ver);
     } else if (ret == -1) {
-        m_update = true;
-        return fmt::format(FMT_COMPILE("∧{}"), sync_pkg_ver);
+        m_local_state.is_update = true;
+        m_local_state.version   = fmt::format(FMT_COMPILE("∧{}"), sync_pkg_ver);
+    } else {
+        m_local_state.version = sync_pkg_ver;
     }
+}
 
-    return sync_pkg_ver;
+const std::string& Kernel::version() const noexcept {
+    resolve_local_state();
+    return m_local_state.version;
 }
 
-// Name must be without any repo name (e.g. core/linux)
 bool Kernel::is_installed() const noexcept {
-    auto* db  = alpm_get_localdb(m_handle);
-    auto* pkg = alpm_db_get_pkg(db, m_name.c_str());
+    resolve_local_state();
+    return m_local_state.is_installed;
+}
 
-    return pkg != nullptr;
+bool Kernel::is_update_available() const noexcept {
+    resolve_local_state();
+    return m_local_state.is_update;
 }
 
-bool Kernel::install() const noexcept {
+bool Kernel::install(Transaction& trans) const noexcept {
 #ifdef ENABLE_AUR_KERNELS
     if (m_repo == "aur") {
-        g_aur_kernel_install_list.insert(g_aur_kernel_install_list.end(), {m_name.c_str()});
+        trans.add_aur_install(m_name);
         return true;
     }
 #endif
-    const char* pkg_name    = alpm_pkg_get_name(m_pkg);
-    const char* pkg_headers = alpm_pkg_get_name(m_headers);
-    if (is_root_on_zfs && m_zfs_module != nullptr) {
-        g_kernel_install_list.emplace_back(alpm_pkg_get_name(m_zfs_module));
-    }
-
-    const bool is_nvidia_dkms_installed = [handle = m_handle] {
-        static constexpr std::string_view NVIDIA_DKMS_PKG = "nvidia-dkms";
-        return alpm_db_get_pkg(alpm_get_localdb(handle), NVIDIA_DKMS_PKG.data()) != nullptr;
-    }();
-    const bool is_nvidia_open_dkms_installed = [handle = m_handle] {
-        static constexpr std::string_view NVIDIA_OPEN_DKMS_PKG = "nvidia-open-dkms";
-        return alpm_db_get_pkg(alpm_get_localdb(handle), NVIDIA_OPEN_DKMS_PKG.data()) != nullptr;
-    }();
-    const bool dkms_modules_not_installed = (!is_nvidia_dkms_installed && !is_nvidia_open_dkms_installed);
+    const auto& hw_profile = HardwareProfile::get();
+    if (hw_profile.is_root_on_zfs() && !m_zfs_module.empty()) {
+        trans.add_install(m_zfs_module);
+    }
 
-    // if we have any of the modules already installed,
-    // then just use whatever is installed. skipping chwd detection
-    const bool is_nvidia_modules_installed      = utils::exec("pacman -Qqs '^linux-cachyos' 2>/dev/null | grep -q '\\-nvidia$'; echo $?") == "0";
-    const bool is_nvidia_open_modules_installed = utils::exec("pacman -Qqs '^linux-cachyos' 2>/dev/null | grep -q '\\-nvidia-open$'; echo $?") == "0";
+    const auto& installed_modules         = get_installed_nvidia_modules(m_handle);
+    const bool dkms_modules_not_installed = (!installed_modules.nvidia_dkms && !installed_modules.nvidia_open_dkms);
 
-    bool should_install_nvidia      = (is_nvidia_card_prebuild_module && m_nvidia_module != nullptr);
-    bool should_install_nvidia_open = (is_nvidia_card_prebuild_open_module && m_nvidia_open_module != nullptr);
+    bool should_install_nvidia      = hw_profile.is_nvidia_card_prebuild_module();
+    bool should_install_nvidia_open = hw_profile.is_nvidia_card_prebuild_open_module();
 
-    if (is_nvidia_open_modules_installed) {
+    // if we have any of the modules already installed,
+    // then just use whatever is installed. skipping chwd detection
+    if (installed_modules.nvidia_open_prebuilt) {
         should_install_nvidia_open = true;
         should_install_nvidia      = false;
-    } else if (is_nvidia_modules_installed) {
+    } else if (installed_modules.nvidia_prebuilt) {
         should_install_nvidia_open = false;
         should_install_nvidia      = true;
     }
+    should_install_nvidia_open = (should_install_nvidia_open && !m_nvidia_open_module.empty());
+    should_install_nvidia      = (should_install_nvidia && !m_nvidia_module.empty());
 
     if (dkms_modules_not_installed && should_install_nvidia_open) {
-        g_kernel_install_list.emplace_back(alpm_pkg_get_name(m_nvidia_open_module));
+        trans.add_install(m_nvidia_open_module);
     } else if (dkms_modules_not_installed && should_install_nvidia) {
-        g_kernel_install_list.emplace_back(alpm_pkg_get_name(m_nvidia_module));
+        trans.add_install(m_nvidia_module);
     }
-    g_kernel_install_list.insert(g_kernel_install_list.end(), {pkg_name, pkg_headers});
+    trans.add_install(m_name);
+    trans.add_install(m_name_headers);
     return true;
 }
 
-bool Kernel::remove() const noexcept {
+bool Kernel::remove(Transaction& trans) const noexcept {
     if (!is_installed()) {
         return false;
     }
-    g_kernel_removal_list.push_back(m_name);
+    trans.add_removal(m_name);
 
-    const auto& append_to_removal_list = [this](alpm_pkg_t* sync_pkg) {
-        if (sync_pkg == nullptr) {
+    const auto& append_to_removal_list = [this, &trans](const std::string& pkg_name) {
+        if (pkg_name.empty()) {
             return;
         }
 
-        const char* pkg_name = alpm_pkg_get_name(sync_pkg);
-
         // check if requested package is installed
-        auto* db        = alpm_get_localdb(m_handle);
-        auto* local_pkg = alpm_db_get_pkg(db, pkg_name);
-        if (local_pkg != nullptr) {
-            g_kernel_removal_list.emplace_back(pkg_name);
+        if (get_local_pkg_version(m_handle, pkg_name)) {
+            trans.add_removal(pkg_name);
         }
     };
 
-    append_to_removal_list(m_headers);
+    append_to_removal_list(m_name_headers);
     append_to_removal_list(m_zfs_module);
     append_to_removal_list(m_nvidia_module);
     append_to_removal_list(m_nvidia_open_module);
@@ -177,133 +341,219 @@ bool Kernel::remove() const noexcept {
 //    reponame/linux-yyy reponame/linux-yyy-headers
 //    ...
 std::vector<Kernel> Kernel::get_kernels(alpm_handle_t* handle) noexcept {
-    static constexpr std::string_view ignored_pkg  = "linux-api-headers";
-    static constexpr std::string_view replace_part = "-headers";
-    std::vector<Kernel> kernels{};
+    const trace::Span trace_span{"get_kernels"};
+    static const auto index_path = utils::fix_path("~/.cache/cachyos-km/kernel-index");
 
-    auto* dbs                       = alpm_get_syncdbs(handle);
-    [[maybe_unused]] auto* local_db = alpm_get_localdb(handle);
-    for (alpm_list_t* i = dbs; i != nullptr; i = i->next) {
-        static constexpr auto needle = "linux[^ ]*-headers";
-        alpm_list_t* needles         = nullptr;
-        alpm_list_t* ret_list        = nullptr;
+    // The fresh handle has the up-to-date localdb cache
+    g_local_pkg_overlay.clear();
+    g_local_nvidia_modules = {};
 
-        // NOLINTNEXTLINE
-        needles = alpm_list_add(needles, const_cast<void*>(reinterpret_cast<const void*>(needle)));
+    // Repo, which db file differs from the one we have in the index, is searched again.
+    // Rows of the others are built right from the index, their sync dbs aren't loaded at all.
+    // NOTE: the repos are searched serially. libalpm isn't thread-safe, even with separate sync dbs of the same handle,
+    // and the pkgcache load is what takes the time, the name matching is cheap.
+    auto cached_repos = kernel_index::load_index(index_path);
 
+    // Merge results in the pacman.conf order
+    std::vector<Kernel> kernels{};
+    std::vector<kernel_index::RepoEntry> repos{};
+    bool is_index_changed{};
+    for (alpm_list_t* i = alpm_get_syncdbs(handle); i != nullptr; i = i->next) {
         auto* db            = reinterpret_cast<alpm_db_t*>(i->data);
         const char* db_name = alpm_db_get_name(db);
-        alpm_db_search(db, needles, &ret_list);
-
-        for (alpm_list_t* j = ret_list; j != nullptr; j = j->next) {
-            auto* pkg            = reinterpret_cast<alpm_pkg_t*>(j->data);
-            std::string pkg_name = alpm_pkg_get_name(pkg);
-            const auto& found    = std::ranges::search(pkg_name, ignored_pkg);
-            if (!found.empty()) {
-                continue;
+        const auto& stamp   = kernel_index::get_db_stamp(handle, db);
+
+        auto& repo = repos.emplace_back();
+        if (auto it = std::ranges::find_if(cached_repos, [db_name](auto&& cached_repo) { return cached_repo.name == db_name; });
+            stamp && it != cached_repos.end() && it->stamp == *stamp) {
+            repo = std::move(*it);
+        } else {
+            is_index_changed = true;
+            repo             = kernel_index::RepoEntry{.name = db_name, .stamp = stamp.value_or(kernel_index::DbStamp{})};
+            repo.kernels     = find_kernels_in_names(get_pkg_names(db));
+            for (auto&& kernel_entry : repo.kernels) {
+                // The pkgcache is loaded by the search already
+                kernel_entry.version = alpm_pkg_get_version(alpm_db_get_pkg(db, kernel_entry.name.c_str()));
             }
-            alpm_pkg_t* headers = alpm_db_get_pkg(db, pkg_name.c_str());
+        }
 
-            utils::remove_all(pkg_name, replace_part);
-            pkg = alpm_db_get_pkg(db, pkg_name.c_str());
+        for (auto&& kernel_entry : repo.kernels) {
+            Kernel kernel_obj{};
 
-            // Skip if the actual kernel package is not found
-            /* clang-format off */
-            if (!pkg) { continue; }
-            /* clang-format on */
+            kernel_obj.m_handle             = handle;
+            kernel_obj.m_repo               = db_name;
+            kernel_obj.m_raw                = fmt::format(FMT_COMPILE("{}/{}"), db_name, kernel_entry.name);
+            kernel_obj.m_name               = kernel_entry.name;
+            kernel_obj.m_version            = kernel_entry.version;
+            kernel_obj.m_name_headers       = kernel_entry.headers;
+            kernel_obj.m_zfs_module         = kernel_entry.zfs_module;
+            kernel_obj.m_nvidia_module      = kernel_entry.nvidia_module;
+            kernel_obj.m_nvidia_open_module = kernel_entry.nvidia_open_module;
 
-            auto kernel_obj = Kernel{handle, pkg, headers, db_name, fmt::format(FMT_COMPILE("{}/{}"), db_name, pkg_name)};
+            kernels.emplace_back(std::move(kernel_obj));
+        }
+    }
+    if (is_index_changed || repos.size() != cached_repos.size()) {
+        kernel_index::save_index(index_path, repos);
+    }
 
 #ifdef HAVE_ALPM_INSTALLED_DB
-            auto* local_pkg = alpm_db_get_pkg(local_db, pkg_name.c_str());
-            if (local_pkg) {
-                const char* pkg_installed_db = alpm_pkg_get_installed_db(local_pkg);
-                if (pkg_installed_db != nullptr) {
-                    kernel_obj.m_installed_db = pkg_installed_db;
-                }
+    // Local db is shared between all repos, so we query it only from this thread.
+    auto* local_db = alpm_get_localdb(handle);
+    for (auto&& kernel_obj : kernels) {
+        auto* local_pkg = alpm_db_get_pkg(local_db, kernel_obj.m_name.c_str());
+        if (local_pkg) {
+            const char* pkg_installed_db = alpm_pkg_get_installed_db(local_pkg);
+            if (pkg_installed_db != nullptr) {
+                kernel_obj.m_installed_db = pkg_installed_db;
             }
+        }
+    }
 #endif
-            if (pkg_name.starts_with("linux-cachyos")) {
-                const auto& zfs_pkgname = fmt::format(FMT_COMPILE("{}-zfs"), pkg_name);
-                kernel_obj.m_zfs_module = alpm_db_get_pkg(db, zfs_pkgname.c_str());
 
-                const auto& nvidia_pkgname = fmt::format(FMT_COMPILE("{}-nvidia"), pkg_name);
-                kernel_obj.m_nvidia_module = alpm_db_get_pkg(db, nvidia_pkgname.c_str());
+    return kernels;
+}
 
-                const auto& nvidia_open_pkgname = fmt::format(FMT_COMPILE("{}-nvidia-open"), pkg_name);
-                kernel_obj.m_nvidia_open_module = alpm_db_get_pkg(db, nvidia_open_pkgname.c_str());
-            }
+auto Kernel::find_faster_variant(std::span<const Kernel> kernels, const Kernel& kernel, const CpuFeatures& cpu_features) noexcept -> const Kernel* {
+    // Without the installed db we can't tell, which repo the kernel has been installed from
+    /* clang-format off */
+    if (!kernel.is_installed() || kernel.m_installed_db != kernel.m_repo) { return nullptr; }
+    /* clang-format on */
 
-            kernels.emplace_back(std::move(kernel_obj));
-        }
+    const Kernel* faster_kernel{};
+    auto best_level = get_repo_x86_64_level(kernel.m_repo);
+    for (auto&& repo_kernel : kernels) {
+        /* clang-format off */
+        if (repo_kernel.m_name != kernel.m_name || !is_repo_supported(repo_kernel.m_repo, cpu_features)) { continue; }
+        /* clang-format on */
 
-        alpm_list_free(needles);
-        alpm_list_free(ret_list);
+        if (const auto level = get_repo_x86_64_level(repo_kernel.m_repo); level > best_level) {
+            faster_kernel = &repo_kernel;
+            best_level    = level;
+        }
     }
+    return faster_kernel;
+}
 
 #ifdef ENABLE_AUR_KERNELS
-    namespace fs = std::filesystem;
-
-    bool is_paru_installed{true};
-    if (!fs::exists("/sbin/paru") && !fs::exists("/sbin/awk")) {
-        fmt::print(stderr, "Paru & AWK are not installed! Disabling AUR kernels support\n");
-        is_paru_installed = false;
-    }
+std::vector<Kernel> Kernel::get_aur_kernels(alpm_handle_t* handle, const std::unordered_set<std::string>& repo_kernel_names) noexcept {
+    const trace::Span trace_span{"get_aur_kernels"};
 
-    if (!kernels.empty() && is_paru_installed) {
-        auto&& aur_kernels_headers = utils::make_multiline(utils::exec("paru --aur -Sl | grep ' linux[^ ]*-headers' | awk '{print $2}'"));
-
-        for (auto&& aur_kernel_header : aur_kernels_headers) {
-            auto&& aur_kernel = std::string{aur_kernel_header};
-            utils::replace_all(aur_kernel, "-headers", "");
-            if (std::ranges::find_if(kernels, [&](auto& kernel) { return kernel.m_name == aur_kernel; }) != kernels.end()) {
-                continue;
-            }
-            Kernel kernel_obj{};
+    std::vector<Kernel> kernels{};
+    for (auto&& aur_kernel : detail::get_aur_kernels(repo_kernel_names)) {
+        Kernel kernel_obj{};
 
-            kernel_obj.m_handle       = handle;
-            kernel_obj.m_repo         = "aur";
-            kernel_obj.m_name         = aur_kernel;
-            kernel_obj.m_name_headers = aur_kernel_header;
-            kernel_obj.m_version      = "unknown-version";
-            kernel_obj.m_raw          = fmt::format("aur/{}", aur_kernel);
+        kernel_obj.m_handle       = handle;
+        kernel_obj.m_repo         = "aur";
+        kernel_obj.m_raw          = fmt::format("aur/{}", aur_kernel.name);
+        kernel_obj.m_name         = std::move(aur_kernel.name);
+        kernel_obj.m_name_headers = std::move(aur_kernel.name_headers);
+        kernel_obj.m_version      = std::move(aur_kernel.version);
 
-            kernels.emplace_back(std::move(kernel_obj));
-        }
+        kernels.emplace_back(std::move(kernel_obj));
     }
-#endif
-
     return kernels;
 }
+#endif
 
-void Kernel::commit_transaction() noexcept {
+auto Kernel::commit_transaction(const Transaction& trans, const utils::transaction_progress_cb_t& on_progress) noexcept -> utils::TransactionResult {
+    utils::TransactionResult aur_result{};
 #ifdef ENABLE_AUR_KERNELS
-    if (!g_aur_kernel_install_list.empty()) {
-        detail::install_aur_kernels(g_aur_kernel_install_list);
-        g_aur_kernel_install_list.clear();
+    if (const auto& aur_install_list = trans.get_aur_install_list(); !aur_install_list.empty()) {
+        aur_result = detail::install_aur_kernels(aur_install_list, on_progress);
     }
 #endif
-    if (!g_kernel_install_list.empty()) {
-        const auto& packages_install = [&] { return utils::join_vec(g_kernel_install_list, " "); }();
-        utils::runCmdTerminal(fmt::format(FMT_COMPILE("pacman -S --needed {}"), packages_install).c_str(), true);
+    /* clang-format off */
+    if (!trans.has_alpm_targets()) { return aur_result; }
+    /* clang-format on */
+
+    auto alpm_result = run_alpm_helper(trans, "pkexec", on_progress);
+    if (!alpm_result.is_success) {
+        fmt::print(stderr, "[KERNEL] alpm transaction has failed: {}\n", alpm_result.err_msg);
     }
+    /* clang-format off */
+    if (aur_result.is_success) { return alpm_result; }
+    if (alpm_result.is_success) { return aur_result; }
+    /* clang-format on */
+    return {.is_success = false, .err_msg = fmt::format("{}\n{}", aur_result.err_msg, alpm_result.err_msg)};
+}
 
-    if (!g_kernel_removal_list.empty()) {
-        const auto& packages_remove = [&] { return utils::join_vec(g_kernel_removal_list, " "); }();
-        utils::runCmdTerminal(fmt::format(FMT_COMPILE("pacman -Rsn {}"), packages_remove).c_str(), true);
+bool Kernel::commit_transaction_batch(const Transaction& trans) noexcept {
+    if (!trans.get_aur_install_list().empty()) {
+        fmt::print(stderr, "AUR kernels cannot be installed in batch mode\n");
     }
+    /* clang-format off */
+    if (!trans.has_alpm_targets()) { return true; }
+    /* clang-format on */
+
+    // progress goes to stderr, that way stdout stays machine-readable
+    const auto& print_progress = [](const utils::TransactionProgress& progress) {
+        if (progress.percent < 0) {
+            fmt::print(stderr, "{}\n", progress.message);
+            return;
+        }
+        fmt::print(stderr, "{} ({}%)\n", progress.message, progress.percent);
+    };
+    const auto& result = run_alpm_helper(trans, (::geteuid() != 0) ? "sudo" : "", print_progress);
+    return result.is_success;
 }
 
-/** @brief Get global kernel install list
- *  @return Global kernel install list
- */
-std::vector<std::string_view>& Kernel::get_install_list() noexcept {
-    return g_kernel_install_list;
+auto Kernel::prefetch_packages(const std::vector<std::string>& pkg_names) noexcept -> std::int32_t {
+    const trace::Span trace_span{"prefetch_packages"};
+
+    std::error_code err{};
+    fs::create_directories(get_prefetch_cache_dir(), err);
+    if (err) {
+        fmt::print(stderr, "[KERNEL] failed to create {}: {}\n", get_prefetch_cache_dir(), err.message());
+        return -1;
+    }
+    return utils::prefetch_packages(pkg_names, get_prefetch_cache_dir());
 }
 
-/** @brief Get global kernel removal list
- *  @return Global kernel removal list
- */
-std::vector<std::string_view>& Kernel::get_removal_list() noexcept {
-    return g_kernel_removal_list;
+auto Kernel::refresh_local_state(std::span<Kernel> kernels, std::span<const std::string> changed_pkgs) noexcept -> std::vector<std::size_t> {
+    const std::unordered_set<std::string_view> pkg_names{changed_pkgs.begin(), changed_pkgs.end()};
+
+    // Only the packages of the transaction are looked up, instead of reloading the whole handle
+    auto&& local_pkgs = utils::read_local_pkg_versions("/var/lib/pacman/", pkg_names);
+    for (auto&& pkg_name : pkg_names) {
+        auto local_pkg_it = local_pkgs.find(std::string{pkg_name});
+        if (local_pkg_it == local_pkgs.end()) {
+            g_local_pkg_overlay.insert_or_assign(std::string{pkg_name}, std::nullopt);
+        } else {
+            g_local_pkg_overlay.insert_or_assign(std::string{pkg_name}, std::move(local_pkg_it->second));
+        }
+    }
+
+    // The helper installs the name from the first sync repo, which has it,
+    // and the kernels are in the same pacman.conf order, so the first row is the installed one.
+    std::unordered_map<std::string_view, std::string_view> installed_repos{};
+    std::vector<std::size_t> changed_kernels{};
+    for (std::size_t i = 0; i < kernels.size(); ++i) {
+        auto& kernel = kernels[i];
+        /* clang-format off */
+        if (!pkg_names.contains(kernel.m_name)) { continue; }
+        /* clang-format on */
+
+        const auto prev_state = std::pair{kernel.is_installed(), kernel.version()};
+        kernel.m_local_state  = {};
+        if (prev_state == std::pair{kernel.is_installed(), kernel.version()}) {
+            continue;
+        }
+        changed_kernels.push_back(i);
+        if (kernel.is_installed()) {
+            installed_repos.emplace(kernel.m_name, kernel.m_repo);
+        }
+    }
+
+    // Sibling rows get the repo too, that way they are shown as not installed
+    for (const auto kernel_index : changed_kernels) {
+        auto& kernel = kernels[kernel_index];
+        if (auto repo_it = installed_repos.find(kernel.m_name); repo_it != installed_repos.end() && repo_it->second != "aur") {
+            kernel.m_installed_db = repo_it->second;
+        } else {
+            kernel.m_installed_db.clear();
+        }
+    }
+
+    return changed_kernels;
 }
@@ -19,20 +19,23 @@
 #ifndef KERNEL_HPP
 #define KERNEL_HPP
 
-#include <algorithm>    // for search
-#include <ranges>       // for ranges::*
-#include <string>       // for string
-#include <string_view>  // for string_view
-#include <vector>       // for vector
+#include "alpm_transaction.hpp"
+#include "cpu_features.hpp"
+#include "transaction.hpp"
+
+#include <algorithm>      // for search
+#include <ranges>         // for ranges::*
+#include <span>           // for span
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_set>  // for unordered_set
+#include <vector>         // for vector
 
 #include <alpm.h>
 
 class Kernel {
  public:
     constexpr Kernel() = default;
-    explicit Kernel(alpm_handle_t* handle, alpm_pkg_t* pkg, alpm_pkg_t* headers) : m_name(alpm_pkg_get_name(pkg)), m_pkg(pkg), m_headers(headers), m_handle(handle) { }
-    explicit Kernel(alpm_handle_t* handle, alpm_pkg_t* pkg, alpm_pkg_t* headers, const std::string_view& repo) : m_name(alpm_pkg_get_name(pkg)), m_repo(repo), m_pkg(pkg), m_headers(headers), m_handle(handle) { }
-    explicit Kernel(alpm_handle_t* handle, alpm_pkg_t* pkg, alpm_pkg_t* headers, const std::string_view& repo, const std::string_view& raw) : m_name(alpm_pkg_get_name(pkg)), m_repo(repo), m_raw(raw), m_pkg(pkg), m_headers(headers), m_handle(handle) { }
 
     constexpr std::string_view category() const noexcept {
         using namespace std::string_view_literals;
@@ -80,14 +83,18 @@ class Kernel {
 
         return "stable"sv;
     }
-    std::string version() noexcept;
+    const std::string& version() const noexcept;
 
     bool is_installed() const noexcept;
-    bool install() const noexcept;
-    bool remove() const noexcept;
+    bool is_update_available() const noexcept;
+    // Add packages of the kernel into the transaction.
+    // Returns false if there is nothing to do (e.g kernel isn't installed).
+    bool install(Transaction& trans) const noexcept;
+    bool remove(Transaction& trans) const noexcept;
     /* clang-format off */
-    constexpr bool is_update_available() const noexcept
-    { return m_update; }
+
+    inline std::string_view get_name() const noexcept
+    { return m_name; }
 
     inline const char* get_raw() const noexcept
     { return m_raw.c_str(); }
@@ -99,30 +106,57 @@ class Kernel {
     { return m_installed_db.c_str(); }
     /* clang-format on */
 
-    static void commit_transaction() noexcept;
+    // Installs and removes kernels in the single transaction via pkexec'ed helper.
+    // Use refresh_local_state afterwards, to see what has changed.
+    // Failed AUR builds and the failed alpm transaction are both reported in the result.
+    static auto commit_transaction(const Transaction& trans, const utils::transaction_progress_cb_t& on_progress = {}) noexcept -> utils::TransactionResult;
+    // Runs the helper directly without confirmations, used by the CLI.
+    static bool commit_transaction_batch(const Transaction& trans) noexcept;
+    // Download the packages to install ahead of the commit, which then picks them up instead of downloading.
+    // Returns number of the packages, which are ready, or -1 on failure.
+    // NOTE: it requires network access, and must not be called from the GUI thread.
+    static auto prefetch_packages(const std::vector<std::string>& pkg_names) noexcept -> std::int32_t;
 
     static std::vector<Kernel> get_kernels(alpm_handle_t* handle) noexcept;
 
-    static std::vector<std::string_view>& get_install_list() noexcept;
-    static std::vector<std::string_view>& get_removal_list() noexcept;
+    // Find the same kernel in the repo built for the higher x86-64 level, which the CPU supports (e.g cachyos-v3 instead of cachyos).
+    // Returns nullptr if the kernel isn't installed from its repo, or there is no faster build of it.
+    static auto find_faster_variant(std::span<const Kernel> kernels, const Kernel& kernel, const CpuFeatures& cpu_features) noexcept -> const Kernel*;
+#ifdef ENABLE_AUR_KERNELS
+    // NOTE: it requires network access, and must not be called from the GUI thread.
+    static std::vector<Kernel> get_aur_kernels(alpm_handle_t* handle, const std::unordered_set<std::string>& repo_kernel_names) noexcept;
+#endif
+
+    // Re-query the local state of the packages, after the transaction was committed.
+    // Newly installed kernels are marked as installed from the first repo of the name, same as the helper resolves it.
+    // Returns indices of the kernels, which state has changed.
+    static auto refresh_local_state(std::span<Kernel> kernels, std::span<const std::string> changed_pkgs) noexcept -> std::vector<std::size_t>;
 
  private:
-    bool m_update{};
+    // Snapshot of the local db state, resolved on first use.
+    // Kernels are recreated on the handle reload, so it never becomes stale.
+    struct LocalState {
+        bool is_resolved{};
+        bool is_installed{};
+        bool is_update{};
+        std::string version{};
+    };
+    mutable LocalState m_local_state{};
+
+    void resolve_local_state() const noexcept;
 
     std::string m_name{};
     std::string m_repo{"local"};
     std::string m_raw{};
     std::string m_installed_db{};
-#ifdef ENABLE_AUR_KERNELS
+    // Version in the repo, the sync db isn't kept around, only names of the packages are
     std::string m_version{};
     std::string m_name_headers{};
-#endif
+    // Empty if there is no such module in the repo
+    std::string m_zfs_module{};
+    std::string m_nvidia_module{};
+    std::string m_nvidia_open_module{};
 
-    alpm_pkg_t* m_pkg{nullptr};
-    alpm_pkg_t* m_headers{nullptr};
-    alpm_pkg_t* m_zfs_module{nullptr};
-    alpm_pkg_t* m_nvidia_module{nullptr};
-    alpm_pkg_t* m_nvidia_open_module{nullptr};
     alpm_handle_t* m_handle{nullptr};
 };
 
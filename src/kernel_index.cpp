@@ -0,0 +1,165 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "kernel_index.hpp"
+#include "string_utils.hpp"
+
+#include <sys/stat.h>  // for stat
+
+#include <cerrno>    // for errno
+#include <charconv>  // for from_chars
+#include <cstdio>    // for fopen, fclose, fread
+#include <cstring>   // for strerror
+
+#include <array>       // for array
+#include <filesystem>  // for rename, create_directories
+#include <fstream>     // for ofstream
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump it, when the layout of the index changes.
+static constexpr std::string_view INDEX_HEADER = "cachyos-km-kernel-index 3";
+static constexpr std::string_view EMPTY_FIELD  = "-";
+
+constexpr auto to_field(std::string_view value) noexcept -> std::string_view {
+    return value.empty() ? EMPTY_FIELD : value;
+}
+
+constexpr auto from_field(std::string_view value) noexcept -> std::string {
+    return value == EMPTY_FIELD ? std::string{} : std::string{value};
+}
+
+template <typename T>
+auto parse_number(std::string_view str) noexcept -> std::optional<T> {
+    T value{};
+    const auto* end = str.data() + str.size();
+    if (auto [ptr, ec] = std::from_chars(str.data(), end, value); ec != std::errc{} || ptr != end) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+}  // namespace
+
+namespace kernel_index {
+
+auto get_db_stamp(alpm_handle_t* handle, alpm_db_t* db) noexcept -> std::optional<DbStamp> {
+    // dbpath always ends with slash (e.g /var/lib/pacman/)
+    const auto& db_filepath = fmt::format(FMT_COMPILE("{}sync/{}.db"), alpm_option_get_dbpath(handle), alpm_db_get_name(db));
+
+    struct stat db_stat{};
+    if (::stat(db_filepath.c_str(), &db_stat) != 0) {
+        return std::nullopt;
+    }
+    const std::int64_t mtime_ns = db_stat.st_mtim.tv_sec * 1'000'000'000 + db_stat.st_mtim.tv_nsec;
+    return DbStamp{.mtime = mtime_ns, .size = static_cast<std::uint64_t>(db_stat.st_size)};
+}
+
+auto load_index(std::string_view filepath) noexcept -> std::vector<RepoEntry> {
+    // Don't use utils::read_whole_file, we don't want to spam about missing cache.
+    std::string content{};
+    {
+        auto* file = std::fopen(filepath.data(), "rb");
+        if (file == nullptr) {
+            return {};
+        }
+        std::array<char, 4096> buffer{};
+        std::size_t read_bytes{};
+        while ((read_bytes = std::fread(buffer.data(), sizeof(char), buffer.size(), file)) != 0) {
+            content.append(buffer.data(), read_bytes);
+        }
+        std::fclose(file);
+    }
+
+    auto lines = utils::make_split_view(content, '\n');
+    auto it    = std::ranges::begin(lines);
+    if (it == std::ranges::end(lines) || *it != INDEX_HEADER) {
+        return {};
+    }
+
+    std::vector<RepoEntry> repos{};
+    for (++it; it != std::ranges::end(lines); ++it) {
+        const auto& fields = utils::make_multiline_view(*it, ' ');
+        if (fields.empty()) {
+            continue;
+        }
+
+        if (fields[0] == "repo" && fields.size() == 4) {
+            auto mtime = parse_number<std::int64_t>(fields[2]);
+            auto size  = parse_number<std::uint64_t>(fields[3]);
+            if (!mtime || !size) {
+                return {};
+            }
+            repos.emplace_back(RepoEntry{.name = std::string{fields[1]}, .stamp = DbStamp{.mtime = *mtime, .size = *size}});
+        } else if (fields[0] == "kernel" && fields.size() == 7 && !repos.empty()) {
+            repos.back().kernels.emplace_back(KernelEntry{
+                .name               = from_field(fields[1]),
+                .version            = from_field(fields[2]),
+                .headers            = from_field(fields[3]),
+                .zfs_module         = from_field(fields[4]),
+                .nvidia_module      = from_field(fields[5]),
+                .nvidia_open_module = from_field(fields[6]),
+            });
+        } else {
+            // Treat broken index as missing one
+            fmt::print(stderr, "[KERNELINDEX] '{}' is malformed, ignoring it\n", filepath);
+            return {};
+        }
+    }
+    return repos;
+}
+
+bool save_index(std::string_view filepath, std::span<const RepoEntry> repos) noexcept {
+    std::string content{INDEX_HEADER};
+    content += '\n';
+    for (auto&& repo : repos) {
+        content += fmt::format(FMT_COMPILE("repo {} {} {}\n"), repo.name, repo.stamp.mtime, repo.stamp.size);
+        for (auto&& kernel : repo.kernels) {
+            content += fmt::format(FMT_COMPILE("kernel {} {} {} {} {} {}\n"), to_field(kernel.name), to_field(kernel.version), to_field(kernel.headers),
+                to_field(kernel.zfs_module), to_field(kernel.nvidia_module), to_field(kernel.nvidia_open_module));
+        }
+    }
+
+    const fs::path index_path{filepath};
+    std::error_code err_code{};
+    fs::create_directories(index_path.parent_path(), err_code);
+
+    // Write into temporary file first, that way we never leave half-written index behind.
+    const auto& tmp_path = fmt::format(FMT_COMPILE("{}.tmp"), filepath);
+    {
+        std::ofstream file{tmp_path};
+        if (!file.is_open()) {
+            fmt::print(stderr, "[KERNELINDEX] '{}' open failed: {}\n", tmp_path, std::strerror(errno));
+            return false;
+        }
+        file << content;
+    }
+    fs::rename(tmp_path, index_path, err_code);
+    if (err_code) {
+        fmt::print(stderr, "[KERNELINDEX] '{}' rename failed: {}\n", filepath, err_code.message());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace kernel_index
@@ -0,0 +1,78 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef KERNEL_INDEX_HPP
+#define KERNEL_INDEX_HPP
+
+#include <cstdint>      // for int64_t, uint64_t
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#include <alpm.h>
+
+namespace kernel_index {
+
+/// Package names of a kernel found in the sync db.
+/// Empty string means the package doesn't exist in the repo.
+struct KernelEntry {
+    std::string name{};
+    /// Version of the kernel package in the repo, that way the rows are built without loading the sync db.
+    std::string version{};
+    std::string headers{};
+    std::string zfs_module{};
+    std::string nvidia_module{};
+    std::string nvidia_open_module{};
+};
+
+/// Identity of the sync db file on the disk.
+struct DbStamp {
+    std::int64_t mtime{};
+    std::uint64_t size{};
+
+    constexpr bool operator==(const DbStamp&) const noexcept = default;
+};
+
+struct RepoEntry {
+    std::string name{};
+    DbStamp stamp{};
+    std::vector<KernelEntry> kernels{};
+};
+
+/// @brief Get stamp of the sync db file (e.g /var/lib/pacman/sync/core.db).
+/// @param handle The alpm handle, which owns the db.
+/// @param db The sync db.
+/// @return The stamp, or nullopt if the db file doesn't exist.
+auto get_db_stamp(alpm_handle_t* handle, alpm_db_t* db) noexcept -> std::optional<DbStamp>;
+
+/// @brief Load the kernel index from the file.
+/// @param filepath The path to the index file.
+/// @return Entries of the index, empty if the index doesn't exist or is outdated.
+auto load_index(std::string_view filepath) noexcept -> std::vector<RepoEntry>;
+
+/// @brief Write the kernel index into the file.
+/// @param filepath The path to the index file.
+/// @param repos The entries to store.
+/// @return True on success, otherwise false.
+bool save_index(std::string_view filepath, std::span<const RepoEntry> repos) noexcept;
+
+}  // namespace kernel_index
+
+#endif  // KERNEL_INDEX_HPP
@@ -0,0 +1,390 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "kernel_list_model.hpp"
+
+#include <algorithm>  // for any_of, find_if, sort
+#include <array>      // for array
+#include <iterator>   // for make_move_iterator
+#include <ranges>     // for views::reverse, views::take
+#include <span>       // for span
+#include <utility>    // for exchange
+
+#include <QColor>
+#include <QStringList>
+
+namespace {
+
+/// Value of the record, which is shown in the column.
+struct BootMetric final {
+    std::int32_t column{};
+    double (*get_value)(const BootRecord&){};
+    // e.g bandwidth, the rest of the metrics are better when they are lower
+    bool is_higher_better{};
+};
+
+static constexpr std::array BOOT_METRICS{
+    BootMetric{KernelCol::BootTime, +[](const BootRecord& record) { return record.timings.total_sec; }, false},
+    BootMetric{KernelCol::InitramfsSize, +[](const BootRecord& record) { return static_cast<double>(record.initramfs_size); }, false},
+    BootMetric{KernelCol::ModuleCount, +[](const BootRecord& record) { return static_cast<double>(record.module_count); }, false},
+    BootMetric{KernelCol::SyscallLatency, +[](const BootRecord& record) { return record.bench.syscall_latency_ns; }, false},
+    BootMetric{KernelCol::ContextSwitch, +[](const BootRecord& record) { return record.bench.context_switch_us; }, false},
+    BootMetric{KernelCol::MemoryBandwidth, +[](const BootRecord& record) { return record.bench.memory_bandwidth_gib_s; }, true},
+};
+
+// Change against the previous release, which is highlighted
+static constexpr double REGRESSION_THRESHOLD = 0.1;
+// Releases in the tooltip, newest first
+static constexpr std::size_t MAX_TOOLTIP_RECORDS = 10;
+
+inline auto to_qstring(std::string_view str) noexcept -> QString {
+    return QString::fromUtf8(str.data(), static_cast<qsizetype>(str.size()));
+}
+
+auto find_boot_metric(std::int32_t column) noexcept -> const BootMetric* {
+    const auto* metric_it = std::ranges::find_if(BOOT_METRICS, [column](auto&& metric) { return metric.column == column; });
+    return (metric_it != BOOT_METRICS.end()) ? metric_it : nullptr;
+}
+
+auto format_boot_metric(std::int32_t column, double value) noexcept -> QString {
+    // zero or negative means it wasn't measured
+    /* clang-format off */
+    if (value <= 0) { return {}; }
+    /* clang-format on */
+    switch (column) {
+    case KernelCol::BootTime:
+        return QStringLiteral("%1 s").arg(value, 0, 'f', 1);
+    case KernelCol::InitramfsSize:
+        return QStringLiteral("%1 MiB").arg(value / (1024.0 * 1024.0), 0, 'f', 1);
+    case KernelCol::ModuleCount:
+        return QString::number(static_cast<qint64>(value));
+    case KernelCol::SyscallLatency:
+        return QStringLiteral("%1 ns").arg(value, 0, 'f', 1);
+    case KernelCol::ContextSwitch:
+        return QStringLiteral("%1 µs").arg(value, 0, 'f', 2);
+    case KernelCol::MemoryBandwidth:
+        return QStringLiteral("%1 GiB/s").arg(value, 0, 'f', 1);
+    default:
+        return {};
+    }
+}
+
+bool is_regression(const BootMetric& metric, std::span<const BootRecord> records) noexcept {
+    /* clang-format off */
+    if (records.size() < 2) { return false; }
+    /* clang-format on */
+    const auto latest_value   = metric.get_value(records.back());
+    const auto previous_value = metric.get_value(records[records.size() - 2]);
+    /* clang-format off */
+    if (latest_value <= 0 || previous_value <= 0) { return false; }
+    /* clang-format on */
+
+    const auto change = (latest_value - previous_value) / previous_value;
+    return metric.is_higher_better ? (change < -REGRESSION_THRESHOLD) : (change > REGRESSION_THRESHOLD);
+}
+
+auto get_boot_metric_data(const BootMetric& metric, std::span<const BootRecord> records, int role) noexcept -> QVariant {
+    /* clang-format off */
+    if (records.empty()) { return {}; }
+    /* clang-format on */
+    switch (role) {
+    case Qt::DisplayRole:
+        return format_boot_metric(metric.column, metric.get_value(records.back()));
+    case Qt::ForegroundRole:
+        return is_regression(metric, records) ? QVariant{QColor{Qt::red}} : QVariant{};
+    case Qt::ToolTipRole: {
+        QStringList history_lines{};
+        for (auto&& record : records | std::views::reverse | std::views::take(MAX_TOOLTIP_RECORDS)) {
+            const auto& value = format_boot_metric(metric.column, metric.get_value(record));
+            history_lines << QStringLiteral("%1: %2").arg(to_qstring(record.kernel_release), value.isEmpty() ? QStringLiteral("-") : value);
+        }
+        if (is_regression(metric, records)) {
+            history_lines.prepend(KernelListModel::tr("Regressed by more than %1% against the previous release").arg(REGRESSION_THRESHOLD * 100));
+        }
+        return history_lines.join('\n');
+    }
+    default:
+        return {};
+    }
+}
+
+// Local state is resolved lazily, make sure it happens on the GUI thread,
+// before the worker thread gets to the kernels.
+void resolve_kernels(std::span<const Kernel> kernels) noexcept {
+    for (auto&& kernel : kernels) {
+        [[maybe_unused]] const auto& version = kernel.version();
+    }
+}
+
+}  // namespace
+
+KernelListModel::KernelListModel(std::vector<Kernel>& kernels, QObject* parent)
+  : QAbstractTableModel(parent), m_kernels(kernels) {
+    resolve_kernels(std::span{m_kernels});
+    update_faster_variants();
+}
+
+int KernelListModel::rowCount(const QModelIndex& parent) const {
+    /* clang-format off */
+    if (parent.isValid()) { return 0; }
+    /* clang-format on */
+    return static_cast<int>(m_kernels.size());
+}
+
+int KernelListModel::columnCount(const QModelIndex& parent) const {
+    /* clang-format off */
+    if (parent.isValid()) { return 0; }
+    /* clang-format on */
+    return KernelCol::Count;
+}
+
+QVariant KernelListModel::data(const QModelIndex& index, int role) const {
+    /* clang-format off */
+    if (!index.isValid() || static_cast<std::size_t>(index.row()) >= m_kernels.size()) { return {}; }
+    /* clang-format on */
+    const auto row     = static_cast<std::size_t>(index.row());
+    const auto& kernel = m_kernels[row];
+
+    // Rows without the history fall through, e.g to the tooltip of the row
+    if (const auto* metric = find_boot_metric(index.column()); metric != nullptr) {
+        if (auto&& metric_data = get_boot_metric_data(*metric, get_boot_records(kernel), role); metric_data.isValid()) {
+            return metric_data;
+        }
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case KernelCol::PkgName:
+            return QString::fromUtf8(kernel.get_raw());
+        case KernelCol::Version:
+            return QString::fromStdString(kernel.version());
+        case KernelCol::Category:
+            return to_qstring(kernel.category());
+        default:
+            return {};
+        }
+    case Qt::CheckStateRole: {
+        /* clang-format off */
+        if (index.column() != KernelCol::Check) { return {}; }
+        /* clang-format on */
+        const bool is_checked = (is_installed_from_repo(kernel) != m_change_set.contains(row));
+        return is_checked ? Qt::Checked : Qt::Unchecked;
+    }
+    case Qt::ToolTipRole:
+        if (auto faster_it = m_faster_variants.find(row); faster_it != m_faster_variants.end()) {
+            return tr("Faster build for this CPU is available from %1").arg(to_qstring(m_kernels[faster_it->second].get_repo()));
+        }
+        if (std::ranges::any_of(m_faster_variants, [row](auto&& variant) { return variant.second == row; })) {
+            return tr("Faster build of the installed kernel for this CPU");
+        }
+        return {};
+    case RepoRole:
+        return to_qstring(kernel.get_repo());
+    case CategoryRole:
+        return to_qstring(kernel.category());
+    default:
+        return {};
+    }
+}
+
+QVariant KernelListModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    /* clang-format off */
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) { return {}; }
+    /* clang-format on */
+    switch (section) {
+    case KernelCol::Check:
+        return tr("Choose");
+    case KernelCol::PkgName:
+        return tr("PkgName");
+    case KernelCol::Version:
+        return tr("Version");
+    case KernelCol::BootTime:
+        return tr("Boot time");
+    case KernelCol::InitramfsSize:
+        return tr("Initramfs");
+    case KernelCol::ModuleCount:
+        return tr("Modules");
+    case KernelCol::SyscallLatency:
+        return tr("Syscall");
+    case KernelCol::ContextSwitch:
+        return tr("Context switch");
+    case KernelCol::MemoryBandwidth:
+        return tr("Memory bandwidth");
+    case KernelCol::Category:
+        return tr("Category");
+    default:
+        return {};
+    }
+}
+
+Qt::ItemFlags KernelListModel::flags(const QModelIndex& index) const {
+    /* clang-format off */
+    if (!index.isValid()) { return Qt::NoItemFlags; }
+    /* clang-format on */
+    auto item_flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    if (index.column() == KernelCol::Check) {
+        item_flags |= Qt::ItemIsUserCheckable;
+    }
+    return item_flags;
+}
+
+bool KernelListModel::setData(const QModelIndex& index, const QVariant& value, int role) {
+    /* clang-format off */
+    if (role != Qt::CheckStateRole || index.column() != KernelCol::Check) { return false; }
+    /* clang-format on */
+    const auto new_state = static_cast<Qt::CheckState>(value.toInt());
+    if (new_state != static_cast<Qt::CheckState>(data(index, Qt::CheckStateRole).toInt())) {
+        toggle(index);
+    }
+    return true;
+}
+
+void KernelListModel::toggle(const QModelIndex& index) noexcept {
+    /* clang-format off */
+    if (!index.isValid()) { return; }
+    /* clang-format on */
+    const auto row = static_cast<std::size_t>(index.row());
+    if (!m_change_set.erase(row)) {
+        m_change_set.insert(row);
+    }
+
+    const auto check_index = this->index(index.row(), KernelCol::Check);
+    emit dataChanged(check_index, check_index, {Qt::CheckStateRole});
+    emit change_set_changed();
+}
+
+void KernelListModel::append_kernels(std::vector<Kernel>&& kernels) noexcept {
+    /* clang-format off */
+    if (kernels.empty()) { return; }
+    /* clang-format on */
+    const auto first_row = static_cast<int>(m_kernels.size());
+    const auto last_row  = first_row + static_cast<int>(kernels.size()) - 1;
+
+    // indices in the change set stay valid, kernels are only appended
+    beginInsertRows({}, first_row, last_row);
+    m_kernels.insert(m_kernels.end(), std::make_move_iterator(kernels.begin()), std::make_move_iterator(kernels.end()));
+    resolve_kernels(std::span{m_kernels}.subspan(static_cast<std::size_t>(first_row)));
+    update_faster_variants();
+    endInsertRows();
+}
+
+void KernelListModel::update_kernels(const std::vector<std::size_t>& changed_kernels) noexcept {
+    // toggled rows, which weren't changed (e.g the transaction has failed), get their state back
+    std::vector<std::size_t> rows{changed_kernels};
+    rows.insert(rows.end(), m_change_set.begin(), m_change_set.end());
+    m_change_set.clear();
+
+    // the kernel may have been replaced by its faster build
+    for (auto&& [installed_row, faster_row] : std::exchange(m_faster_variants, {})) {
+        rows.insert(rows.end(), {installed_row, faster_row});
+    }
+    update_faster_variants();
+
+    for (auto&& row : rows) {
+        emit dataChanged(index(static_cast<int>(row), KernelCol::Check), index(static_cast<int>(row), KernelCol::Count - 1));
+    }
+    emit change_set_changed();
+}
+
+auto KernelListModel::get_change_list() const noexcept -> std::vector<std::string> {
+    std::vector<std::size_t> rows{m_change_set.begin(), m_change_set.end()};
+    std::ranges::sort(rows);
+
+    std::vector<std::string> change_list{};
+    change_list.reserve(rows.size());
+    for (auto&& row : rows) {
+        change_list.emplace_back(m_kernels[row].get_raw());
+    }
+    return change_list;
+}
+
+void KernelListModel::update_faster_variants() noexcept {
+    m_faster_variants.clear();
+
+    const auto& cpu_features = CpuFeatures::get();
+    for (std::size_t row = 0; row < m_kernels.size(); ++row) {
+        if (const auto* faster_kernel = Kernel::find_faster_variant(m_kernels, m_kernels[row], cpu_features); faster_kernel != nullptr) {
+            m_faster_variants.emplace(row, static_cast<std::size_t>(faster_kernel - m_kernels.data()));
+        }
+    }
+}
+
+void KernelListModel::set_boot_history(std::vector<BootRecord>&& records) noexcept {
+    m_boot_history.clear();
+    for (auto&& record : records) {
+        m_boot_history[record.pkg_name].emplace_back(std::move(record));
+    }
+
+    /* clang-format off */
+    if (m_kernels.empty()) { return; }
+    /* clang-format on */
+    emit dataChanged(index(0, KernelCol::BootTime), index(static_cast<int>(m_kernels.size()) - 1, KernelCol::MemoryBandwidth));
+}
+
+auto KernelListModel::get_boot_records(const Kernel& kernel) const noexcept -> std::span<const BootRecord> {
+    // Same kernel from the other repo doesn't get the history of the installed one
+    /* clang-format off */
+    if (!is_installed_from_repo(kernel)) { return {}; }
+    /* clang-format on */
+    if (auto history_it = m_boot_history.find(std::string{kernel.get_name()}); history_it != m_boot_history.end()) {
+        return history_it->second;
+    }
+    return {};
+}
+
+bool KernelListModel::is_installed_from_repo(const Kernel& kernel) noexcept {
+    /* clang-format off */
+    if (!kernel.is_installed()) { return false; }
+    /* clang-format on */
+
+    // The same kernel from the other repo is shown as not installed
+    const std::string_view kernel_installed_db = kernel.get_installed_db();
+    return kernel_installed_db.empty() || kernel_installed_db == kernel.get_repo();
+}
+
+KernelFilterProxyModel::KernelFilterProxyModel(QObject* parent)
+  : QSortFilterProxyModel(parent) { }
+
+void KernelFilterProxyModel::set_repo_filter(const QString& repo) noexcept {
+    m_repo = repo;
+    invalidateFilter();
+}
+
+void KernelFilterProxyModel::set_category_filter(const QString& category) noexcept {
+    m_category = category;
+    invalidateFilter();
+}
+
+void KernelFilterProxyModel::set_search_text(const QString& text) noexcept {
+    m_search_text = text.trimmed();
+    invalidateFilter();
+}
+
+bool KernelFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const {
+    auto* model = sourceModel();
+
+    const auto& pkg_index = model->index(source_row, KernelCol::PkgName, source_parent);
+    if (!m_repo.isEmpty() && pkg_index.data(KernelListModel::RepoRole).toString() != m_repo) {
+        return false;
+    }
+    if (!m_category.isEmpty() && pkg_index.data(KernelListModel::CategoryRole).toString() != m_category) {
+        return false;
+    }
+    return m_search_text.isEmpty() || pkg_index.data().toString().contains(m_search_text, Qt::CaseInsensitive);
+}
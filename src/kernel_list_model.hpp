@@ -0,0 +1,159 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef KERNEL_LIST_MODEL_HPP
+#define KERNEL_LIST_MODEL_HPP
+
+#include "boot_history.hpp"
+#include "kernel.hpp"
+
+#include <cstddef>        // for size_t
+#include <span>           // for span
+#include <string>         // for string
+#include <unordered_map>  // for unordered_map
+#include <unordered_set>  // for unordered_set
+#include <vector>         // for vector
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QString>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace KernelCol {
+enum { Check,
+    PkgName,
+    Version,
+    BootTime,
+    InitramfsSize,
+    ModuleCount,
+    SyscallLatency,
+    ContextSwitch,
+    MemoryBandwidth,
+    Category,
+    Count };
+}
+
+/// Table of kernels, which reads the data directly from the kernels vector.
+///
+/// Kernels, which the user has toggled, are kept in the change set by index.
+/// Check state of the row is the installed state, inverted if the row is toggled.
+class KernelListModel final : public QAbstractTableModel {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(KernelListModel)
+ public:
+    enum Role {
+        RepoRole = Qt::UserRole + 1,
+        CategoryRole,
+    };
+
+    /// @param kernels The kernels, they must outlive the model.
+    /// Changes of the vector must go through the model.
+    explicit KernelListModel(std::vector<Kernel>& kernels, QObject* parent = nullptr);
+    ~KernelListModel() override = default;
+
+    int rowCount(const QModelIndex& parent = {}) const override;
+    int columnCount(const QModelIndex& parent = {}) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+
+    /// @brief Invert the check state of the row.
+    void toggle(const QModelIndex& index) noexcept;
+
+    /// @brief Append kernels at the end (e.g found in AUR).
+    void append_kernels(std::vector<Kernel>&& kernels) noexcept;
+
+    /// @brief Refresh the rows after the transaction, and drop the change set.
+    /// @param changed_kernels Indices of the kernels, which state has changed.
+    void update_kernels(const std::vector<std::size_t>& changed_kernels) noexcept;
+
+    /// @brief Get raw names (e.g cachyos/linux-cachyos) of the toggled kernels.
+    auto get_change_list() const noexcept -> std::vector<std::string>;
+
+    /* clang-format off */
+    bool has_changes() const noexcept
+    { return !m_change_set.empty(); }
+    /* clang-format on */
+
+    /// @brief Get rows of the installed kernels, which have faster build for this CPU, mapped to the row of that build.
+    /* clang-format off */
+    auto get_faster_variants() const noexcept -> const std::unordered_map<std::size_t, std::size_t>&
+    { return m_faster_variants; }
+    /* clang-format on */
+
+    /// @brief Show boot timings and benchmarks of the installed kernels.
+    /// @param records The history, oldest first (see boot_history::update_history).
+    void set_boot_history(std::vector<BootRecord>&& records) noexcept;
+
+    /// @brief Check if the kernel is installed from the repo of this row.
+    static bool is_installed_from_repo(const Kernel& kernel) noexcept;
+
+ signals:
+    void change_set_changed();
+
+ private:
+    std::vector<Kernel>& m_kernels;
+    std::unordered_set<std::size_t> m_change_set{};
+    std::unordered_map<std::size_t, std::size_t> m_faster_variants{};
+    // pkg name -> records of its releases, oldest first
+    std::unordered_map<std::string, std::vector<BootRecord>> m_boot_history{};
+
+    void update_faster_variants() noexcept;
+    auto get_boot_records(const Kernel& kernel) const noexcept -> std::span<const BootRecord>;
+};
+
+/// Filters kernels by repo, category and the search text.
+class KernelFilterProxyModel final : public QSortFilterProxyModel {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(KernelFilterProxyModel)
+ public:
+    explicit KernelFilterProxyModel(QObject* parent = nullptr);
+    ~KernelFilterProxyModel() override = default;
+
+    /// @brief Empty value shows kernels from any repo/category.
+    void set_repo_filter(const QString& repo) noexcept;
+    void set_category_filter(const QString& category) noexcept;
+    void set_search_text(const QString& text) noexcept;
+
+ protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override;
+
+ private:
+    QString m_repo{};
+    QString m_category{};
+    QString m_search_text{};
+};
+
+#endif  // KERNEL_LIST_MODEL_HPP
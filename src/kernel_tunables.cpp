@@ -0,0 +1,300 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "kernel_tunables.hpp"
+
+#include <algorithm>  // for all_of, find, find_if, sort, unique
+#include <array>      // for array
+#include <charconv>   // for from_chars
+#include <fstream>    // for ifstream
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr auto PROC_CMDLINE_PATH = "/proc/cmdline"sv;
+
+static constexpr std::array TUNABLES{
+    TunableInfo{.name = "transparent_hugepage"sv, .path = "/sys/kernel/mm/transparent_hugepage/enabled"sv, .kind = TunableKind::Param},
+    TunableInfo{.name = "preempt"sv, .path = "/sys/kernel/debug/sched/preempt"sv, .kind = TunableKind::Param},
+    TunableInfo{.name = "nohz_full"sv, .path = "/sys/devices/system/cpu/nohz_full"sv, .kind = TunableKind::BootParam},
+    TunableInfo{.name = "isolcpus"sv, .path = "/sys/devices/system/cpu/isolated"sv, .kind = TunableKind::BootParam},
+    TunableInfo{.name = "vm.swappiness"sv, .path = "/proc/sys/vm/swappiness"sv, .kind = TunableKind::Sysctl},
+    TunableInfo{.name = "vm.dirty_ratio"sv, .path = "/proc/sys/vm/dirty_ratio"sv, .kind = TunableKind::Sysctl},
+    TunableInfo{.name = "vm.dirty_background_ratio"sv, .path = "/proc/sys/vm/dirty_background_ratio"sv, .kind = TunableKind::Sysctl},
+    TunableInfo{.name = "vm.vfs_cache_pressure"sv, .path = "/proc/sys/vm/vfs_cache_pressure"sv, .kind = TunableKind::Sysctl},
+};
+
+static constexpr std::array THP_MODES{"always"sv, "madvise"sv, "never"sv};
+static constexpr std::array PREEMPT_MODES{"none"sv, "voluntary"sv, "full"sv, "lazy"sv};
+static constexpr std::array ISOLCPUS_FLAGS{"nohz"sv, "domain"sv, "managed_irq"sv};
+
+// sysctl values we support are ratios and counters
+static constexpr std::size_t MAX_SYSCTL_VALUE_LEN = 10;
+// Upper bound of CONFIG_NR_CPUS, higher ids can't be passed to the kernel
+static constexpr std::uint32_t MAX_CPU_ID = 8191;
+
+constexpr bool is_space(char ch) noexcept {
+    return ch == ' ' || ch == '\t' || ch == '\n';
+}
+
+constexpr auto trim(std::string_view str) noexcept -> std::string_view {
+    while (!str.empty() && is_space(str.front())) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && is_space(str.back())) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+template <typename Callback>
+void for_each_cmdline_param(std::string_view cmdline, Callback&& callback) noexcept {
+    std::size_t pos{};
+    while (pos < cmdline.size()) {
+        if (is_space(cmdline[pos])) {
+            ++pos;
+            continue;
+        }
+        auto end = pos;
+        while (end < cmdline.size() && !is_space(cmdline[end])) {
+            ++end;
+        }
+        callback(cmdline.substr(pos, end - pos));
+        pos = end;
+    }
+}
+
+constexpr auto get_param_name(std::string_view param) noexcept -> std::string_view {
+    return param.substr(0, param.find('='));
+}
+
+auto read_first_line(std::string_view file_path) noexcept -> std::string {
+    std::ifstream file_stream{std::string{file_path}};
+    std::string line{};
+    std::getline(file_stream, line);
+    return line;
+}
+
+// Dynamic preempt mode is reported only in debugfs, which is root-only.
+// Without it we still know the mode, if it's been set on boot.
+auto get_cmdline_param(std::string_view name) noexcept -> std::string {
+    const auto& cmdline = read_first_line(PROC_CMDLINE_PATH);
+
+    std::string value{};
+    for_each_cmdline_param(cmdline, [&](std::string_view param) {
+        if (get_param_name(param) == name && param.size() > name.size()) {
+            value = param.substr(name.size() + 1);
+        }
+    });
+    return value;
+}
+
+auto parse_cpu_range(std::string_view range, std::vector<std::uint32_t>& cpus) noexcept -> bool {
+    const auto parse_number = [](std::string_view str, std::uint32_t& number) {
+        const auto* end = str.data() + str.size();
+        auto [ptr, ec]  = std::from_chars(str.data(), end, number);
+        return !str.empty() && ec == std::errc{} && ptr == end;
+    };
+
+    const auto dash_pos = range.find('-');
+    std::uint32_t first{};
+    std::uint32_t last{};
+    if (dash_pos == std::string_view::npos) {
+        /* clang-format off */
+        if (!parse_number(range, first)) { return false; }
+        /* clang-format on */
+        last = first;
+    } else if (!parse_number(range.substr(0, dash_pos), first) || !parse_number(range.substr(dash_pos + 1), last) || last < first) {
+        return false;
+    }
+    // Checked before the expansion, huge ranges would never end or exhaust the memory
+    /* clang-format off */
+    if (last > MAX_CPU_ID) { return false; }
+    /* clang-format on */
+    for (auto cpu = first; cpu <= last; ++cpu) {
+        cpus.emplace_back(cpu);
+    }
+    return true;
+}
+
+constexpr bool is_cpu_list_tunable(std::string_view name) noexcept {
+    return name == "nohz_full"sv || name == "isolcpus"sv;
+}
+
+}  // namespace
+
+auto find_tunable(std::string_view name) noexcept -> const TunableInfo* {
+    const auto* tunable_it = std::ranges::find(TUNABLES, name, &TunableInfo::name);
+    return (tunable_it != TUNABLES.end()) ? tunable_it : nullptr;
+}
+
+auto is_valid_tunable_value(std::string_view name, std::string_view value) noexcept -> bool {
+    const auto* tunable = find_tunable(name);
+    /* clang-format off */
+    if (tunable == nullptr || value.empty()) { return false; }
+    /* clang-format on */
+
+    if (name == "transparent_hugepage"sv) {
+        return std::ranges::find(THP_MODES, value) != THP_MODES.end();
+    }
+    if (name == "preempt"sv) {
+        return std::ranges::find(PREEMPT_MODES, value) != PREEMPT_MODES.end();
+    }
+    if (name == "nohz_full"sv) {
+        // flags are accepted only by isolcpus
+        constexpr auto is_valid_char = [](char ch) { return (ch >= '0' && ch <= '9') || ch == '-' || ch == ','; };
+        return std::ranges::all_of(value, is_valid_char) && parse_cpu_list(value).has_value();
+    }
+    if (name == "isolcpus"sv) {
+        constexpr auto is_valid_char = [](char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '-' || ch == ','; };
+        return std::ranges::all_of(value, is_valid_char) && parse_cpu_list(value).has_value();
+    }
+    constexpr auto is_digit = [](char ch) { return ch >= '0' && ch <= '9'; };
+    return tunable->kind == TunableKind::Sysctl && value.size() <= MAX_SYSCTL_VALUE_LEN && std::ranges::all_of(value, is_digit);
+}
+
+auto parse_tunable_arg(std::string_view arg) noexcept -> std::optional<TunableValue> {
+    const auto eq_pos = arg.find('=');
+    /* clang-format off */
+    if (eq_pos == std::string_view::npos) { return std::nullopt; }
+    /* clang-format on */
+
+    const auto name  = arg.substr(0, eq_pos);
+    const auto value = arg.substr(eq_pos + 1);
+    if (!is_valid_tunable_value(name, value)) {
+        return std::nullopt;
+    }
+    return TunableValue{.name = std::string{name}, .value = std::string{value}};
+}
+
+auto parse_selected_mode(std::string_view content) noexcept -> std::string {
+    std::string mode{};
+    for_each_cmdline_param(content, [&](std::string_view word) {
+        if (word.size() > 2 && ((word.front() == '[' && word.back() == ']') || (word.front() == '(' && word.back() == ')'))) {
+            mode = word.substr(1, word.size() - 2);
+        }
+    });
+    return mode;
+}
+
+auto parse_cpu_list(std::string_view cpu_list) noexcept -> std::optional<std::vector<std::uint32_t>> {
+    std::vector<std::uint32_t> cpus{};
+
+    std::size_t start{};
+    cpu_list = trim(cpu_list);
+    while (start < cpu_list.size()) {
+        auto end = cpu_list.find(',', start);
+        if (end == std::string_view::npos) {
+            end = cpu_list.size();
+        }
+        const auto range = cpu_list.substr(start, end - start);
+        start            = end + 1;
+
+        if (std::ranges::find(ISOLCPUS_FLAGS, range) != ISOLCPUS_FLAGS.end()) {
+            continue;
+        }
+        if (!parse_cpu_range(range, cpus)) {
+            return std::nullopt;
+        }
+    }
+
+    std::ranges::sort(cpus);
+    const auto [first, last] = std::ranges::unique(cpus);
+    cpus.erase(first, last);
+    return cpus;
+}
+
+auto get_running_tunable(const TunableInfo& tunable) noexcept -> std::string {
+    const auto& line = read_first_line(tunable.path);
+
+    if (tunable.name == "transparent_hugepage"sv) {
+        return parse_selected_mode(line);
+    }
+    if (tunable.name == "preempt"sv) {
+        auto mode = parse_selected_mode(line);
+        return !mode.empty() ? mode : get_cmdline_param(tunable.name);
+    }
+
+    const auto value = trim(line);
+    // nohz_full reports it, if the parameter isn't set
+    if (value == "(null)"sv) {
+        return {};
+    }
+    return std::string{value};
+}
+
+auto diff_tunables(std::span<const TunableValue> profile) noexcept -> std::vector<TunableDiff> {
+    std::vector<TunableDiff> diffs{};
+    diffs.reserve(profile.size());
+
+    for (auto&& [name, value] : profile) {
+        const auto* tunable = find_tunable(name);
+        /* clang-format off */
+        if (tunable == nullptr) { continue; }
+        /* clang-format on */
+
+        auto running_value = get_running_tunable(*tunable);
+        bool is_different  = running_value != value;
+        if (is_cpu_list_tunable(name)) {
+            // e.g isolcpus=domain,2-3 is reported as 2-3
+            is_different = parse_cpu_list(running_value) != parse_cpu_list(value);
+        }
+        diffs.emplace_back(TunableDiff{
+            .name          = name,
+            .profile_value = value,
+            .running_value = std::move(running_value),
+            .kind          = tunable->kind,
+            .is_different  = is_different,
+        });
+    }
+    return diffs;
+}
+
+auto update_cmdline(std::string_view cmdline, std::span<const TunableValue> params) noexcept -> std::string {
+    std::string new_cmdline{};
+    std::vector<bool> is_set(params.size());
+
+    const auto& append_param = [&](std::string_view param) {
+        if (!new_cmdline.empty()) {
+            new_cmdline += ' ';
+        }
+        new_cmdline += param;
+    };
+
+    for_each_cmdline_param(cmdline, [&](std::string_view param) {
+        const auto& param_it = std::ranges::find_if(params, [name = get_param_name(param)](auto&& tunable) { return tunable.name == name; });
+        if (param_it == params.end()) {
+            append_param(param);
+            return;
+        }
+        // the first occurrence is replaced in place, duplicates are dropped
+        const auto param_index = static_cast<std::size_t>(param_it - params.begin());
+        if (!is_set[param_index]) {
+            append_param(param_it->name + '=' + param_it->value);
+            is_set[param_index] = true;
+        }
+    });
+
+    for (std::size_t i = 0; i < params.size(); ++i) {
+        if (!is_set[i]) {
+            append_param(params[i].name + '=' + params[i].value);
+        }
+    }
+    return new_cmdline;
+}
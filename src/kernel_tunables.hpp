@@ -0,0 +1,93 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef KERNEL_TUNABLES_HPP
+#define KERNEL_TUNABLES_HPP
+
+#include <cstdint>      // for uint8_t, uint32_t
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+/// Runtime counterparts of the build options, shared by the GUI and tunables-helper.
+///
+/// The profile is a list of name=value pairs, only the tunables set in the profile are touched.
+/// Usage: tunables-helper [--apply] [--persist] <name>=<value>...
+inline constexpr std::string_view TUNABLES_HELPER_PATH = "/usr/lib/cachyos-kernel-manager/tunables-helper";
+
+enum class TunableKind : std::uint8_t {
+    // Kernel parameter, which also can be changed at runtime through sysfs (e.g transparent_hugepage)
+    Param,
+    // Kernel parameter, which takes effect only after reboot (e.g isolcpus)
+    BootParam,
+    // sysctl knob, persisted in sysctl.d instead of the kernel command line
+    Sysctl,
+};
+
+struct TunableInfo final {
+    // kernel parameter (e.g preempt), or sysctl name (e.g vm.swappiness)
+    std::string_view name{};
+    // file, which holds the running value
+    std::string_view path{};
+    TunableKind kind{};
+};
+
+struct TunableValue final {
+    std::string name{};
+    std::string value{};
+};
+
+/// Value from the profile next to the running one.
+struct TunableDiff final {
+    std::string name{};
+    std::string profile_value{};
+    // empty if the running value couldn't be read (e.g debugfs isn't accessible)
+    std::string running_value{};
+    TunableKind kind{};
+    bool is_different{};
+};
+
+/// @brief Get the tunable by its name, or nullptr if it's not known.
+auto find_tunable(std::string_view name) noexcept -> const TunableInfo*;
+
+/// @brief Check if the value can be set for the tunable.
+/// Values are passed to the kernel command line and sysfs, so they never contain spaces or quotes.
+auto is_valid_tunable_value(std::string_view name, std::string_view value) noexcept -> bool;
+
+/// @brief Parse name=value argument, as it's passed to tunables-helper.
+auto parse_tunable_arg(std::string_view arg) noexcept -> std::optional<TunableValue>;
+
+/// @brief Get the selected mode from the sysfs list (e.g "always [madvise] never" or "none (full) lazy").
+auto parse_selected_mode(std::string_view content) noexcept -> std::string;
+
+/// @brief Expand the cpu list (e.g "0-3,8"). Housekeeping flags of isolcpus (e.g "domain,managed_irq,2-7") are skipped.
+/// @return Sorted CPUs, or std::nullopt if the list is malformed.
+auto parse_cpu_list(std::string_view cpu_list) noexcept -> std::optional<std::vector<std::uint32_t>>;
+
+/// @brief Read the running value of the tunable.
+auto get_running_tunable(const TunableInfo& tunable) noexcept -> std::string;
+
+/// @brief Compare the profile with the running kernel.
+auto diff_tunables(std::span<const TunableValue> profile) noexcept -> std::vector<TunableDiff>;
+
+/// @brief Set the parameters in the kernel command line, replacing the existing ones. Other parameters are kept as is.
+auto update_cmdline(std::string_view cmdline, std::span<const TunableValue> params) noexcept -> std::string;
+
+#endif  // KERNEL_TUNABLES_HPP
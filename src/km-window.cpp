@@ -20,15 +20,19 @@
 
 #include "km-window.hpp"
 #include "conf-window.hpp"
+#include "hardware_profile.hpp"
 #include "kernel.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
-#include <algorithm>   // for any_of, find_if
-#include <filesystem>  // for exists
-#include <future>
-#include <ranges>  // for ranges::*
-#include <span>    // for span
-#include <thread>  // for this_thread
+#include <algorithm>      // for find_if, max
+#include <filesystem>     // for exists
+#include <ranges>         // for ranges::*
+#include <set>            // for set
+#include <span>           // for span
+#include <thread>         // for this_thread
+#include <unordered_set>  // for unordered_set
+#include <utility>        // for move
 
 #include <fmt/core.h>
 
@@ -37,18 +41,20 @@
 #include <QMessageBox>
 #include <QScreen>
 #include <QShortcut>
+#include <QStatusBar>
+#include <QStringList>
 #include <QTimer>
-#include <QTreeWidgetItem>
 #include <QtConcurrent/QtConcurrent>
 
 namespace fs = std::filesystem;
 
 namespace {
-bool install_packages(alpm_handle_t* handle, const std::span<Kernel>& kernels, const std::span<std::string>& selected_list) {
+bool install_packages(alpm_handle_t* handle, Transaction& trans, const std::span<Kernel>& kernels, const std::span<std::string>& selected_list) {
     for (const auto& selected : selected_list) {
         const auto& kernel = std::ranges::find_if(kernels, [selected](auto&& el) { return el.get_raw() == selected; });
-        if ((kernel != kernels.end()) && (!kernel->is_installed() || kernel->is_update_available())) {
-            if (!kernel->install()) {
+        // Toggling the installed kernel means the removal, even if the update is available
+        if ((kernel != kernels.end()) && !kernel->is_installed()) {
+            if (!kernel->install(trans)) {
                 fmt::print(stderr, "failed to add package to be installed ({})\n", alpm_strerror(alpm_errno(handle)));
             }
         }
@@ -56,11 +62,11 @@ bool install_packages(alpm_handle_t* handle, const std::span<Kernel>& kernels, c
     return true;
 }
 
-bool remove_packages(alpm_handle_t* handle, const std::span<Kernel>& kernels, const std::span<std::string>& selected_list) {
+bool remove_packages(alpm_handle_t* handle, Transaction& trans, const std::span<Kernel>& kernels, const std::span<std::string>& selected_list) {
     for (const auto& selected : selected_list) {
         const auto& kernel = std::ranges::find_if(kernels, [selected](auto&& el) { return el.get_raw() == selected; });
         if ((kernel != kernels.end()) && (kernel->is_installed())) {
-            if (!kernel->remove()) {
+            if (!kernel->remove(trans)) {
                 fmt::print(stderr, "failed to add package to be removed ({})\n", alpm_strerror(alpm_errno(handle)));
             }
         }
@@ -68,45 +74,12 @@ bool remove_packages(alpm_handle_t* handle, const std::span<Kernel>& kernels, co
 
     return true;
 }
-
-bool is_kernels_change_state(alpm_handle_t* handle, std::span<std::string_view> kernel_install_list, std::span<std::string_view> kernel_removal_list) {
-    if (handle == nullptr) {
-        return false;
-    }
-    auto* local_db = alpm_get_localdb(handle);
-
-    if (std::ranges::any_of(kernel_install_list, [local_db](auto&& kernel_install) { return nullptr != alpm_db_get_pkg(local_db, kernel_install.data()); })) {
-        return true;
-    }
-    if (std::ranges::any_of(kernel_removal_list, [local_db](auto&& kernel_removal) { return nullptr == alpm_db_get_pkg(local_db, kernel_removal.data()); })) {
-        return true;
-    }
-
-    return false;
-}
-
-void init_kernels_tree_widget(QTreeWidget* tree_kernels, std::span<Kernel> kernels) noexcept {
-    for (auto& kernel : kernels) {
-        auto* widget_item = new QTreeWidgetItem(tree_kernels);
-        widget_item->setCheckState(TreeCol::Check, Qt::Unchecked);
-        widget_item->setText(TreeCol::PkgName, kernel.get_raw());
-        widget_item->setText(TreeCol::Version, QString::fromStdString(kernel.version()));
-        widget_item->setText(TreeCol::Category, QString::fromStdString(std::string{kernel.category()}));
-        widget_item->setText(TreeCol::Displayed, QStringLiteral("true"));
-        if (kernel.is_installed()) {
-            const std::string_view kernel_installed_db = kernel.get_installed_db();
-            if (!kernel_installed_db.empty() && kernel_installed_db != kernel.get_repo()) {
-                continue;
-            }
-            widget_item->setText(TreeCol::Immutable, QStringLiteral("true"));
-            widget_item->setCheckState(TreeCol::Check, Qt::Checked);
-        }
-    }
-}
 }  // namespace
 
 MainWindow::MainWindow(QWidget* parent)
   : QMainWindow(parent) {
+    // alpm handle and kernels are set up before, they have own spans
+    const trace::Span trace_span{"init_main_window"};
     m_ui->setupUi(this);
 
     setAttribute(Qt::WA_NativeWindow);
@@ -121,55 +94,45 @@ MainWindow::MainWindow(QWidget* parent)
             m_cv.wait(lock, [&] { return m_running.load(std::memory_order_consume); });
 
             if (m_running.load(std::memory_order_consume) && m_thread_running.load(std::memory_order_consume)) {
-                m_ui->ok->setEnabled(false);
-
-                std::vector<std::string> change_list(static_cast<std::size_t>(m_change_list.size()));
-                for (int i = 0; i < m_change_list.size(); ++i) {
-                    change_list[static_cast<std::size_t>(i)] = m_change_list[i].toStdString();
-                }
-
-                install_packages(m_handle, m_kernels, change_list);
-                remove_packages(m_handle, m_kernels, change_list);
-                Kernel::commit_transaction();
+                Transaction trans{};
+                install_packages(m_handle, trans, m_kernels, m_change_list);
+                remove_packages(m_handle, trans, m_kernels, m_change_list);
 
-                // check if we need to re-init kernels
                 // [1.1]
-                auto& kernel_install_list = Kernel::get_install_list();
-                auto& kernel_removal_list = Kernel::get_removal_list();
-
-                // NOTE: we don't want to override handle, because we would need to invalidate kernels then.
-                auto* temp_handle = utils::parse_alpm("/", "/var/lib/pacman/", &m_err);
-                if (temp_handle == nullptr) {
-                    QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to initialize alpm handle (%1)").arg(alpm_strerror(m_err)));
-                }
-
-                // [1.2]
-                // iterate over install and removal lists and check if any of the packages
-                // in the lists were either installed or removed
-                const bool is_kernel_status_changed = is_kernels_change_state(temp_handle, std::span{kernel_install_list}, std::span{kernel_removal_list});
-
-                // [1.3]
-                // if kernel status has changed, then re-init alpm handler,
-                // fetch kernels and repopulate tree widget again
-                if (is_kernel_status_changed) {
-                    if (m_handle != nullptr && utils::release_alpm(m_handle, &m_err) != 0) {
-                        QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to release alpm handle (%1)").arg(alpm_strerror(m_err)));
+                // let the download of the prefetch finish, the helper copies it into the cache of pacman
+                m_commit_prefetch_future.waitForFinished();
+
+                // commit both lists in the single transaction, and relay its progress
+                QMetaObject::invokeMethod(this, [this] {
+                    m_conf_progress_dialog->setLabelText(tr("Applying changes..."));
+                    m_conf_progress_dialog->setMaximum(100);
+                    m_conf_progress_dialog->show();
+                }, Qt::QueuedConnection);
+                const auto& commit_result = Kernel::commit_transaction(trans, [this](const utils::TransactionProgress& progress) {
+                    QMetaObject::invokeMethod(this, [this, progress] {
+                        m_conf_progress_dialog->setLabelText(QString::fromStdString(progress.message));
+                        if (progress.percent >= 0) {
+                            m_conf_progress_dialog->setValue(progress.percent);
+                        }
+                    }, Qt::QueuedConnection);
+                });
+                QMetaObject::invokeMethod(this, [this, commit_result] {
+                    m_conf_progress_dialog->hide();
+                    m_conf_progress_dialog->setMaximum(0);
+                    m_conf_progress_dialog->reset();
+                    if (!commit_result.is_success) {
+                        QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to apply changes:\n%1").arg(QString::fromStdString(commit_result.err_msg)));
                     }
+                }, Qt::QueuedConnection);
 
-                    m_handle = temp_handle;
-                    m_kernels.clear();
-                    m_kernels = Kernel::get_kernels(m_handle);
-
-                    // schedule init_kernels to be executed in the main thread
-                    QMetaObject::invokeMethod(this, "init_kernels", Qt::QueuedConnection);
-                }
-
-                // clear install and removal lists
-                kernel_install_list.clear();
-                kernel_removal_list.clear();
+                // [1.2]
+                // re-query only the packages of the transaction, and update the affected rows.
+                // NOTE: it's done on the main thread, because the view reads the kernels.
+                QMetaObject::invokeMethod(this, [this, changed_pkgs = trans.get_pkg_names()] {
+                    update_kernels(changed_pkgs);
+                }, Qt::QueuedConnection);
 
                 m_running.store(false, std::memory_order_relaxed);
-                m_ui->ok->setEnabled(!is_kernel_status_changed);
             }
         }
     });
@@ -188,13 +151,23 @@ MainWindow::MainWindow(QWidget* parent)
     // Setup progress dialog
     set_progress_dialog();
 
+    // Fetch PKGBUILDs in advance, so the configure window opens instantly.
+    // The later prepare_build_environment waits for it, and reuses its result.
+    m_pkgbuilds_future = QtConcurrent::run([] { return utils::sync_build_environment(); });
+
+    // Probe the hardware in advance too, it runs chwd. Otherwise the first toggle of the kernel
+    // would run it on this thread, once start_prefetch collects the packages to install.
+    m_hw_profile_future = QtConcurrent::run([] { HardwareProfile::get(); });
+
     // Setup configure window
-    connect(&m_future_watcher, &QFutureWatcher<void>::finished, this, [&]() {
+    connect(&m_future_watcher, &QFutureWatcher<bool>::finished, this, [&]() {
         m_conf_progress_dialog->hide();
         if (m_future_watcher.future().isCanceled()) {
             return;
         }
-        if (m_future_watcher.future().isFinished()) {
+        if (m_future_watcher.future().result()) {
+            // NOTE: it touches widgets, so must run on the GUI thread
+            m_conf_window->reset_patches_data_tab();
             m_conf_window->show();
             return;
         }
@@ -206,22 +179,46 @@ MainWindow::MainWindow(QWidget* parent)
         m_future_watcher.cancel();
     });
 
-    // Setup tree widget
+    // Setup kernels view
+    {
+        const trace::Span trace_span{"setup_kernels_view"};
+        const std::lock_guard<std::mutex> guard(m_mutex);
+        m_kernel_model = new KernelListModel(m_kernels, this);
+    }
+    m_kernel_proxy = new KernelFilterProxyModel(this);
+    m_kernel_proxy->setSourceModel(m_kernel_model);
+
     auto* tree_kernels = m_ui->treeKernels;
-    tree_kernels->hideColumn(TreeCol::Displayed);  // Displayed status true/false
-    tree_kernels->hideColumn(TreeCol::Immutable);  // Immutable status true/false
+    tree_kernels->setModel(m_kernel_proxy);
+    tree_kernels->setRootIsDecorated(false);
+    tree_kernels->setUniformRowHeights(true);
     tree_kernels->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
 
     // Set context menu policy
     tree_kernels->setContextMenuPolicy(Qt::CustomContextMenu);
+    update_filters();
 
-    tree_kernels->blockSignals(true);
+#ifdef ENABLE_AUR_KERNELS
+    // AUR kernels are appended to the tree, once they are found
+    connect(&m_aur_future_watcher, &QFutureWatcher<aur_discovery_result_t>::finished, this, &MainWindow::on_aur_kernels_found);
+    start_aur_kernels_discovery();
+#endif
 
-    // TODO(vnepogodin): parallelize it
-    auto a2 = std::async(std::launch::deferred, [&] {
-        const std::lock_guard<std::mutex> guard(m_mutex);
-        init_kernels_tree_widget(tree_kernels, std::span{m_kernels});
+    // First boot of the running kernel is recorded in the background, the benchmarks take a while
+    connect(&m_boot_history_watcher, &QFutureWatcher<std::vector<BootRecord>>::finished, this, [this] {
+        m_kernel_model->set_boot_history(m_boot_history_watcher.result());
     });
+    m_boot_history_watcher.setFuture(QtConcurrent::run([] { return boot_history::update_history(); }));
+
+    // Point at the faster builds of the installed kernels (e.g from cachyos-v3)
+    if (const auto& faster_variants = m_kernel_model->get_faster_variants(); !faster_variants.empty()) {
+        QStringList faster_kernels{};
+        for (auto&& [installed_row, faster_row] : faster_variants) {
+            faster_kernels << QString::fromUtf8(m_kernels[faster_row].get_raw());
+        }
+        faster_kernels.sort();
+        statusBar()->showMessage(tr("Faster builds of the installed kernels are available for this CPU: %1").arg(faster_kernels.join(", ")));
+    }
 
     if (m_kernels.empty()) {
         QMessageBox::critical(this, "CachyOS Kernel Manager", tr("No kernels found!\nPlease run `pacman -Sy` to update DB!\nThis is needed for the app to work properly"));
@@ -241,17 +238,34 @@ MainWindow::MainWindow(QWidget* parent)
     auto* shortcutToggle = new QShortcut(Qt::Key_Space, this);
     connect(shortcutToggle, &QShortcut::activated, this, &MainWindow::check_uncheck_item);
 
-    // Connect tree widget
-    connect(tree_kernels, &QTreeWidget::itemChanged, this, &MainWindow::item_changed);
-    connect(tree_kernels, &QTreeWidget::itemDoubleClicked, [tree_kernels](QTreeWidgetItem* item) { tree_kernels->setCurrentItem(item); });
-    connect(tree_kernels, &QTreeWidget::itemDoubleClicked, this, &MainWindow::check_uncheck_item);
-
-    // Wait for async function to finish
-    a2.wait();
-    tree_kernels->blockSignals(false);
+    // Connect kernels view
+    connect(m_kernel_model, &KernelListModel::change_set_changed, this, [this] {
+        m_ui->ok->setEnabled(m_kernel_model->has_changes());
+        m_prefetch_timer->start();
+    });
+    connect(tree_kernels, &QTreeView::doubleClicked, this, &MainWindow::check_uncheck_item);
+
+    // Packages of the checked kernels are downloaded, while the user is still choosing
+    m_prefetch_timer = new QTimer(this);
+    m_prefetch_timer->setSingleShot(true);
+    m_prefetch_timer->setInterval(std::chrono::seconds{1});
+    connect(m_prefetch_timer, &QTimer::timeout, this, &MainWindow::start_prefetch);
+    connect(&m_prefetch_watcher, &QFutureWatcher<std::int32_t>::finished, this, &MainWindow::on_prefetch_finished);
+
+    // Connect filters
+    connect(m_ui->searchEdit, &QLineEdit::textChanged, m_kernel_proxy, &KernelFilterProxyModel::set_search_text);
+    connect(m_ui->repoFilter, &QComboBox::currentIndexChanged, this, [this] {
+        m_kernel_proxy->set_repo_filter(m_ui->repoFilter->currentData().toString());
+    });
+    connect(m_ui->categoryFilter, &QComboBox::currentIndexChanged, this, [this] {
+        m_kernel_proxy->set_category_filter(m_ui->categoryFilter->currentData().toString());
+    });
 }
 
 MainWindow::~MainWindow() {
+    // The sync uses static state, it must be done before the statics are destroyed
+    m_pkgbuilds_future.waitForFinished();
+    m_hw_profile_future.waitForFinished();
     std::this_thread::sleep_for(std::chrono::milliseconds(1));
     if (m_worker_th != nullptr) {
         m_worker_th->exit();
@@ -281,45 +295,39 @@ void MainWindow::set_progress_dialog() noexcept {
 }
 
 void MainWindow::check_uncheck_item() noexcept {
-    if (auto* t_widget = qobject_cast<QTreeWidget*>(focusWidget())) {
-        if (t_widget->currentItem() == nullptr || t_widget->currentItem()->childCount() > 0) {
-            return;
-        }
-        auto new_state = (t_widget->currentItem()->checkState(TreeCol::Check) == Qt::Checked) ? Qt::Unchecked : Qt::Checked;
-        t_widget->currentItem()->setCheckState(TreeCol::Check, new_state);
-    }
+    /* clang-format off */
+    if (focusWidget() != m_ui->treeKernels) { return; }
+    /* clang-format on */
+    const auto& current_index = m_ui->treeKernels->currentIndex();
+    /* clang-format off */
+    if (!current_index.isValid()) { return; }
+    /* clang-format on */
+    m_kernel_model->toggle(m_kernel_proxy->mapToSource(current_index));
 }
 
-// When selecting on item in the list
-void MainWindow::item_changed(QTreeWidgetItem* item, int /*unused*/) noexcept {
-    if (item->checkState(TreeCol::Check) == Qt::Checked) {
-        m_ui->treeKernels->setCurrentItem(item);
-    }
-    build_change_list(item);
-}
-
-// Build the change_list when selecting on item in the tree
-void MainWindow::build_change_list(QTreeWidgetItem* item) noexcept {
-    auto item_text = item->text(TreeCol::PkgName);
-    auto immutable = item->text(TreeCol::Immutable);
-    if (immutable == "true" && item->checkState(0) == Qt::Unchecked) {
-        m_ui->ok->setEnabled(true);
-        m_change_list.append(item_text);
-        return;
-    }
+// Fill the filters with repos and categories of the known kernels
+void MainWindow::update_filters() noexcept {
+    const auto& fill_filter = [](QComboBox* combo_box, const QString& all_text, std::set<QString>&& values) {
+        const auto current_value = combo_box->currentData().toString();
 
-    if (immutable == "true" && item->checkState(0) == Qt::Checked) {
-        m_change_list.removeOne(item_text);
-    } else if (item->checkState(0) == Qt::Checked) {
-        m_ui->ok->setEnabled(true);
-        m_change_list.append(item_text);
-    } else {
-        m_change_list.removeOne(item_text);
-    }
-
-    if (m_change_list.isEmpty()) {
-        m_ui->ok->setEnabled(false);
+        combo_box->blockSignals(true);
+        combo_box->clear();
+        combo_box->addItem(all_text, QString{});
+        for (auto&& value : values) {
+            combo_box->addItem(value, value);
+        }
+        combo_box->setCurrentIndex(std::max(combo_box->findData(current_value), 0));
+        combo_box->blockSignals(false);
+    };
+
+    std::set<QString> repos{};
+    std::set<QString> categories{};
+    for (auto&& kernel : m_kernels) {
+        repos.emplace(QString::fromStdString(std::string{kernel.get_repo()}));
+        categories.emplace(QString::fromStdString(std::string{kernel.category()}));
     }
+    fill_filter(m_ui->repoFilter, tr("All repositories"), std::move(repos));
+    fill_filter(m_ui->categoryFilter, tr("All categories"), std::move(categories));
 }
 
 void MainWindow::closeEvent(QCloseEvent* event) {
@@ -342,10 +350,8 @@ void MainWindow::on_configure() noexcept {
 
     // NOTE: the future created by QtConcurrent::run is not cancelable.
     // prepare in the background, without blocking the UI
-    m_future_watcher.setFuture(QtConcurrent::run([this] {
-        utils::prepare_build_environment();
-        m_conf_window->reset_patches_data_tab();
-    }));
+    // NOTE: in the common case the checkout is already prefetched, and it only resets local changes
+    m_future_watcher.setFuture(QtConcurrent::run([] { return utils::prepare_build_environment(); }));
 }
 
 void MainWindow::on_cancel() noexcept {
@@ -356,26 +362,98 @@ void Work::doHeavyCalculations() {
     m_func();
 }
 
-void MainWindow::init_kernels() noexcept {
-    // show progress dialog to indicate user something is happening
-    m_conf_progress_dialog->setLabelText(tr("Please wait...\nInitializing kernels.."));
-    m_conf_progress_dialog->show();
+void MainWindow::update_kernels(const std::vector<std::string>& changed_pkgs) noexcept {
+    const auto& changed_kernels = Kernel::refresh_local_state(std::span{m_kernels}, std::span{changed_pkgs});
+    m_kernel_model->update_kernels(changed_kernels);
+}
 
-    auto* tree_kernels = m_ui->treeKernels;
-    tree_kernels->blockSignals(true);
-    tree_kernels->clear();
+#ifdef ENABLE_AUR_KERNELS
+void MainWindow::start_aur_kernels_discovery() noexcept {
+    /* clang-format off */
+    if (m_kernels.empty()) { return; }
+    /* clang-format on */
+
+    std::unordered_set<std::string> repo_kernel_names{};
+    for (auto&& kernel : m_kernels) {
+        repo_kernel_names.emplace(kernel.get_name());
+    }
+
+    const auto generation = ++m_aur_discovery_generation;
+    m_aur_future_watcher.setFuture(QtConcurrent::run([generation, handle = m_handle, repo_kernel_names = std::move(repo_kernel_names)] {
+        return aur_discovery_result_t{generation, Kernel::get_aur_kernels(handle, repo_kernel_names)};
+    }));
+}
+
+void MainWindow::on_aur_kernels_found() noexcept {
+    // Transaction is in progress and kernels might be reloaded, try again later
+    if (m_running.load(std::memory_order_consume)) {
+        QTimer::singleShot(std::chrono::seconds{1}, this, &MainWindow::on_aur_kernels_found);
+        return;
+    }
+
+    const std::lock_guard<std::mutex> guard(m_mutex);
+
+    // Kernels were reloaded in the meantime, if the newer search is already started
+    auto [generation, aur_kernels] = m_aur_future_watcher.result();
+    /* clang-format off */
+    if (generation != m_aur_discovery_generation || aur_kernels.empty()) { return; }
+    /* clang-format on */
+
+    m_kernel_model->append_kernels(std::move(aur_kernels));
+    update_filters();
+}
+#endif
 
-    // NOTE: I don't think this should be parallelized, because it's already not running on the main thread
-    init_kernels_tree_widget(tree_kernels, std::span{m_kernels});
+void MainWindow::start_prefetch() noexcept {
+    // One download at a time, the latest change set is picked up once it's done
+    if (m_prefetch_watcher.isRunning()) {
+        m_is_prefetch_pending = true;
+        return;
+    }
+    m_is_prefetch_pending = false;
+    /* clang-format off */
+    if (m_running.load(std::memory_order_consume)) { return; }
+    /* clang-format on */
+
+    // NOTE: the targets are collected on this thread, the view reads the same kernels and the handle.
+    // It's cheap, the hardware profile is probed in the background at startup.
+    Transaction trans{};
+    auto change_list = m_kernel_model->get_change_list();
+    install_packages(m_handle, trans, m_kernels, change_list);
+    /* clang-format off */
+    if (trans.get_install_list().empty()) { return; }
+    /* clang-format on */
+
+    statusBar()->showMessage(tr("Downloading packages of the chosen kernels..."));
+    m_prefetch_watcher.setFuture(QtConcurrent::run([pkg_names = trans.get_install_list()] {
+        return Kernel::prefetch_packages(pkg_names);
+    }));
+}
 
-    tree_kernels->blockSignals(false);
-    m_conf_progress_dialog->hide();
+void MainWindow::on_prefetch_finished() noexcept {
+    // Failed downloads are just retried by the transaction
+    const auto ready_count = m_prefetch_watcher.result();
+    if (ready_count > 0) {
+        statusBar()->showMessage(tr("%n package(s) of the chosen kernels are downloaded", "", ready_count));
+    } else {
+        statusBar()->clearMessage();
+    }
+
+    if (m_is_prefetch_pending) {
+        start_prefetch();
+    }
 }
 
 void MainWindow::on_execute() noexcept {
     if (m_running.load(std::memory_order_consume)) {
         return;
     }
+    m_ui->ok->setEnabled(false);
+    m_change_list = m_kernel_model->get_change_list();
+    // No new downloads until the commit, the running one is awaited by the worker
+    m_prefetch_timer->stop();
+    m_is_prefetch_pending    = false;
+    m_commit_prefetch_future = m_prefetch_watcher.future();
     m_running.store(true, std::memory_order_relaxed);
     m_thread_running.store(true, std::memory_order_relaxed);
     m_cv.notify_all();
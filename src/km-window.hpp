@@ -40,13 +40,16 @@
 
 #include <ui_km-window.h>
 
+#include "boot_history.hpp"
 #include "conf-window.hpp"
 #include "kernel.hpp"
+#include "kernel_list_model.hpp"
 #include "schedext-window.hpp"
 #include "utils.hpp"
 
 #include <array>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <utility>
@@ -83,15 +86,6 @@ class Work final : public QObject {
     function_t m_func;
 };
 
-namespace TreeCol {
-enum { Check,
-    PkgName,
-    Version,
-    Category,
-    Displayed,
-    Immutable };
-}
-
 class MainWindow final : public QMainWindow {
     Q_OBJECT
     Q_DISABLE_COPY_MOVE(MainWindow)
@@ -109,21 +103,43 @@ class MainWindow final : public QMainWindow {
     void on_configure() noexcept;
 
     void check_uncheck_item() noexcept;
-
-    void item_changed(QTreeWidgetItem* item, int column) noexcept;
-
-    void init_kernels() noexcept;
+    void update_filters() noexcept;
+
+    void update_kernels(const std::vector<std::string>& changed_pkgs) noexcept;
+    void start_prefetch() noexcept;
+    void on_prefetch_finished() noexcept;
+#ifdef ENABLE_AUR_KERNELS
+    void start_aur_kernels_discovery() noexcept;
+    void on_aur_kernels_found() noexcept;
+#endif
 
     std::atomic_bool m_running{};
     std::atomic_bool m_thread_running{true};
     std::mutex m_mutex{};
     std::condition_variable m_cv{};
 
-    QStringList m_change_list{};
+    // Raw names of the kernels to change, passed to the worker thread
+    std::vector<std::string> m_change_list{};
 
     QProgressDialog* m_conf_progress_dialog{nullptr};
     QProgressBar* m_conf_progress_bar{nullptr};
-    QFutureWatcher<void> m_future_watcher{};
+    QFutureWatcher<bool> m_future_watcher{};
+    QFuture<bool> m_pkgbuilds_future{};
+    QFuture<void> m_hw_profile_future{};
+    QFutureWatcher<std::vector<BootRecord>> m_boot_history_watcher{};
+    QFutureWatcher<std::int32_t> m_prefetch_watcher{};
+    // The prefetch, which was running at the click on Apply, passed to the worker thread
+    QFuture<std::int32_t> m_commit_prefetch_future{};
+    // Debounces toggling of the kernels, before the download is started
+    QTimer* m_prefetch_timer{nullptr};
+    bool m_is_prefetch_pending{};
+#ifdef ENABLE_AUR_KERNELS
+    // The result is tagged with the generation of the search, which has found it
+    using aur_discovery_result_t = std::pair<std::uint64_t, std::vector<Kernel>>;
+    QFutureWatcher<aur_discovery_result_t> m_aur_future_watcher{};
+    // Incremented on each search, only the result of the latest one is shown
+    std::uint64_t m_aur_discovery_generation{};
+#endif
 
     QThread* m_worker_th = new QThread(this);
     Work* m_worker{nullptr};
@@ -134,8 +150,9 @@ class MainWindow final : public QMainWindow {
     std::unique_ptr<Ui::MainWindow> m_ui           = std::make_unique<Ui::MainWindow>();
     std::unique_ptr<ConfWindow> m_conf_window      = std::make_unique<ConfWindow>();
     std::unique_ptr<SchedExtWindow> m_sched_window = std::make_unique<SchedExtWindow>();
+    KernelListModel* m_kernel_model{nullptr};
+    KernelFilterProxyModel* m_kernel_proxy{nullptr};
 
-    void build_change_list(QTreeWidgetItem* item) noexcept;
     void set_progress_dialog() noexcept;
 };
 
@@ -16,7 +16,12 @@
 // with this program; if not, write to the Free Software Foundation, Inc.,
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
+#include "cli.hpp"
 #include "km-window.hpp"
+#include "trace.hpp"
+
+#include <span>         // for span
+#include <string_view>  // for string_view
 
 #include <QApplication>
 #include <QSharedMemory>
@@ -108,6 +113,14 @@ void initTranslations(QTranslator& qtTranslatorBase, QTranslator& qtTranslator,
 }  // namespace
 
 auto main(int argc, char** argv) -> std::int32_t {
+    // The trace is written at exit, so it covers the whole lifetime of the app
+    argc = trace::init(argc, argv);
+
+    // Headless mode, neither GUI nor translations are initialized
+    if (argc > 1 && std::string_view{argv[1]} == cli::CLI_ARG) {
+        return cli::run(std::span{argv + 2, static_cast<std::size_t>(argc - 2)});
+    }
+
     QSharedMemory sharedMemoryLock("CachyOS-KM-lock");
     if (IsInstanceAlreadyRunning(sharedMemoryLock)) {
         return -1;
@@ -133,7 +146,10 @@ auto main(int argc, char** argv) -> std::int32_t {
     QTranslator qtTranslator;
     QTranslator translatorBase;
     QTranslator translator;
-    initTranslations(qtTranslatorBase, qtTranslator, translatorBase, translator);
+    {
+        const trace::Span trace_span{"init_translations"};
+        initTranslations(qtTranslatorBase, qtTranslator, translatorBase, translator);
+    }
 
     MainWindow w;
     w.show();
@@ -0,0 +1,296 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pacman_config.hpp"
+#include "string_utils.hpp"
+#include "trace.hpp"
+
+#include <cstdlib>  // for strtol
+
+#include <algorithm>   // for max, ranges::all_of
+#include <filesystem>  // for last_write_time, file_time_type
+#include <fstream>     // for ifstream
+#include <mutex>       // for mutex, lock_guard
+#include <utility>     // for pair, move
+
+#include <glob.h>         // for glob, globfree
+#include <sys/utsname.h>  // for uname
+
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr auto OPTIONS_SECTION   = "options"sv;
+static constexpr auto MAX_INCLUDE_DEPTH = 10;
+// Same as 'SigLevel = Required DatabaseOptional'
+static constexpr std::int32_t DEFAULT_SIG_LEVEL = ALPM_SIG_PACKAGE | ALPM_SIG_DATABASE | ALPM_SIG_DATABASE_OPTIONAL;
+
+using watched_files_t = std::vector<std::pair<std::string, fs::file_time_type>>;
+
+/// State of the parser, which is shared between pacman.conf and included files.
+struct ParseContext {
+    utils::PacmanConfig& config;
+    std::string section{};
+    // every file or directory, which affects the result
+    watched_files_t watched_files{};
+};
+
+/// Last parsed config and the files it's parsed from.
+struct ConfigCache {
+    std::mutex mutex{};
+    std::string conf_path{};
+    watched_files_t watched_files{};
+    std::shared_ptr<const utils::PacmanConfig> config{};
+};
+
+constexpr auto trim(std::string_view str) noexcept -> std::string_view {
+    constexpr std::string_view whitespace = " \t\r\n";
+
+    const auto first = str.find_first_not_of(whitespace);
+    /* clang-format off */
+    if (first == std::string_view::npos) { return {}; }
+    /* clang-format on */
+    const auto last = str.find_last_not_of(whitespace);
+    return str.substr(first, last - first + 1);
+}
+
+auto get_native_arch() noexcept -> std::string {
+    struct utsname name { };
+    /* clang-format off */
+    if (::uname(&name) != 0) { return "x86_64"; }
+    /* clang-format on */
+    return name.machine;
+}
+
+// Missing file gets the minimal time, so it's noticed, once it appears
+auto get_mtime(const std::string& path) noexcept -> fs::file_time_type {
+    std::error_code err{};
+    const auto mtime = fs::last_write_time(path, err);
+    return err ? fs::file_time_type::min() : mtime;
+}
+
+void watch_file(ParseContext& context, std::string path) noexcept {
+    auto mtime = get_mtime(path);
+    context.watched_files.emplace_back(std::move(path), mtime);
+}
+
+void parse_conf_file(const std::string& path, ParseContext& context, std::int32_t depth) noexcept;
+
+// Include can be glob (e.g /etc/pacman.d/*.conf), pacman parses matches in order
+void parse_conf_include(std::string_view pattern, ParseContext& context, std::int32_t depth) noexcept {
+    // new files matching the glob change mtime of the directory
+    if (pattern.find_first_of("*?["sv) != std::string_view::npos) {
+        watch_file(context, fs::path{pattern}.parent_path().string());
+    }
+
+    glob_t globbuf{};
+    if (::glob(std::string{pattern}.c_str(), GLOB_NOCHECK, nullptr, &globbuf) == 0) {
+        for (std::size_t i = 0; i < globbuf.gl_pathc; ++i) {
+            parse_conf_file(globbuf.gl_pathv[i], context, depth + 1);
+        }
+    }
+    ::globfree(&globbuf);
+}
+
+void parse_conf_option(std::string_view key, std::string_view value, ParseContext& context) noexcept {
+    auto& config = context.config;
+    if (key == "CacheDir"sv) {
+        config.cache_dirs.emplace_back(value);
+    } else if (key == "HookDir"sv) {
+        config.hook_dirs.emplace_back(value);
+    } else if (key == "GPGDir"sv) {
+        config.gpg_dir = value;
+    } else if (key == "LogFile"sv) {
+        config.log_file = value;
+    } else if (key == "Architecture"sv) {
+        // pacman allows multiple architectures, the first one is the native one
+        config.architecture = value.substr(0, value.find(' '));
+    } else if (key == "ParallelDownloads"sv) {
+        config.parallel_downloads = static_cast<std::uint32_t>(std::max(1L, std::strtol(std::string{value}.c_str(), nullptr, 10)));
+    } else if (key == "SigLevel"sv && !utils::parse_siglevel(value, config.siglevel)) {
+        fmt::print(stderr, "[ALPM] invalid SigLevel in [options]: '{}'\n", value);
+    }
+}
+
+void parse_conf_repo_option(std::string_view key, std::string_view value, ParseContext& context) noexcept {
+    auto& repos = context.config.repos;
+    /* clang-format off */
+    if (repos.empty() || repos.back().name != context.section) { return; }
+    /* clang-format on */
+
+    auto& repo = repos.back();
+    if (key == "Server"sv) {
+        repo.servers.emplace_back(value);
+    } else if (key == "SigLevel"sv) {
+        // Repo level is applied on top of the global one, same as in pacman
+        auto siglevel = (repo.siglevel == ALPM_SIG_USE_DEFAULT) ? context.config.siglevel : repo.siglevel;
+        if (!utils::parse_siglevel(value, siglevel)) {
+            fmt::print(stderr, "[ALPM] invalid SigLevel in [{}]: '{}'\n", repo.name, value);
+            return;
+        }
+        repo.siglevel = siglevel;
+    }
+}
+
+void parse_conf_file(const std::string& path, ParseContext& context, std::int32_t depth) noexcept {
+    if (depth > MAX_INCLUDE_DEPTH) {
+        fmt::print(stderr, "[ALPM] too deep include nesting at '{}'\n", path);
+        return;
+    }
+    watch_file(context, path);
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        fmt::print(stderr, "[ALPM] failed to open '{}'\n", path);
+        return;
+    }
+
+    std::string raw_line;
+    while (std::getline(file, raw_line)) {
+        std::string_view line{raw_line};
+        if (const auto comment_pos = line.find('#'); comment_pos != std::string_view::npos) {
+            line = line.substr(0, comment_pos);
+        }
+        line = trim(line);
+        /* clang-format off */
+        if (line.empty()) { continue; }
+        /* clang-format on */
+
+        if (line.front() == '[' && line.back() == ']') {
+            context.section = std::string{line.substr(1, line.size() - 2)};
+            if (context.section != OPTIONS_SECTION) {
+                context.config.repos.emplace_back(utils::PacmanRepo{.name = context.section});
+            }
+            continue;
+        }
+
+        const auto delim_pos = line.find('=');
+        /* clang-format off */
+        if (delim_pos == std::string_view::npos) { continue; }
+        /* clang-format on */
+        const auto key   = trim(line.substr(0, delim_pos));
+        const auto value = trim(line.substr(delim_pos + 1));
+
+        if (key == "Include"sv) {
+            parse_conf_include(value, context, depth);
+        } else if (context.section == OPTIONS_SECTION) {
+            parse_conf_option(key, value, context);
+        } else {
+            parse_conf_repo_option(key, value, context);
+        }
+    }
+}
+
+auto parse_conf(std::string_view conf_path, watched_files_t& watched_files) noexcept -> utils::PacmanConfig {
+    const trace::Span trace_span{"parse_pacman_conf"};
+
+    utils::PacmanConfig config{.siglevel = DEFAULT_SIG_LEVEL};
+    ParseContext context{.config = config};
+    parse_conf_file(std::string{conf_path}, context, 0);
+
+    if (config.architecture.empty() || config.architecture == "auto"sv) {
+        config.architecture = get_native_arch();
+    }
+    for (auto&& repo : config.repos) {
+        for (auto&& server : repo.servers) {
+            utils::replace_all(server, "$repo", repo.name);
+            utils::replace_all(server, "$arch", config.architecture);
+        }
+    }
+
+    watched_files = std::move(context.watched_files);
+    return config;
+}
+
+}  // namespace
+
+namespace utils {
+
+auto parse_pacman_conf(std::string_view conf_path) noexcept -> PacmanConfig {
+    watched_files_t watched_files{};
+    return parse_conf(conf_path, watched_files);
+}
+
+auto get_pacman_config(std::string_view conf_path) noexcept -> std::shared_ptr<const PacmanConfig> {
+    static ConfigCache cache{};
+
+    const std::lock_guard<std::mutex> guard(cache.mutex);
+    const bool is_up_to_date = cache.config && cache.conf_path == conf_path
+        && std::ranges::all_of(cache.watched_files, [](auto&& watched_file) { return get_mtime(watched_file.first) == watched_file.second; });
+    /* clang-format off */
+    if (is_up_to_date) { return cache.config; }
+    /* clang-format on */
+
+    cache.conf_path = conf_path;
+    cache.config    = std::make_shared<const PacmanConfig>(parse_conf(conf_path, cache.watched_files));
+    return cache.config;
+}
+
+// The same rules, which pacman uses (see pacman.conf(5))
+bool parse_siglevel(std::string_view value, std::int32_t& siglevel) noexcept {
+    auto new_siglevel = siglevel;
+    for (auto option : utils::make_multiline_view(value, ' ')) {
+        bool is_package{true};
+        bool is_database{true};
+        if (option.starts_with("Package"sv)) {
+            is_database = false;
+            option.remove_prefix("Package"sv.size());
+        } else if (option.starts_with("Database"sv)) {
+            is_package = false;
+            option.remove_prefix("Database"sv.size());
+        }
+
+        // package and database flags are laid out the same way, the database ones are just shifted
+        std::int32_t check_flag{};
+        std::int32_t optional_flag{};
+        std::int32_t trust_flags{};
+        if (is_package) {
+            check_flag |= ALPM_SIG_PACKAGE;
+            optional_flag |= ALPM_SIG_PACKAGE_OPTIONAL;
+            trust_flags |= ALPM_SIG_PACKAGE_MARGINAL_OK | ALPM_SIG_PACKAGE_UNKNOWN_OK;
+        }
+        if (is_database) {
+            check_flag |= ALPM_SIG_DATABASE;
+            optional_flag |= ALPM_SIG_DATABASE_OPTIONAL;
+            trust_flags |= ALPM_SIG_DATABASE_MARGINAL_OK | ALPM_SIG_DATABASE_UNKNOWN_OK;
+        }
+
+        if (option == "Never"sv) {
+            new_siglevel &= ~check_flag;
+        } else if (option == "Optional"sv) {
+            new_siglevel |= check_flag | optional_flag;
+        } else if (option == "Required"sv) {
+            new_siglevel |= check_flag;
+            new_siglevel &= ~optional_flag;
+        } else if (option == "TrustedOnly"sv) {
+            new_siglevel &= ~trust_flags;
+        } else if (option == "TrustAll"sv) {
+            new_siglevel |= trust_flags;
+        } else {
+            return false;
+        }
+    }
+    siglevel = new_siglevel;
+    return true;
+}
+
+}  // namespace utils
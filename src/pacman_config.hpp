@@ -0,0 +1,69 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PACMAN_CONFIG_HPP
+#define PACMAN_CONFIG_HPP
+
+#include <cstdint>      // for uint32_t
+#include <memory>       // for shared_ptr
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#include <alpm.h>
+
+namespace utils {
+
+inline constexpr std::string_view PACMAN_CONF_PATH = "/etc/pacman.conf";
+
+/// Sync repo, in the pacman.conf order.
+struct PacmanRepo {
+    std::string name{};
+    // $repo and $arch are already expanded
+    std::vector<std::string> servers{};
+    // ALPM_SIG_USE_DEFAULT, unless the repo has own SigLevel
+    std::int32_t siglevel{ALPM_SIG_USE_DEFAULT};
+};
+
+/// The subset of pacman.conf, which matters for alpm handle.
+struct PacmanConfig {
+    std::vector<std::string> cache_dirs{};
+    std::vector<std::string> hook_dirs{};
+    std::string gpg_dir{};
+    std::string log_file{};
+    // resolved, if it's 'auto' or isn't set
+    std::string architecture{};
+    std::uint32_t parallel_downloads{1};
+    std::int32_t siglevel{};
+    std::vector<PacmanRepo> repos{};
+};
+
+/// @brief Parse pacman.conf line by line, following Include directives the same way pacman does.
+auto parse_pacman_conf(std::string_view conf_path) noexcept -> PacmanConfig;
+
+/// @brief Get the parsed pacman.conf.
+/// The config is parsed again only if pacman.conf or any of the included files has changed since the last call.
+auto get_pacman_config(std::string_view conf_path = PACMAN_CONF_PATH) noexcept -> std::shared_ptr<const PacmanConfig>;
+
+/// @brief Apply the SigLevel value (e.g 'Required DatabaseOptional') on top of the level.
+/// @return False if the value has unknown option, the level isn't changed then.
+bool parse_siglevel(std::string_view value, std::int32_t& siglevel) noexcept;
+
+}  // namespace utils
+
+#endif  // PACMAN_CONFIG_HPP
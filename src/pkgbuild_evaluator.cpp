@@ -0,0 +1,312 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pkgbuild_evaluator.hpp"
+#include "utils.hpp"
+
+#include <fcntl.h>       // for O_WRONLY
+#include <poll.h>        // for poll, pollfd
+#include <signal.h>      // for kill, SIGTERM
+#include <spawn.h>       // for posix_spawnp, posix_spawn_file_actions_*
+#include <sys/socket.h>  // for socketpair, send, recv
+#include <sys/wait.h>    // for waitpid
+#include <unistd.h>      // for close
+
+#include <cerrno>   // for errno, EINTR
+#include <cstdlib>  // for getenv
+#include <cstring>  // for strerror
+
+#include <array>       // for array
+#include <filesystem>  // for absolute
+#include <functional>  // for hash
+#include <ranges>      // for ranges::*
+#include <utility>     // for pair
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Sourcing the PKGBUILD is fast, if it takes longer something is wrong with it.
+static constexpr int QUERY_TIMEOUT_MS = 10'000;
+
+// Don't let the cache grow forever, when user plays with options.
+static constexpr std::size_t MAX_CACHE_ENTRIES = 64;
+
+auto parse_query_output(std::string_view output) noexcept -> PkgbuildInfo {
+    using namespace std::string_view_literals;
+
+    PkgbuildInfo pkgbuild_info{};
+    for (auto&& line : utils::make_split_view(output, '\n')) {
+        auto&& [key, value] = [line]() -> std::pair<std::string_view, std::string_view> {
+            const auto pos = line.find('=');
+            if (pos == std::string_view::npos) {
+                return {};
+            }
+            return {line.substr(0, pos), line.substr(pos + 1)};
+        }();
+        /* clang-format off */
+        if (value.empty()) { continue; }
+        /* clang-format on */
+
+        if (key == "pkgver"sv) {
+            pkgbuild_info.pkgver = value;
+        } else if (key == "pkgrel"sv) {
+            pkgbuild_info.pkgrel = value;
+        } else if (key == "source"sv) {
+            pkgbuild_info.source.emplace_back(value);
+        } else if (key == "function"sv) {
+            pkgbuild_info.package_functions.emplace_back(value);
+        }
+    }
+    return pkgbuild_info;
+}
+
+auto prepare_func_names(std::vector<std::string> parse_lines, std::string_view pkgver_str) noexcept -> std::vector<std::string> {
+    using namespace std::string_view_literals;
+
+    static constexpr auto functor = [](auto&& rng) {
+        auto rng_str = std::string_view(&*rng.begin(), static_cast<size_t>(std::ranges::distance(rng)));
+        return rng_str.starts_with("package_"sv);
+    };
+
+    std::vector<std::string> pkg_globs{};
+    pkg_globs = parse_lines
+        | std::ranges::views::transform([&](auto&& rng) {
+              auto&& line = std::string_view(&*rng.begin(), static_cast<size_t>(std::ranges::distance(rng)));
+
+              static constexpr auto needle_prefix = "declare -f "sv;
+              if (line.starts_with(needle_prefix)) {
+                  line.remove_prefix(needle_prefix.size());
+              }
+              return line;
+          })
+        | std::ranges::views::filter(functor)
+        | std::ranges::views::transform([&](auto&& rng) {
+              auto&& line = std::string_view(&*rng.begin(), static_cast<size_t>(std::ranges::distance(rng)));
+
+              static constexpr auto needle_prefix = "package_"sv;
+              if (line.starts_with(needle_prefix)) {
+                  line.remove_prefix(needle_prefix.size());
+              }
+              return fmt::format(FMT_COMPILE("{}-{}-*.pkg.tar.zst"), line, pkgver_str);
+          })
+        | std::ranges::to<std::vector<std::string>>();
+    return pkg_globs;
+}
+
+}  // namespace
+
+PkgbuildEvaluator::~PkgbuildEvaluator() {
+    stop_coprocess();
+}
+
+auto PkgbuildEvaluator::instance() noexcept -> PkgbuildEvaluator& {
+    static PkgbuildEvaluator evaluator{};
+    return evaluator;
+}
+
+auto PkgbuildEvaluator::evaluate(std::string_view pkgbuild_dir, std::string_view options_set) noexcept -> std::optional<PkgbuildInfo> {
+    // Coprocess has its own working directory
+    std::error_code err_code{};
+    const auto& abs_pkgbuild_dir = fs::absolute(fs::path{pkgbuild_dir}, err_code).string();
+    if (err_code) {
+        fmt::print(stderr, "[PKGBUILDEVAL] invalid path '{}': {}\n", pkgbuild_dir, err_code.message());
+        return std::nullopt;
+    }
+
+    const auto& pkgbuild_content = utils::read_whole_file(fmt::format(FMT_COMPILE("{}/PKGBUILD"), abs_pkgbuild_dir));
+    /* clang-format off */
+    if (pkgbuild_content.empty()) { return std::nullopt; }
+    /* clang-format on */
+
+    // PKGBUILD is modified before the build (e.g source array), so the content must be a part of the key
+    const auto& cache_key = fmt::format(FMT_COMPILE("{}\n{:x}\n{}"), abs_pkgbuild_dir, std::hash<std::string>{}(pkgbuild_content), options_set);
+
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    if (auto cache_it = m_cache.find(cache_key); cache_it != m_cache.end()) {
+        return cache_it->second;
+    }
+
+    // Source in the subshell, that way neither options nor PKGBUILD leak into the next query
+    const auto& sentinel = fmt::format(FMT_COMPILE("__CACHYOS_KM_EVAL_END_{}__"), ++m_query_count);
+    const auto& query    = fmt::format(FMT_COMPILE("(\n"
+                                                   "cd {} || exit 1\n"
+                                                   "{}\n"
+                                                   "source ./PKGBUILD >/dev/null 2>&1\n"
+                                                   "printf 'pkgver=%s\\n' \"$pkgver\"\n"
+                                                   "printf 'pkgrel=%s\\n' \"$pkgrel\"\n"
+                                                   "printf 'source=%s\\n' \"${{source[@]}}\"\n"
+                                                   "printf 'function=%s\\n' $(compgen -A function package_)\n"
+                                                   ") </dev/null\n"
+                                                   "printf '\\n%s\\n' '{}'\n"),
+           utils::shell_quote(abs_pkgbuild_dir), options_set, sentinel);
+
+    auto output = run_query(query, sentinel);
+    if (!output) {
+        fmt::print(stderr, "[PKGBUILDEVAL] failed to evaluate '{}'\n", abs_pkgbuild_dir);
+        return std::nullopt;
+    }
+
+    if (m_cache.size() >= MAX_CACHE_ENTRIES) {
+        m_cache.clear();
+    }
+    auto pkgbuild_info = parse_query_output(*output);
+    m_cache.insert_or_assign(cache_key, pkgbuild_info);
+    return pkgbuild_info;
+}
+
+bool PkgbuildEvaluator::spawn_coprocess() noexcept {
+    std::array<int, 2> sock_fds{-1, -1};
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sock_fds.data()) != 0) {
+        fmt::print(stderr, "[PKGBUILDEVAL] socketpair failed: {}\n", std::strerror(errno));
+        return false;
+    }
+
+    // Both stdin and stdout of bash are connected to the one end of the socket
+    posix_spawn_file_actions_t file_actions{};
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_adddup2(&file_actions, sock_fds[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&file_actions, sock_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // Clean environment, only options passed with the query must affect the result
+    const char* home_dir     = std::getenv("HOME");
+    const auto& home_env     = fmt::format(FMT_COMPILE("HOME={}"), (home_dir != nullptr) ? home_dir : "/");
+    std::array<char*, 4> env = {
+        const_cast<char*>("PATH=/usr/local/sbin:/usr/local/bin:/usr/bin"),  // NOLINT
+        const_cast<char*>("LC_ALL=C"),                                    // NOLINT
+        const_cast<char*>(home_env.c_str()),                              // NOLINT
+        nullptr,
+    };
+    std::array<char*, 4> argv = {
+        const_cast<char*>("bash"),         // NOLINT
+        const_cast<char*>("--noprofile"),  // NOLINT
+        const_cast<char*>("--norc"),       // NOLINT
+        nullptr,
+    };
+
+    const int spawn_status = ::posix_spawnp(&m_pid, argv[0], &file_actions, nullptr, argv.data(), env.data());
+    posix_spawn_file_actions_destroy(&file_actions);
+    ::close(sock_fds[1]);
+    if (spawn_status != 0) {
+        fmt::print(stderr, "[PKGBUILDEVAL] failed to spawn bash: {}\n", std::strerror(spawn_status));
+        ::close(sock_fds[0]);
+        m_pid = -1;
+        return false;
+    }
+    m_fd = sock_fds[0];
+    return true;
+}
+
+void PkgbuildEvaluator::stop_coprocess() noexcept {
+    if (m_fd != -1) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (m_pid != -1) {
+        ::kill(m_pid, SIGTERM);
+        ::waitpid(m_pid, nullptr, 0);
+        m_pid = -1;
+    }
+}
+
+auto PkgbuildEvaluator::run_query(std::string_view query, std::string_view sentinel) noexcept -> std::optional<std::string> {
+    const auto& terminator = fmt::format(FMT_COMPILE("\n{}\n"), sentinel);
+
+    const auto& try_query = [&]() -> std::optional<std::string> {
+        // MSG_NOSIGNAL: don't get killed by SIGPIPE if bash went away
+        for (std::size_t sent_bytes{}; sent_bytes < query.size();) {
+            const auto ret = ::send(m_fd, query.data() + sent_bytes, query.size() - sent_bytes, MSG_NOSIGNAL);
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret < 0) {
+                return std::nullopt;
+            }
+            sent_bytes += static_cast<std::size_t>(ret);
+        }
+
+        std::string output{};
+        std::array<char, 64 * 1024> buffer{};
+        while (true) {
+            pollfd poll_fd{.fd = m_fd, .events = POLLIN, .revents = 0};
+            const int poll_ret = ::poll(&poll_fd, 1, QUERY_TIMEOUT_MS);
+            if (poll_ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (poll_ret <= 0) {
+                return std::nullopt;
+            }
+
+            const auto read_bytes = ::recv(m_fd, buffer.data(), buffer.size(), 0);
+            if (read_bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read_bytes <= 0) {
+                return std::nullopt;
+            }
+
+            // Only new data and the tail of the previous chunk can contain the terminator
+            const auto search_from = output.size() > terminator.size() ? output.size() - terminator.size() : 0;
+            output.append(buffer.data(), static_cast<std::size_t>(read_bytes));
+            if (auto pos = output.find(terminator, search_from); pos != std::string::npos) {
+                output.resize(pos);
+                return output;
+            }
+        }
+    };
+
+    // Restart the coprocess once, if it died or hung
+    for (std::int32_t attempt = 0; attempt < 2; ++attempt) {
+        if (m_fd == -1 && !spawn_coprocess()) {
+            return std::nullopt;
+        }
+        if (auto output = try_query(); output) {
+            return output;
+        }
+        stop_coprocess();
+    }
+    return std::nullopt;
+}
+
+auto get_package_names_glob_from_pkgbuild(std::string_view kernel_name_path) noexcept -> std::vector<std::string> {
+    const auto& pkgbuild_info = PkgbuildEvaluator::instance().evaluate(kernel_name_path, {});
+    if (!pkgbuild_info || pkgbuild_info->pkgver.empty()) {
+        fmt::print(stderr, "broken pkgbuild; pkgver must be present\n");
+        return {};
+    }
+    const auto& pkgver_str = fmt::format(FMT_COMPILE("{}-{}"), pkgbuild_info->pkgver, pkgbuild_info->pkgrel);
+
+    return prepare_func_names(pkgbuild_info->package_functions, pkgver_str);
+}
+
+bool set_custom_name_in_pkgbuild(std::string_view kernel_name_path, std::string_view custom_name) noexcept {
+    const auto& pkgbuild_path = fmt::format(FMT_COMPILE("{}/PKGBUILD"), kernel_name_path);
+    auto pkgbuildsrc          = utils::read_whole_file(pkgbuild_path);
+
+    const auto& custom_name_var = fmt::format(FMT_COMPILE("\n\npkgbase=\"{}\""), custom_name);
+    if (auto foundpos = pkgbuildsrc.find("_major="); foundpos != std::string::npos) {
+        if (auto last_newline_before = pkgbuildsrc.find_last_of('\n', foundpos); last_newline_before != std::string::npos) {
+            pkgbuildsrc.insert(last_newline_before, custom_name_var);
+        }
+    }
+    return utils::write_to_file(pkgbuild_path, pkgbuildsrc);
+}
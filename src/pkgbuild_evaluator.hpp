@@ -0,0 +1,86 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PKGBUILD_EVALUATOR_HPP
+#define PKGBUILD_EVALUATOR_HPP
+
+#include <cstdint>        // for uint64_t
+#include <mutex>          // for mutex
+#include <optional>       // for optional
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+#include <sys/types.h>  // for pid_t
+
+/// Values of the PKGBUILD, after it was sourced with the options.
+struct PkgbuildInfo {
+    std::string pkgver{};
+    std::string pkgrel{};
+    std::vector<std::string> source{};
+    /// Names of the package functions (e.g package_linux-cachyos).
+    std::vector<std::string> package_functions{};
+};
+
+/// Evaluates PKGBUILDs with long-lived bash coprocess.
+///
+/// Each query is sourced in a subshell, so queries never affect each other,
+/// and results are memoized by the PKGBUILD content and the option set.
+class PkgbuildEvaluator {
+ public:
+    PkgbuildEvaluator() = default;
+    ~PkgbuildEvaluator();
+
+    PkgbuildEvaluator(const PkgbuildEvaluator&)            = delete;
+    PkgbuildEvaluator& operator=(const PkgbuildEvaluator&) = delete;
+
+    /// @brief Get the evaluator shared by the whole app.
+    static auto instance() noexcept -> PkgbuildEvaluator&;
+
+    /// @brief Source the PKGBUILD and get its values.
+    /// @param pkgbuild_dir The directory, which contains PKGBUILD.
+    /// @param options_set The variable assignments (e.g "_cachy_config=y\n"), which are set before sourcing.
+    /// @return The values of PKGBUILD, or nullopt on failure.
+    auto evaluate(std::string_view pkgbuild_dir, std::string_view options_set) noexcept -> std::optional<PkgbuildInfo>;
+
+ private:
+    bool spawn_coprocess() noexcept;
+    void stop_coprocess() noexcept;
+    auto run_query(std::string_view query, std::string_view sentinel) noexcept -> std::optional<std::string>;
+
+    std::mutex m_mutex{};
+    std::unordered_map<std::string, PkgbuildInfo> m_cache{};
+    std::uint64_t m_query_count{};
+
+    pid_t m_pid{-1};
+    int m_fd{-1};
+};
+
+/// @brief Get globs of the package files, which are produced by the PKGBUILD (e.g linux-cachyos-6.9.1-1-*.pkg.tar.zst).
+/// @param kernel_name_path The directory, which contains PKGBUILD.
+/// @return The globs relative to the directory, or empty vector if PKGBUILD is broken.
+auto get_package_names_glob_from_pkgbuild(std::string_view kernel_name_path) noexcept -> std::vector<std::string>;
+
+/// @brief Override pkgbase of the PKGBUILD.
+/// @param kernel_name_path The directory, which contains PKGBUILD.
+/// @param custom_name The name of the package base.
+/// @return True if PKGBUILD was written successfully.
+bool set_custom_name_in_pkgbuild(std::string_view kernel_name_path, std::string_view custom_name) noexcept;
+
+#endif  // PKGBUILD_EVALUATOR_HPP
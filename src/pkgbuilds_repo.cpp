@@ -0,0 +1,132 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "pkgbuilds_repo.hpp"
+#include "utils.hpp"
+
+#include <chrono>         // for steady_clock, minutes
+#include <mutex>          // for mutex, lock_guard
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Don't query the remote on each configure/build within single session.
+constexpr auto REMOTE_CHECK_INTERVAL = std::chrono::minutes{10};
+
+std::mutex g_sync_mutex{};                                                                 // NOLINT
+std::unordered_map<std::string, std::chrono::steady_clock::time_point> g_last_remote_check{};  // NOLINT
+
+auto run_git(const fs::path& repo_path, std::vector<std::string>&& args) noexcept -> utils::ExecResult {
+    args.insert(args.begin(), {"git", "-C", repo_path.string()});
+    auto result = utils::exec_argv(args);
+    if (!result.is_success()) {
+        fmt::print(stderr, "[PKGBUILDSREPO] '{}' failed: {}\n", fmt::join(args, " "), result.err);
+    }
+    return result;
+}
+
+// Get hash of the branch head, without downloading anything.
+auto get_remote_head(const pkgbuilds::RepoSpec& repo) noexcept -> std::string {
+    auto&& result = utils::exec_argv({"git", "ls-remote", repo.url, fmt::format("refs/heads/{}", repo.branch)});
+    if (!result.is_success()) {
+        return {};
+    }
+    // Output format: '<hash>\trefs/heads/<branch>'
+    return result.out.substr(0, result.out.find('\t'));
+}
+
+auto get_local_head(const fs::path& repo_path) noexcept -> std::string {
+    auto&& result = run_git(repo_path, {"rev-parse", "HEAD"});
+    if (result.out.ends_with('\n')) {
+        result.out.pop_back();
+    }
+    return result.out;
+}
+
+bool clone_repo(const pkgbuilds::RepoSpec& repo) noexcept {
+    std::error_code err_code{};
+    fs::create_directories(repo.path.parent_path(), err_code);
+
+    // Only the latest revision is needed to build the package
+    auto&& result = utils::exec_argv({"git", "clone", "--depth", "1", "--filter=blob:none", "--branch", repo.branch, repo.url, repo.path.string()});
+    if (!result.is_success()) {
+        fmt::print(stderr, "[PKGBUILDSREPO] failed to clone '{}': {}\n", repo.url, result.err);
+        return false;
+    }
+    return true;
+}
+
+bool update_repo(const pkgbuilds::RepoSpec& repo) noexcept {
+    const auto& remote_head = get_remote_head(repo);
+    if (remote_head.empty()) {
+        fmt::print(stderr, "[PKGBUILDSREPO] cannot reach '{}', using local checkout\n", repo.url);
+        return false;
+    }
+    /* clang-format off */
+    if (remote_head == get_local_head(repo.path)) { return true; }
+    /* clang-format on */
+
+    // Shallow history can't be merged, so just move to the fetched revision
+    return run_git(repo.path, {"fetch", "--depth", "1", "origin", repo.branch}).is_success()
+        && run_git(repo.path, {"reset", "--hard", "FETCH_HEAD"}).is_success();
+}
+
+// Drop local changes (e.g modified PKGBUILD from the previous build)
+bool reset_worktree(const pkgbuilds::RepoSpec& repo) noexcept {
+    return run_git(repo.path, {"checkout", "--force", repo.branch}).is_success()
+        && run_git(repo.path, {"clean", "-fd"}).is_success();
+}
+
+}  // namespace
+
+namespace pkgbuilds {
+
+bool sync_repo(const RepoSpec& repo) noexcept {
+    const std::lock_guard<std::mutex> guard(g_sync_mutex);
+
+    // Check if folder exits, but .git doesn't.
+    if (fs::exists(repo.path) && !fs::exists(repo.path / ".git")) {
+        std::error_code err_code{};
+        fs::remove_all(repo.path, err_code);
+    }
+
+    const auto& now = std::chrono::steady_clock::now();
+    if (!fs::exists(repo.path)) {
+        if (!clone_repo(repo)) {
+            return false;
+        }
+        g_last_remote_check.insert_or_assign(repo.path.string(), now);
+        return true;
+    }
+
+    auto last_check_it = g_last_remote_check.find(repo.path.string());
+    if (last_check_it == g_last_remote_check.end() || (now - last_check_it->second) > REMOTE_CHECK_INTERVAL) {
+        // Recorded even on failure, otherwise each sync waits for the unreachable remote again
+        update_repo(repo);
+        g_last_remote_check.insert_or_assign(repo.path.string(), now);
+    }
+    return reset_worktree(repo);
+}
+
+}  // namespace pkgbuilds
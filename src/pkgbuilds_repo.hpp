@@ -0,0 +1,44 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PKGBUILDS_REPO_HPP
+#define PKGBUILDS_REPO_HPP
+
+#include <filesystem>   // for path
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+namespace pkgbuilds {
+
+/// Git repository with PKGBUILDs (e.g linux-cachyos, or AUR package).
+struct RepoSpec {
+    std::filesystem::path path{};
+    std::string url{};
+    std::string branch{"master"};
+};
+
+/// @brief Make the local checkout of the repository up to date, and drop local changes.
+/// Repository is cloned shallow, and the network is queried only if the
+/// remote wasn't checked recently. Safe to call from any thread.
+/// @param repo The repository.
+/// @return True if the checkout is usable, even if the remote couldn't be reached.
+bool sync_repo(const RepoSpec& repo) noexcept;
+
+}  // namespace pkgbuilds
+
+#endif  // PKGBUILDS_REPO_HPP
@@ -0,0 +1,197 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "process_utils.hpp"
+
+#include <fcntl.h>     // for O_CLOEXEC, O_RDONLY
+#include <poll.h>      // for poll, pollfd
+#include <spawn.h>     // for posix_spawnp, posix_spawn_file_actions_*
+#include <sys/wait.h>  // for waitpid, WIFEXITED, WEXITSTATUS
+#include <unistd.h>    // for pipe2, read, close
+
+#include <cerrno>   // for errno, EINTR
+#include <cstring>  // for strerror
+
+#include <array>     // for array
+#include <optional>  // for optional
+
+#include <fmt/core.h>
+
+extern char** environ;  // NOLINT
+
+namespace {
+
+// Big enough to drain the whole pipe buffer with single call.
+static constexpr std::size_t READ_CHUNK_SIZE = 64 * 1024;
+
+// Splits the incoming chunks into lines, keeping the incomplete tail until the next chunk.
+class LineSplitter {
+ public:
+    explicit LineSplitter(const utils::exec_line_callback_t& on_line) : m_on_line(on_line) { }
+
+    void feed(std::string_view chunk) noexcept {
+        std::size_t newline_pos{};
+        while ((newline_pos = chunk.find('\n')) != std::string_view::npos) {
+            if (m_pending.empty()) {
+                m_on_line(chunk.substr(0, newline_pos));
+            } else {
+                m_pending.append(chunk.substr(0, newline_pos));
+                m_on_line(m_pending);
+                m_pending.clear();
+            }
+            chunk.remove_prefix(newline_pos + 1);
+        }
+        m_pending.append(chunk);
+    }
+
+    void flush() noexcept {
+        /* clang-format off */
+        if (m_pending.empty()) { return; }
+        /* clang-format on */
+        m_on_line(m_pending);
+        m_pending.clear();
+    }
+
+ private:
+    const utils::exec_line_callback_t& m_on_line;
+    std::string m_pending{};
+};
+
+auto spawn_process(const std::vector<std::string>& argv, const utils::exec_line_callback_t* on_line) noexcept -> utils::ExecResult {
+    utils::ExecResult result{};
+    if (argv.empty()) {
+        return result;
+    }
+
+    std::array<int, 2> out_pipe{-1, -1};
+    std::array<int, 2> err_pipe{-1, -1};
+    if (::pipe2(out_pipe.data(), O_CLOEXEC) != 0 || ::pipe2(err_pipe.data(), O_CLOEXEC) != 0) {
+        fmt::print(stderr, "[EXEC] pipe failed: {}\n", std::strerror(errno));
+        for (int fd : {out_pipe[0], out_pipe[1], err_pipe[0], err_pipe[1]}) {
+            /* clang-format off */
+            if (fd != -1) { ::close(fd); }
+            /* clang-format on */
+        }
+        return result;
+    }
+
+    posix_spawn_file_actions_t file_actions{};
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&file_actions, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&file_actions, err_pipe[1], STDERR_FILENO);
+
+    std::vector<char*> c_argv{};
+    c_argv.reserve(argv.size() + 1);
+    for (auto&& arg : argv) {
+        c_argv.push_back(const_cast<char*>(arg.c_str()));  // NOLINT
+    }
+    c_argv.push_back(nullptr);
+
+    pid_t child_pid{};
+    const int spawn_status = ::posix_spawnp(&child_pid, c_argv[0], &file_actions, nullptr, c_argv.data(), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+
+    // Close write ends on our side, otherwise we never get EOF.
+    ::close(out_pipe[1]);
+    ::close(err_pipe[1]);
+    if (spawn_status != 0) {
+        fmt::print(stderr, "[EXEC] failed to spawn '{}': {}\n", argv[0], std::strerror(spawn_status));
+        ::close(out_pipe[0]);
+        ::close(err_pipe[0]);
+        return result;
+    }
+
+    std::optional<LineSplitter> line_splitter{};
+    if (on_line != nullptr) {
+        line_splitter.emplace(*on_line);
+    }
+
+    // Drain both pipes at once, otherwise the child might block on the full stderr pipe.
+    std::string read_buffer(READ_CHUNK_SIZE, '\0');
+    std::array<pollfd, 2> poll_fds{pollfd{.fd = out_pipe[0], .events = POLLIN, .revents = 0}, pollfd{.fd = err_pipe[0], .events = POLLIN, .revents = 0}};
+    while (poll_fds[0].fd != -1 || poll_fds[1].fd != -1) {
+        if (::poll(poll_fds.data(), poll_fds.size(), -1) < 0) {
+            /* clang-format off */
+            if (errno == EINTR) { continue; }
+            /* clang-format on */
+            fmt::print(stderr, "[EXEC] poll failed: {}\n", std::strerror(errno));
+            break;
+        }
+
+        for (auto& poll_fd : poll_fds) {
+            if (poll_fd.fd == -1 || poll_fd.revents == 0) {
+                continue;
+            }
+            const auto read_bytes = ::read(poll_fd.fd, read_buffer.data(), read_buffer.size());
+            if (read_bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read_bytes <= 0) {
+                ::close(poll_fd.fd);
+                poll_fd.fd = -1;
+                continue;
+            }
+
+            const std::string_view chunk{read_buffer.data(), static_cast<std::size_t>(read_bytes)};
+            if (poll_fd.fd != out_pipe[0]) {
+                result.err.append(chunk);
+            } else if (line_splitter) {
+                line_splitter->feed(chunk);
+            } else {
+                result.out.append(chunk);
+            }
+        }
+    }
+    for (auto& poll_fd : poll_fds) {
+        /* clang-format off */
+        if (poll_fd.fd != -1) { ::close(poll_fd.fd); }
+        /* clang-format on */
+    }
+    if (line_splitter) {
+        line_splitter->flush();
+    }
+
+    int wait_status{};
+    while (::waitpid(child_pid, &wait_status, 0) < 0) {
+        if (errno != EINTR) {
+            fmt::print(stderr, "[EXEC] waitpid failed: {}\n", std::strerror(errno));
+            return result;
+        }
+    }
+    if (WIFEXITED(wait_status)) {
+        result.status = WEXITSTATUS(wait_status);
+    } else if (WIFSIGNALED(wait_status)) {
+        result.status = 128 + WTERMSIG(wait_status);
+    }
+    return result;
+}
+
+}  // namespace
+
+namespace utils {
+
+auto exec_argv(const std::vector<std::string>& argv) noexcept -> ExecResult {
+    return spawn_process(argv, nullptr);
+}
+
+auto exec_argv(const std::vector<std::string>& argv, const exec_line_callback_t& on_line) noexcept -> ExecResult {
+    return spawn_process(argv, &on_line);
+}
+
+}  // namespace utils
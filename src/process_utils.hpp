@@ -0,0 +1,63 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef PROCESS_UTILS_HPP
+#define PROCESS_UTILS_HPP
+
+#include <cstdint>      // for int32_t
+#include <functional>   // for function
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace utils {
+
+/// Result of the finished child process.
+struct ExecResult {
+    /// Exit code of the process, 128 + signal number if it was killed,
+    /// or -1 if the process couldn't be spawned.
+    std::int32_t status{-1};
+    std::string out{};
+    std::string err{};
+
+    /* clang-format off */
+    constexpr bool is_success() const noexcept
+    { return status == 0; }
+    /* clang-format on */
+};
+
+/// Receives a line of the output, without trailing newline.
+/// NOTE: the view is valid only inside of the callback.
+using exec_line_callback_t = std::function<void(std::string_view)>;
+
+/// @brief Run the program directly, without intermediate shell.
+/// The program is searched in PATH, stdin is redirected to /dev/null.
+/// @param argv The program and its arguments.
+/// @return The exit status, stdout and stderr of the process.
+auto exec_argv(const std::vector<std::string>& argv) noexcept -> ExecResult;
+
+/// @brief Run the program directly, and deliver stdout line by line.
+/// Output is never accumulated, so it's suited for the huge or long-running output (e.g build logs).
+/// @param argv The program and its arguments.
+/// @param on_line The callback, which is called for each line of stdout.
+/// @return The exit status and stderr of the process. ExecResult::out is always empty.
+auto exec_argv(const std::vector<std::string>& argv, const exec_line_callback_t& on_line) noexcept -> ExecResult;
+
+}  // namespace utils
+
+#endif  // PROCESS_UTILS_HPP
@@ -0,0 +1,245 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "sched_bench.hpp"
+#include "process_utils.hpp"
+#include "scx_utils.hpp"
+#include "string_utils.hpp"
+
+#include <algorithm>  // for sort, find_if_not
+#include <charconv>   // for from_chars
+#include <chrono>     // for steady_clock, duration
+#include <optional>   // for optional
+#include <thread>     // for sleep_for
+
+#include <fmt/core.h>
+
+namespace {
+
+using namespace std::string_view_literals;
+using namespace std::chrono_literals;  // NOLINT
+
+// Loading BPF scheduler can take a while, rust ones are parsing the topology first
+static constexpr auto SCHEDULER_START_TIMEOUT = 15s;
+static constexpr auto SCHEDULER_POLL_INTERVAL = 200ms;
+// Let the scheduler settle after the switch, before the first run
+static constexpr auto SCHEDULER_WARMUP = 2s;
+
+constexpr auto trim_view(std::string_view str) noexcept -> std::string_view {
+    constexpr auto is_space = [](char ch) { return ch == ' ' || ch == '\t' || ch == '\r'; };
+    const auto first = std::ranges::find_if_not(str, is_space);
+    const auto last  = std::ranges::find_if_not(str.rbegin(), str.rend(), is_space).base();
+    return (first < last) ? std::string_view{first, last} : std::string_view{};
+}
+
+// Parses the leading number, trailing text (e.g units or sample count) is ignored
+auto parse_leading_double(std::string_view str, double& value) noexcept -> bool {
+    str            = trim_view(str);
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return ec == std::errc{} && ptr != str.data();
+}
+
+auto quote_csv_field(std::string_view field) noexcept -> std::string {
+    /* clang-format off */
+    if (field.find_first_of(",\"\n"sv) == std::string_view::npos) { return std::string{field}; }
+    /* clang-format on */
+    std::string quoted{field};
+    utils::replace_all(quoted, "\""sv, "\"\""sv);
+    return fmt::format("\"{}\"", quoted);
+}
+
+auto format_csv_metric(double value) noexcept -> std::string {
+    return (value < 0.0) ? std::string{} : fmt::format("{:.2f}", value);
+}
+
+auto median_of(std::vector<double> values) noexcept -> double {
+    /* clang-format off */
+    if (values.empty()) { return -1.0; }
+    /* clang-format on */
+    std::ranges::sort(values);
+    const auto middle = values.size() / 2;
+    return (values.size() % 2 != 0) ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+auto wait_for_scheduler(std::string_view scheduler) noexcept -> bool {
+    const auto deadline = std::chrono::steady_clock::now() + SCHEDULER_START_TIMEOUT;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (scx::is_scheduler_running(scheduler)) {
+            return true;
+        }
+        std::this_thread::sleep_for(SCHEDULER_POLL_INTERVAL);
+    }
+    return false;
+}
+
+auto run_workload(const std::vector<std::string>& workload_argv) noexcept -> std::optional<BenchSample> {
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto& result    = utils::exec_argv(workload_argv);
+    const auto end_time   = std::chrono::steady_clock::now();
+    if (!result.is_success()) {
+        fmt::print(stderr, "[BENCH] workload '{}' failed with status {}: {}\n", workload_argv.front(), result.status, result.err);
+        return std::nullopt;
+    }
+
+    BenchSample sample{.duration_s = std::chrono::duration<double>(end_time - start_time).count()};
+    // schbench reports to stderr, hackbench to stdout
+    parse_bench_output(result.out, sample);
+    parse_bench_output(result.err, sample);
+    if (sample.throughput <= 0.0 && sample.duration_s > 0.0) {
+        sample.throughput = 1.0 / sample.duration_s;
+    }
+    return sample;
+}
+
+}  // namespace
+
+auto get_workload_argv(BenchWorkload workload, std::string_view custom_command) noexcept -> std::vector<std::string> {
+    switch (workload) {
+    case BenchWorkload::Schbench:
+        return {"schbench", "-r", "10"};
+    case BenchWorkload::Hackbench:
+        return {"hackbench", "-g", "10", "-l", "1000"};
+    case BenchWorkload::Custom:
+        return {"/bin/sh", "-c", std::string{custom_command}};
+    }
+    return {};
+}
+
+void parse_bench_output(std::string_view output, BenchSample& sample) noexcept {
+    bool is_wakeup_section{};
+    for (auto&& line : utils::make_multiline_view(output, '\n')) {
+        // schbench prints intermediate reports too, we take the last one
+        if (line.find("percentiles"sv) != std::string_view::npos) {
+            // older schbench versions print only wakeup latencies, as "Latency percentiles"
+            is_wakeup_section = line.find("Wakeup"sv) != std::string_view::npos || line.starts_with("Latency percentiles"sv);
+            continue;
+        }
+
+        auto field = trim_view(line);
+        if (field.starts_with("average rps:"sv)) {
+            parse_leading_double(field.substr(12), sample.throughput);
+            continue;
+        }
+        if (field.starts_with("Time:"sv)) {
+            double time_s{};
+            if (parse_leading_double(field.substr(5), time_s) && time_s > 0.0) {
+                sample.throughput = 1.0 / time_s;
+            }
+            continue;
+        }
+        /* clang-format off */
+        if (!is_wakeup_section) { continue; }
+        /* clang-format on */
+
+        // the requested percentile is marked, e.g "* 99.0th: 20"
+        if (field.starts_with('*')) {
+            field = trim_view(field.substr(1));
+        }
+        if (field.starts_with("50.0th:"sv)) {
+            parse_leading_double(field.substr(7), sample.p50_wakeup_us);
+        } else if (field.starts_with("99.0th:"sv)) {
+            parse_leading_double(field.substr(7), sample.p99_wakeup_us);
+        }
+    }
+}
+
+auto summarize_bench_samples(std::span<const BenchSample> samples) noexcept -> BenchSample {
+    std::vector<double> p50_values{};
+    std::vector<double> p99_values{};
+    BenchSample summary{};
+    for (auto&& sample : samples) {
+        if (sample.p50_wakeup_us >= 0.0) {
+            p50_values.emplace_back(sample.p50_wakeup_us);
+        }
+        if (sample.p99_wakeup_us >= 0.0) {
+            p99_values.emplace_back(sample.p99_wakeup_us);
+        }
+        summary.throughput += sample.throughput;
+        summary.duration_s += sample.duration_s;
+    }
+    if (!samples.empty()) {
+        summary.throughput /= static_cast<double>(samples.size());
+        summary.duration_s /= static_cast<double>(samples.size());
+    }
+    summary.p50_wakeup_us = median_of(std::move(p50_values));
+    summary.p99_wakeup_us = median_of(std::move(p99_values));
+    return summary;
+}
+
+auto format_bench_csv(std::span<const BenchResult> results) noexcept -> std::string {
+    std::string csv{"scheduler,flags,iteration,p50_wakeup_us,p99_wakeup_us,throughput,duration_s,error\n"};
+    for (auto&& result : results) {
+        const auto& scheduler = quote_csv_field(result.candidate.scheduler);
+        const auto& flags     = quote_csv_field(result.candidate.flags);
+        if (result.samples.empty()) {
+            csv += fmt::format("{},{},,,,,,{}\n", scheduler, flags, quote_csv_field(result.error));
+            continue;
+        }
+        for (std::size_t iteration{}; auto&& sample : result.samples) {
+            csv += fmt::format("{},{},{},{},{},{:.2f},{:.3f},{}\n", scheduler, flags, ++iteration,
+                format_csv_metric(sample.p50_wakeup_us), format_csv_metric(sample.p99_wakeup_us),
+                sample.throughput, sample.duration_s, quote_csv_field(result.error));
+        }
+    }
+    return csv;
+}
+
+auto run_sched_bench(const BenchConfig& config, const bench_switch_cb_t& switch_scheduler,
+    const bench_progress_cb_t& on_progress, const std::atomic_bool& is_cancelled) noexcept -> std::vector<BenchResult> {
+    const auto& workload_argv = get_workload_argv(config.workload, config.custom_command);
+
+    std::vector<BenchResult> results{};
+    results.reserve(config.candidates.size());
+    for (auto&& candidate : config.candidates) {
+        /* clang-format off */
+        if (is_cancelled.load(std::memory_order_relaxed)) { break; }
+        /* clang-format on */
+        auto& result = results.emplace_back(BenchResult{.candidate = candidate});
+
+        on_progress(fmt::format("Switching to {} {}", candidate.scheduler, candidate.flags));
+        if (!switch_scheduler(candidate)) {
+            result.error = "failed to switch the scheduler";
+            continue;
+        }
+        if (!wait_for_scheduler(candidate.scheduler)) {
+            result.error = "scheduler didn't start";
+            continue;
+        }
+        std::this_thread::sleep_for(SCHEDULER_WARMUP);
+
+        for (std::uint32_t iteration = 1; iteration <= config.iterations; ++iteration) {
+            /* clang-format off */
+            if (is_cancelled.load(std::memory_order_relaxed)) { break; }
+            /* clang-format on */
+            on_progress(fmt::format("Running {} on {} ({}/{})", workload_argv.front(), candidate.scheduler, iteration, config.iterations));
+
+            auto sample = run_workload(workload_argv);
+            if (!sample) {
+                result.error = "workload failed";
+                break;
+            }
+            // the scheduler could have been kicked out by the watchdog in the middle
+            if (!scx::is_scheduler_running(candidate.scheduler)) {
+                result.error = "scheduler has exited during the run";
+                break;
+            }
+            result.samples.emplace_back(*sample);
+        }
+    }
+    return results;
+}
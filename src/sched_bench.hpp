@@ -0,0 +1,89 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef SCHED_BENCH_HPP
+#define SCHED_BENCH_HPP
+
+#include <atomic>       // for atomic_bool
+#include <cstdint>      // for uint32_t, uint8_t
+#include <functional>   // for function
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+enum class BenchWorkload : std::uint8_t {
+    Schbench,
+    Hackbench,
+    Custom,
+};
+
+/// Scheduler with its flags, as they are set in /etc/default/scx.
+struct BenchCandidate final {
+    std::string scheduler{};
+    std::string flags{};
+};
+
+struct BenchConfig final {
+    std::vector<BenchCandidate> candidates{};
+    BenchWorkload workload{BenchWorkload::Schbench};
+    // shell command, used only by BenchWorkload::Custom
+    std::string custom_command{};
+    std::uint32_t iterations{3};
+};
+
+/// Result of a single workload run.
+/// Latencies are negative if the workload doesn't report them.
+struct BenchSample final {
+    double p50_wakeup_us{-1.0};
+    double p99_wakeup_us{-1.0};
+    // requests per second reported by the workload, or runs per second
+    double throughput{};
+    double duration_s{};
+};
+
+struct BenchResult final {
+    BenchCandidate candidate{};
+    std::vector<BenchSample> samples{};
+    // empty if the scheduler has been benchmarked
+    std::string error{};
+};
+
+/// Switches the running scheduler to the candidate. Called on the benchmark thread.
+using bench_switch_cb_t   = std::function<bool(const BenchCandidate&)>;
+using bench_progress_cb_t = std::function<void(std::string_view)>;
+
+/// @brief Get the command, which runs the workload.
+auto get_workload_argv(BenchWorkload workload, std::string_view custom_command) noexcept -> std::vector<std::string>;
+
+/// @brief Parse output of schbench ("Wakeup Latencies" percentiles, "average rps")
+/// or hackbench ("Time:"). Fields, which aren't found, are left untouched.
+void parse_bench_output(std::string_view output, BenchSample& sample) noexcept;
+
+/// @brief Median latencies and mean throughput of the samples.
+auto summarize_bench_samples(std::span<const BenchSample> samples) noexcept -> BenchSample;
+
+/// @brief Format every sample as a CSV row, with the header.
+auto format_bench_csv(std::span<const BenchResult> results) noexcept -> std::string;
+
+/// @brief Run the workload on every candidate in turn. Blocks until done, run it off the GUI thread.
+/// The cancel flag is checked before each run, the running workload isn't interrupted.
+auto run_sched_bench(const BenchConfig& config, const bench_switch_cb_t& switch_scheduler,
+    const bench_progress_cb_t& on_progress, const std::atomic_bool& is_cancelled) noexcept -> std::vector<BenchResult>;
+
+#endif  // SCHED_BENCH_HPP
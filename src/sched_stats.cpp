@@ -0,0 +1,285 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "sched_stats.hpp"
+#include "string_utils.hpp"
+
+#include <cerrno>  // for errno, EINTR
+
+#include <algorithm>     // for find_if
+#include <array>         // for array
+#include <charconv>      // for from_chars
+#include <system_error>  // for errc
+#include <tuple>         // for tie
+
+#include <fcntl.h>   // for open, O_RDONLY, O_CLOEXEC
+#include <unistd.h>  // for close, pread
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr auto SCHEDSTAT_PATH  = "/proc/schedstat"sv;
+static constexpr auto PSI_CPU_PATH    = "/proc/pressure/cpu"sv;
+static constexpr auto SCX_EVENTS_PATH = "/sys/kernel/sched_ext/root/events"sv;
+static constexpr auto PROC_STAT_PATH  = "/proc/stat"sv;
+// 0 by default, enabling it has a cost, so it's only reported
+static constexpr auto SCHEDSTATS_SYSCTL_PATH = "/proc/sys/kernel/sched_schedstats"sv;
+
+// cpu lines layout is stable since schedstat version 15
+static constexpr std::uint64_t SCHEDSTAT_MIN_VERSION = 15;
+
+// Field indices after the "cpuN" token
+static constexpr std::size_t SCHEDSTAT_SCHED_COUNT_FIELD = 2;
+static constexpr std::size_t SCHEDSTAT_RUN_DELAY_FIELD   = 7;
+static constexpr std::size_t SCHEDSTAT_TIMESLICES_FIELD  = 8;
+
+template <typename T>
+constexpr auto parse_number(std::string_view str, T& value) noexcept -> bool {
+    const auto* str_end = str.data() + str.size();
+    auto [ptr, ec]      = std::from_chars(str.data(), str_end, value);
+    return ec == std::errc{} && ptr == str_end;
+}
+
+auto open_file(std::string_view file_path) noexcept -> std::int32_t {
+    return ::open(file_path.data(), O_RDONLY | O_CLOEXEC);
+}
+
+// procfs/sysfs files don't have the size, read them in chunks from the start
+auto pread_whole(std::int32_t fd, std::string& buf) noexcept -> bool {
+    static constexpr std::size_t CHUNK_SIZE = 16384;
+
+    buf.clear();
+    for (;;) {
+        const auto offset = buf.size();
+        buf.resize(offset + CHUNK_SIZE);
+        const auto read_bytes = ::pread(fd, buf.data() + offset, CHUNK_SIZE, static_cast<off_t>(offset));
+        if (read_bytes == -1 && errno == EINTR) {
+            buf.resize(offset);
+            continue;
+        }
+        if (read_bytes <= 0) {
+            buf.resize(offset);
+            return read_bytes == 0;
+        }
+        buf.resize(offset + static_cast<std::size_t>(read_bytes));
+    }
+}
+
+void close_fd(std::int32_t fd) noexcept {
+    if (fd != -1) {
+        ::close(fd);
+    }
+}
+
+// previous value is larger if the counter has been reset (e.g CPU hotplug)
+constexpr auto counter_delta(std::uint64_t prev, std::uint64_t cur) noexcept -> std::uint64_t {
+    return (cur >= prev) ? (cur - prev) : 0;
+}
+
+}  // namespace
+
+SchedStatsSampler::SchedStatsSampler() noexcept
+  : m_schedstat_fd(open_file(SCHEDSTAT_PATH)), m_psi_fd(open_file(PSI_CPU_PATH)), m_proc_stat_fd(open_file(PROC_STAT_PATH)),
+    m_schedstats_sysctl_fd(open_file(SCHEDSTATS_SYSCTL_PATH)) { }
+
+SchedStatsSampler::~SchedStatsSampler() noexcept {
+    close_fd(m_schedstat_fd);
+    close_fd(m_psi_fd);
+    close_fd(m_proc_stat_fd);
+    close_fd(m_schedstats_sysctl_fd);
+}
+
+auto SchedStatsSampler::sample() noexcept -> SchedSnapshot {
+    SchedSnapshot snapshot{.time = std::chrono::steady_clock::now()};
+
+    if (m_schedstat_fd != -1 && pread_whole(m_schedstat_fd, m_buf)) {
+        snapshot.cpus = parse_schedstat(m_buf);
+    }
+    if (m_psi_fd != -1 && pread_whole(m_psi_fd, m_buf)) {
+        std::tie(snapshot.psi_some_avg10, snapshot.psi_some_total_us) = parse_psi_some(m_buf);
+    }
+    if (m_proc_stat_fd != -1 && pread_whole(m_proc_stat_fd, m_buf)) {
+        std::tie(snapshot.ctxt, snapshot.online_cpus) = parse_proc_stat(m_buf);
+    }
+    // it can be toggled at any time, so read on each sample
+    if (m_schedstats_sysctl_fd != -1 && pread_whole(m_schedstats_sysctl_fd, m_buf)) {
+        snapshot.is_schedstats_enabled = m_buf.starts_with('1');
+    }
+
+    // root kobject exists only while a scheduler is attached
+    if (const auto events_fd = open_file(SCX_EVENTS_PATH); events_fd != -1) {
+        if (pread_whole(events_fd, m_buf)) {
+            snapshot.scx_events = parse_scx_events(m_buf);
+        }
+        close_fd(events_fd);
+    }
+    return snapshot;
+}
+
+auto parse_schedstat(std::string_view content) noexcept -> std::vector<CpuSchedCounters> {
+    std::vector<CpuSchedCounters> cpus{};
+    for (auto&& line : utils::make_multiline_view(content, '\n')) {
+        if (line.starts_with("version "sv)) {
+            std::uint64_t version{};
+            /* clang-format off */
+            if (!parse_number(line.substr(8), version) || version < SCHEDSTAT_MIN_VERSION) { return {}; }
+            /* clang-format on */
+            continue;
+        }
+        // line must be "cpuN", and not "domainN" or "cpu" in other files
+        if (!line.starts_with("cpu"sv) || line.size() < 4 || line[3] < '0' || line[3] > '9') {
+            continue;
+        }
+
+        CpuSchedCounters counters{};
+        std::size_t field_index{};
+        bool is_valid{true};
+        for (auto&& field : utils::make_multiline_view(line, ' ')) {
+            if (field_index == 0) {
+                is_valid = parse_number(field.substr(3), counters.cpu);
+            } else if (field_index - 1 == SCHEDSTAT_SCHED_COUNT_FIELD) {
+                is_valid = parse_number(field, counters.sched_count);
+            } else if (field_index - 1 == SCHEDSTAT_RUN_DELAY_FIELD) {
+                is_valid = parse_number(field, counters.run_delay_ns);
+            } else if (field_index - 1 == SCHEDSTAT_TIMESLICES_FIELD) {
+                is_valid = parse_number(field, counters.timeslices);
+            }
+            /* clang-format off */
+            if (!is_valid) { break; }
+            /* clang-format on */
+            ++field_index;
+        }
+        if (is_valid && field_index > SCHEDSTAT_TIMESLICES_FIELD + 1) {
+            cpus.emplace_back(counters);
+        }
+    }
+    return cpus;
+}
+
+auto parse_psi_some(std::string_view content) noexcept -> std::pair<double, std::uint64_t> {
+    std::pair<double, std::uint64_t> some_values{};
+    for (auto&& line : utils::make_multiline_view(content, '\n')) {
+        /* clang-format off */
+        if (!line.starts_with("some "sv)) { continue; }
+        /* clang-format on */
+        for (auto&& field : utils::make_multiline_view(line.substr(5), ' ')) {
+            if (field.starts_with("avg10="sv)) {
+                parse_number(field.substr(6), some_values.first);
+            } else if (field.starts_with("total="sv)) {
+                parse_number(field.substr(6), some_values.second);
+            }
+        }
+        break;
+    }
+    return some_values;
+}
+
+auto parse_proc_stat(std::string_view content) noexcept -> std::pair<std::uint64_t, std::uint32_t> {
+    std::pair<std::uint64_t, std::uint32_t> stat_values{};
+    for (auto&& line : utils::make_multiline_view(content, '\n')) {
+        // only online CPUs are listed
+        if (line.starts_with("cpu"sv) && line.size() > 3 && line[3] >= '0' && line[3] <= '9') {
+            ++stat_values.second;
+        } else if (line.starts_with("ctxt "sv)) {
+            parse_number(line.substr(5), stat_values.first);
+            break;
+        }
+    }
+    return stat_values;
+}
+
+auto parse_scx_events(std::string_view content) noexcept -> std::vector<std::pair<std::string, std::uint64_t>> {
+    std::vector<std::pair<std::string, std::uint64_t>> events{};
+    for (auto&& line : utils::make_multiline_view(content, '\n')) {
+        // names and values are padded with spaces
+        std::string_view name{};
+        std::uint64_t value{};
+        bool has_value{};
+        for (auto&& field : utils::make_multiline_view(line, ' ')) {
+            if (field.empty()) {
+                continue;
+            }
+            if (name.empty()) {
+                name = field;
+            } else {
+                has_value = parse_number(field, value);
+                break;
+            }
+        }
+        if (has_value) {
+            events.emplace_back(std::string{name}, value);
+        }
+    }
+    return events;
+}
+
+auto compute_sched_metrics(const SchedSnapshot& prev, const SchedSnapshot& cur) noexcept -> SchedMetrics {
+    SchedMetrics metrics{};
+
+    const auto interval = std::chrono::duration<double>(cur.time - prev.time).count();
+    /* clang-format off */
+    if (interval <= 0.0) { return metrics; }
+    /* clang-format on */
+
+    // Both samples must have counted, otherwise the delta is meaningless
+    metrics.has_cpu_ctx_switch_rate = prev.is_schedstats_enabled && cur.is_schedstats_enabled;
+
+    metrics.cpus.reserve(cur.cpus.size());
+    for (auto&& cur_cpu : cur.cpus) {
+        const auto prev_cpu = std::ranges::find_if(prev.cpus, [&](auto&& cpu) { return cpu.cpu == cur_cpu.cpu; });
+        /* clang-format off */
+        if (prev_cpu == prev.cpus.end()) { continue; }
+        /* clang-format on */
+
+        const auto timeslices  = counter_delta(prev_cpu->timeslices, cur_cpu.timeslices);
+        const auto run_delay   = counter_delta(prev_cpu->run_delay_ns, cur_cpu.run_delay_ns);
+        const auto sched_count = counter_delta(prev_cpu->sched_count, cur_cpu.sched_count);
+
+        CpuSchedMetrics cpu_metrics{.cpu = cur_cpu.cpu};
+        if (timeslices > 0) {
+            cpu_metrics.run_delay_us = (static_cast<double>(run_delay) / static_cast<double>(timeslices)) / 1000.0;
+        }
+        if (metrics.has_cpu_ctx_switch_rate) {
+            cpu_metrics.ctx_switch_rate = static_cast<double>(sched_count) / interval;
+        }
+
+        metrics.avg_run_delay_us += cpu_metrics.run_delay_us;
+        metrics.avg_ctx_switch_rate += cpu_metrics.ctx_switch_rate;
+        metrics.cpus.emplace_back(cpu_metrics);
+    }
+    if (!metrics.cpus.empty()) {
+        metrics.avg_run_delay_us /= static_cast<double>(metrics.cpus.size());
+        metrics.avg_ctx_switch_rate /= static_cast<double>(metrics.cpus.size());
+    }
+    if (!metrics.has_cpu_ctx_switch_rate && cur.online_cpus > 0) {
+        const auto ctxt             = counter_delta(prev.ctxt, cur.ctxt);
+        metrics.avg_ctx_switch_rate = static_cast<double>(ctxt) / interval / static_cast<double>(cur.online_cpus);
+    }
+
+    // total is in us, so the stall share of the interval is in percents
+    const auto psi_stall_us = counter_delta(prev.psi_some_total_us, cur.psi_some_total_us);
+    metrics.psi_some_pct    = (static_cast<double>(psi_stall_us) / 1e6) / interval * 100.0;
+
+    for (auto&& [name, value] : cur.scx_events) {
+        const auto prev_event = std::ranges::find_if(prev.scx_events, [&](auto&& event) { return event.first == name; });
+        const auto prev_value  = (prev_event != prev.scx_events.end()) ? prev_event->second : 0;
+        metrics.scx_events_delta.emplace_back(name, counter_delta(prev_value, value));
+    }
+    return metrics;
+}
@@ -0,0 +1,124 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef SCHED_STATS_HPP
+#define SCHED_STATS_HPP
+
+#include <chrono>       // for steady_clock
+#include <cstdint>      // for uint64_t, uint32_t, int32_t
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <utility>      // for pair
+#include <vector>       // for vector
+
+/// Counters of a single CPU from /proc/schedstat.
+struct CpuSchedCounters final {
+    std::int32_t cpu{-1};
+    // calls of schedule(), each one is a potential context switch
+    std::uint64_t sched_count{};
+    // time spent by tasks waiting on the run queue, in ns
+    std::uint64_t run_delay_ns{};
+    // timeslices run on this CPU
+    std::uint64_t timeslices{};
+};
+
+/// Raw counters at a point of time. Metrics are computed from two snapshots.
+struct SchedSnapshot final {
+    std::chrono::steady_clock::time_point time{};
+    std::vector<CpuSchedCounters> cpus{};
+    // "some" line of /proc/pressure/cpu
+    double psi_some_avg10{};
+    std::uint64_t psi_some_total_us{};
+    // counters of the running sched_ext scheduler (/sys/kernel/sched_ext/root/events)
+    std::vector<std::pair<std::string, std::uint64_t>> scx_events{};
+    // context switches of all CPUs, "ctxt" line of /proc/stat, and the number of online CPUs there
+    std::uint64_t ctxt{};
+    std::uint32_t online_cpus{};
+    // sched_count of /proc/schedstat stays 0, unless kernel.sched_schedstats=1
+    bool is_schedstats_enabled{};
+};
+
+struct CpuSchedMetrics final {
+    std::int32_t cpu{-1};
+    // average wait on the run queue per timeslice
+    double run_delay_us{};
+    double ctx_switch_rate{};
+};
+
+/// Rates over the interval between two snapshots.
+struct SchedMetrics final {
+    std::vector<CpuSchedMetrics> cpus{};
+    // share of the interval, during which some tasks were stalled on CPU
+    double psi_some_pct{};
+    std::vector<std::pair<std::string, std::uint64_t>> scx_events_delta{};
+
+    // Averages over all CPUs
+    double avg_run_delay_us{};
+    double avg_ctx_switch_rate{};
+    // Per-CPU rates are known only with schedstats enabled, the average is taken from /proc/stat otherwise
+    bool has_cpu_ctx_switch_rate{};
+};
+
+/// Samples scheduler counters. The files are opened once and reread with pread,
+/// so a sample costs a few syscalls.
+class SchedStatsSampler final {
+ public:
+    SchedStatsSampler() noexcept;
+    ~SchedStatsSampler() noexcept;
+
+    SchedStatsSampler(const SchedStatsSampler&)            = delete;
+    SchedStatsSampler& operator=(const SchedStatsSampler&) = delete;
+
+    /// @brief Read the current counters.
+    /// Missing sources (e.g kernel without CONFIG_SCHEDSTATS or PSI) leave its fields empty.
+    auto sample() noexcept -> SchedSnapshot;
+
+    /* clang-format off */
+    bool has_schedstat() const noexcept
+    { return m_schedstat_fd != -1; }
+
+    bool has_psi() const noexcept
+    { return m_psi_fd != -1; }
+    /* clang-format on */
+
+ private:
+    std::int32_t m_schedstat_fd{-1};
+    std::int32_t m_psi_fd{-1};
+    std::int32_t m_proc_stat_fd{-1};
+    std::int32_t m_schedstats_sysctl_fd{-1};
+    std::string m_buf{};
+};
+
+/// @brief Parse cpu lines of /proc/schedstat (version 15 and newer).
+auto parse_schedstat(std::string_view content) noexcept -> std::vector<CpuSchedCounters>;
+
+/// @brief Parse "some" line of /proc/pressure/cpu.
+/// @return avg10 and total.
+auto parse_psi_some(std::string_view content) noexcept -> std::pair<double, std::uint64_t>;
+
+/// @brief Parse "ctxt" and "cpuN" lines of /proc/stat.
+/// @return Context switches since the boot and the number of online CPUs, zeros if the lines are missing.
+auto parse_proc_stat(std::string_view content) noexcept -> std::pair<std::uint64_t, std::uint32_t>;
+
+/// @brief Parse "name value" lines of the sched_ext events.
+auto parse_scx_events(std::string_view content) noexcept -> std::vector<std::pair<std::string, std::uint64_t>>;
+
+/// @brief Compute metrics over the interval between the snapshots.
+auto compute_sched_metrics(const SchedSnapshot& prev, const SchedSnapshot& cur) noexcept -> SchedMetrics;
+
+#endif  // SCHED_STATS_HPP
@@ -21,7 +21,9 @@
 #include "schedext-window.hpp"
 #include "utils.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <string>
 #include <string_view>
 
@@ -38,8 +40,13 @@
 #pragma GCC diagnostic ignored "-Wconversion"
 #endif
 
-#include <QProcess>
+#include <QDateTime>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QStatusBar>
 #include <QStringList>
+#include <QTableWidgetItem>
+#include <QtConcurrent/QtConcurrent>
 
 #if defined(__clang__)
 #pragma clang diagnostic pop
@@ -51,156 +58,468 @@
 #include <fmt/core.h>
 
 namespace {
-auto read_kernel_file(std::string_view file_path) noexcept -> std::string {
-    std::string file_content{};
 
-    // Skip if failed to open file descriptor.
-    std::ifstream file_stream{std::string{file_path}};
-    if (!file_stream.is_open()) {
-        return {};
-    }
-    if (!std::getline(file_stream, file_content)) {
-        fmt::print(stderr, "Failed to read := '{}'\n", file_path);
-        return {};
-    }
+using namespace std::chrono_literals;  // NOLINT
+using namespace std::string_view_literals;
+
+static constexpr auto SCHED_STATS_INTERVAL = 1s;
+// The benchmark thread checks, if the window is closing, while waiting for the helper
+static constexpr auto HELPER_WAIT_INTERVAL = 100ms;
+// Baseline is averaged over the last snapshots, a single second is too noisy to compare
+static constexpr std::size_t SCHED_STATS_WINDOW = 10;
+
+namespace BenchCol {
+enum { Scheduler,
+    Flags,
+    P50Wakeup,
+    P99Wakeup,
+    Throughput,
+    RelativeThroughput };
+}
 
-    return file_content;
+namespace StatsCol {
+enum { Cpu,
+    RunDelay,
+    BaselineRunDelay,
+    CtxSwitchRate,
+    BaselineCtxSwitchRate };
 }
 
-auto get_current_scheduler() noexcept -> std::string {
-    using namespace std::string_view_literals;
+auto is_scx_service_active() noexcept -> bool {
+    return utils::exec_argv({"systemctl", "is-active", "--quiet", "scx"}).is_success();
+}
 
-    // NOTE: we assume that window won't be launched on kernel without sched_ext
-    // e.g we won't show window at all in that case.
-    const auto& current_state = read_kernel_file("/sys/kernel/sched_ext/state"sv);
-    if (current_state != "enabled"sv) {
-        return current_state;
-    }
-    const auto& current_sched = read_kernel_file("/sys/kernel/sched_ext/root/ops"sv);
-    if (current_sched.empty()) {
-        return std::string{"unknown"sv};
+// Ops name is the scheduler name without the prefix and with the version (e.g lavd_1.0.5)
+auto find_installed_scheduler(std::string_view ops_name) noexcept -> std::string {
+    std::string found_sched{};
+    /* clang-format off */
+    if (ops_name.empty()) { return found_sched; }
+    /* clang-format on */
+    for (auto&& scheduler : scx::get_installed_schedulers()) {
+        // the longest match wins, e.g rustland over rusty
+        if (ops_name.starts_with(std::string_view{scheduler}.substr(4)) && scheduler.size() > found_sched.size()) {
+            found_sched = scheduler;
+        }
     }
-    return current_sched;
+    return found_sched;
 }
 
-auto is_scx_service_enabled() noexcept -> bool {
-    using namespace std::string_view_literals;
-    return utils::exec("systemctl is-enabled scx"sv) == "enabled"sv;
+auto format_sched_transition(const SchedTransition& transition) noexcept -> QString {
+    const auto& time = QDateTime::fromSecsSinceEpoch(std::chrono::system_clock::to_time_t(transition.time));
+    return QStringLiteral("%1  %2 -> %3").arg(time.toString(Qt::ISODate), QString::fromStdString(transition.from), QString::fromStdString(transition.to));
 }
 
-auto is_scx_service_active() noexcept -> bool {
-    using namespace std::string_view_literals;
-    return utils::exec("systemctl is-active scx"sv) == "active"sv;
+inline auto format_metric(double value) noexcept -> QString {
+    return QString::number(value, 'f', 1);
+}
+
+// latency is negative, if the workload doesn't report it
+inline auto format_latency(double value) noexcept -> QString {
+    return (value < 0.0) ? QStringLiteral("-") : format_metric(value);
+}
+
+inline auto format_candidate(const BenchCandidate& candidate) noexcept -> QString {
+    return QString::fromStdString(candidate.flags.empty() ? candidate.scheduler : fmt::format("{} {}", candidate.scheduler, candidate.flags));
+}
+
+void set_table_text(QTableWidget* table, std::int32_t row, std::int32_t column, const QString& text) noexcept {
+    auto* item = table->item(row, column);
+    if (item == nullptr) {
+        item = new QTableWidgetItem();
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        table->setItem(row, column, item);
+    }
+    item->setText(text);
 }
 }  // namespace
 
 SchedExtWindow::SchedExtWindow(QWidget* parent)
-  : QMainWindow(parent), m_sched_timer(new QTimer(this)) {
+  : QMainWindow(parent), m_sched_monitor(new SchedExtMonitor(this)), m_stats_timer(new QTimer(this)),
+    m_scx_helper(new ScxHelperClient(this)) {
     m_ui->setupUi(this);
 
     setAttribute(Qt::WA_NativeWindow);
     setWindowFlags(Qt::Window);  // for the close, min and max buttons
 
-    // Selecting the scheduler
+    // Selecting the scheduler, from the installed ones
     QStringList sched_names;
-    sched_names << "scx_bpfland"
-                << "scx_central"
-                << "scx_lavd"
-                << "scx_layered"
-                << "scx_nest"
-                << "scx_qmap"
-                << "scx_rlfifo"
-                << "scx_rustland"
-                << "scx_rusty"
-                << "scx_simple"
-                << "scx_userland";
+    for (auto&& scheduler : scx::get_installed_schedulers()) {
+        sched_names << QString::fromStdString(scheduler);
+    }
     m_ui->schedext_combo_box->addItems(sched_names);
+    if (sched_names.isEmpty()) {
+        m_ui->schedext_combo_box->setPlaceholderText(tr("No sched-ext schedulers installed"));
+    }
 
-    m_ui->current_sched_label->setText(QString::fromStdString(get_current_scheduler()));
-
-    // setup timer
-    using namespace std::chrono_literals;  // NOLINT
-
-    connect(m_sched_timer, &QTimer::timeout, this, &SchedExtWindow::update_current_sched);
-    m_sched_timer->start(1s);
+    // The monitor runs only while the window is shown, see showEvent/hideEvent
+    connect(m_sched_monitor, &SchedExtMonitor::scheduler_changed, this, &SchedExtWindow::add_sched_transition);
+
+    connect(m_stats_timer, &QTimer::timeout, this, &SchedExtWindow::update_sched_stats);
+    connect(m_ui->pin_baseline_button, &QPushButton::clicked, this, &SchedExtWindow::on_pin_baseline);
+    connect(m_ui->clear_baseline_button, &QPushButton::clicked, this, &SchedExtWindow::on_clear_baseline);
+    m_ui->pin_baseline_button->setEnabled(false);
+    m_ui->clear_baseline_button->setEnabled(false);
+
+    connect(m_ui->bench_add_button, &QPushButton::clicked, this, &SchedExtWindow::on_bench_add);
+    connect(m_ui->bench_remove_button, &QPushButton::clicked, this, &SchedExtWindow::on_bench_remove);
+    connect(m_ui->bench_run_button, &QPushButton::clicked, this, &SchedExtWindow::on_bench_run);
+    connect(m_ui->bench_cancel_button, &QPushButton::clicked, this, &SchedExtWindow::on_bench_cancel);
+    connect(m_ui->bench_export_button, &QPushButton::clicked, this, &SchedExtWindow::on_bench_export);
+    connect(&m_bench_watcher, &QFutureWatcher<std::vector<BenchResult>>::finished, this, &SchedExtWindow::on_bench_finished);
+    connect(m_ui->bench_workload_combo, &QComboBox::currentIndexChanged, this, [this](int index) {
+        m_ui->bench_command_edit->setEnabled(static_cast<BenchWorkload>(index) == BenchWorkload::Custom);
+    });
+    update_bench_buttons();
 
     // Connect buttons signal
     connect(m_ui->apply_button, &QPushButton::clicked, this, &SchedExtWindow::on_apply);
     connect(m_ui->disable_button, &QPushButton::clicked, this, &SchedExtWindow::on_disable);
 }
 
+SchedExtWindow::~SchedExtWindow() {
+    // the benchmark thread posts progress to the window
+    m_is_closing.store(true, std::memory_order_relaxed);
+    if (m_bench_cancelled) {
+        m_bench_cancelled->store(true, std::memory_order_relaxed);
+    }
+    m_bench_watcher.waitForFinished();
+}
+
 void SchedExtWindow::closeEvent(QCloseEvent* event) {
     QWidget::closeEvent(event);
 }
 
+void SchedExtWindow::showEvent(QShowEvent* event) {
+    QMainWindow::showEvent(event);
+    m_sched_monitor->start();
+    update_current_sched();
+
+    m_stats_sampler = std::make_unique<SchedStatsSampler>();
+    update_sched_stats();
+    m_stats_timer->start(SCHED_STATS_INTERVAL);
+}
+
+void SchedExtWindow::hideEvent(QHideEvent* event) {
+    m_sched_monitor->stop();
+
+    // counters would have a gap, start over when shown again
+    m_stats_timer->stop();
+    m_stats_sampler.reset();
+    m_stats_snapshots.clear();
+    QMainWindow::hideEvent(event);
+}
+
 void SchedExtWindow::update_current_sched() noexcept {
-    m_ui->current_sched_label->setText(QString::fromStdString(get_current_scheduler()));
+    m_ui->current_sched_label->setText(QString::fromStdString(m_sched_monitor->get_current_scheduler()));
 }
 
-void SchedExtWindow::on_disable() noexcept {
-    m_ui->disable_button->setEnabled(false);
-    m_ui->apply_button->setEnabled(false);
+void SchedExtWindow::add_sched_transition(const SchedTransition& transition) noexcept {
+    update_current_sched();
+    /* clang-format off */
+    if (transition.from.empty()) { return; }
+    /* clang-format on */
 
-    using namespace std::string_view_literals;
-    // TODO(vnepogodin): refactor that
-    if (is_scx_service_enabled()) {
-        QProcess::startDetached("/usr/bin/pkexec", {"/usr/bin/systemctl", "disable", "--now", "scx"});
-        fmt::print("Disabling scx\n");
-    } else if (is_scx_service_active()) {
-        QProcess::startDetached("/usr/bin/pkexec", {"/usr/bin/systemctl", "stop", "scx"});
-        fmt::print("Stoping scx\n");
+    // keep the list in sync with the capped history of the monitor
+    m_ui->sched_history_list->addItem(format_sched_transition(transition));
+    while (static_cast<std::size_t>(m_ui->sched_history_list->count()) > SchedExtMonitor::MAX_HISTORY_SIZE) {
+        delete m_ui->sched_history_list->takeItem(0);
     }
-
-    m_ui->disable_button->setEnabled(true);
-    m_ui->apply_button->setEnabled(true);
+    m_ui->sched_history_list->scrollToBottom();
 }
 
-void SchedExtWindow::on_apply() noexcept {
-    m_ui->disable_button->setEnabled(false);
-    m_ui->apply_button->setEnabled(false);
+void SchedExtWindow::update_sched_stats() noexcept {
+    /* clang-format off */
+    if (!m_stats_sampler) { return; }
+    /* clang-format on */
 
-    const auto service_cmd = []() -> std::string_view {
-        using namespace std::string_view_literals;
-        if (!is_scx_service_enabled()) {
-            return "enable --now"sv;
+    if (m_stats_snapshots.size() > SCHED_STATS_WINDOW) {
+        m_stats_snapshots.pop_front();
+    }
+    m_stats_snapshots.emplace_back(m_stats_sampler->sample());
+    m_ui->pin_baseline_button->setEnabled(m_stats_snapshots.size() > SCHED_STATS_WINDOW);
+
+    if (!m_stats_sampler->has_schedstat()) {
+        m_ui->sched_stats_summary_label->setText(tr("/proc/schedstat is unavailable (kernel without CONFIG_SCHEDSTATS?)"));
+    }
+    /* clang-format off */
+    if (m_stats_snapshots.size() < 2) { return; }
+    /* clang-format on */
+
+    const auto& live_metrics = compute_sched_metrics(*(m_stats_snapshots.end() - 2), m_stats_snapshots.back());
+
+    auto* table = m_ui->sched_stats_table;
+    table->setRowCount(static_cast<std::int32_t>(live_metrics.cpus.size()));
+    for (std::int32_t row{}; auto&& cpu_metrics : live_metrics.cpus) {
+        set_table_text(table, row, StatsCol::Cpu, QString::number(cpu_metrics.cpu));
+        set_table_text(table, row, StatsCol::RunDelay, format_metric(cpu_metrics.run_delay_us));
+        set_table_text(table, row, StatsCol::CtxSwitchRate, live_metrics.has_cpu_ctx_switch_rate ? format_metric(cpu_metrics.ctx_switch_rate) : tr("n/a"));
+
+        QString baseline_run_delay{};
+        QString baseline_ctx_switch_rate{};
+        if (m_stats_baseline) {
+            const auto& baseline_cpus = m_stats_baseline->cpus;
+            const auto baseline_cpu   = std::ranges::find_if(baseline_cpus, [&](auto&& cpu) { return cpu.cpu == cpu_metrics.cpu; });
+            if (baseline_cpu != baseline_cpus.end()) {
+                baseline_run_delay       = format_metric(baseline_cpu->run_delay_us);
+                baseline_ctx_switch_rate = m_stats_baseline->has_cpu_ctx_switch_rate ? format_metric(baseline_cpu->ctx_switch_rate) : tr("n/a");
+            }
         }
-        return "restart"sv;
-    }();
-
-    static constexpr auto is_flags_commented = []() -> bool {
-        using namespace std::string_view_literals;
-        static constexpr auto scx_conf_path = "/etc/default/scx"sv;
-        const auto& scx_conf_content        = utils::read_whole_file(scx_conf_path);
-        return scx_conf_content.find("#SCX_FLAGS="sv) != std::string::npos;
+        set_table_text(table, row, StatsCol::BaselineRunDelay, baseline_run_delay);
+        set_table_text(table, row, StatsCol::BaselineCtxSwitchRate, baseline_ctx_switch_rate);
+        ++row;
+    }
+
+    auto summary = tr("Average run delay: %1 us, context switches: %2/s per CPU, CPU pressure: %3% (avg10 %4%)")
+                       .arg(format_metric(live_metrics.avg_run_delay_us), format_metric(live_metrics.avg_ctx_switch_rate),
+                           format_metric(live_metrics.psi_some_pct), format_metric(m_stats_snapshots.back().psi_some_avg10));
+    if (m_stats_baseline) {
+        summary += u'\n' + tr("Baseline: %1 us, %2/s per CPU, CPU pressure: %3%")
+                       .arg(format_metric(m_stats_baseline->avg_run_delay_us), format_metric(m_stats_baseline->avg_ctx_switch_rate),
+                           format_metric(m_stats_baseline->psi_some_pct));
+    }
+    if (!live_metrics.has_cpu_ctx_switch_rate) {
+        summary += u'\n' + tr("Per-CPU context switches need kernel.sched_schedstats=1, the average is taken from /proc/stat");
+    }
+    for (auto&& [event_name, event_delta] : live_metrics.scx_events_delta) {
+        /* clang-format off */
+        if (event_delta == 0) { continue; }
+        /* clang-format on */
+        summary += QStringLiteral("\n%1: +%2").arg(QString::fromStdString(event_name)).arg(event_delta);
+    }
+    m_ui->sched_stats_summary_label->setText(summary);
+}
+
+void SchedExtWindow::on_pin_baseline() noexcept {
+    /* clang-format off */
+    if (m_stats_snapshots.size() < 2) { return; }
+    /* clang-format on */
+
+    m_stats_baseline       = compute_sched_metrics(m_stats_snapshots.front(), m_stats_snapshots.back());
+    m_stats_baseline_sched = m_sched_monitor->get_current_scheduler();
+
+    const auto& pinned_time = QDateTime::currentDateTime().toString(Qt::ISODate);
+    m_ui->sched_baseline_label->setText(tr("Baseline: %1, pinned at %2").arg(QString::fromStdString(m_stats_baseline_sched), pinned_time));
+    m_ui->clear_baseline_button->setEnabled(true);
+}
+
+void SchedExtWindow::on_clear_baseline() noexcept {
+    m_stats_baseline.reset();
+    m_stats_baseline_sched.clear();
+
+    m_ui->sched_baseline_label->setText(tr("No baseline pinned"));
+    m_ui->clear_baseline_button->setEnabled(false);
+}
+
+void SchedExtWindow::on_bench_add() noexcept {
+    BenchCandidate candidate{
+        .scheduler = m_ui->schedext_combo_box->currentText().toStdString(),
+        .flags     = m_ui->schedext_flags_edit->text().trimmed().toStdString(),
     };
-    static constexpr auto get_scx_flags_sed = [](std::string_view sched_flags_text, bool flags_commented) -> std::string {
-        using namespace std::string_literals;
-        if (sched_flags_text.empty() && !flags_commented) {
-            // comment out flags in scx
-            return "-e 's/SCX_FLAGS=/#SCX_FLAGS=/'"s;
-        } else if (!sched_flags_text.empty() && flags_commented) {
-            // set flags in scx
-            return fmt::format(R"(-e "s/.*SCX_FLAGS=.*/SCX_FLAGS='{}'/")", sched_flags_text);
-        } else if (!sched_flags_text.empty() && !flags_commented) {
-            // set flags in scx
-            return fmt::format(R"(-e "s/SCX_FLAGS=.*/SCX_FLAGS='{}'/")", sched_flags_text);
-        }
-        return ""s;
+    m_ui->bench_candidates_list->addItem(format_candidate(candidate));
+    m_bench_candidates.emplace_back(std::move(candidate));
+    update_bench_buttons();
+}
+
+void SchedExtWindow::on_bench_remove() noexcept {
+    const auto row = m_ui->bench_candidates_list->currentRow();
+    /* clang-format off */
+    if (row < 0 || static_cast<std::size_t>(row) >= m_bench_candidates.size()) { return; }
+    /* clang-format on */
+    delete m_ui->bench_candidates_list->takeItem(row);
+    m_bench_candidates.erase(m_bench_candidates.begin() + row);
+    update_bench_buttons();
+}
+
+void SchedExtWindow::on_bench_run() noexcept {
+    /* clang-format off */
+    if (m_bench_watcher.isRunning() || m_bench_candidates.empty()) { return; }
+    /* clang-format on */
+
+    BenchConfig config{
+        .candidates     = m_bench_candidates,
+        .workload       = static_cast<BenchWorkload>(m_ui->bench_workload_combo->currentIndex()),
+        .custom_command = m_ui->bench_command_edit->text().trimmed().toStdString(),
+        .iterations     = static_cast<std::uint32_t>(m_ui->bench_iterations_spin->value()),
     };
+    if (config.workload == BenchWorkload::Custom && config.custom_command.empty()) {
+        QMessageBox::warning(this, "CachyOS Kernel Manager", tr("Enter the command to benchmark"));
+        return;
+    }
 
-    const bool flags_commented = is_flags_commented();
+    // scheduler is switched back after the benchmark
+    const bool was_service_active = is_scx_service_active();
+    const auto& original_sched    = find_installed_scheduler(scx::get_running_scheduler());
+
+    m_bench_cancelled = std::make_shared<std::atomic_bool>(false);
+    m_bench_results.clear();
+    m_ui->bench_results_table->setRowCount(0);
+
+    m_bench_watcher.setFuture(QtConcurrent::run([this, config = std::move(config), is_cancelled = m_bench_cancelled, original_sched, was_service_active] {
+        const auto& on_progress = [this](std::string_view message) {
+            QMetaObject::invokeMethod(this, [this, status = QString::fromUtf8(message.data(), static_cast<qsizetype>(message.size()))] {
+                m_ui->bench_status_label->setText(status);
+            }, Qt::QueuedConnection);
+        };
+        const auto& switch_scheduler = [this](const BenchCandidate& candidate) {
+            const auto& response = call_scx_helper_blocking({.command = scx::HelperCommand::Switch, .scheduler = candidate.scheduler, .flags = scx::split_flags(candidate.flags)});
+            if (!response.is_success) {
+                fmt::print(stderr, "[BENCH] failed to switch to {}: {}\n", candidate.scheduler, response.message);
+            }
+            return response.is_success;
+        };
+        auto results = run_sched_bench(config, switch_scheduler, on_progress, *is_cancelled);
+
+        // flags of the scheduler, which wasn't started by the service, are unknown
+        on_progress("Restoring the scheduler");
+        scx::HelperRequest restore_request{.command = scx::HelperCommand::Stop};
+        if (was_service_active) {
+            restore_request.command = scx::HelperCommand::StartService;
+        } else if (!original_sched.empty()) {
+            restore_request = {.command = scx::HelperCommand::Switch, .scheduler = original_sched};
+        }
+        if (const auto& response = call_scx_helper_blocking(restore_request); !response.is_success) {
+            fmt::print(stderr, "[BENCH] failed to restore the scheduler: {}\n", response.message);
+        }
+        return results;
+    }));
+    update_bench_buttons();
+}
 
-    // TODO(vnepogodin): refactor that
-    const auto& sched_flags_text = m_ui->schedext_flags_edit->text().trimmed().toStdString();
-    const auto& scx_flags_sed    = get_scx_flags_sed(sched_flags_text, flags_commented);
+void SchedExtWindow::on_bench_cancel() noexcept {
+    /* clang-format off */
+    if (!m_bench_cancelled) { return; }
+    /* clang-format on */
+    m_bench_cancelled->store(true, std::memory_order_relaxed);
+    m_ui->bench_status_label->setText(tr("Cancelling after the current run..."));
+}
 
-    const auto& current_selected = m_ui->schedext_combo_box->currentText().toStdString();
-    const auto& sed_cmd          = fmt::format("sed -e 's/SCX_SCHEDULER=.*/SCX_SCHEDULER={}/' {} -i /etc/default/scx && systemctl {} scx", current_selected, scx_flags_sed, service_cmd);
-    QProcess::startDetached("/usr/bin/pkexec", {"/usr/bin/bash", "-c", QString::fromStdString(sed_cmd)});
-    fmt::print("Applying scx {}\n", current_selected);
+void SchedExtWindow::on_bench_finished() noexcept {
+    m_bench_results = m_bench_watcher.result();
+
+    // throughput is compared to the first scheduler, which has finished the runs
+    const auto first_result = std::ranges::find_if(m_bench_results, [](auto&& result) { return !result.samples.empty(); });
+    const auto& reference   = (first_result != m_bench_results.end()) ? summarize_bench_samples(first_result->samples) : BenchSample{};
+
+    auto* table = m_ui->bench_results_table;
+    table->setRowCount(static_cast<std::int32_t>(m_bench_results.size()));
+    for (std::int32_t row{}; auto&& result : m_bench_results) {
+        const auto& summary = summarize_bench_samples(result.samples);
+        set_table_text(table, row, BenchCol::Scheduler, QString::fromStdString(result.candidate.scheduler));
+        set_table_text(table, row, BenchCol::Flags, QString::fromStdString(result.candidate.flags));
+        if (result.samples.empty()) {
+            set_table_text(table, row, BenchCol::P50Wakeup, {});
+            set_table_text(table, row, BenchCol::P99Wakeup, {});
+            set_table_text(table, row, BenchCol::Throughput, {});
+            set_table_text(table, row, BenchCol::RelativeThroughput, QString::fromStdString(result.error));
+            ++row;
+            continue;
+        }
+        set_table_text(table, row, BenchCol::P50Wakeup, format_latency(summary.p50_wakeup_us));
+        set_table_text(table, row, BenchCol::P99Wakeup, format_latency(summary.p99_wakeup_us));
+        set_table_text(table, row, BenchCol::Throughput, format_metric(summary.throughput));
+
+        auto relative_throughput = (reference.throughput > 0.0) ? QStringLiteral("%1%").arg(format_metric(summary.throughput / reference.throughput * 100.0)) : QString{};
+        if (!result.error.empty()) {
+            relative_throughput += QStringLiteral(" (%1)").arg(QString::fromStdString(result.error));
+        }
+        set_table_text(table, row, BenchCol::RelativeThroughput, relative_throughput);
+        ++row;
+    }
+
+    m_ui->bench_status_label->setText(m_bench_cancelled->load(std::memory_order_relaxed) ? tr("Benchmark cancelled") : tr("Benchmark finished"));
+    update_bench_buttons();
+}
+
+void SchedExtWindow::on_bench_export() noexcept {
+    auto save_file_path = QFileDialog::getSaveFileName(
+        this,
+        tr("Save file as"),
+        QString::fromStdString(utils::fix_path("~/scx-benchmark.csv")),
+        tr("CSV file (*.csv)"))
+                              .toStdString();
+    /* clang-format off */
+    if (save_file_path.empty()) { return; }
+    /* clang-format on */
+
+    if (!utils::write_to_file(save_file_path, format_bench_csv(m_bench_results))) {
+        QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to save benchmark results to file: %1").arg(QString::fromStdString(save_file_path)));
+    }
+}
+
+void SchedExtWindow::update_bench_buttons() noexcept {
+    const bool is_running = m_bench_watcher.isRunning();
+    m_ui->bench_run_button->setEnabled(!is_running && !m_bench_candidates.empty());
+    m_ui->bench_cancel_button->setEnabled(is_running);
+    m_ui->bench_export_button->setEnabled(!is_running && !m_bench_results.empty());
+    m_ui->bench_add_button->setEnabled(!is_running);
+    m_ui->bench_remove_button->setEnabled(!is_running);
+    // switching the scheduler by hand would break the results
+    m_ui->apply_button->setEnabled(!is_running);
+    m_ui->disable_button->setEnabled(!is_running);
+}
+
+auto SchedExtWindow::call_scx_helper_blocking(const scx::HelperRequest& request) noexcept -> scx::HelperResponse {
+    auto promise  = std::make_shared<std::promise<scx::HelperResponse>>();
+    auto response = promise->get_future();
+    QMetaObject::invokeMethod(this, [this, request, promise] {
+        m_scx_helper->send(request, [promise](const scx::HelperResponse& helper_response) { promise->set_value(helper_response); });
+    }, Qt::QueuedConnection);
+
+    // GUI thread waits for us in the destructor, and can't deliver the response anymore
+    while (response.wait_for(HELPER_WAIT_INTERVAL) != std::future_status::ready) {
+        if (m_is_closing.load(std::memory_order_relaxed)) {
+            return scx::HelperResponse{.is_success = false, .message = "window is closing"};
+        }
+    }
+    return response.get();
+}
 
+void SchedExtWindow::on_helper_response(const scx::HelperResponse& response) noexcept {
+    if (response.is_success) {
+        statusBar()->showMessage(QString::fromStdString(response.message));
+    } else {
+        QMessageBox::critical(this, "CachyOS Kernel Manager", tr("Failed to configure sched-ext: %1").arg(QString::fromStdString(response.message)));
+    }
+    /* clang-format off */
+    if (m_scx_helper->has_pending_requests()) { return; }
+    /* clang-format on */
     m_ui->disable_button->setEnabled(true);
     m_ui->apply_button->setEnabled(true);
+    update_bench_buttons();
+}
+
+void SchedExtWindow::on_disable() noexcept {
+    m_ui->disable_button->setEnabled(false);
+    m_ui->apply_button->setEnabled(false);
+
+    fmt::print("Disabling scx\n");
+    m_scx_helper->send({.command = scx::HelperCommand::Disable}, [this](auto&& response) { on_helper_response(response); });
+}
+
+void SchedExtWindow::on_apply() noexcept {
+    const auto& current_selected = m_ui->schedext_combo_box->currentText().toStdString();
+    /* clang-format off */
+    if (current_selected.empty()) { return; }
+    /* clang-format on */
+
+    m_ui->disable_button->setEnabled(false);
+    m_ui->apply_button->setEnabled(false);
+
+    // switch right away, and make it default for the next boot only if it has attached
+    scx::HelperRequest request{
+        .command   = scx::HelperCommand::Switch,
+        .scheduler = current_selected,
+        .flags     = scx::split_flags(m_ui->schedext_flags_edit->text().trimmed().toStdString()),
+    };
+    fmt::print("Applying scx {}\n", current_selected);
+    m_scx_helper->send(request, [this, request](const scx::HelperResponse& response) mutable {
+        if (!response.is_success) {
+            on_helper_response(response);
+            return;
+        }
+        request.command = scx::HelperCommand::Persist;
+        m_scx_helper->send(request, [this](auto&& persist_response) { on_helper_response(persist_response); });
+    });
 }
 
 // NOLINTEND(bugprone-unhandled-exception-at-new)
@@ -19,6 +19,11 @@
 #ifndef SCHEDEXT_WINDOW_HPP_
 #define SCHEDEXT_WINDOW_HPP_
 
+#include "sched_bench.hpp"
+#include "sched_stats.hpp"
+#include "schedext_monitor.hpp"
+#include "scx_helper_client.hpp"
+
 #if defined(__clang__)
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wsign-conversion"
@@ -39,11 +44,15 @@
 
 #include <ui_schedext-window.h>
 
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include <QFutureWatcher>
 #include <QMainWindow>
 #include <QTimer>
 
@@ -58,10 +67,12 @@ class SchedExtWindow final : public QMainWindow {
     Q_DISABLE_COPY_MOVE(SchedExtWindow)
  public:
     explicit SchedExtWindow(QWidget* parent = nullptr);
-    ~SchedExtWindow() = default;
+    ~SchedExtWindow() override;
 
  protected:
     void closeEvent(QCloseEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
 
  private:
     void on_apply() noexcept;
@@ -69,9 +80,43 @@ class SchedExtWindow final : public QMainWindow {
 
     std::vector<std::string> m_previously_set_options{};
     std::unique_ptr<Ui::SchedExtWindow> m_ui = std::make_unique<Ui::SchedExtWindow>();
-    QTimer* m_sched_timer                    = nullptr;
+    SchedExtMonitor* m_sched_monitor         = nullptr;
+
+    // Metrics pane, sampled only while the window is shown
+    QTimer* m_stats_timer = nullptr;
+    std::unique_ptr<SchedStatsSampler> m_stats_sampler{};
+    std::deque<SchedSnapshot> m_stats_snapshots{};
+    std::optional<SchedMetrics> m_stats_baseline{};
+    std::string m_stats_baseline_sched{};
 
     void update_current_sched() noexcept;
+    void add_sched_transition(const SchedTransition& transition) noexcept;
+
+    void update_sched_stats() noexcept;
+    void on_pin_baseline() noexcept;
+    void on_clear_baseline() noexcept;
+
+    // A/B benchmark of the schedulers
+    QFutureWatcher<std::vector<BenchResult>> m_bench_watcher{};
+    std::shared_ptr<std::atomic_bool> m_bench_cancelled{};
+    std::vector<BenchCandidate> m_bench_candidates{};
+    std::vector<BenchResult> m_bench_results{};
+
+    void on_bench_add() noexcept;
+    void on_bench_remove() noexcept;
+    void on_bench_run() noexcept;
+    void on_bench_cancel() noexcept;
+    void on_bench_finished() noexcept;
+    void on_bench_export() noexcept;
+    void update_bench_buttons() noexcept;
+
+    // Switches schedulers as root, the user authenticates once
+    ScxHelperClient* m_scx_helper = nullptr;
+    std::atomic_bool m_is_closing{};
+
+    void on_helper_response(const scx::HelperResponse& response) noexcept;
+    /// @brief Send the request from the benchmark thread, and wait for the response.
+    auto call_scx_helper_blocking(const scx::HelperRequest& request) noexcept -> scx::HelperResponse;
 };
 
 #endif  // SCHEDEXT_WINDOW_HPP_
@@ -0,0 +1,208 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "schedext_monitor.hpp"
+
+#include <cerrno>  // for errno, EINTR
+
+#include <array>        // for array
+#include <string_view>  // for string_view
+#include <utility>      // for exchange
+
+#include <fcntl.h>           // for open, O_RDONLY, O_CLOEXEC
+#include <linux/netlink.h>   // for sockaddr_nl, NETLINK_KOBJECT_UEVENT
+#include <sys/socket.h>      // for socket, bind, recv
+#include <unistd.h>          // for close, pread
+
+#include <fmt/core.h>
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr auto SCHED_EXT_STATE_PATH = "/sys/kernel/sched_ext/state"sv;
+static constexpr auto SCHED_EXT_OPS_PATH   = "/sys/kernel/sched_ext/root/ops"sv;
+
+// Kernel uevents are multicasted to the group 1, udev rebroadcasts them on the group 2
+static constexpr std::uint32_t UEVENT_KERNEL_GROUP = 1;
+
+// Used only when uevents can't be received
+static constexpr auto POLL_INTERVAL = std::chrono::seconds{5};
+// The state goes through enabling/disabling, reread once more after the event
+static constexpr auto SETTLE_INTERVAL = std::chrono::milliseconds{250};
+
+// sysfs regenerates the attribute content on read from the offset 0
+auto pread_attribute(std::int32_t fd) noexcept -> std::string {
+    std::array<char, 256> buf{};
+
+    ssize_t read_bytes{};
+    do {
+        read_bytes = ::pread(fd, buf.data(), buf.size(), 0);
+    } while (read_bytes == -1 && errno == EINTR);
+    /* clang-format off */
+    if (read_bytes <= 0) { return {}; }
+    /* clang-format on */
+
+    std::string_view content{buf.data(), static_cast<std::size_t>(read_bytes)};
+    while (!content.empty() && (content.back() == '\n' || content.back() == '\0')) {
+        content.remove_suffix(1);
+    }
+    return std::string{content};
+}
+
+auto open_attribute(std::string_view file_path) noexcept -> std::int32_t {
+    return ::open(file_path.data(), O_RDONLY | O_CLOEXEC);
+}
+
+auto open_uevent_socket() noexcept -> std::int32_t {
+    const auto fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    /* clang-format off */
+    if (fd == -1) { return -1; }
+    /* clang-format on */
+
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = UEVENT_KERNEL_GROUP;
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void close_fd(std::int32_t& fd) noexcept {
+    if (fd != -1) {
+        ::close(std::exchange(fd, -1));
+    }
+}
+
+}  // namespace
+
+SchedExtMonitor::SchedExtMonitor(QObject* parent)
+  : QObject(parent), m_poll_timer(new QTimer(this)), m_settle_timer(new QTimer(this)) {
+    m_settle_timer->setSingleShot(true);
+    m_settle_timer->setInterval(SETTLE_INTERVAL);
+
+    connect(m_poll_timer, &QTimer::timeout, this, &SchedExtMonitor::refresh);
+    connect(m_settle_timer, &QTimer::timeout, this, &SchedExtMonitor::refresh);
+}
+
+SchedExtMonitor::~SchedExtMonitor() {
+    stop();
+}
+
+void SchedExtMonitor::start() noexcept {
+    /* clang-format off */
+    if (is_running()) { return; }
+    /* clang-format on */
+
+    m_state_fd = open_attribute(SCHED_EXT_STATE_PATH);
+    if (m_state_fd == -1) {
+        fmt::print(stderr, "[SCHEDEXT] failed to open '{}'\n", SCHED_EXT_STATE_PATH);
+        m_current_sched = "unknown";
+        return;
+    }
+
+    m_uevent_fd = open_uevent_socket();
+    if (m_uevent_fd != -1) {
+        m_uevent_notifier = new QSocketNotifier(m_uevent_fd, QSocketNotifier::Read, this);
+        connect(m_uevent_notifier, &QSocketNotifier::activated, this, &SchedExtMonitor::on_uevent);
+    } else {
+        fmt::print(stderr, "[SCHEDEXT] uevents are unavailable, falling back to polling\n");
+        m_poll_timer->start(POLL_INTERVAL);
+    }
+
+    // catch up with what has happened while we were stopped
+    refresh();
+}
+
+void SchedExtMonitor::stop() noexcept {
+    m_poll_timer->stop();
+    m_settle_timer->stop();
+    if (m_uevent_notifier != nullptr) {
+        delete std::exchange(m_uevent_notifier, nullptr);
+    }
+    close_fd(m_uevent_fd);
+    close_fd(m_state_fd);
+}
+
+void SchedExtMonitor::refresh() noexcept {
+    /* clang-format off */
+    if (!is_running()) { return; }
+    /* clang-format on */
+
+    auto current_sched = read_current_scheduler();
+    /* clang-format off */
+    if (current_sched == m_current_sched) { return; }
+    /* clang-format on */
+
+    SchedTransition transition{
+        .time = std::chrono::system_clock::now(),
+        .from = std::exchange(m_current_sched, std::move(current_sched)),
+        .to   = m_current_sched,
+    };
+    // the very first read isn't a transition
+    if (!transition.from.empty()) {
+        if (m_history.size() == MAX_HISTORY_SIZE) {
+            m_history.pop_front();
+        }
+        m_history.emplace_back(transition);
+    }
+    emit scheduler_changed(transition);
+}
+
+void SchedExtMonitor::on_uevent() noexcept {
+    // message is "action@devpath\0KEY=VALUE\0...", drain the socket
+    std::array<char, 4096> buf{};
+    bool is_sched_ext_event{};
+    for (;;) {
+        const auto recv_bytes = ::recv(m_uevent_fd, buf.data(), buf.size(), MSG_DONTWAIT);
+        if (recv_bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        /* clang-format off */
+        if (recv_bytes <= 0) { break; }
+        /* clang-format on */
+        const std::string_view message{buf.data(), static_cast<std::size_t>(recv_bytes)};
+        if (message.find("sched_ext"sv) != std::string_view::npos) {
+            is_sched_ext_event = true;
+        }
+    }
+    /* clang-format off */
+    if (!is_sched_ext_event) { return; }
+    /* clang-format on */
+
+    refresh();
+    m_settle_timer->start();
+}
+
+auto SchedExtMonitor::read_current_scheduler() const noexcept -> std::string {
+    auto current_state = pread_attribute(m_state_fd);
+    if (current_state != "enabled"sv) {
+        return current_state.empty() ? std::string{"unknown"sv} : current_state;
+    }
+
+    // root kobject is recreated for each attached scheduler, so it can't be kept open
+    auto ops_fd        = open_attribute(SCHED_EXT_OPS_PATH);
+    auto current_sched = (ops_fd != -1) ? pread_attribute(ops_fd) : std::string{};
+    close_fd(ops_fd);
+    if (current_sched.empty()) {
+        return std::string{"unknown"sv};
+    }
+    return current_sched;
+}
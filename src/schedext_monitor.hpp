@@ -0,0 +1,110 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef SCHEDEXT_MONITOR_HPP
+#define SCHEDEXT_MONITOR_HPP
+
+#include <chrono>   // for system_clock
+#include <cstddef>  // for size_t
+#include <cstdint>  // for int32_t
+#include <deque>    // for deque
+#include <string>   // for string
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/// Change of the running sched_ext scheduler, e.g scx_lavd -> disabled.
+struct SchedTransition final {
+    std::chrono::system_clock::time_point time{};
+    std::string from{};
+    std::string to{};
+};
+
+/// Watches the running sched_ext scheduler.
+///
+/// The kernel sends uevent for the sched_ext kobject, when the BPF scheduler
+/// is attached or detached (including when it is kicked out by the watchdog).
+/// The monitor listens on the kobject uevent netlink socket and only then
+/// rereads the sysfs attributes, the state file is kept open and read with pread.
+/// If the netlink socket isn't available, it falls back to a slow polling.
+class SchedExtMonitor final : public QObject {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(SchedExtMonitor)
+ public:
+    static constexpr std::size_t MAX_HISTORY_SIZE = 64;
+
+    explicit SchedExtMonitor(QObject* parent = nullptr);
+    ~SchedExtMonitor() override;
+
+    /// @brief Open the files and start watching. Does nothing if already started.
+    void start() noexcept;
+    /// @brief Stop watching and close the files. History is kept.
+    void stop() noexcept;
+
+    /// @brief Reread the running scheduler now.
+    void refresh() noexcept;
+
+    /* clang-format off */
+    bool is_running() const noexcept
+    { return m_state_fd != -1; }
+
+    /// Name of the running scheduler, or the state (e.g disabled)
+    const std::string& get_current_scheduler() const noexcept
+    { return m_current_sched; }
+
+    /// Transitions, the oldest first
+    const std::deque<SchedTransition>& get_history() const noexcept
+    { return m_history; }
+    /* clang-format on */
+
+ signals:
+    void scheduler_changed(const SchedTransition& transition);
+
+ private:
+    std::int32_t m_state_fd{-1};
+    std::int32_t m_uevent_fd{-1};
+    QSocketNotifier* m_uevent_notifier{nullptr};
+    QTimer* m_poll_timer{nullptr};
+    QTimer* m_settle_timer{nullptr};
+
+    std::string m_current_sched{};
+    std::deque<SchedTransition> m_history{};
+
+    void on_uevent() noexcept;
+    auto read_current_scheduler() const noexcept -> std::string;
+};
+
+#endif  // SCHEDEXT_MONITOR_HPP
@@ -0,0 +1,351 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Privileged part of the sched-ext window, which is started once via pkexec.
+// It reads requests from stdin, and answers on stdout, see scx_utils.hpp.
+// Schedulers are started directly, without the round trip through scx.service,
+// in own session, so they keep running after the helper exits.
+
+#include "process_utils.hpp"
+#include "scx_utils.hpp"
+
+#include <cerrno>   // for errno, ESRCH, ECHILD
+#include <csignal>  // for kill, signal, SIGINT, SIGKILL
+#include <cstdio>   // for fflush
+
+#include <algorithm>    // for find
+#include <chrono>       // for steady_clock
+#include <filesystem>   // for create_directories, rename
+#include <fstream>      // for ifstream, ofstream
+#include <iostream>     // for cin
+#include <iterator>     // for istreambuf_iterator
+#include <string>       // for string, getline
+#include <string_view>  // for string_view
+#include <thread>       // for sleep_for
+#include <vector>       // for vector
+
+#include <fcntl.h>     // for O_RDONLY, O_WRONLY
+#include <spawn.h>     // for posix_spawn, posix_spawnattr_*
+#include <sys/wait.h>  // for waitpid, WIFEXITED, WEXITSTATUS
+#include <unistd.h>    // for geteuid, pid_t
+
+#include <fmt/core.h>
+
+extern char** environ;  // NOLINT
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::string_view_literals;
+using namespace std::chrono_literals;  // NOLINT
+
+static constexpr std::int32_t EXIT_CODE_OK      = 0;
+static constexpr std::int32_t EXIT_CODE_FAILURE = 1;
+
+static constexpr auto SCX_CONF_PATH = "/etc/default/scx"sv;
+// Scheduler started by us, it outlives the helper
+static constexpr auto SCHED_PID_DIR  = "/run/cachyos-kernel-manager"sv;
+static constexpr auto SCHED_PID_PATH = "/run/cachyos-kernel-manager/scx.pid"sv;
+
+static constexpr auto SCHEDULER_START_TIMEOUT = 15s;
+static constexpr auto SCHEDULER_STOP_TIMEOUT  = 5s;
+static constexpr auto POLL_INTERVAL           = 50ms;
+
+using scx::HelperResponse;
+
+void reply(const HelperResponse& response) noexcept {
+    fmt::print("{}\n", scx::format_response(response));
+    std::fflush(stdout);
+}
+
+auto make_error(std::string message) noexcept -> HelperResponse {
+    return HelperResponse{.is_success = false, .message = std::move(message)};
+}
+
+auto make_ok(std::string message) noexcept -> HelperResponse {
+    return HelperResponse{.is_success = true, .message = std::move(message)};
+}
+
+auto is_installed_scheduler(std::string_view scheduler) noexcept -> bool {
+    const auto& schedulers = scx::get_installed_schedulers();
+    return std::ranges::find(schedulers, scheduler) != schedulers.end();
+}
+
+auto systemctl(std::vector<std::string> args) noexcept -> bool {
+    args.insert(args.begin(), "systemctl");
+    const auto& result = utils::exec_argv(args);
+    if (!result.is_success()) {
+        fmt::print(stderr, "[SCX] '{}' failed: {}\n", args[1], result.err);
+    }
+    return result.is_success();
+}
+
+auto is_scx_service_active() noexcept -> bool {
+    return utils::exec_argv({"systemctl", "is-active", "--quiet", "scx"}).is_success();
+}
+
+// Reap exited children, so they don't stay as zombies
+void reap_children() noexcept {
+    while (::waitpid(-1, nullptr, WNOHANG) > 0) { }
+}
+
+auto is_process_alive(pid_t pid) noexcept -> bool {
+    reap_children();
+    return ::kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+auto read_sched_pid() noexcept -> pid_t {
+    std::ifstream pid_file{std::string{SCHED_PID_PATH}};
+    pid_t pid{};
+    /* clang-format off */
+    if (!(pid_file >> pid) || pid <= 0) { return -1; }
+    /* clang-format on */
+
+    // pid could have been reused, make sure that it's still the scheduler
+    std::ifstream comm_file{fmt::format("/proc/{}/comm", pid)};
+    std::string comm{};
+    /* clang-format off */
+    if (!std::getline(comm_file, comm) || !comm.starts_with("scx_"sv)) { return -1; }
+    /* clang-format on */
+    return pid;
+}
+
+void write_sched_pid(pid_t pid) noexcept {
+    std::error_code err{};
+    fs::create_directories(SCHED_PID_DIR, err);
+    std::ofstream pid_file{std::string{SCHED_PID_PATH}, std::ios::trunc};
+    pid_file << pid << '\n';
+}
+
+// Stop the scheduler, which we have started before (maybe by the previous helper instance)
+void stop_own_scheduler() noexcept {
+    const auto pid = read_sched_pid();
+    std::error_code err{};
+    fs::remove(SCHED_PID_PATH, err);
+    /* clang-format off */
+    if (pid <= 0) { return; }
+    /* clang-format on */
+
+    // schedulers detach cleanly on SIGINT
+    ::kill(pid, SIGINT);
+    const auto deadline = std::chrono::steady_clock::now() + SCHEDULER_STOP_TIMEOUT;
+    while (is_process_alive(pid) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+    if (is_process_alive(pid)) {
+        fmt::print(stderr, "[SCX] scheduler {} hasn't exited, killing it\n", pid);
+        ::kill(pid, SIGKILL);
+    }
+}
+
+auto spawn_scheduler(const std::string& scheduler_path, const std::vector<std::string>& flags) noexcept -> pid_t {
+    std::vector<char*> c_argv{};
+    c_argv.reserve(flags.size() + 2);
+    c_argv.emplace_back(const_cast<char*>(scheduler_path.c_str()));  // NOLINT
+    for (auto&& flag : flags) {
+        c_argv.emplace_back(const_cast<char*>(flag.c_str()));  // NOLINT
+    }
+    c_argv.emplace_back(nullptr);
+
+    // stdin is our protocol, and stdout is not read by anyone
+    posix_spawn_file_actions_t file_actions{};
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    posix_spawnattr_t spawn_attr{};
+    posix_spawnattr_init(&spawn_attr);
+    posix_spawnattr_setflags(&spawn_attr, POSIX_SPAWN_SETSID);
+
+    pid_t child_pid{-1};
+    const auto spawn_status = ::posix_spawn(&child_pid, c_argv[0], &file_actions, &spawn_attr, c_argv.data(), environ);
+    posix_spawnattr_destroy(&spawn_attr);
+    posix_spawn_file_actions_destroy(&file_actions);
+    return (spawn_status == 0) ? child_pid : -1;
+}
+
+// Previous scheduler must be detached, before the new one can be attached
+auto detach_running_scheduler() noexcept -> HelperResponse {
+    stop_own_scheduler();
+    if (is_scx_service_active() && !systemctl({"stop", "scx"})) {
+        return make_error("failed to stop scx.service");
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + SCHEDULER_STOP_TIMEOUT;
+    while (!scx::get_running_scheduler().empty() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+    if (auto running_sched = scx::get_running_scheduler(); !running_sched.empty()) {
+        return make_error(fmt::format("{} is attached by someone else", running_sched));
+    }
+    return make_ok({});
+}
+
+auto switch_scheduler(const scx::HelperRequest& request) noexcept -> HelperResponse {
+    /* clang-format off */
+    if (!is_installed_scheduler(request.scheduler)) { return make_error(fmt::format("{} is not installed", request.scheduler)); }
+    /* clang-format on */
+    if (auto response = detach_running_scheduler(); !response.is_success) {
+        return response;
+    }
+
+    const auto& scheduler_path = fmt::format("{}/{}", scx::SCX_BIN_DIR, request.scheduler);
+    const auto pid             = spawn_scheduler(scheduler_path, request.flags);
+    /* clang-format off */
+    if (pid <= 0) { return make_error(fmt::format("failed to start {}", request.scheduler)); }
+    /* clang-format on */
+
+    const auto deadline = std::chrono::steady_clock::now() + SCHEDULER_START_TIMEOUT;
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::int32_t status{};
+        if (::waitpid(pid, &status, WNOHANG) == pid) {
+            const auto exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            return make_error(fmt::format("{} has exited with status {}", request.scheduler, exit_code));
+        }
+        if (scx::is_scheduler_running(request.scheduler)) {
+            write_sched_pid(pid);
+            return make_ok(fmt::format("{} is running", request.scheduler));
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    ::kill(pid, SIGKILL);
+    ::waitpid(pid, nullptr, 0);
+    return make_error(fmt::format("{} hasn't attached in time", request.scheduler));
+}
+
+// Rewrite scheduler and flags in place, everything else in the config is kept
+auto update_scx_config(std::string_view content, std::string_view scheduler, std::string_view flags) noexcept -> std::string {
+    std::string new_content{};
+    bool has_scheduler{};
+    bool has_flags{};
+
+    std::size_t line_start{};
+    while (line_start < content.size()) {
+        auto line_end = content.find('\n', line_start);
+        if (line_end == std::string_view::npos) {
+            line_end = content.size();
+        }
+        const auto line = content.substr(line_start, line_end - line_start);
+        line_start      = line_end + 1;
+
+        if (line.starts_with("SCX_SCHEDULER="sv)) {
+            new_content += fmt::format("SCX_SCHEDULER={}\n", scheduler);
+            has_scheduler = true;
+        } else if (line.starts_with("SCX_FLAGS="sv) || (!flags.empty() && !has_flags && line.starts_with("#SCX_FLAGS="sv))) {
+            // commented flags are the example, it's replaced only if we don't have the real one
+            new_content += flags.empty() ? fmt::format("#{}\n", line) : fmt::format("SCX_FLAGS='{}'\n", flags);
+            has_flags = true;
+        } else {
+            new_content += line;
+            new_content += '\n';
+        }
+    }
+    if (!has_scheduler) {
+        new_content += fmt::format("SCX_SCHEDULER={}\n", scheduler);
+    }
+    if (!has_flags && !flags.empty()) {
+        new_content += fmt::format("SCX_FLAGS='{}'\n", flags);
+    }
+    return new_content;
+}
+
+auto persist_scheduler(const scx::HelperRequest& request) noexcept -> HelperResponse {
+    /* clang-format off */
+    if (!is_installed_scheduler(request.scheduler)) { return make_error(fmt::format("{} is not installed", request.scheduler)); }
+    /* clang-format on */
+
+    std::string flags{};
+    for (auto&& flag : request.flags) {
+        if (flag.find('\'') != std::string::npos) {
+            return make_error("flags can't contain single quotes");
+        }
+        flags += flags.empty() ? flag : fmt::format(" {}", flag);
+    }
+
+    std::string content{};
+    if (std::ifstream conf_file{std::string{SCX_CONF_PATH}}; conf_file.is_open()) {
+        content.assign(std::istreambuf_iterator<char>{conf_file}, std::istreambuf_iterator<char>{});
+    }
+
+    // write next to the config and rename, so it's never seen half-written
+    const auto& tmp_path = fmt::format("{}.new", SCX_CONF_PATH);
+    {
+        std::ofstream tmp_file{tmp_path, std::ios::trunc};
+        tmp_file << update_scx_config(content, request.scheduler, flags);
+        if (!tmp_file.flush()) {
+            return make_error(fmt::format("failed to write {}", tmp_path));
+        }
+    }
+    std::error_code err{};
+    fs::rename(tmp_path, SCX_CONF_PATH, err);
+    /* clang-format off */
+    if (err) { return make_error(fmt::format("failed to write {}: {}", SCX_CONF_PATH, err.message())); }
+    /* clang-format on */
+
+    // service takes over on the next boot, the scheduler runs already
+    if (!systemctl({"enable", "scx"})) {
+        return make_error("failed to enable scx.service");
+    }
+    return make_ok(fmt::format("{} is the default scheduler", request.scheduler));
+}
+
+auto handle_request(const scx::HelperRequest& request) noexcept -> HelperResponse {
+    reap_children();
+
+    switch (request.command) {
+    case scx::HelperCommand::Switch:
+        return switch_scheduler(request);
+    case scx::HelperCommand::Persist:
+        return persist_scheduler(request);
+    case scx::HelperCommand::StartService:
+        stop_own_scheduler();
+        return systemctl({"restart", "scx"}) ? make_ok("scx.service is running") : make_error("failed to start scx.service");
+    case scx::HelperCommand::Stop:
+        stop_own_scheduler();
+        return (!is_scx_service_active() || systemctl({"stop", "scx"})) ? make_ok("scheduler is stopped") : make_error("failed to stop scx.service");
+    case scx::HelperCommand::Disable:
+        stop_own_scheduler();
+        return systemctl({"disable", "--now", "scx"}) ? make_ok("scx.service is disabled") : make_error("failed to disable scx.service");
+    }
+    return make_error("unknown command");
+}
+
+}  // namespace
+
+auto main() -> std::int32_t {
+    if (::geteuid() != 0) {
+        fmt::print(stderr, "[SCX] the helper must be run as root\n");
+        return EXIT_CODE_FAILURE;
+    }
+    // the GUI may go away at any moment
+    std::signal(SIGPIPE, SIG_IGN);
+
+    reply(make_ok("ready"));
+    for (std::string line{}; std::getline(std::cin, line);) {
+        const auto& request = scx::parse_request(line);
+        if (!request) {
+            reply(make_error(fmt::format("invalid request: '{}'", line)));
+            continue;
+        }
+        reply(handle_request(*request));
+    }
+    return EXIT_CODE_OK;
+}
@@ -0,0 +1,125 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "scx_helper_client.hpp"
+
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <utility>      // for move, exchange
+
+#include <fmt/core.h>
+
+namespace {
+
+// pkexec exits with these, if the user has dismissed or failed the authentication
+static constexpr int PKEXEC_EXIT_NOT_AUTHORIZED = 126;
+static constexpr int PKEXEC_EXIT_AUTH_FAILED    = 127;
+
+}  // namespace
+
+ScxHelperClient::ScxHelperClient(QObject* parent)
+  : QObject(parent) { }
+
+ScxHelperClient::~ScxHelperClient() {
+    /* clang-format off */
+    if (m_process == nullptr) { return; }
+    /* clang-format on */
+
+    // EOF makes the helper exit, the running scheduler stays attached
+    m_process->disconnect(this);
+    m_process->closeWriteChannel();
+    m_process->waitForFinished(1000);
+}
+
+void ScxHelperClient::send(const scx::HelperRequest& request, response_cb_t on_response) noexcept {
+    if (m_process == nullptr) {
+        start_helper();
+    }
+
+    auto line = scx::format_request(request);
+    line += '\n';
+    m_pending.emplace_back(std::move(on_response));
+    m_process->write(line.data(), static_cast<qint64>(line.size()));
+}
+
+void ScxHelperClient::start_helper() noexcept {
+    m_is_ready = false;
+    m_process  = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &ScxHelperClient::on_ready_read);
+    connect(m_process, &QProcess::finished, this, [this](int exit_code) { on_finished(exit_code); });
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            on_finished(-1);
+        }
+    });
+
+    // requests are buffered in the pipe, while the user authenticates
+    m_process->start("/usr/bin/pkexec", {QString::fromUtf8(scx::SCX_HELPER_PATH.data(), static_cast<qsizetype>(scx::SCX_HELPER_PATH.size()))});
+}
+
+void ScxHelperClient::on_ready_read() noexcept {
+    while (m_process->canReadLine()) {
+        const auto& raw_line = m_process->readLine();
+        std::string_view line{raw_line.constData(), static_cast<std::size_t>(raw_line.size())};
+        if (line.ends_with('\n')) {
+            line.remove_suffix(1);
+        }
+
+        const auto& response = scx::parse_response(line);
+        if (!response) {
+            fmt::print(stderr, "[SCX] unexpected helper output: '{}'\n", line);
+            continue;
+        }
+        // the first line greets us after the authentication
+        if (!std::exchange(m_is_ready, true)) {
+            continue;
+        }
+        /* clang-format off */
+        if (m_pending.empty()) { continue; }
+        /* clang-format on */
+
+        auto on_response = std::move(m_pending.front());
+        m_pending.pop_front();
+        if (on_response) {
+            on_response(*response);
+        }
+    }
+}
+
+void ScxHelperClient::on_finished(int exit_code) noexcept {
+    const auto& message = [&]() -> std::string {
+        if (!m_is_ready && (exit_code == PKEXEC_EXIT_NOT_AUTHORIZED || exit_code == PKEXEC_EXIT_AUTH_FAILED)) {
+            return "authorization failed";
+        }
+        return fmt::format("scx-helper has exited with code {}", exit_code);
+    }();
+
+    // next request starts the helper again
+    m_process->disconnect(this);
+    m_process->deleteLater();
+    m_process = nullptr;
+
+    auto pending = std::exchange(m_pending, {});
+    for (auto&& on_response : pending) {
+        if (on_response) {
+            on_response(scx::HelperResponse{.is_success = false, .message = message});
+        }
+    }
+}
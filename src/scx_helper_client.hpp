@@ -0,0 +1,81 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef SCX_HELPER_CLIENT_HPP
+#define SCX_HELPER_CLIENT_HPP
+
+#include "scx_utils.hpp"
+
+#include <deque>       // for deque
+#include <functional>  // for function
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-conversion"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#pragma GCC diagnostic ignored "-Wsuggest-final-methods"
+#pragma GCC diagnostic ignored "-Wsuggest-attribute=pure"
+#endif
+
+#include <QObject>
+#include <QProcess>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/// Talks to scx-helper, which runs as root.
+///
+/// The helper is started via pkexec on the first request and kept running,
+/// so the user authenticates once per session of the window, not once per switch.
+/// Requests are answered asynchronously and in order.
+class ScxHelperClient final : public QObject {
+    Q_OBJECT
+    Q_DISABLE_COPY_MOVE(ScxHelperClient)
+ public:
+    using response_cb_t = std::function<void(const scx::HelperResponse&)>;
+
+    explicit ScxHelperClient(QObject* parent = nullptr);
+    ~ScxHelperClient() override;
+
+    /// @brief Queue the request. The callback is always called on the GUI thread,
+    /// with the error if the helper couldn't be started or has exited.
+    void send(const scx::HelperRequest& request, response_cb_t on_response) noexcept;
+
+    /* clang-format off */
+    bool has_pending_requests() const noexcept
+    { return !m_pending.empty(); }
+    /* clang-format on */
+
+ private:
+    QProcess* m_process{nullptr};
+    bool m_is_ready{};
+    // sent requests, waiting for the response
+    std::deque<response_cb_t> m_pending{};
+
+    void start_helper() noexcept;
+    void on_ready_read() noexcept;
+    void on_finished(int exit_code) noexcept;
+};
+
+#endif  // SCX_HELPER_CLIENT_HPP
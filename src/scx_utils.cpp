@@ -0,0 +1,221 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "scx_utils.hpp"
+
+#include <algorithm>     // for all_of, find_if, sort, replace_if
+#include <array>         // for array
+#include <cstddef>       // for ptrdiff_t
+#include <filesystem>    // for directory_iterator
+#include <fstream>       // for ifstream
+#include <system_error>  // for error_code
+#include <utility>       // for pair
+
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::string_view_literals;
+
+// scx_* binaries, which aren't schedulers
+static constexpr std::array NON_SCHEDULER_BINARIES{"scx_loader"sv};
+
+static constexpr std::array<std::pair<scx::HelperCommand, std::string_view>, 5> COMMAND_NAMES{{
+    {scx::HelperCommand::Switch, "switch"sv},
+    {scx::HelperCommand::Persist, "persist"sv},
+    {scx::HelperCommand::StartService, "start-service"sv},
+    {scx::HelperCommand::Stop, "stop"sv},
+    {scx::HelperCommand::Disable, "disable"sv},
+}};
+
+static constexpr auto SCHED_EXT_STATE_PATH = "/sys/kernel/sched_ext/state"sv;
+static constexpr auto SCHED_EXT_OPS_PATH   = "/sys/kernel/sched_ext/root/ops"sv;
+
+static constexpr auto RESPONSE_OK    = "ok"sv;
+static constexpr auto RESPONSE_ERROR = "error"sv;
+
+// Tabs and newlines would break the line into wrong fields
+inline void append_field(std::string& line, std::string_view field) noexcept {
+    const auto first_pos = line.size();
+    line += field;
+    std::ranges::replace_if(line.begin() + static_cast<std::ptrdiff_t>(first_pos), line.end(), [](char ch) { return ch == '\t' || ch == '\n'; }, ' ');
+}
+
+auto read_sysfs_line(std::string_view file_path) noexcept -> std::string {
+    std::ifstream file_stream{std::string{file_path}};
+    std::string line{};
+    std::getline(file_stream, line);
+    return line;
+}
+
+// Unlike make_split_view, empty fields are kept, the scheduler may be empty
+auto split_fields(std::string_view line) noexcept -> std::vector<std::string_view> {
+    std::vector<std::string_view> fields{};
+    for (std::size_t start{};;) {
+        const auto end = line.find('\t', start);
+        fields.emplace_back(line.substr(start, end - start));
+        /* clang-format off */
+        if (end == std::string_view::npos) { break; }
+        /* clang-format on */
+        start = end + 1;
+    }
+    return fields;
+}
+
+}  // namespace
+
+namespace scx {
+
+auto get_installed_schedulers(std::string_view bin_dir) noexcept -> std::vector<std::string> {
+    std::vector<std::string> schedulers{};
+
+    std::error_code err{};
+    for (fs::directory_iterator it{bin_dir, err}, end{}; !err && it != end; it.increment(err)) {
+        auto&& filename = it->path().filename().string();
+        if (!is_valid_scheduler_name(filename) || std::ranges::find(NON_SCHEDULER_BINARIES, filename) != NON_SCHEDULER_BINARIES.end()) {
+            continue;
+        }
+        std::error_code status_err{};
+        const auto& status = it->status(status_err);
+        if (status_err || !fs::is_regular_file(status) || (status.permissions() & fs::perms::owner_exec) == fs::perms::none) {
+            continue;
+        }
+        schedulers.emplace_back(std::move(filename));
+    }
+    if (err) {
+        fmt::print(stderr, "[SCX] failed to list '{}': {}\n", bin_dir, err.message());
+    }
+
+    std::ranges::sort(schedulers);
+    return schedulers;
+}
+
+auto is_valid_scheduler_name(std::string_view scheduler) noexcept -> bool {
+    constexpr auto is_valid_char = [](char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_'; };
+    return scheduler.starts_with("scx_"sv) && scheduler.size() > 4 && std::ranges::all_of(scheduler, is_valid_char);
+}
+
+auto get_running_scheduler() noexcept -> std::string {
+    /* clang-format off */
+    if (read_sysfs_line(SCHED_EXT_STATE_PATH) != "enabled"sv) { return {}; }
+    /* clang-format on */
+    return read_sysfs_line(SCHED_EXT_OPS_PATH);
+}
+
+auto is_scheduler_running(std::string_view scheduler) noexcept -> bool {
+    // ops name is the scheduler name without prefix, and may have the version suffix (e.g lavd_1.0.5)
+    if (scheduler.starts_with("scx_"sv)) {
+        scheduler.remove_prefix(4);
+    }
+    const auto& running_sched = get_running_scheduler();
+    return !running_sched.empty() && running_sched.starts_with(scheduler);
+}
+
+auto split_flags(std::string_view flags) noexcept -> std::vector<std::string> {
+    std::vector<std::string> args{};
+    std::string current_arg{};
+    bool has_arg{};
+    char quote_char{};
+    for (char ch : flags) {
+        if (quote_char != 0) {
+            if (ch == quote_char) {
+                quote_char = 0;
+            } else {
+                current_arg += ch;
+            }
+        } else if (ch == '\'' || ch == '"') {
+            quote_char = ch;
+            has_arg    = true;
+        } else if (ch == ' ' || ch == '\t' || ch == '\n') {
+            if (has_arg) {
+                args.emplace_back(std::move(current_arg));
+                current_arg.clear();
+                has_arg = false;
+            }
+        } else {
+            current_arg += ch;
+            has_arg = true;
+        }
+    }
+    if (has_arg) {
+        args.emplace_back(std::move(current_arg));
+    }
+    return args;
+}
+
+auto format_request(const HelperRequest& request) noexcept -> std::string {
+    const auto command_it = std::ranges::find_if(COMMAND_NAMES, [&](auto&& entry) { return entry.first == request.command; });
+
+    std::string line{command_it->second};
+    line += '\t';
+    append_field(line, request.scheduler);
+    for (auto&& flag : request.flags) {
+        line += '\t';
+        append_field(line, flag);
+    }
+    return line;
+}
+
+auto parse_request(std::string_view line) noexcept -> std::optional<HelperRequest> {
+    const auto& fields = split_fields(line);
+    /* clang-format off */
+    if (fields.size() < 2) { return std::nullopt; }
+    /* clang-format on */
+
+    const auto command_it = std::ranges::find_if(COMMAND_NAMES, [&](auto&& entry) { return entry.second == fields[0]; });
+    /* clang-format off */
+    if (command_it == COMMAND_NAMES.end()) { return std::nullopt; }
+    /* clang-format on */
+
+    HelperRequest request{.command = command_it->first, .scheduler = std::string{fields[1]}};
+    const bool needs_scheduler = (request.command == HelperCommand::Switch || request.command == HelperCommand::Persist);
+    if (needs_scheduler != !request.scheduler.empty()) {
+        return std::nullopt;
+    }
+    if (!request.scheduler.empty() && !is_valid_scheduler_name(request.scheduler)) {
+        return std::nullopt;
+    }
+    for (std::size_t i = 2; i < fields.size(); ++i) {
+        request.flags.emplace_back(fields[i]);
+    }
+    return request;
+}
+
+auto format_response(const HelperResponse& response) noexcept -> std::string {
+    std::string line{response.is_success ? RESPONSE_OK : RESPONSE_ERROR};
+    line += '\t';
+    append_field(line, response.message);
+    return line;
+}
+
+auto parse_response(std::string_view line) noexcept -> std::optional<HelperResponse> {
+    const auto delim_pos = line.find('\t');
+    /* clang-format off */
+    if (delim_pos == std::string_view::npos) { return std::nullopt; }
+    /* clang-format on */
+
+    const auto status = line.substr(0, delim_pos);
+    if (status != RESPONSE_OK && status != RESPONSE_ERROR) {
+        return std::nullopt;
+    }
+    return HelperResponse{.is_success = (status == RESPONSE_OK), .message = std::string{line.substr(delim_pos + 1)}};
+}
+
+}  // namespace scx
@@ -0,0 +1,92 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef SCX_UTILS_HPP
+#define SCX_UTILS_HPP
+
+#include <cstdint>      // for uint8_t
+#include <optional>     // for optional
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+/// sched_ext helpers, shared by the GUI and scx-helper.
+///
+/// Line protocol between the GUI and scx-helper.
+///
+/// The helper is started once via pkexec, and reads requests from stdin until EOF.
+/// Each request is answered with exactly one response line on stdout, in order.
+/// Fields are separated by tabs, so neither of them may contain tabs or newlines.
+///   request:  <command>\t<scheduler>\t<flag>...
+///   response: ok\t<message> | error\t<message>
+/// Right after the start the helper sends "ok\tready".
+namespace scx {
+
+inline constexpr std::string_view SCX_HELPER_PATH = "/usr/lib/cachyos-kernel-manager/scx-helper";
+inline constexpr std::string_view SCX_BIN_DIR     = "/usr/bin";
+
+enum class HelperCommand : std::uint8_t {
+    // Attach the scheduler now, the running one is replaced
+    Switch,
+    // Make the scheduler default in /etc/default/scx and enable scx.service
+    Persist,
+    // Hand over to scx.service with its configured scheduler
+    StartService,
+    // Detach the scheduler, and stop scx.service
+    Stop,
+    // Same as Stop, and disable scx.service
+    Disable,
+};
+
+struct HelperRequest final {
+    HelperCommand command{};
+    std::string scheduler{};
+    std::vector<std::string> flags{};
+};
+
+struct HelperResponse final {
+    bool is_success{};
+    std::string message{};
+};
+
+/// @brief Get sched_ext schedulers, installed in the directory (e.g scx_lavd).
+/// @return Sorted scheduler names.
+auto get_installed_schedulers(std::string_view bin_dir = SCX_BIN_DIR) noexcept -> std::vector<std::string>;
+
+/// @brief Check if the name looks like scheduler binary (scx_[a-z0-9_]+).
+auto is_valid_scheduler_name(std::string_view scheduler) noexcept -> bool;
+
+/// @brief Get ops name of the attached scheduler (e.g lavd_1.0.5), or empty string if none.
+auto get_running_scheduler() noexcept -> std::string;
+
+/// @brief Check if the scheduler is attached, by the ops name in sysfs.
+auto is_scheduler_running(std::string_view scheduler) noexcept -> bool;
+
+/// @brief Split flags, as typed by the user, into arguments.
+/// Single and double quotes group the words, no other shell syntax is supported.
+auto split_flags(std::string_view flags) noexcept -> std::vector<std::string>;
+
+auto format_request(const HelperRequest& request) noexcept -> std::string;
+auto parse_request(std::string_view line) noexcept -> std::optional<HelperRequest>;
+
+auto format_response(const HelperResponse& response) noexcept -> std::string;
+auto parse_response(std::string_view line) noexcept -> std::optional<HelperResponse>;
+
+}  // namespace scx
+
+#endif  // SCX_UTILS_HPP
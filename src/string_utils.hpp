@@ -58,6 +58,15 @@ inline constexpr std::size_t remove_all(std::string& inout, std::string_view wha
     return replace_all(inout, what, "");
 }
 
+/// @brief Quote the string to be passed as single word to the shell.
+/// @param str The string to quote.
+/// @return The string wrapped into single quotes.
+inline constexpr auto shell_quote(std::string_view str) noexcept -> std::string {
+    std::string quoted{str};
+    replace_all(quoted, "'", "'\\''");
+    return "'" + quoted + "'";
+}
+
 /// @brief Split a string into multiple lines based on a delimiter.
 /// @param str The string to split.
 /// @param delim The delimiter to split the string.
@@ -0,0 +1,175 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "trace.hpp"
+
+#include <cerrno>   // for errno
+#include <cstdio>   // for fdopen, fputs, fclose
+#include <cstdlib>  // for getenv, atexit
+#include <cstring>  // for strerror
+
+#include <chrono>      // for steady_clock
+#include <filesystem>  // for create_directories
+#include <mutex>       // for mutex, lock_guard
+#include <span>        // for span
+#include <string>      // for string
+#include <vector>      // for vector
+
+#include <fcntl.h>   // for open, O_EXCL
+#include <unistd.h>  // for getpid, gettid
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+namespace {
+
+struct TraceEvent {
+    std::string_view name{};
+    std::int64_t start_us{};
+    std::int64_t duration_us{};
+    std::int32_t tid{};
+};
+
+// Timestamps are relative to the start of the app, so the trace begins at zero
+const auto g_start_time = std::chrono::steady_clock::now();  // NOLINT
+
+std::mutex g_events_mutex{};         // NOLINT
+std::vector<TraceEvent> g_events{};  // NOLINT
+std::string g_trace_path{};          // NOLINT
+// The default path is ours, it must not exist yet. The path from env is overwritten.
+bool g_is_default_path{};  // NOLINT
+
+// Private to the user, unlike /tmp, where anyone could precreate the file or the symlink
+auto get_default_trace_path() noexcept -> std::string {
+    const auto pid = ::getpid();
+    if (const auto* runtime_dir = std::getenv("XDG_RUNTIME_DIR"); runtime_dir != nullptr && runtime_dir[0] == '/') {
+        return fmt::format(FMT_COMPILE("{}/cachyos-km-trace-{}.json"), runtime_dir, pid);
+    }
+    const auto* home_dir = std::getenv("HOME");
+    /* clang-format off */
+    if (home_dir == nullptr || home_dir[0] != '/') { return {}; }
+    /* clang-format on */
+
+    const auto& cache_dir = fmt::format(FMT_COMPILE("{}/.cache/cachyos-km"), home_dir);
+    std::error_code err{};
+    std::filesystem::create_directories(cache_dir, err);
+    return fmt::format(FMT_COMPILE("{}/trace-{}.json"), cache_dir, pid);
+}
+
+// Span names are ours, but make sure they never break the JSON
+auto escape_json(std::string_view str) noexcept -> std::string {
+    std::string escaped{};
+    escaped.reserve(str.size());
+    for (const char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+        }
+        escaped += ch;
+    }
+    return escaped;
+}
+
+void write_trace() noexcept {
+    trace::detail::g_is_enabled.store(false, std::memory_order_relaxed);
+
+    const std::lock_guard<std::mutex> guard(g_events_mutex);
+    const auto open_flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_NOFOLLOW | (g_is_default_path ? O_EXCL : O_TRUNC);
+    const auto trace_fd   = ::open(g_trace_path.c_str(), open_flags, 0600);
+    auto* trace_file      = (trace_fd != -1) ? ::fdopen(trace_fd, "w") : nullptr;
+    if (trace_file == nullptr) {
+        fmt::print(stderr, "[TRACE] failed to open {}: {}\n", g_trace_path, std::strerror(errno));
+        if (trace_fd != -1) {
+            ::close(trace_fd);
+        }
+        return;
+    }
+
+    const auto pid = ::getpid();
+    std::string trace_json{R"({"traceEvents":[)"};
+    for (std::size_t i = 0; i < g_events.size(); ++i) {
+        const auto& event = g_events[i];
+        trace_json += fmt::format(FMT_COMPILE(R"({}{{"name":"{}","ph":"X","ts":{},"dur":{},"pid":{},"tid":{}}})"),
+            (i == 0) ? "" : ",", escape_json(event.name), event.start_us, event.duration_us, pid, event.tid);
+    }
+    trace_json += "]}\n";
+
+    const bool is_written = (std::fputs(trace_json.c_str(), trace_file) >= 0);
+    if (std::fclose(trace_file) != 0 || !is_written) {
+        fmt::print(stderr, "[TRACE] failed to write the trace into {}\n", g_trace_path);
+        return;
+    }
+    fmt::print(stderr, "[TRACE] {} spans are written into {}\n", g_events.size(), g_trace_path);
+}
+
+}  // namespace
+
+namespace trace {
+
+namespace detail {
+
+std::atomic_bool g_is_enabled{false};  // NOLINT
+
+auto get_timestamp_us() noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_start_time).count();
+}
+
+void add_span(std::string_view name, std::int64_t start_us, std::int64_t end_us) noexcept {
+    const std::int32_t tid = ::gettid();
+
+    const std::lock_guard<std::mutex> guard(g_events_mutex);
+    g_events.emplace_back(TraceEvent{.name = name, .start_us = start_us, .duration_us = end_us - start_us, .tid = tid});
+}
+
+}  // namespace detail
+
+auto init(std::int32_t argc, char** argv) noexcept -> std::int32_t {
+    const std::span args{argv, static_cast<std::size_t>(argc)};
+
+    // argv is null-terminated, keep it that way
+    std::int32_t new_argc{};
+    bool has_trace_arg{};
+    for (auto* arg : args) {
+        if (std::string_view{arg} == TRACE_ARG) {
+            has_trace_arg = true;
+            continue;
+        }
+        args[static_cast<std::size_t>(new_argc++)] = arg;
+    }
+    if (new_argc != argc) {
+        argv[new_argc] = nullptr;
+    }
+
+    if (const auto* trace_env = std::getenv(TRACE_ENV.data()); trace_env != nullptr && trace_env[0] != '\0') {
+        g_trace_path = trace_env;
+    } else if (has_trace_arg) {
+        g_trace_path      = get_default_trace_path();
+        g_is_default_path = true;
+    } else {
+        return new_argc;
+    }
+    if (g_trace_path.empty()) {
+        fmt::print(stderr, "[TRACE] neither XDG_RUNTIME_DIR nor HOME is set, set {} to the trace path\n", TRACE_ENV);
+        return new_argc;
+    }
+
+    detail::g_is_enabled.store(true, std::memory_order_relaxed);
+    std::atexit(write_trace);
+    return new_argc;
+}
+
+}  // namespace trace
@@ -0,0 +1,72 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>       // for atomic_bool
+#include <cstdint>      // for int32_t, int64_t
+#include <string_view>  // for string_view
+
+namespace trace {
+
+/// Environment variable with the path of the trace file, which enables tracing.
+inline constexpr std::string_view TRACE_ENV = "CACHYOS_KM_TRACE";
+/// Argument, which enables tracing into $XDG_RUNTIME_DIR/cachyos-km-trace-<pid>.json, or ~/.cache/cachyos-km/trace-<pid>.json without it.
+inline constexpr std::string_view TRACE_ARG = "--trace";
+
+namespace detail {
+extern std::atomic_bool g_is_enabled;
+
+auto get_timestamp_us() noexcept -> std::int64_t;
+void add_span(std::string_view name, std::int64_t start_us, std::int64_t end_us) noexcept;
+}  // namespace detail
+
+/// @brief Enable tracing, if it's requested by TRACE_ENV or TRACE_ARG.
+/// The trace is written in Chrome trace format (see chrome://tracing or ui.perfetto.dev) at exit.
+/// @return The new argc, TRACE_ARG is removed from the arguments.
+auto init(std::int32_t argc, char** argv) noexcept -> std::int32_t;
+
+inline bool is_enabled() noexcept {
+    return detail::g_is_enabled.load(std::memory_order_relaxed);
+}
+
+/// Records the time from its construction to destruction, if tracing is enabled.
+/// Otherwise it costs a single load of the flag.
+class Span final {
+ public:
+    /// @param name The name, it must outlive the trace (e.g string literal).
+    explicit Span(std::string_view name) noexcept
+      : m_name(name), m_start_us(is_enabled() ? detail::get_timestamp_us() : -1) { }
+    ~Span() noexcept {
+        if (m_start_us >= 0) {
+            detail::add_span(m_name, m_start_us, detail::get_timestamp_us());
+        }
+    }
+
+    Span(const Span&)            = delete;
+    Span& operator=(const Span&) = delete;
+
+ private:
+    std::string_view m_name{};
+    std::int64_t m_start_us{-1};
+};
+
+}  // namespace trace
+
+#endif  // TRACE_HPP
@@ -0,0 +1,84 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include "transaction.hpp"
+
+#include <utility>  // for move
+
+#include <fmt/core.h>
+
+void Transaction::add_to(std::vector<std::string>& list, std::unordered_set<std::string>& names, std::string_view pkg_name) noexcept {
+    /* clang-format off */
+    if (pkg_name.empty()) { return; }
+    /* clang-format on */
+    if (auto [it, is_inserted] = names.emplace(pkg_name); is_inserted) {
+        list.emplace_back(*it);
+    }
+}
+
+bool Transaction::add_install(std::string_view pkg_name) noexcept {
+    const std::string name{pkg_name};
+    if (m_removal_names.contains(name)) {
+        fmt::print(stderr, "[TRANSACTION] '{}' is already going to be removed, not installing it\n", pkg_name);
+        return false;
+    }
+    add_to(m_targets.install, m_install_names, pkg_name);
+    return true;
+}
+
+bool Transaction::add_removal(std::string_view pkg_name) noexcept {
+    const std::string name{pkg_name};
+    if (m_install_names.contains(name) || m_aur_install_names.contains(name)) {
+        fmt::print(stderr, "[TRANSACTION] '{}' is already going to be installed, not removing it\n", pkg_name);
+        return false;
+    }
+    add_to(m_targets.remove, m_removal_names, pkg_name);
+    return true;
+}
+
+bool Transaction::add_aur_install(std::string_view pkg_name) noexcept {
+    const std::string name{pkg_name};
+    if (m_removal_names.contains(name)) {
+        fmt::print(stderr, "[TRANSACTION] '{}' is already going to be removed, not installing it\n", pkg_name);
+        return false;
+    }
+    add_to(m_aur_install, m_aur_install_names, pkg_name);
+    return true;
+}
+
+void Transaction::merge(Transaction&& other) noexcept {
+    for (auto&& pkg_name : other.m_targets.install) {
+        add_install(pkg_name);
+    }
+    for (auto&& pkg_name : other.m_targets.remove) {
+        add_removal(pkg_name);
+    }
+    for (auto&& pkg_name : other.m_aur_install) {
+        add_aur_install(pkg_name);
+    }
+    other = Transaction{};
+}
+
+auto Transaction::get_pkg_names() const noexcept -> std::vector<std::string> {
+    std::vector<std::string> pkg_names{};
+    pkg_names.reserve(m_targets.install.size() + m_targets.remove.size() + m_aur_install.size());
+    pkg_names.insert(pkg_names.end(), m_targets.install.begin(), m_targets.install.end());
+    pkg_names.insert(pkg_names.end(), m_targets.remove.begin(), m_targets.remove.end());
+    pkg_names.insert(pkg_names.end(), m_aur_install.begin(), m_aur_install.end());
+    return pkg_names;
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#ifndef TRANSACTION_HPP
+#define TRANSACTION_HPP
+
+#include "alpm_transaction.hpp"
+
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_set>  // for unordered_set
+#include <vector>         // for vector
+
+/// Packages to install and remove, collected from the kernels before the commit.
+///
+/// It owns copies of the package names, so it doesn't depend on the lifetime
+/// of the alpm handle or of the kernels. Each transaction is independent,
+/// so they can be built on any thread. Move-only, to not duplicate the batch by accident.
+class Transaction final {
+ public:
+    Transaction() = default;
+    ~Transaction() = default;
+
+    Transaction(Transaction&&) noexcept            = default;
+    Transaction& operator=(Transaction&&) noexcept = default;
+    Transaction(const Transaction&)                = delete;
+    Transaction& operator=(const Transaction&)     = delete;
+
+    /// @brief Add the package to install. Duplicates are ignored.
+    /// @return False if the package is already in the removal list, it isn't added then.
+    bool add_install(std::string_view pkg_name) noexcept;
+    /// @brief Add the package to remove. Duplicates are ignored.
+    /// @return False if the package is already in one of the install lists, it isn't added then.
+    bool add_removal(std::string_view pkg_name) noexcept;
+    /// @brief Add the AUR package, which is built and installed with makepkg.
+    /// @return False if the package is already in the removal list, it isn't added then.
+    bool add_aur_install(std::string_view pkg_name) noexcept;
+
+    /// @brief Move all packages of the other transaction into this one.
+    void merge(Transaction&& other) noexcept;
+
+    /* clang-format off */
+    const std::vector<std::string>& get_install_list() const noexcept
+    { return m_targets.install; }
+
+    const std::vector<std::string>& get_removal_list() const noexcept
+    { return m_targets.remove; }
+
+    const std::vector<std::string>& get_aur_install_list() const noexcept
+    { return m_aur_install; }
+
+    const utils::TransactionTargets& get_targets() const noexcept
+    { return m_targets; }
+
+    bool has_alpm_targets() const noexcept
+    { return !m_targets.install.empty() || !m_targets.remove.empty(); }
+
+    bool empty() const noexcept
+    { return !has_alpm_targets() && m_aur_install.empty(); }
+    /* clang-format on */
+
+    /// @brief Get names of all packages in the transaction.
+    auto get_pkg_names() const noexcept -> std::vector<std::string>;
+
+ private:
+    utils::TransactionTargets m_targets{};
+    std::vector<std::string> m_aur_install{};
+    // Names of each list, the same name must not be installed and removed at once
+    std::unordered_set<std::string> m_install_names{};
+    std::unordered_set<std::string> m_removal_names{};
+    std::unordered_set<std::string> m_aur_install_names{};
+
+    void add_to(std::vector<std::string>& list, std::unordered_set<std::string>& names, std::string_view pkg_name) noexcept;
+};
+
+#endif  // TRANSACTION_HPP
@@ -0,0 +1,277 @@
+// Copyright (C) 2022-2024 Vladislav Nepogodin
+//
+// This file is part of CachyOS kernel manager.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Privileged part of the runtime tunables, which is started via pkexec.
+// Usage: tunables-helper [--apply] [--persist] <name>=<value>...
+// --apply writes the values to sysfs/procfs, --persist stores them in the bootloader config and sysctl.d.
+// What has been done is printed to stdout, errors go to stderr.
+
+#include "kernel_tunables.hpp"
+#include "process_utils.hpp"
+
+#include <filesystem>   // for exists, rename
+#include <fstream>      // for ifstream, ofstream
+#include <iterator>     // for istreambuf_iterator
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+#include <unistd.h>  // for geteuid
+
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::string_view_literals;
+
+static constexpr std::int32_t EXIT_CODE_OK      = 0;
+static constexpr std::int32_t EXIT_CODE_FAILURE = 1;
+static constexpr std::int32_t EXIT_CODE_USAGE   = 2;
+
+// Sorted after the sysctl.d snippets of the distribution, so ours win
+static constexpr auto SYSCTL_CONF_PATH = "/etc/sysctl.d/99-cachyos-kernel-manager.conf"sv;
+
+/// Bootloader config, which holds the kernel command line.
+struct BootloaderConfig final {
+    std::string_view path{};
+    // shell variable with the command line, or empty if the whole file is the command line
+    std::string_view key{};
+    // regenerates the boot entries from the config
+    std::vector<std::string> regen_argv{};
+};
+
+auto get_bootloader_configs() noexcept -> std::vector<BootloaderConfig> {
+    return {
+        {.path = "/etc/sdboot-manage.conf"sv, .key = "LINUX_OPTIONS"sv, .regen_argv = {"sdboot-manage", "gen"}},
+        {.path = "/etc/default/grub"sv, .key = "GRUB_CMDLINE_LINUX_DEFAULT"sv, .regen_argv = {"grub-mkconfig", "-o", "/boot/grub/grub.cfg"}},
+        // picked up by kernel-install and mkinitcpio on the next kernel install
+        {.path = "/etc/kernel/cmdline"sv, .key = {}, .regen_argv = {}},
+    };
+}
+
+auto read_file(std::string_view file_path) noexcept -> std::string {
+    std::ifstream file_stream{std::string{file_path}};
+    return {std::istreambuf_iterator<char>{file_stream}, std::istreambuf_iterator<char>{}};
+}
+
+// Config is replaced atomically, the bootloader must never see a half-written one
+auto write_file_atomic(std::string_view file_path, std::string_view content) noexcept -> bool {
+    const auto& tmp_path = fmt::format("{}.new", file_path);
+    {
+        std::ofstream tmp_file{tmp_path, std::ios::trunc};
+        tmp_file << content;
+        if (!tmp_file.flush()) {
+            fmt::print(stderr, "[TUNABLES] failed to write {}\n", tmp_path);
+            return false;
+        }
+    }
+    std::error_code err{};
+    fs::rename(tmp_path, file_path, err);
+    if (err) {
+        fmt::print(stderr, "[TUNABLES] failed to write {}: {}\n", file_path, err.message());
+        return false;
+    }
+    return true;
+}
+
+template <typename Callback>
+void for_each_line(std::string_view content, Callback&& callback) noexcept {
+    std::size_t line_start{};
+    while (line_start < content.size()) {
+        auto line_end = content.find('\n', line_start);
+        if (line_end == std::string_view::npos) {
+            line_end = content.size();
+        }
+        callback(content.substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
+    }
+}
+
+// Rewrite every assignment of the key, everything else in the config is kept
+auto update_cmdline_assignment(std::string_view content, std::string_view key, std::span<const TunableValue> params) noexcept -> std::string {
+    std::string new_content{};
+    bool has_key{};
+
+    const auto& prefix = fmt::format("{}=", key);
+    for_each_line(content, [&](std::string_view line) {
+        if (!line.starts_with(prefix)) {
+            new_content += line;
+            new_content += '\n';
+            return;
+        }
+        auto value = line.substr(prefix.size());
+        if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front()) {
+            value = value.substr(1, value.size() - 2);
+        }
+        new_content += fmt::format("{}\"{}\"\n", prefix, update_cmdline(value, params));
+        has_key = true;
+    });
+    if (!has_key) {
+        new_content += fmt::format("{}\"{}\"\n", prefix, update_cmdline({}, params));
+    }
+    return new_content;
+}
+
+// Same as update_cmdline_assignment, but for "key = value" lines of sysctl.d
+auto update_sysctl_conf(std::string_view content, std::span<const TunableValue> sysctls) noexcept -> std::string {
+    std::string new_content{};
+    std::vector<bool> is_set(sysctls.size());
+
+    for_each_line(content, [&](std::string_view line) {
+        auto name = line.substr(0, line.find('='));
+        while (!name.empty() && name.back() == ' ') {
+            name.remove_suffix(1);
+        }
+        for (std::size_t i = 0; i < sysctls.size(); ++i) {
+            if (sysctls[i].name == name) {
+                /* clang-format off */
+                if (!is_set[i]) { new_content += fmt::format("{} = {}\n", sysctls[i].name, sysctls[i].value); }
+                /* clang-format on */
+                is_set[i] = true;
+                return;
+            }
+        }
+        new_content += line;
+        new_content += '\n';
+    });
+    for (std::size_t i = 0; i < sysctls.size(); ++i) {
+        if (!is_set[i]) {
+            new_content += fmt::format("{} = {}\n", sysctls[i].name, sysctls[i].value);
+        }
+    }
+    return new_content;
+}
+
+auto apply_tunables(std::span<const TunableValue> values) noexcept -> bool {
+    bool is_success{true};
+    for (auto&& [name, value] : values) {
+        const auto* tunable = find_tunable(name);
+        if (tunable->kind == TunableKind::BootParam) {
+            fmt::print("{} takes effect after reboot\n", name);
+            continue;
+        }
+
+        std::ofstream tunable_file{std::string{tunable->path}};
+        tunable_file << value;
+        if (!tunable_file.flush()) {
+            // e.g preempt= can't be changed, if debugfs isn't mounted or the kernel isn't built with PREEMPT_DYNAMIC
+            fmt::print(stderr, "[TUNABLES] failed to set {} in {}\n", name, tunable->path);
+            is_success = false;
+            continue;
+        }
+        fmt::print("{} is set to {}\n", name, value);
+    }
+    return is_success;
+}
+
+auto persist_cmdline(std::span<const TunableValue> params) noexcept -> bool {
+    /* clang-format off */
+    if (params.empty()) { return true; }
+    /* clang-format on */
+
+    bool is_found{};
+    bool is_success{true};
+    for (auto&& bootloader : get_bootloader_configs()) {
+        /* clang-format off */
+        if (!fs::exists(bootloader.path)) { continue; }
+        /* clang-format on */
+        is_found = true;
+
+        const auto& content     = read_file(bootloader.path);
+        const auto& new_content = bootloader.key.empty() ? update_cmdline(content, params) + '\n' : update_cmdline_assignment(content, bootloader.key, params);
+        if (!write_file_atomic(bootloader.path, new_content)) {
+            is_success = false;
+            continue;
+        }
+        if (!bootloader.regen_argv.empty()) {
+            const auto& result = utils::exec_argv(bootloader.regen_argv);
+            if (!result.is_success()) {
+                fmt::print(stderr, "[TUNABLES] '{}' failed: {}\n", bootloader.regen_argv[0], result.err);
+                is_success = false;
+                continue;
+            }
+        }
+        fmt::print("kernel command line is updated in {}\n", bootloader.path);
+    }
+    if (!is_found) {
+        fmt::print(stderr, "[TUNABLES] no supported bootloader config is found\n");
+        return false;
+    }
+    return is_success;
+}
+
+auto persist_sysctls(std::span<const TunableValue> sysctls) noexcept -> bool {
+    /* clang-format off */
+    if (sysctls.empty()) { return true; }
+    /* clang-format on */
+
+    if (!write_file_atomic(SYSCTL_CONF_PATH, update_sysctl_conf(read_file(SYSCTL_CONF_PATH), sysctls))) {
+        return false;
+    }
+    fmt::print("sysctl values are stored in {}\n", SYSCTL_CONF_PATH);
+    return true;
+}
+
+}  // namespace
+
+auto main(int argc, char** argv) -> std::int32_t {
+    bool is_apply{};
+    bool is_persist{};
+    std::vector<TunableValue> params{};
+    std::vector<TunableValue> sysctls{};
+    for (std::string_view arg : std::span{argv + 1, static_cast<std::size_t>(argc - 1)}) {
+        if (arg == "--apply"sv) {
+            is_apply = true;
+            continue;
+        }
+        if (arg == "--persist"sv) {
+            is_persist = true;
+            continue;
+        }
+        // The helper is reachable by pkexec, so we accept only known tunables with valid values
+        auto tunable_value = parse_tunable_arg(arg);
+        if (!tunable_value) {
+            fmt::print(stderr, "[TUNABLES] invalid argument: '{}'\n", arg);
+            return EXIT_CODE_USAGE;
+        }
+        auto& values = (find_tunable(tunable_value->name)->kind == TunableKind::Sysctl) ? sysctls : params;
+        values.emplace_back(std::move(*tunable_value));
+    }
+    if ((!is_apply && !is_persist) || (params.empty() && sysctls.empty())) {
+        fmt::print(stderr, "Usage: {} [--apply] [--persist] <name>=<value>...\n", argv[0]);
+        return EXIT_CODE_USAGE;
+    }
+    if (::geteuid() != 0) {
+        fmt::print(stderr, "[TUNABLES] the helper must be run as root\n");
+        return EXIT_CODE_FAILURE;
+    }
+
+    bool is_success{true};
+    if (is_apply) {
+        is_success &= apply_tunables(params);
+        is_success &= apply_tunables(sysctls);
+    }
+    if (is_persist) {
+        is_success &= persist_cmdline(params);
+        is_success &= persist_sysctls(sysctls);
+    }
+    return is_success ? EXIT_CODE_OK : EXIT_CODE_FAILURE;
+}
@@ -17,10 +17,11 @@
 // 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 
 #include "utils.hpp"
+#include "pkgbuilds_repo.hpp"
 
 #include <cerrno>   // for errno
 #include <cstdio>   // for fopen, fclose, fread, fseek, ftell, SEEK_END, SEEK_SET
-#include <cstdlib>  // for system
+#include <cstring>  // for strerror
 
 #include <filesystem>  // for exists
 #include <fstream>     // for ofstream
@@ -43,8 +44,6 @@
 
 #include <glib.h>
 
-#include <QProcess>
-
 #if defined(__clang__)
 #pragma clang diagnostic pop
 #elif defined(__GNUC__)
@@ -53,6 +52,14 @@
 
 namespace fs = std::filesystem;
 
+namespace {
+
+auto get_cachyos_pkgbuilds_repo() noexcept -> pkgbuilds::RepoSpec {
+    return pkgbuilds::RepoSpec{.path = utils::fix_path("~/.cache/cachyos-km/pkgbuilds"), .url = "https://github.com/cachyos/linux-cachyos.git"};
+}
+
+}  // namespace
+
 namespace utils {
 
 auto read_whole_file(std::string_view filepath) noexcept -> std::string {
@@ -91,27 +98,18 @@ bool write_to_file(std::string_view filepath, std::string_view data) noexcept {
     return true;
 }
 
-// https://github.com/sheredom/subprocess.h
-// https://gist.github.com/konstantint/d49ab683b978b3d74172
-// https://github.com/arun11299/cpp-subprocess/blob/master/subprocess.hpp#L1218
-// https://stackoverflow.com/questions/11342868/c-interface-for-interactive-bash
-// https://github.com/hniksic/rust-subprocess
 std::string exec(std::string_view command) noexcept {
-    // NOLINTNEXTLINE
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(command.data(), "r"), pclose);
-    if (!pipe) {
-        fmt::print(stderr, "popen failed! '{}'\n", command);
+    auto exec_result = utils::exec_argv({"/bin/sh", "-c", std::string{command}});
+    if (exec_result.status == -1) {
+        fmt::print(stderr, "exec failed! '{}'\n", command);
         return "-1";
     }
-
-    std::string result{};
-    std::array<char, 128> buffer{};
-    while (!feof(pipe.get())) {
-        if (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-            result += buffer.data();
-        }
+    // Keep stderr visible, as it was with popen
+    if (!exec_result.err.empty()) {
+        fmt::print(stderr, "{}", exec_result.err);
     }
 
+    auto result = std::move(exec_result.out);
     if (result.ends_with('\n')) {
         result.pop_back();
     }
@@ -119,21 +117,6 @@ std::string exec(std::string_view command) noexcept {
     return result;
 }
 
-int runCmdTerminal(QString cmd, bool escalate) noexcept {
-    QProcess proc;
-    cmd += "; read -p 'Press enter to exit'";
-    auto paramlist = QStringList();
-    if (escalate) {
-        paramlist << "-s"
-                  << "pkexec /usr/lib/cachyos-kernel-manager/rootshell.sh";
-    }
-    paramlist << cmd;
-
-    proc.start("/usr/lib/cachyos-kernel-manager/terminal-helper", paramlist);
-    proc.waitForFinished(-1);
-    return proc.exitCode();
-}
-
 std::string fix_path(std::string&& path) noexcept {
     /* clang-format off */
     if (path[0] != '~') { return std::move(path); }
@@ -142,57 +125,20 @@ std::string fix_path(std::string&& path) noexcept {
     return std::move(path);
 }
 
-void prepare_build_environment() noexcept {
-    static const fs::path app_path       = utils::fix_path("~/.cache/cachyos-km");
-    static const fs::path pkgbuilds_path = utils::fix_path("~/.cache/cachyos-km/pkgbuilds");
-    if (!fs::exists(app_path)) {
-        fs::create_directories(app_path);
-    }
-
-    fs::current_path(app_path);
-
-    // Check if folder exits, but .git doesn't.
-    if (fs::exists(pkgbuilds_path) && !fs::exists(pkgbuilds_path / ".git")) {
-        fs::remove_all(pkgbuilds_path);
-    }
-
-    std::int32_t cmd_status{};
-    if (!fs::exists(pkgbuilds_path)) {
-        cmd_status = std::system("git clone https://github.com/cachyos/linux-cachyos.git pkgbuilds");
+bool prepare_build_environment() noexcept {
+    const auto& pkgbuilds_repo = get_cachyos_pkgbuilds_repo();
+    if (!pkgbuilds::sync_repo(pkgbuilds_repo)) {
+        fmt::print(stderr, "[PREPAREBUILDENV] failed to prepare '{}'\n", pkgbuilds_repo.path.string());
+        return false;
     }
 
-    fs::current_path(pkgbuilds_path);
-    cmd_status += std::system("git checkout --force master");
-    cmd_status += std::system("git clean -fd");
-    cmd_status += std::system("git pull");
-    if (cmd_status != 0) {
-        std::perror("prepare_build_environment");
-    }
+    std::error_code err_code{};
+    fs::current_path(pkgbuilds_repo.path, err_code);
+    return !err_code;
 }
 
-void restore_clean_environment(std::vector<std::string>& previously_set_options, std::string_view all_set_values) noexcept {
-    // Unset env variables before appplying new ones.
-    for (auto&& previous_option : previously_set_options) {
-        if (unsetenv(previous_option.c_str()) != 0) {
-            fmt::print(stderr, "Cannot unset environment variable!: {}\n", std::strerror(errno));
-        }
-    }
-    previously_set_options.clear();
-
-    auto set_values_list = utils::make_split_view(all_set_values, '\n');
-    for (auto&& expr : set_values_list) {
-        auto expr_split = utils::make_multiline(std::move(expr), '=');
-        auto var_name   = expr_split[0];
-
-        const auto& var_val = expr_split[1];
-        if (::setenv(var_name.c_str(), var_val.c_str(), 1) != 0) {
-            fmt::print(stderr, "Cannot set environment variable!: {}\n", std::strerror(errno));
-            continue;
-        }
-
-        // Save env name to unset it before running the next compilation.
-        previously_set_options.emplace_back(std::move(var_name));
-    }
+bool sync_build_environment() noexcept {
+    return pkgbuilds::sync_repo(get_cachyos_pkgbuilds_repo());
 }
 
 }  // namespace utils
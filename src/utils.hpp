@@ -20,6 +20,7 @@
 #define UTILS_HPP
 
 #include "alpm_utils.hpp"
+#include "process_utils.hpp"
 #include "string_utils.hpp"
 
 #include <string>       // for string
@@ -51,14 +52,16 @@ namespace utils {
 
 [[nodiscard]] auto read_whole_file(std::string_view filepath) noexcept -> std::string;
 bool write_to_file(std::string_view filepath, std::string_view data) noexcept;
+// Runs the command through the shell, returns its stdout without trailing newline, or "-1" on failure.
+// Prefer utils::exec_argv, when the shell isn't needed.
 std::string exec(std::string_view command) noexcept;
 [[nodiscard]] std::string fix_path(std::string&& path) noexcept;
 
-// Runs a command in a terminal, escalates using pkexec if escalate is true
-int runCmdTerminal(QString cmd, bool escalate) noexcept;
-
-void prepare_build_environment() noexcept;
-void restore_clean_environment(std::vector<std::string>& previously_set_options, std::string_view all_set_values) noexcept;
+// Updates the linux-cachyos PKGBUILDs checkout, and changes the working directory into it
+bool prepare_build_environment() noexcept;
+// Updates the linux-cachyos PKGBUILDs checkout, without changing the working directory.
+// NOTE: it blocks on the network, run it in the background and wait for it before the exit.
+bool sync_build_environment() noexcept;
 
 }  // namespace utils
 